@@ -0,0 +1,310 @@
+/*****************************************************************************
+* FILENAME: Storage_Flash.c                                                  *
+*                                                                            *
+* DESCRIPTION: Simple persistent storage of small records in flash, using    *
+*              the Nordic Flash Data Storage (fds) library. Shared by the    *
+*              glove and the vehicle BLE boards.                             *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+* CREDITS: The following were used as starting points:                       *
+*     Nordic SDK Flash Data Storage:                                         *
+*         Link: https://infocenter.nordicsemi.com/topic/                     *
+*               com.nordic.infocenter.sdk5.v12.0.0/lib_fds_usage.html        *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Storage_Flash.h"
+
+#include <string.h>
+
+// Include the NordicSDK
+#include "NordicSDK.h"
+
+// Constants
+#define BYTES_PER_WORD  4
+#define MAX_RECORD_WORDS ((STORAGE_FLASH_MAX_RECORD_BYTES + BYTES_PER_WORD - 1) / BYTES_PER_WORD)
+
+// A record waiting to be written. fds does not copy the data, so it is
+// kept here until the write is complete.
+typedef struct
+{
+    bool        inUse;      // The slot holds a record that has not been written yet
+    bool        pendingGC;  // The write is waiting for garbage collection to finish
+    uint16_t    key;        // The key of the record
+    uint16_t    words;      // The length of the record in words
+    uint32_t    data[MAX_RECORD_WORDS]; // The record (word aligned for fds)
+} WriteSlot_t;
+
+// Private functions
+static void pStorageEventHandler(fds_evt_t const * const event); // Handles fds events
+static uint32_t pStartWrite(WriteSlot_t * slot); // Passes a slot to fds
+static uint16_t pLengthInWords(uint16_t length); // Rounds a byte length up to words
+
+// Private variables
+static volatile bool mInitialized = false; // fds is ready
+static WriteSlot_t mWriteSlots[STORAGE_FLASH_WRITE_SLOTS]; // Writes in progress
+static fds_record_chunk_t mChunks[STORAGE_FLASH_WRITE_SLOTS]; // The fds chunk of each slot
+static bool mGarbageCollecting = false; // fds_gc is in progress
+
+/*****************************************************************************
+ * Description: Initializes the storage and waits for the flash storage to   *
+ *              be ready. Must be called after the SoftDevice is enabled, as *
+ *              flash operations complete on SoftDevice system events. On    *
+ *              the glove, it can be called before or after the peer manager *
+ *              is set up.                                                   *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Storage_Flash_Init()
+{
+    ret_code_t err_code;
+
+    // Register first, so that we are told when fds is ready. If the glove's
+    // peer manager has already initialized fds, fds_init notifies us right
+    // away.
+    err_code = fds_register(pStorageEventHandler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = fds_init();
+    APP_ERROR_CHECK(err_code);
+
+    // The first start up formats the flash pages, which completes on
+    // SoftDevice system events.
+    while(!mInitialized)
+    {
+        err_code = sd_app_evt_wait();
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+/*****************************************************************************
+ * Description: Reads a record from flash.                                   *
+ *                                                                           *
+ * Returns: true if the record exists and is exactly 'length' bytes long     *
+ *          (rounded up to 4 byte words), otherwise false                    *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  key    - The key of the record (STORAGE_FLASH_KEY_...)                   *
+ *  data   - Where to place the record                                       *
+ *  length - The length of the record in bytes                               *
+ *                                                                           *
+ *****************************************************************************/
+bool Storage_Flash_Read(uint16_t key, void * data, uint16_t length)
+{
+    fds_record_desc_t  descriptor;
+    fds_find_token_t   token;
+    fds_flash_record_t record;
+    bool found = false;
+
+    memset(&token, 0x00, sizeof(token));
+    if(fds_record_find(STORAGE_FLASH_FILE_ID, key, &descriptor, &token) != FDS_SUCCESS)
+    {
+        return false;
+    }
+
+    if(fds_record_open(&descriptor, &record) != FDS_SUCCESS)
+    {
+        return false;
+    }
+
+    // A record of a different length is from an older layout
+    if(record.p_header->tl.length_words == pLengthInWords(length))
+    {
+        memcpy(data, record.p_data, length);
+        found = true;
+    }
+
+    APP_ERROR_CHECK(fds_record_close(&descriptor));
+    return found;
+}
+
+/*****************************************************************************
+ * Description: Writes a record to flash, replacing the existing one. This   *
+ *              returns without waiting for the flash write; the data is     *
+ *              copied, so it does not need to remain valid. If the flash is *
+ *              full, it is garbage collected and the write is retried.      *
+ *                                                                           *
+ * Returns: NRF_SUCCESS, NRF_ERROR_INVALID_LENGTH if the record is too long, *
+ *          NRF_ERROR_BUSY if all write slots are in use, or an fds error    *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  key    - The key of the record (STORAGE_FLASH_KEY_...)                   *
+ *  data   - The record                                                      *
+ *  length - The length of the record in bytes                               *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t Storage_Flash_Write(uint16_t key, const void * data, uint16_t length)
+{
+    if(length == 0 || length > STORAGE_FLASH_MAX_RECORD_BYTES)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    // Find a free slot
+    WriteSlot_t * slot = NULL;
+    CRITICAL_REGION_ENTER();
+    for(uint8_t i = 0; i < STORAGE_FLASH_WRITE_SLOTS; i++)
+    {
+        if(!mWriteSlots[i].inUse)
+        {
+            slot = &mWriteSlots[i];
+            slot->inUse = true;
+            break;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    if(slot == NULL)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    slot->key = key;
+    slot->words = pLengthInWords(length);
+    slot->pendingGC = false;
+    memset(slot->data, 0x00, sizeof(slot->data));
+    memcpy(slot->data, data, length);
+
+    uint32_t err_code = pStartWrite(slot);
+    if(err_code != NRF_SUCCESS)
+    {
+        slot->inUse = false;
+    }
+    return err_code;
+}
+
+/*****************************************************************************
+ * Description: Passes a slot to fds, as an update of the existing record if *
+ *              there is one. If the flash is full, garbage collection is    *
+ *              started and the slot is written once it is done.             *
+ *                                                                           *
+ * Returns: NRF_SUCCESS or an fds error                                      *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  slot - The slot to write                                                 *
+ *****************************************************************************/
+static uint32_t pStartWrite(WriteSlot_t * slot)
+{
+    uint8_t index = (uint8_t)(slot - mWriteSlots);
+    fds_record_t      record;
+    fds_record_desc_t descriptor;
+    fds_find_token_t  token;
+    ret_code_t        err_code;
+
+    mChunks[index].p_data       = slot->data;
+    mChunks[index].length_words = slot->words;
+
+    record.file_id          = STORAGE_FLASH_FILE_ID;
+    record.key.record_key   = slot->key;
+    record.data.p_chunks    = &mChunks[index];
+    record.data.num_chunks  = 1;
+
+    memset(&token, 0x00, sizeof(token));
+    if(fds_record_find(STORAGE_FLASH_FILE_ID, slot->key, &descriptor, &token) == FDS_SUCCESS)
+    {
+        err_code = fds_record_update(&descriptor, &record);
+    }
+    else
+    {
+        err_code = fds_record_write(&descriptor, &record);
+    }
+
+    if(err_code == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        // Reclaim the space of deleted and updated records, then try again
+        slot->pendingGC = true;
+        if(!mGarbageCollecting)
+        {
+            mGarbageCollecting = true;
+            err_code = fds_gc();
+            if(err_code != FDS_SUCCESS)
+            {
+                mGarbageCollecting = false;
+                slot->pendingGC = false;
+                return err_code;
+            }
+        }
+        return NRF_SUCCESS;
+    }
+
+    return err_code;
+}
+
+/*****************************************************************************
+ * Description: Handles fds events. Frees write slots once their record is   *
+ *              in flash, and retries writes after garbage collection.       *
+ *****************************************************************************/
+static void pStorageEventHandler(fds_evt_t const * const event)
+{
+    switch(event->id)
+    {
+        case FDS_EVT_INIT:
+            if(event->result == FDS_SUCCESS)
+            {
+                mInitialized = true;
+            }
+            else
+            {
+                APP_ERROR_CHECK(event->result);
+            }
+            break;
+
+        case FDS_EVT_WRITE:
+        case FDS_EVT_UPDATE:
+            // Events are sent to every fds user, so only handle our file
+            if(event->write.file_id == STORAGE_FLASH_FILE_ID)
+            {
+                for(uint8_t i = 0; i < STORAGE_FLASH_WRITE_SLOTS; i++)
+                {
+                    if(mWriteSlots[i].inUse && !mWriteSlots[i].pendingGC &&
+                       mWriteSlots[i].key == event->write.record_key)
+                    {
+                        mWriteSlots[i].inUse = false;
+                        break;
+                    }
+                }
+            }
+            break;
+
+        case FDS_EVT_GC:
+            mGarbageCollecting = false;
+            for(uint8_t i = 0; i < STORAGE_FLASH_WRITE_SLOTS; i++)
+            {
+                if(mWriteSlots[i].inUse && mWriteSlots[i].pendingGC)
+                {
+                    mWriteSlots[i].pendingGC = false;
+                    if(pStartWrite(&mWriteSlots[i]) != NRF_SUCCESS)
+                    {
+                        // Still no room, the record is lost
+                        mWriteSlots[i].inUse = false;
+                    }
+                }
+            }
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+/*****************************************************************************
+ * Description: Rounds a length in bytes up to a length in 4 byte words      *
+ *****************************************************************************/
+static uint16_t pLengthInWords(uint16_t length)
+{
+    return (length + BYTES_PER_WORD - 1) / BYTES_PER_WORD;
+}
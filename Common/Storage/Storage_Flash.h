@@ -0,0 +1,82 @@
+/*****************************************************************************
+* FILENAME: Storage_Flash.h                                                  *
+*                                                                            *
+* DESCRIPTION: Simple persistent storage of small records in flash, using    *
+*              the Nordic Flash Data Storage (fds) library. Shared by the    *
+*              glove and the vehicle BLE boards; each one has its own        *
+*              Storage_Config.h in its Storage folder.                       *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Flex calibration records            |  *
+* | @02     | 17Oct26  | BNordland  | Vehicle address record              |  *
+* | @03     | 17Oct26  | BNordland  | Shared with the vehicle, see        |  *
+* |         |          |            | Storage_Config.h                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef STORAGE_FLASH_H__
+#define STORAGE_FLASH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The file ID, the record keys, the largest record and the number of
+// write slots are set by each application, see Storage_Config.h
+#include "Storage_Config.h"
+
+/*****************************************************************************
+ * Description: Initializes the storage and waits for the flash storage to   *
+ *              be ready. Must be called after the SoftDevice is enabled, as *
+ *              flash operations complete on SoftDevice system events. On    *
+ *              the glove, it can be called before or after the peer manager *
+ *              is set up.                                                   *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Storage_Flash_Init();
+
+/*****************************************************************************
+ * Description: Reads a record from flash.                                   *
+ *                                                                           *
+ * Returns: true if the record exists and is exactly 'length' bytes long     *
+ *          (rounded up to 4 byte words), otherwise false                    *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  key    - The key of the record (STORAGE_FLASH_KEY_...)                   *
+ *  data   - Where to place the record                                       *
+ *  length - The length of the record in bytes                               *
+ *                                                                           *
+ *****************************************************************************/
+bool Storage_Flash_Read(uint16_t key, void * data, uint16_t length);
+
+/*****************************************************************************
+ * Description: Writes a record to flash, replacing the existing one. This   *
+ *              returns without waiting for the flash write; the data is     *
+ *              copied, so it does not need to remain valid. If the flash is *
+ *              full, it is garbage collected and the write is retried.      *
+ *                                                                           *
+ * Returns: NRF_SUCCESS, NRF_ERROR_INVALID_LENGTH if the record is too long, *
+ *          NRF_ERROR_BUSY if all write slots are in use, or an fds error    *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  key    - The key of the record (STORAGE_FLASH_KEY_...)                   *
+ *  data   - The record                                                      *
+ *  length - The length of the record in bytes                               *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t Storage_Flash_Write(uint16_t key, const void * data, uint16_t length);
+
+#endif /* STORAGE_FLASH_H__ */
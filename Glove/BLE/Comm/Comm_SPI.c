@@ -15,6 +15,8 @@
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 08Apr17  | BNordland  | Initial creation                    |  *
 * | @01     | 09Apr17  | BNordland  | Allow write only mode               |  *
+* | @02     | 16Oct26  | BNordland  | Added burst read                    |  *
+* | @03     | 16Oct26  | BNordland  | Asynchronous transaction queue      |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
@@ -28,15 +30,25 @@
 
 // Function Definitions
 void pSPIEventHandler(nrf_drv_spi_evt_t const * p_event); // Handles events from SPI driver
+static void pStartTransaction(Comm_SPI_Transaction_t * transaction); // @03a Starts a transaction on the driver
+static void pRunBlocking(Comm_SPI_Transaction_t * transaction); // @03a Schedules a transaction and waits for it
+static void pBlockingComplete(Comm_SPI_Transaction_t * transaction); // @03a Callback of the blocking functions
 
 
 // SPI Variables
 static const nrf_drv_spi_t mSpi = NRF_DRV_SPI_INSTANCE(0);  // Initialize SPI instance 0
 static volatile bool mSPITransferComplete;  // Indicates of a SPI transfer is complete
 
-// Transmit and receive buffers
-static uint8_t  mTxBuffer[16];
-static uint8_t  mRxBuffer[16];
+// @03a Transaction queue. mQueueHead is the transaction on the bus (if any),
+// the rest are waiting in order.
+static Comm_SPI_Transaction_t * volatile mQueueHead = NULL;
+static Comm_SPI_Transaction_t * volatile mQueueTail = NULL;
+
+// @03c Receive buffer for the blocking functions, which return only the
+// bytes after the ones transmitted. The transmit data is given to the driver
+// directly (it clocks out the over-read character after it), so there is no
+// transmit buffer, and neither buffer needs to be cleared on each call.
+static uint8_t  mRxBuffer[COMM_SPI_MAX_TRANSFER_BYTES];
 
 /*****************************************************************************
  * Description: Initializes the SPI interface to be ready for data transfer  *
@@ -69,48 +81,191 @@ void Comm_SPI_Init()
  *                                                                           *
  * Parameters:                                                               *
  *     txBuffer* - A byte buffer of bytes to transmit                        *
- *     txBytes   - Number of bytes to transmit (max 8)                       *
+ *     txBytes   - Number of bytes to transmit                               *
  *     rxBuffer* - A byte buffer of bytes to receive                         *
- *     rxBytes   - Number of bytes to receive (max 8)                        *
+ *     rxBytes   - Number of bytes to receive                                *
+ *                 @03c txBytes + rxBytes must not be more than              *
+ *                 COMM_SPI_MAX_TRANSFER_BYTES                               *
  *                                                                           *
  *****************************************************************************/
 void Comm_SPI_Transfer(uint8_t * txBuffer, uint8_t txBytes, uint8_t * rxBuffer, uint8_t rxBytes)
 {
-    if(txBytes <= 8 && rxBytes <= 8)
+    // @03c Report transfers that are too long instead of dropping them
+    if(((uint16_t)txBytes + rxBytes) > COMM_SPI_MAX_TRANSFER_BYTES)
+    {
+        APP_ERROR_CHECK(NRF_ERROR_INVALID_LENGTH);
+        return;
+    }
+
+    Comm_SPI_Transaction_t transaction =
+    {
+        .txBuffer = txBuffer,
+        .txBytes  = txBytes,
+        .rxBuffer = (rxBytes > 0) ? mRxBuffer : NULL,
+        .rxBytes  = (rxBytes > 0) ? (txBytes + rxBytes) : 0,
+    };
+    pRunBlocking(&transaction);
+
+    if(rxBytes > 0) // @01a - check before copying that we have at least 1 byte of received data
+    {
+        // copy from our static buffer into the receive buffer
+        memcpy(rxBuffer, &mRxBuffer[txBytes],rxBytes);
+    }
+}
+
+/*****************************************************************************
+ * Description: Transmits a single command byte and then receives rxBytes    *
+ *              in the same chip select window. This is used to read a       *
+ *              block of consecutive registers from a device that supports   *
+ *              address auto-increment in one transaction.              @02a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *     command   - The command byte to transmit (i.e. read + start address)  *
+ *     rxBuffer* - A byte buffer of bytes to receive                         *
+ *     rxBytes   - Number of bytes to receive                                *
+ *                 (max COMM_SPI_MAX_BURST_BYTES)                            *
+ *                                                                           *
+ *****************************************************************************/
+void Comm_SPI_ReadBurst(uint8_t command, uint8_t * rxBuffer, uint8_t rxBytes)
+{
+    if(rxBytes == 0 || rxBytes > COMM_SPI_MAX_BURST_BYTES)
     {
-        mSPITransferComplete = false;
+        APP_ERROR_CHECK(NRF_ERROR_INVALID_LENGTH);
+        return;
+    }
 
-        // Use static variables that are double our max size of both to handle SPI
-        // transmit structure.
-        memset(mTxBuffer, 0x00, sizeof(mTxBuffer));
-        memset(mRxBuffer, 0x00, sizeof(mRxBuffer));
+    // @03c The tx byte only has to remain valid until the transfer is done,
+    // and we block until then.
+    Comm_SPI_Transaction_t transaction =
+    {
+        .txBuffer = &command,
+        .txBytes  = 1,
+        .rxBuffer = mRxBuffer,
+        .rxBytes  = rxBytes + 1,
+    };
+    pRunBlocking(&transaction);
 
-        // copy the tx buffer
-        memcpy(mTxBuffer, txBuffer, txBytes);
+    // skip the byte that was received during the command byte
+    memcpy(rxBuffer, &mRxBuffer[1], rxBytes);
+}
 
-        APP_ERROR_CHECK(nrf_drv_spi_transfer(&mSpi, mTxBuffer, (txBytes+rxBytes), mRxBuffer, (txBytes+rxBytes)));
+/*****************************************************************************
+ * Description: Adds a transaction to the end of the queue and returns       *
+ *              without waiting. Transactions are run back to back from the  *
+ *              SPI interrupt, and the callback of each one is called from   *
+ *              the SPI interrupt once it is complete. A callback may        *
+ *              schedule further transactions, including itself.             *
+ *              This can be called from any context.                    @03a *
+ *                                                                           *
+ * Returns: NRF_SUCCESS, or NRF_ERROR_INVALID_LENGTH if the transaction is   *
+ *          empty or longer than COMM_SPI_MAX_TRANSFER_BYTES                 *
+ *                                                                           *
+ * Parameters:                                                               *
+ *     transaction* - The transaction to run. Owned by the caller, and must  *
+ *                    not be changed until its callback is called.           *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t Comm_SPI_Schedule(Comm_SPI_Transaction_t * transaction)
+{
+    if((transaction->txBytes == 0 && transaction->rxBytes == 0) ||
+       transaction->txBytes > COMM_SPI_MAX_TRANSFER_BYTES ||
+       transaction->rxBytes > COMM_SPI_MAX_TRANSFER_BYTES)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
 
-        // wait for the transfer to be complete
-        while(!mSPITransferComplete)
-        {
-            __WFE();
-        }
+    bool start = false;
+    transaction->next = NULL;
 
-        if(rxBytes > 0) // @01a - check before copying that we have at least 1 byte of received data
-        {
-            // copy from our static buffer into the receive buffer
-            memcpy(rxBuffer, &mRxBuffer[txBytes],rxBytes);
-        }
+    CRITICAL_REGION_ENTER();
+    if(mQueueHead == NULL)
+    {
+        // The bus is idle, so this transaction goes straight on to it
+        mQueueHead = transaction;
+        start = true;
+    }
+    else
+    {
+        mQueueTail->next = transaction;
     }
-    // TODO: we should throw an error here in the else clause
+    mQueueTail = transaction;
+    CRITICAL_REGION_EXIT();
+
+    if(start)
+    {
+        pStartTransaction(transaction);
+    }
+
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+ * Description: Starts a transaction on the SPI driver.                 @03a *
+ *****************************************************************************/
+static void pStartTransaction(Comm_SPI_Transaction_t * transaction)
+{
+    APP_ERROR_CHECK(nrf_drv_spi_transfer(&mSpi,
+                                         transaction->txBuffer, transaction->txBytes,
+                                         transaction->rxBuffer, transaction->rxBytes));
 }
 
+/*****************************************************************************
+ * Description: Schedules a transaction and sleeps until it is complete.     *
+ *              Used by the blocking functions.                         @03a *
+ *****************************************************************************/
+static void pRunBlocking(Comm_SPI_Transaction_t * transaction)
+{
+    mSPITransferComplete = false;
+    transaction->callback = pBlockingComplete;
+
+    APP_ERROR_CHECK(Comm_SPI_Schedule(transaction));
+
+    // wait for the transfer to be complete
+    while(!mSPITransferComplete)
+    {
+        __WFE();
+    }
+}
+
+/*****************************************************************************
+ * Description: Completion callback of the blocking functions.          @03a *
+ *****************************************************************************/
+static void pBlockingComplete(Comm_SPI_Transaction_t * transaction)
+{
+    mSPITransferComplete = true;
+}
 
 /*****************************************************************************
  * Description: Handles events from SPI driver. Used to indicate transmit is *
  *              complete.                                                    *
+ *              @03c Starts the next queued transaction before calling the   *
+ *              callback of the finished one, so the bus is kept busy while  *
+ *              the callback runs.                                           *
  *****************************************************************************/
 void pSPIEventHandler(nrf_drv_spi_evt_t const * p_event)
 {
-    mSPITransferComplete = true;
+    Comm_SPI_Transaction_t * done;
+    Comm_SPI_Transaction_t * next;
+
+    CRITICAL_REGION_ENTER();
+    done = mQueueHead;
+    next = (done != NULL) ? done->next : NULL;
+    mQueueHead = next;
+    if(next == NULL)
+    {
+        mQueueTail = NULL;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if(next != NULL)
+    {
+        pStartTransaction(next);
+    }
+
+    if(done != NULL && done->callback != NULL)
+    {
+        done->callback(done);
+    }
 }
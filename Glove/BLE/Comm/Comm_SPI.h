@@ -14,6 +14,8 @@
 * | Flag    | (DDMYY)  | Author     | Description                         |  *
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 08Apr17  | BNordland  | Initial creation                    |  *
+* | @01     | 16Oct26  | BNordland  | Added burst read                    |  *
+* | @02     | 16Oct26  | BNordland  | Asynchronous transaction queue      |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
@@ -22,6 +24,35 @@
 
 #include <stdint.h>
 
+// @02a The maximum length of a single transaction (command + data). The SPI
+// driver on the nRF51 takes 8 bit lengths, so this can be at most 255.
+#ifndef COMM_SPI_MAX_TRANSFER_BYTES
+    #define COMM_SPI_MAX_TRANSFER_BYTES 255
+#endif
+
+// The maximum number of bytes that can be read in a single burst @01a
+// @02c One byte of the transaction is used by the command byte
+#define COMM_SPI_MAX_BURST_BYTES (COMM_SPI_MAX_TRANSFER_BYTES - 1)
+
+// @02a A single chip select window on the SPI bus. The buffers are owned by
+// the caller and must stay valid until the callback is called.
+// The transfer is full duplex and is max(txBytes, rxBytes) long:
+//  - txBuffer is clocked out first, followed by 0xFF filler bytes
+//  - rxBuffer receives every byte from the start of the transfer, so when
+//    reading a device the first bytes are those received during the command.
+typedef struct Comm_SPI_Transaction_s Comm_SPI_Transaction_t;
+typedef void (*Comm_SPI_Callback_t)(Comm_SPI_Transaction_t * transaction);
+struct Comm_SPI_Transaction_s
+{
+    const uint8_t *         txBuffer;   // Bytes to transmit (may be NULL if txBytes is 0)
+    uint8_t                 txBytes;    // Number of bytes to transmit
+    uint8_t *               rxBuffer;   // Where to place received bytes (may be NULL if rxBytes is 0)
+    uint8_t                 rxBytes;    // Number of bytes to receive
+    Comm_SPI_Callback_t     callback;   // Called from the SPI interrupt when complete (may be NULL)
+    void *                  context;    // Free for use by the owner of the transaction
+    Comm_SPI_Transaction_t* next;       // Used by the queue, do not modify while scheduled
+};
+
 /*****************************************************************************
  * Description: Initializes the SPI interface to be ready for data transfer  *
  *                                                                           *
@@ -46,12 +77,54 @@ void Comm_SPI_Init();
  *                                                                           *
  * Parameters:                                                               *
  *     txBuffer* - A byte buffer of bytes to transmit                        *
- *     txBytes   - Number of bytes to transmit (max 8)                       *
+ *     txBytes   - Number of bytes to transmit                               *
  *     rxBuffer* - A byte buffer of bytes to receive                         *
- *     rxBytes   - Number of bytes to receive (max 8)                        *
+ *     rxBytes   - Number of bytes to receive                                *
+ *                 @02c txBytes + rxBytes must not be more than              *
+ *                 COMM_SPI_MAX_TRANSFER_BYTES                               *
  *                                                                           *
  *****************************************************************************/
 void Comm_SPI_Transfer(uint8_t * txBuffer, uint8_t txBytes, uint8_t * rxBuffer, uint8_t rxBytes);
 
+/*****************************************************************************
+ * Description: Transmits a single command byte and then receives rxBytes    *
+ *              in the same chip select window. This is used to read a       *
+ *              block of consecutive registers from a device that supports   *
+ *              address auto-increment in one transaction.              @01a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *     command   - The command byte to transmit (i.e. read + start address)  *
+ *     rxBuffer* - A byte buffer of bytes to receive                         *
+ *     rxBytes   - Number of bytes to receive                                *
+ *                 (max COMM_SPI_MAX_BURST_BYTES)                            *
+ *                                                                           *
+ *****************************************************************************/
+void Comm_SPI_ReadBurst(uint8_t command, uint8_t * rxBuffer, uint8_t rxBytes);
+
+/*****************************************************************************
+ * Description: Adds a transaction to the end of the queue and returns       *
+ *              without waiting. Transactions are run back to back from the  *
+ *              SPI interrupt, and the callback of each one is called from   *
+ *              the SPI interrupt once it is complete. A callback may        *
+ *              schedule further transactions, including itself.             *
+ *              This can be called from any context.                    @02a *
+ *                                                                           *
+ *              Note: The blocking functions above are built on this queue,  *
+ *                    so they must not be called from a callback (or any     *
+ *                    other interrupt at the SPI priority) as they would     *
+ *                    never see their transfer complete.                     *
+ *                                                                           *
+ * Returns: NRF_SUCCESS, or NRF_ERROR_INVALID_LENGTH if the transaction is   *
+ *          empty or longer than COMM_SPI_MAX_TRANSFER_BYTES                 *
+ *                                                                           *
+ * Parameters:                                                               *
+ *     transaction* - The transaction to run. Owned by the caller, and must  *
+ *                    not be changed until its callback is called.           *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t Comm_SPI_Schedule(Comm_SPI_Transaction_t * transaction);
+
 
 #endif /* _ COMM_SPI_H__ */
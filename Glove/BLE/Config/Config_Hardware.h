@@ -15,6 +15,8 @@
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 07Apr17  | BNordland  | Initial creation                    |  *
 * | @01     | 10Apr17  | BNordland  | Added flex sensor pins              |  *
+* | @02     | 16Oct26  | BNordland  | Added accelerometer INT1 pin        |  *
+* | @03     | 17Oct26  | BNordland  | Added flex sensor channel table     |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
@@ -45,6 +47,23 @@
     #define HDW_CONFIG_THROTTLE_FLEX_ADC_PIN ADC_CONFIG_PSEL_AnalogInput6
 #endif
 
+// The flex sensors, in the order of Sensors_Flex_Channel_t. Each ADC channel
+// is scanned in turn, and its sensor is powered from the pin at the same
+// position in HDW_CONFIG_FLEX_VIN_PINS. To add a sensor, add it to both
+// tables and to Sensors_Flex_Channel_t. @03a
+#ifndef HDW_CONFIG_FLEX_ADC_CHANNELS
+    #define HDW_CONFIG_FLEX_ADC_CHANNELS                                \
+    {                                                                   \
+        NRF_DRV_ADC_DEFAULT_CHANNEL(HDW_CONFIG_THROTTLE_FLEX_ADC_PIN),  \
+        NRF_DRV_ADC_DEFAULT_CHANNEL(HDW_CONFIG_DIR_FLEX_ADC_PIN)        \
+    }
+    #define HDW_CONFIG_FLEX_VIN_PINS                                    \
+    {                                                                   \
+        HDW_CONFIG_THROTTLE_FLEX_VIN_PIN,                               \
+        HDW_CONFIG_DIR_FLEX_VIN_PIN                                     \
+    }
+#endif
+
 // The location of the SPI PINs
 // according the the BLE NANO pinout guide: http://redbearlab.com/blenano/
 // P10: CS   (Slave Select)
@@ -63,3 +82,8 @@
 #ifndef HDW_CONFIG_SPI_SCK_PIN
     #define HDW_CONFIG_SPI_SCK_PIN 8
 #endif
+
+// The location of the accelerometer INT1 pin (data ready/FIFO watermark) @02a
+#ifndef HDW_CONFIG_ACCEL_INT1_PIN
+    #define HDW_CONFIG_ACCEL_INT1_PIN 6
+#endif
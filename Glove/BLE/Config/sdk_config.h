@@ -24,6 +24,10 @@
 * | @01     | 14Apr17  | BNordland  | Enable ADC                      | *
 * | @02     | 18Apr17  | BNordland  | Making connection interval      | *
 * |         |          |            | updates.                        | *
+* | @03     | 17Oct26  | BNordland  | Enable TIMER1 and PPI for the   | *
+* |         |          |            | flex sensor ADC scan            | *
+* | @04     | 17Oct26  | BNordland  | Connect with the drive profile  | *
+* | @05     | 17Oct26  | BNordland  | Fast then slow advertising      | *
 *  -------------------------------------------------------------------  *
 *************************************************************************/
 
@@ -33,10 +37,12 @@
 #define IS_SRVC_CHANGED_CHARACT_PRESENT  1                                          /**< Include or not the service_changed characteristic. if not enabled, the server's database cannot be changed for the lifetime of the device*/
 
 #define APP_ADV_INTERVAL                 50                                         /**< The advertising interval (in units of 0.625 ms. This value corresponds to 25 ms). */
-#define APP_ADV_TIMEOUT_IN_SECONDS       180                                        /**< The advertising timeout in units of seconds. */
+#define APP_ADV_TIMEOUT_IN_SECONDS       30                                         /** @05c The fast advertising timeout in units of seconds, then slow advertising starts. */
+#define APP_ADV_SLOW_INTERVAL            800                                        /** @05a The slow advertising interval (in units of 0.625 ms. This value corresponds to 500 ms). */
+#define APP_ADV_SLOW_TIMEOUT_IN_SECONDS  150                                        /** @05a The slow advertising timeout in units of seconds, then the glove waits for motion in system off. */
 
-#define MIN_CONN_INTERVAL                MSEC_TO_UNITS(20, UNIT_1_25_MS)            /** @02c Minimum acceptable connection interval. */
-#define MAX_CONN_INTERVAL                MSEC_TO_UNITS(75, UNIT_1_25_MS)            /** @02c Maximum acceptable connection interval. */
+#define MIN_CONN_INTERVAL                MSEC_TO_UNITS(7.5, UNIT_1_25_MS)           /** @04c Minimum acceptable connection interval (drive profile, see Service_Profile.h). */
+#define MAX_CONN_INTERVAL                MSEC_TO_UNITS(15, UNIT_1_25_MS)            /** @04c Maximum acceptable connection interval (drive profile, see Service_Profile.h). */
 #define SLAVE_LATENCY                    0                                          /**< Slave latency. */
 #define CONN_SUP_TIMEOUT                 MSEC_TO_UNITS(4000, UNIT_10_MS)            /**< Connection supervisory timeout (4 seconds). */
 
@@ -252,6 +258,54 @@
 
     #endif //SPI_ENABLED
 
+// <e> TIMER_ENABLED - nrf_drv_timer - TIMER peripheral driver @03a
+//==========================================================
+    #ifndef TIMER_ENABLED
+        #define TIMER_ENABLED 1
+    #endif
+    #if  TIMER_ENABLED
+        // <o> TIMER_DEFAULT_CONFIG_FREQUENCY  - Timer frequency if in Timer mode (31.25 kHz)
+        #ifndef TIMER_DEFAULT_CONFIG_FREQUENCY
+            #define TIMER_DEFAULT_CONFIG_FREQUENCY 9
+        #endif
+
+        // <o> TIMER_DEFAULT_CONFIG_MODE  - Timer mode or operation (Timer)
+        #ifndef TIMER_DEFAULT_CONFIG_MODE
+            #define TIMER_DEFAULT_CONFIG_MODE 0
+        #endif
+
+        // <o> TIMER_DEFAULT_CONFIG_BIT_WIDTH  - Timer counter bit width (16 bit)
+        #ifndef TIMER_DEFAULT_CONFIG_BIT_WIDTH
+            #define TIMER_DEFAULT_CONFIG_BIT_WIDTH 0
+        #endif
+
+        // <o> TIMER_DEFAULT_CONFIG_IRQ_PRIORITY  - Interrupt priority
+        #ifndef TIMER_DEFAULT_CONFIG_IRQ_PRIORITY
+            #define TIMER_DEFAULT_CONFIG_IRQ_PRIORITY 3
+        #endif
+
+        // <q> TIMER0_ENABLED  - Enable TIMER0 instance (used by the SoftDevice)
+        #ifndef TIMER0_ENABLED
+            #define TIMER0_ENABLED 0
+        #endif
+
+        // <q> TIMER1_ENABLED  - Enable TIMER1 instance (flex sensor ADC scan)
+        #ifndef TIMER1_ENABLED
+            #define TIMER1_ENABLED 1
+        #endif
+
+        // <q> TIMER2_ENABLED  - Enable TIMER2 instance
+        #ifndef TIMER2_ENABLED
+            #define TIMER2_ENABLED 0
+        #endif
+    #endif //TIMER_ENABLED
+// </e>
+
+// <q> PPI_ENABLED  - nrf_drv_ppi - PPI peripheral driver @03a
+    #ifndef PPI_ENABLED
+        #define PPI_ENABLED 1
+    #endif
+
 //==========================================================
 
 // <h> nRF_Libraries
@@ -0,0 +1,267 @@
+/*****************************************************************************
+* FILENAME: Fusion_Benchmark.c                                               *
+*                                                                            *
+* DESCRIPTION: Counts the processor cycles the attitude math takes on the    *
+*              nRF51, see Fusion_Benchmark.h.                                *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Quaternion update of a batch        |  *
+* | @02     | 17Oct26  | BNordland  | Complementary update of a batch     |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Fusion_Benchmark.h"
+
+#if FUSION_BENCHMARK_ENABLED
+
+#include <math.h>
+
+#include "nrf.h"
+#include "Fusion_Math.h"
+#include "Fusion_Quaternion.h" // @01a
+#include "Fusion_Complementary.h" // @02a
+
+// TIMER2 is not used by the glove. On the nRF51 it is only 16 bits wide,
+// which is 4ms at 16MHz, so each call is timed on its own. A batch must be
+// done well within that anyway (FUSION_BENCHMARK_BUDGET_CYCLES).
+#define BENCHMARK_TIMER     NRF_TIMER2
+#define RADIANS_TO_DEGREES  (180.0 / 3.14159265358979)
+
+// A function being timed, given the number of the run
+typedef void (*Benchmark_Function_t)(uint8_t run);
+
+// Private functions
+static void pMeasure(Fusion_Benchmark_Cycles_t * result, Benchmark_Function_t function, uint32_t overhead);
+static uint16_t pNow(); // Reads the timer
+static void pSample(uint8_t run, Sensors_Accel_Data_t * accel); // A sample for each run
+static void pNothing(uint8_t run);
+static void pTilt(uint8_t run);
+static void pTiltDouble(uint8_t run);
+static void pFillBatch(); // @01a A batch of hand motion
+static void pNoBatch(uint8_t run); // @01a
+static void pQuaternion(uint8_t run); // @01a
+static void pComplementary(uint8_t run); // @02a
+
+// Private variables
+static volatile int32_t mSink; // Keeps the results from being optimized out
+static Sensors_AccelGyro_Batch_t mBatch; // @01a The batch the filters are timed on
+
+Fusion_Benchmark_Results_t Fusion_Benchmark_Results;
+
+/*****************************************************************************
+ ****************Start of Public Function Implementations ********************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Times each of the measured functions FUSION_BENCHMARK_RUNS   *
+ *              times, on varied samples, and fills in                       *
+ *              Fusion_Benchmark_Results. Takes a few milliseconds. Must be  *
+ *              called before the SoftDevice is enabled. Does nothing unless *
+ *              FUSION_BENCHMARK_ENABLED.                                    *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Benchmark_Run()
+{
+    Fusion_Benchmark_Cycles_t empty;
+
+    BENCHMARK_TIMER->TASKS_STOP = 1;
+    BENCHMARK_TIMER->MODE = TIMER_MODE_MODE_Timer;
+    BENCHMARK_TIMER->BITMODE = TIMER_BITMODE_BITMODE_16Bit;
+    BENCHMARK_TIMER->PRESCALER = 0; // 16MHz
+    BENCHMARK_TIMER->TASKS_CLEAR = 1;
+    BENCHMARK_TIMER->TASKS_START = 1;
+
+    // The cost of the call, of making the sample and of reading the timer
+    pMeasure(&empty, pNothing, 0);
+
+    pMeasure(&Fusion_Benchmark_Results.tilt, pTilt, empty.min);
+    pMeasure(&Fusion_Benchmark_Results.tiltDouble, pTiltDouble, empty.min);
+
+    // @01a The filters, a full batch at a time. The first update only sets
+    // the orientation, so it is done before timing; the filters are reset
+    // afterwards so they start from the real samples.
+    pFillBatch();
+    pMeasure(&empty, pNoBatch, 0);
+    Fusion_Quaternion_Reset();
+    Fusion_Quaternion_Update(&mBatch);
+    pMeasure(&Fusion_Benchmark_Results.quaternion, pQuaternion, empty.min);
+    Fusion_Quaternion_Reset();
+    Fusion_Complementary_Reset(); // @02a
+    Fusion_Complementary_Update(&mBatch);
+    pMeasure(&Fusion_Benchmark_Results.complementary, pComplementary, empty.min);
+    Fusion_Complementary_Reset();
+
+    BENCHMARK_TIMER->TASKS_STOP = 1;
+    BENCHMARK_TIMER->TASKS_SHUTDOWN = 1;
+}
+
+/*****************************************************************************
+ ****************Start of Private Function Implementations *******************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Times a function FUSION_BENCHMARK_RUNS times.                *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: result   -> where to place the cycles                         *
+ *             function -> the function to time                              *
+ *             overhead -> cycles to take off each call                      *
+ *                                                                           *
+ *****************************************************************************/
+static void pMeasure(Fusion_Benchmark_Cycles_t * result, Benchmark_Function_t function, uint32_t overhead)
+{
+    uint32_t total = 0;
+
+    result->min = UINT32_MAX;
+    result->max = 0;
+
+    for(uint8_t run = 0; run < FUSION_BENCHMARK_RUNS; run++)
+    {
+        uint16_t start = pNow();
+        function(run);
+        uint32_t cycles = (uint16_t)(pNow() - start) - overhead;
+
+        total += cycles;
+        result->min = (cycles < result->min) ? cycles : result->min;
+        result->max = (cycles > result->max) ? cycles : result->max;
+    }
+
+    result->average = total / FUSION_BENCHMARK_RUNS;
+}
+
+/*****************************************************************************
+ * Description: Reads the timer.                                             *
+ *                                                                           *
+ * Returns: The count                                                        *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static uint16_t pNow()
+{
+    BENCHMARK_TIMER->TASKS_CAPTURE[0] = 1;
+    return (uint16_t)BENCHMARK_TIMER->CC[0];
+}
+
+/*****************************************************************************
+ * Description: Makes an accelerometer sample for a run, spread over every   *
+ *              direction and size, so no one path of the math is timed.     *
+ *                                                                           *
+ * Returns: None (the sample is returned via 'accel')                        *
+ *                                                                           *
+ * Parameters: run   -> the number of the run                                *
+ *             accel -> where to place the sample                            *
+ *                                                                           *
+ *****************************************************************************/
+static void pSample(uint8_t run, Sensors_Accel_Data_t * accel)
+{
+    accel->xData = (int16_t)((run * 1021) - 32000);
+    accel->yData = (int16_t)((run * 7919) ^ 0x5A5A);
+    accel->zData = (int16_t)(16384 - (run * 509));
+}
+
+/*****************************************************************************
+ * Description: @01a Fills mBatch with a hand turning at up to about 70 dps  *
+ *              about each axis, tilted from flat, so the filters take their *
+ *              usual path.                                                  *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pFillBatch()
+{
+    mBatch.count = SENSORS_ACCELGYRO_FIFO_BATCH_SIZE;
+    for(uint8_t i = 0; i < SENSORS_ACCELGYRO_FIFO_BATCH_SIZE; i++)
+    {
+        mBatch.accel[i].xData = (int16_t)(-4000 + (i * 37));
+        mBatch.accel[i].yData = (int16_t)(5000 - (i * 53));
+        mBatch.accel[i].zData = (int16_t)(14800 + (i * 11));
+        mBatch.gyro[i].xData = (int16_t)(8000 - (i * 611));
+        mBatch.gyro[i].yData = (int16_t)(-3000 + (i * 277));
+        mBatch.gyro[i].zData = (int16_t)(6000 + (i * 149));
+    }
+}
+
+/*****************************************************************************
+ * Description: The functions being timed.                                   *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: run -> the number of the run                                  *
+ *                                                                           *
+ *****************************************************************************/
+static void pNothing(uint8_t run)
+{
+    Sensors_Accel_Data_t accel;
+
+    pSample(run, &accel);
+    mSink = accel.xData;
+}
+
+static void pTilt(uint8_t run)
+{
+    Sensors_Accel_Data_t accel;
+    int16_t pitch;
+    int16_t roll;
+
+    pSample(run, &accel);
+    Fusion_Math_GetTilt(&accel, &pitch, &roll);
+    mSink = pitch + roll;
+}
+
+static void pTiltDouble(uint8_t run)
+{
+    Sensors_Accel_Data_t accel;
+    double x;
+    double y;
+    double z;
+
+    pSample(run, &accel);
+    x = accel.xData;
+    y = accel.yData;
+    z = accel.zData;
+    mSink = (int32_t)(atan2(-x, sqrt((y * y) + (z * z))) * RADIANS_TO_DEGREES * 100)
+            + (int32_t)(atan2(y, z) * RADIANS_TO_DEGREES * 100);
+}
+
+static void pNoBatch(uint8_t run)
+{
+    mSink = run + mBatch.count;
+}
+
+static void pQuaternion(uint8_t run)
+{
+    Fusion_Quaternion_Update(&mBatch);
+    mSink = run;
+}
+
+static void pComplementary(uint8_t run)
+{
+    Fusion_Complementary_Update(&mBatch);
+    mSink = run;
+}
+
+#else
+
+void Fusion_Benchmark_Run()
+{
+}
+
+#endif /* FUSION_BENCHMARK_ENABLED */
@@ -0,0 +1,79 @@
+/*****************************************************************************
+* FILENAME: Fusion_Benchmark.h                                               *
+*                                                                            *
+* DESCRIPTION: Counts the processor cycles the attitude math takes on the    *
+*              nRF51 itself. Built in with "make FUSION_BENCHMARK=1"; it     *
+*              runs once at start up, before the SoftDevice is enabled so    *
+*              nothing interrupts it, and leaves the results in              *
+*              Fusion_Benchmark_Results for a debugger to read, e.g.         *
+*              "print Fusion_Benchmark_Results" in gdb. The host tests in    *
+*              test/ check the accuracy; only the board can give the cycles. *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Quaternion update of a batch        |  *
+* | @02     | 17Oct26  | BNordland  | Complementary update of a batch     |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef FUSION_BENCHMARK_H__
+#define FUSION_BENCHMARK_H__
+
+#include <stdint.h>
+
+#ifndef FUSION_BENCHMARK_ENABLED
+    #define FUSION_BENCHMARK_ENABLED 0
+#endif
+
+// The number of calls each result is taken over
+#define FUSION_BENCHMARK_RUNS               64
+
+// @01a The batches are handled in the SPI interrupt, which has to be done
+// before the radio event it was started ahead of: 2680us (GLOVE_RADIO_LEAD_US
+// in main.c) at 16MHz. Everything in pImuBatchHandler shares these cycles.
+#define FUSION_BENCHMARK_BUDGET_CYCLES      (2680UL * 16)
+
+// The cycles of one call. TIMER2 counts the 16MHz clock the processor runs
+// from, so a count is a cycle; the cost of reading it is taken off.
+typedef struct
+{
+    uint32_t    min;        // Fewest cycles of a call
+    uint32_t    average;    // Average cycles of a call
+    uint32_t    max;        // Most cycles of a call
+} Fusion_Benchmark_Cycles_t;
+
+// The results, filled in by Fusion_Benchmark_Run
+typedef struct
+{
+    Fusion_Benchmark_Cycles_t   tilt;       // Fusion_Math_GetTilt, pitch and roll
+    Fusion_Benchmark_Cycles_t   tiltDouble; // The same in double precision, as main.c had it
+    Fusion_Benchmark_Cycles_t   quaternion; // @01a Fusion_Quaternion_Update of a full FIFO batch
+    Fusion_Benchmark_Cycles_t   complementary; // @02a Fusion_Complementary_Update of a full FIFO batch
+} Fusion_Benchmark_Results_t;
+
+extern Fusion_Benchmark_Results_t Fusion_Benchmark_Results;
+
+/*****************************************************************************
+ * Description: Times each of the measured functions FUSION_BENCHMARK_RUNS   *
+ *              times, on varied samples, and fills in                       *
+ *              Fusion_Benchmark_Results. Takes a few milliseconds. Must be  *
+ *              called before the SoftDevice is enabled. Does nothing unless *
+ *              FUSION_BENCHMARK_ENABLED.                                    *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Benchmark_Run();
+
+#endif /* FUSION_BENCHMARK_H__ */
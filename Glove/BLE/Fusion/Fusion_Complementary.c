@@ -0,0 +1,195 @@
+/*****************************************************************************
+* FILENAME: Fusion_Complementary.c                                           *
+*                                                                            *
+* DESCRIPTION: Fixed point complementary filter for the pitch and roll of    *
+*              the glove. The gyroscope is integrated on every sample so     *
+*              the angles follow hand motion right away, and the slow        *
+*              accelerometer tilt removes the drift of the integration.      *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 16Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Correct against the middle of the   |  *
+* |         |          |            | batch, not its end                  |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Fusion_Complementary.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "Fusion_Math.h"
+
+// The angles are kept in centidegrees with 15 fraction bits, so a full turn
+// (36000 << 15) still fits in 32 bits, and the rotation of one gyroscope
+// sample keeps about 12 bits of fraction.
+#define ANGLE_FRACTION_BITS 15
+#define ANGLE_HALF_TURN     (18000L << ANGLE_FRACTION_BITS)
+#define ANGLE_FULL_TURN     (36000L << ANGLE_FRACTION_BITS)
+
+// The rotation of one gyroscope sample, per LSB, in angle units times 64:
+//      udps/LSB * 100 cdeg/deg / 1e6 / sample rate * 2^15 * 64
+#define GYRO_STEP_SHIFT     6
+#define GYRO_STEP_PER_LSB   ((uint32_t)(((uint64_t)SENSORS_ACCELGYRO_GYRO_UDPS_PER_LSB * 100 \
+                                        << (ANGLE_FRACTION_BITS + GYRO_STEP_SHIFT)) \
+                                        / (1000000ULL * SENSORS_ACCELGYRO_SAMPLE_RATE_HZ)))
+
+// Private functions
+static int32_t pWrap(int32_t angle); // wraps an angle into +/- half a turn
+static int32_t pCorrect(int32_t angle, int32_t middle, int16_t target, uint8_t samples); // @01c blends in the accelerometer tilt
+static int16_t pToCentidegrees(int32_t angle); // rounds an angle to centidegrees
+
+// Private variables
+static bool mInitialized = false; // The angles have been set from the accelerometer
+static int32_t mPitch = 0; // The pitch angle
+static int32_t mRoll = 0; // The roll angle
+
+/*****************************************************************************
+ * Description: Resets the filter. The angles are taken from the             *
+ *              accelerometer on the next update.                            *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Complementary_Reset()
+{
+    mInitialized = false;
+}
+
+/*****************************************************************************
+ * Description: Updates the filter with a batch of samples from the FIFO.    *
+ *              The gyroscope is integrated for each sample, then the        *
+ *              accelerometer tilt of the batch (averaged) is blended in.    *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  batch - The samples, evenly spaced at SENSORS_ACCELGYRO_SAMPLE_RATE_HZ   *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Complementary_Update(const Sensors_AccelGyro_Batch_t * batch)
+{
+    if(batch->count == 0)
+    {
+        return;
+    }
+
+    // Rotation about Y is pitch, rotation about X is roll (see
+    // Fusion_Math_GetTilt). This ignores the coupling between the axes,
+    // which the accelerometer corrects.
+    int32_t sumX = 0;
+    int32_t sumY = 0;
+    int32_t sumZ = 0;
+    int32_t middlePitch = 0; // @01a The angles half way through the batch
+    int32_t middleRoll = 0;
+    for(uint8_t i = 0; i < batch->count; i++)
+    {
+        mPitch += ((int32_t)batch->gyro[i].yData * (int32_t)GYRO_STEP_PER_LSB) >> GYRO_STEP_SHIFT;
+        mRoll  += ((int32_t)batch->gyro[i].xData * (int32_t)GYRO_STEP_PER_LSB) >> GYRO_STEP_SHIFT;
+        if(i == (batch->count - 1) / 2)
+        {
+            middlePitch = mPitch;
+            middleRoll = mRoll;
+        }
+
+        sumX += batch->accel[i].xData;
+        sumY += batch->accel[i].yData;
+        sumZ += batch->accel[i].zData;
+    }
+    mPitch = pWrap(mPitch);
+    mRoll  = pWrap(mRoll);
+
+    // The tilt is only taken once per batch, from the average, which also
+    // takes out some of the accelerometer noise.
+    Sensors_Accel_Data_t average;
+    average.xData = (int16_t)(sumX / batch->count);
+    average.yData = (int16_t)(sumY / batch->count);
+    average.zData = (int16_t)(sumZ / batch->count);
+
+    int16_t pitch;
+    int16_t roll;
+    Fusion_Math_GetTilt(&average, &pitch, &roll);
+
+    if(!mInitialized)
+    {
+        mPitch = (int32_t)pitch << ANGLE_FRACTION_BITS;
+        mRoll  = (int32_t)roll << ANGLE_FRACTION_BITS;
+        mInitialized = true;
+        return;
+    }
+
+    // @01c The average is the tilt of the middle of the batch, so the
+    // error is taken there. Against the end of the batch the correction
+    // held the angles back by half a batch of rotation.
+    mPitch = pCorrect(mPitch, middlePitch, pitch, batch->count);
+    mRoll  = pCorrect(mRoll, middleRoll, roll, batch->count);
+}
+
+/*****************************************************************************
+ * Description: Gets the filtered angles.                                    *
+ *              Note: Roll is not meaningful when pitch is close to +/-90    *
+ *                                                                           *
+ * Returns: None (the angles are returned via 'pitch' and 'roll')            *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  pitch - The pitch in centidegrees                                        *
+ *  roll  - The roll in centidegrees, may be NULL                            *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Complementary_GetAngles(int16_t * pitch, int16_t * roll)
+{
+    *pitch = pToCentidegrees(mPitch);
+
+    if(roll != NULL)
+    {
+        *roll = pToCentidegrees(mRoll);
+    }
+}
+
+/*****************************************************************************
+ * Description: Wraps an angle into +/- half a turn                          *
+ *****************************************************************************/
+static int32_t pWrap(int32_t angle)
+{
+    if(angle > ANGLE_HALF_TURN)
+    {
+        angle -= ANGLE_FULL_TURN;
+    }
+    else if(angle < -ANGLE_HALF_TURN)
+    {
+        angle += ANGLE_FULL_TURN;
+    }
+    return angle;
+}
+
+/*****************************************************************************
+ * Description: Moves the angle towards the accelerometer tilt by            *
+ *              samples / FUSION_COMPLEMENTARY_TIME_CONSTANT_SAMPLES of the  *
+ *              difference, taking the short way around. @01c The            *
+ *              difference is taken from the angle when the tilt was seen.   *
+ *****************************************************************************/
+static int32_t pCorrect(int32_t angle, int32_t middle, int16_t target, uint8_t samples)
+{
+    int32_t error = pWrap(((int32_t)target << ANGLE_FRACTION_BITS) - middle);
+    int32_t step = (int32_t)(((int64_t)error * samples) / FUSION_COMPLEMENTARY_TIME_CONSTANT_SAMPLES);
+    return pWrap(angle + step);
+}
+
+/*****************************************************************************
+ * Description: Rounds an angle to centidegrees                              *
+ *****************************************************************************/
+static int16_t pToCentidegrees(int32_t angle)
+{
+    return (int16_t)((angle + (1L << (ANGLE_FRACTION_BITS - 1))) >> ANGLE_FRACTION_BITS);
+}
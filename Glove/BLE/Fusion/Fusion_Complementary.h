@@ -0,0 +1,73 @@
+/*****************************************************************************
+* FILENAME: Fusion_Complementary.h                                           *
+*                                                                            *
+* DESCRIPTION: Fixed point complementary filter for the pitch and roll of    *
+*              the glove. The gyroscope is integrated on every sample so     *
+*              the angles follow hand motion right away, and the slow        *
+*              accelerometer tilt removes the drift of the integration.      *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 16Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef FUSION_COMPLEMENTARY_H__
+#define FUSION_COMPLEMENTARY_H__
+
+#include <stdint.h>
+
+#include "Sensors_AccelGyro.h"
+
+// The time constant of the filter in samples (0.5s). Changes slower than
+// this come from the accelerometer, faster ones from the gyroscope.
+#ifndef FUSION_COMPLEMENTARY_TIME_CONSTANT_SAMPLES
+    #define FUSION_COMPLEMENTARY_TIME_CONSTANT_SAMPLES (SENSORS_ACCELGYRO_SAMPLE_RATE_HZ / 2)
+#endif
+
+/*****************************************************************************
+ * Description: Resets the filter. The angles are taken from the             *
+ *              accelerometer on the next update.                            *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Complementary_Reset();
+
+/*****************************************************************************
+ * Description: Updates the filter with a batch of samples from the FIFO.    *
+ *              The gyroscope is integrated for each sample, then the        *
+ *              accelerometer tilt of the batch (averaged) is blended in.    *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  batch - The samples, evenly spaced at SENSORS_ACCELGYRO_SAMPLE_RATE_HZ   *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Complementary_Update(const Sensors_AccelGyro_Batch_t * batch);
+
+/*****************************************************************************
+ * Description: Gets the filtered angles.                                    *
+ *              Note: Roll is not meaningful when pitch is close to +/-90    *
+ *                                                                           *
+ * Returns: None (the angles are returned via 'pitch' and 'roll')            *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  pitch - The pitch in centidegrees                                        *
+ *  roll  - The roll in centidegrees, may be NULL                            *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Complementary_GetAngles(int16_t * pitch, int16_t * roll);
+
+#endif /* FUSION_COMPLEMENTARY_H__ */
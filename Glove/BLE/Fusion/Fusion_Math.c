@@ -0,0 +1,223 @@
+/*****************************************************************************
+* FILENAME: Fusion_Math.c                                                    *
+*                                                                            *
+* DESCRIPTION: Integer only math for computing the attitude of the glove.    *
+*              The nRF51 has no FPU, so floating point atan2/sqrt pull in    *
+*              the soft float library and cost thousands of cycles.          *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+* CREDITS: CORDIC vectoring mode:                                            *
+*         Link: https://en.wikipedia.org/wiki/CORDIC                         *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 16Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Full scaling of small samples in    |  *
+* |         |          |            | GetTilt; headroom comment corrected |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Fusion_Math.h"
+
+#include <stddef.h>
+
+// Angles inside the CORDIC are in 1/2^24 of a full turn, so that the
+// rounding of the table below adds up to less than 0.001 degrees.
+#define ANGLE_BITS          24
+#define ANGLE_QUARTER_TURN  (1L << (ANGLE_BITS - 2))
+#define CENTIDEGREES_PER_TURN 36000
+
+// The inputs are scaled so that the larger one is in [2^28, 2^29), which
+// keeps 28 bits of precision for any input size. The vector is then at
+// most sqrt(2) * 2^29 long (x and y both at the top), and the CORDIC gain
+// (1.65) grows it to under 1.17 * 2^30, so vx and vy never overflow.
+#define INPUT_MIN           (1UL << 28)
+#define INPUT_MAX           (1UL << 29)
+
+// Number of CORDIC iterations. After the last one the residual angle is at
+// most atan(2^-(ITERATIONS-1)) = 0.0001 degrees.
+#define ITERATIONS          20
+
+// atan(2^-i) in 1/2^24 of a turn
+static const int32_t mAtanTable[ITERATIONS] =
+{
+    2097152, 1238021, 654136, 332050, 166669, 83416, 41718, 20860,
+    10430,   5215,    2608,   1304,   652,    326,   163,   81,
+    41,      20,      10,     5
+};
+
+/*****************************************************************************
+ * Description: Integer square root.                                         *
+ *                                                                           *
+ * Returns: floor(sqrt(value))                                               *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  value - The value to take the square root of                             *
+ *                                                                           *
+ *****************************************************************************/
+uint16_t Fusion_Math_Sqrt(uint32_t value)
+{
+    // Digit by digit method, one result bit per iteration, no multiply
+    uint32_t result = 0;
+    uint32_t bit = 1UL << 30;
+
+    while(bit > value)
+    {
+        bit >>= 2;
+    }
+
+    while(bit != 0)
+    {
+        if(value >= result + bit)
+        {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint16_t)result;
+}
+
+/*****************************************************************************
+ * Description: Integer four quadrant arc tangent of y/x, using CORDIC.      *
+ *              The result is within 0.01 degrees of the floating point      *
+ *              atan2 rounded to centidegrees, for any input.                *
+ *                                                                           *
+ * Returns: The angle in centidegrees (-18000 to 18000). 0 if x and y are 0  *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  y - The y coordinate                                                     *
+ *  x - The x coordinate                                                     *
+ *                                                                           *
+ *****************************************************************************/
+int16_t Fusion_Math_Atan2(int32_t y, int32_t x)
+{
+    // Work on magnitudes so that every input (including INT32_MIN) is in range
+    uint32_t ux = (x < 0) ? (0UL - (uint32_t)x) : (uint32_t)x;
+    uint32_t uy = (y < 0) ? (0UL - (uint32_t)y) : (uint32_t)y;
+    uint32_t larger = (ux > uy) ? ux : uy;
+
+    if(larger == 0)
+    {
+        return 0;
+    }
+
+    // Scale both so the larger is in [INPUT_MIN, INPUT_MAX)
+    while(larger >= INPUT_MAX)
+    {
+        larger >>= 1;
+        ux >>= 1;
+        uy >>= 1;
+    }
+    while(larger < INPUT_MIN)
+    {
+        larger <<= 1;
+        ux <<= 1;
+        uy <<= 1;
+    }
+
+    // The vector is mirrored into the first quadrant, and mirrored back at
+    // the end.
+    int32_t vx = (int32_t)ux;
+    int32_t vy = (int32_t)uy;
+    int32_t angle = 0;
+
+    // Rotate the vector onto the x axis, adding up the angle rotated by
+    for(uint8_t i = 0; i < ITERATIONS; i++)
+    {
+        int32_t dx = vy >> i;
+        int32_t dy = vx >> i;
+        if(vy > 0)
+        {
+            vx += dx;
+            vy -= dy;
+            angle += mAtanTable[i];
+        }
+        else
+        {
+            vx -= dx;
+            vy += dy;
+            angle -= mAtanTable[i];
+        }
+    }
+
+    // The residual of the last iteration can leave the angle just outside
+    // of the quadrant.
+    if(angle < 0)
+    {
+        angle = 0;
+    }
+    else if(angle > ANGLE_QUARTER_TURN)
+    {
+        angle = ANGLE_QUARTER_TURN;
+    }
+
+    // Convert from 1/2^24 turn to centidegrees, with rounding
+    int16_t result = (int16_t)(((uint64_t)angle * CENTIDEGREES_PER_TURN + (1UL << (ANGLE_BITS - 1))) >> ANGLE_BITS);
+
+    // Back to the original quadrant
+    if(x < 0)
+    {
+        result = (CENTIDEGREES_PER_TURN / 2) - result;
+    }
+    if(y < 0)
+    {
+        result = -result;
+    }
+
+    return result;
+}
+
+/*****************************************************************************
+ * Description: Gets the tilt of the glove from an accelerometer sample:     *
+ *                  pitch = atan2(-x, sqrt(y*y + z*z))                       *
+ *                  roll  = atan2(y, z)                                      *
+ *              Only valid when the glove is not accelerating.               *
+ *              The pitch is within 0.01 degrees of the floating point       *
+ *              formula for any sample.                                      *
+ *                                                                           *
+ * Returns: None (the angles are returned via 'pitch' and 'roll')            *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  accel - The accelerometer sample                                         *
+ *  pitch - The pitch in centidegrees (-9000 to 9000)                        *
+ *  roll  - The roll in centidegrees (-18000 to 18000), may be NULL          *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Math_GetTilt(const Sensors_Accel_Data_t * accel, int16_t * pitch, int16_t * roll)
+{
+    // y*y + z*z is at most 2 * 32768^2 = 2^31, which fits unsigned 32 bits
+    int32_t x = -(int32_t)accel->xData;
+    int32_t y = accel->yData;
+    int32_t z = accel->zData;
+    uint32_t yz = (uint32_t)(y * y) + (uint32_t)(z * z);
+
+    // The square root is truncated to an integer, which is a large error
+    // when y and z are small. Scale y*y + z*z up by 4 (and x by 2) until
+    // it uses the full 32 bits, so the root has 16 significant bits.
+    // @01c Even y*y + z*z = 1 gets there, in 15 steps, which takes x to at
+    // most 2^30. Stopping at 8 left small samples 0.02 degrees out.
+    for(uint8_t shift = 0; shift < 15 && yz < (1UL << 30); shift++)
+    {
+        yz <<= 2;
+        x <<= 1;
+    }
+
+    *pitch = Fusion_Math_Atan2(x, Fusion_Math_Sqrt(yz));
+
+    if(roll != NULL)
+    {
+        *roll = Fusion_Math_Atan2(y, z);
+    }
+}
@@ -0,0 +1,75 @@
+/*****************************************************************************
+* FILENAME: Fusion_Math.h                                                    *
+*                                                                            *
+* DESCRIPTION: Integer only math for computing the attitude of the glove.    *
+*              The nRF51 has no FPU, so floating point atan2/sqrt pull in    *
+*              the soft float library and cost thousands of cycles.          *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 16Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef FUSION_MATH_H__
+#define FUSION_MATH_H__
+
+#include <stdint.h>
+
+#include "Sensors_AccelGyro.h"
+
+// Angles are returned in centidegrees (1/100 of a degree), -18000 to 18000
+#define FUSION_MATH_CENTIDEGREES_PER_DEGREE 100
+
+/*****************************************************************************
+ * Description: Integer square root.                                         *
+ *                                                                           *
+ * Returns: floor(sqrt(value))                                               *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  value - The value to take the square root of                             *
+ *                                                                           *
+ *****************************************************************************/
+uint16_t Fusion_Math_Sqrt(uint32_t value);
+
+/*****************************************************************************
+ * Description: Integer four quadrant arc tangent of y/x, using CORDIC.      *
+ *              The result is within 0.01 degrees of the floating point      *
+ *              atan2 rounded to centidegrees, for any input.                *
+ *                                                                           *
+ * Returns: The angle in centidegrees (-18000 to 18000). 0 if x and y are 0  *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  y - The y coordinate                                                     *
+ *  x - The x coordinate                                                     *
+ *                                                                           *
+ *****************************************************************************/
+int16_t Fusion_Math_Atan2(int32_t y, int32_t x);
+
+/*****************************************************************************
+ * Description: Gets the tilt of the glove from an accelerometer sample:     *
+ *                  pitch = atan2(-x, sqrt(y*y + z*z))                       *
+ *                  roll  = atan2(y, z)                                      *
+ *              Only valid when the glove is not accelerating.               *
+ *              The pitch is within 0.01 degrees of the floating point       *
+ *              formula for any sample.                                      *
+ *                                                                           *
+ * Returns: None (the angles are returned via 'pitch' and 'roll')            *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  accel - The accelerometer sample                                         *
+ *  pitch - The pitch in centidegrees (-9000 to 9000)                        *
+ *  roll  - The roll in centidegrees (-18000 to 18000), may be NULL          *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Math_GetTilt(const Sensors_Accel_Data_t * accel, int16_t * pitch, int16_t * roll);
+
+#endif /* FUSION_MATH_H__ */
@@ -0,0 +1,404 @@
+/*****************************************************************************
+* FILENAME: Fusion_Quaternion.c                                              *
+*                                                                            *
+* DESCRIPTION: Fixed point quaternion orientation engine (Mahony filter)     *
+*              for the full 3 axis pose of the hand. The gyroscope is        *
+*              integrated on every sample, and the accelerometer corrects    *
+*              roll and pitch (and the gyroscope bias) once per batch. Yaw   *
+*              has no absolute reference, so it will drift slowly.           *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+* CREDITS: Mahony complementary filter on SO(3):                             *
+*         Link: https://hal.archives-ouvertes.fr/hal-00488376/document       *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Correct against the middle of the   |  *
+* |         |          |            | batch, not its end                  |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Fusion_Quaternion.h"
+
+#include <stdbool.h>
+
+#include "Fusion_Math.h"
+
+// The quaternion is kept in Q30 while integrating. The rotation of one
+// gyroscope sample is only a few Q15 LSBs at low rates, so a Q15 state
+// would lose most of it to rounding. The products are done in 64 bits.
+#define Q30_ONE             (1L << 30)
+
+// Half of the rotation of one gyroscope sample, per LSB, in Q30 radians
+// times 64:  8.75 mdps * pi/180 / 416Hz / 2 * 2^30 * 64 = 12613.7
+#define GYRO_HALF_STEP_PER_LSB  12614
+#define GYRO_HALF_STEP_SHIFT    6
+
+// Converts a rate in Q30 half radians per sample to centidegrees per second
+// times 2^16:  2 * 416Hz / 2^30 * 18000/pi * 2^16 = 290.96
+#define HALF_STEP_TO_CDEG_PER_S 291
+#define HALF_STEP_TO_CDEG_SHIFT 16
+
+// The constants above are for this configuration of the sensor
+#if (SENSORS_ACCELGYRO_SAMPLE_RATE_HZ != 416) || (SENSORS_ACCELGYRO_GYRO_UDPS_PER_LSB != 8750)
+    #error "Fusion_Quaternion gyroscope constants do not match the sensor configuration"
+#endif
+
+// The gyroscope rates are 7/8 centidegrees per second per LSB (8.75 mdps)
+#define GYRO_LSB_TO_CDEG_PER_S(lsb) (((int32_t)(lsb) * 7) / 8)
+
+// Limit of the gyroscope bias estimate, 20 dps in Q30 half radians per sample
+#define BIAS_LIMIT          450489L
+
+// Private functions
+static void pRotate(int32_t hx, int32_t hy, int32_t hz); // rotates the quaternion by a small half angle
+static void pNormalizeQuaternion(); // brings the quaternion back to unit length
+static void pRemoveYaw(); // rotates the quaternion about world Z so that yaw is 0
+static bool pNormalizeVector(int32_t x, int32_t y, int32_t z, int32_t * unit); // scales a vector to Q30 unit length
+static int32_t pMultiply(int32_t a, int32_t b); // Q30 product
+static int32_t pClampBias(int32_t bias); // limits a gyroscope bias estimate
+
+// Private variables
+static bool mInitialized = false; // The quaternion has been set from the accelerometer
+static int32_t mQ[4] = {Q30_ONE, 0, 0, 0}; // The orientation (w, x, y, z) in Q30
+static int32_t mBias[3] = {0, 0, 0}; // The gyroscope bias estimate in Q30 half radians per sample
+static Sensors_Gyro_Data_t mLastGyro; // The last gyroscope sample, for the rates
+
+/*****************************************************************************
+ * Description: Resets the engine. The roll and pitch are taken from the     *
+ *              accelerometer on the next update, and yaw is set to 0.       *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Quaternion_Reset()
+{
+    mInitialized = false;
+    mBias[0] = 0;
+    mBias[1] = 0;
+    mBias[2] = 0;
+}
+
+/*****************************************************************************
+ * Description: Updates the orientation with a batch of samples from the     *
+ *              FIFO.                                                        *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  batch - The samples, evenly spaced at SENSORS_ACCELGYRO_SAMPLE_RATE_HZ   *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Quaternion_Update(const Sensors_AccelGyro_Batch_t * batch)
+{
+    if(batch->count == 0)
+    {
+        return;
+    }
+
+    // Integrate the bias corrected gyroscope, one sample at a time
+    int32_t sumX = 0;
+    int32_t sumY = 0;
+    int32_t sumZ = 0;
+    int32_t middle[4] = {0, 0, 0, 0}; // @01a The quaternion half way through the batch
+    for(uint8_t i = 0; i < batch->count; i++)
+    {
+        const Sensors_Gyro_Data_t * gyro = &batch->gyro[i];
+        pRotate((((int32_t)gyro->xData * GYRO_HALF_STEP_PER_LSB) >> GYRO_HALF_STEP_SHIFT) + mBias[0],
+                (((int32_t)gyro->yData * GYRO_HALF_STEP_PER_LSB) >> GYRO_HALF_STEP_SHIFT) + mBias[1],
+                (((int32_t)gyro->zData * GYRO_HALF_STEP_PER_LSB) >> GYRO_HALF_STEP_SHIFT) + mBias[2]);
+        if(i == (batch->count - 1) / 2)
+        {
+            middle[0] = mQ[0];
+            middle[1] = mQ[1];
+            middle[2] = mQ[2];
+            middle[3] = mQ[3];
+        }
+
+        sumX += batch->accel[i].xData;
+        sumY += batch->accel[i].yData;
+        sumZ += batch->accel[i].zData;
+    }
+    mLastGyro = batch->gyro[batch->count - 1];
+
+    // The measured direction of gravity, from the average of the batch
+    int32_t a[3];
+    if(!pNormalizeVector(sumX / batch->count, sumY / batch->count, sumZ / batch->count, a))
+    {
+        // Free fall, nothing to correct with
+        pNormalizeQuaternion();
+        return;
+    }
+
+    if(!mInitialized)
+    {
+        // The shortest rotation that takes world up (0, 0, 1) onto the
+        // measured gravity, i.e. roll and pitch with a yaw of 0:
+        //      q = (1 + az, ay, -ax, 0), normalized
+        // Halved so that 1 + az fits. Upside down (az = -1) it is 180
+        // degrees about X.
+        int32_t w = (Q30_ONE >> 1) + (a[2] >> 1);
+        if(w < (Q30_ONE >> 16))
+        {
+            mQ[0] = 0;
+            mQ[1] = Q30_ONE;
+            mQ[2] = 0;
+            mQ[3] = 0;
+        }
+        else
+        {
+            // Q30 to Q14, so the squares add up to less than 2^32
+            int32_t w14 = w >> 16;
+            int32_t x14 = (a[1] >> 1) >> 16;
+            int32_t y14 = -(a[0] >> 1) >> 16;
+            uint32_t norm = Fusion_Math_Sqrt((uint32_t)(w14 * w14) + (uint32_t)(x14 * x14) + (uint32_t)(y14 * y14));
+            mQ[0] = (int32_t)(((int64_t)w14 << 30) / norm);
+            mQ[1] = (int32_t)(((int64_t)x14 << 30) / norm);
+            mQ[2] = (int32_t)(((int64_t)y14 << 30) / norm);
+            mQ[3] = 0;
+
+            // In Z-Y-X angles that rotation also has a little yaw, which is
+            // taken out so that yaw starts at 0.
+            pRemoveYaw();
+        }
+        mInitialized = true;
+        return;
+    }
+
+    // The direction of gravity as estimated by the quaternion:
+    //      v = (2(xz - wy), 2(wx + yz), w^2 - x^2 - y^2 + z^2)
+    // @01c The average of the batch is the gravity of its middle sample, so
+    // it is compared with the quaternion of that sample. Against the end of
+    // the batch the correction pulled the estimate back by half a batch of
+    // rotation (almost 2 degrees at 100 dps).
+    int32_t v[3];
+    v[0] = 2 * (pMultiply(middle[1], middle[3]) - pMultiply(middle[0], middle[2]));
+    v[1] = 2 * (pMultiply(middle[0], middle[1]) + pMultiply(middle[2], middle[3]));
+    v[2] = pMultiply(middle[0], middle[0]) - pMultiply(middle[1], middle[1]) -
+           pMultiply(middle[2], middle[2]) + pMultiply(middle[3], middle[3]);
+
+    // The error is the rotation that takes the estimate onto the
+    // measurement: e = a x v
+    int32_t e[3];
+    e[0] = pMultiply(a[1], v[2]) - pMultiply(a[2], v[1]);
+    e[1] = pMultiply(a[2], v[0]) - pMultiply(a[0], v[2]);
+    e[2] = pMultiply(a[0], v[1]) - pMultiply(a[1], v[0]);
+
+    // Proportional: rotate by the error over the time constant, for the
+    // length of the batch (as a half angle)
+    int32_t correction[3];
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        correction[i] = (int32_t)(((int64_t)e[i] * batch->count) / (2 * FUSION_QUATERNION_KP_SAMPLES));
+
+        // Integral: the bias (a half angle per sample) moves towards the
+        // error over both time constants.
+        int32_t biasStep = (int32_t)(((int64_t)e[i] * batch->count) /
+                                     (2LL * FUSION_QUATERNION_KP_SAMPLES * FUSION_QUATERNION_KI_SAMPLES));
+        mBias[i] = pClampBias(mBias[i] + biasStep);
+    }
+    pRotate(correction[0], correction[1], correction[2]);
+
+    pNormalizeQuaternion();
+}
+
+/*****************************************************************************
+ * Description: Gets the orientation as a Q15 quaternion.                    *
+ *                                                                           *
+ * Returns: None (the quaternion is returned via 'quaternion')               *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  quaternion - Where to place the quaternion                               *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Quaternion_Get(Fusion_Quaternion_t * quaternion)
+{
+    // Q30 to Q15 with rounding, 1.0 is saturated to 32767
+    int16_t * out[4] = {&quaternion->w, &quaternion->x, &quaternion->y, &quaternion->z};
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        int32_t value = (mQ[i] + (1L << 14)) >> 15;
+        if(value > INT16_MAX)
+        {
+            value = INT16_MAX;
+        }
+        else if(value < -INT16_MAX)
+        {
+            value = -INT16_MAX;
+        }
+        *out[i] = (int16_t)value;
+    }
+}
+
+/*****************************************************************************
+ * Description: Gets the orientation as Euler angles (Z-Y-X order) and the   *
+ *              bias corrected angular rates of the last sample.             *
+ *              Note: Roll and yaw are not meaningful when pitch is close    *
+ *                    to +/-90                                               *
+ *                                                                           *
+ * Returns: None (the orientation is returned via 'orientation')             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  orientation - Where to place the orientation                             *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Quaternion_GetOrientation(Fusion_Orientation_t * orientation)
+{
+    int32_t w = mQ[0];
+    int32_t x = mQ[1];
+    int32_t y = mQ[2];
+    int32_t z = mQ[3];
+
+    // Gravity in the glove frame (as in Fusion_Quaternion_Update) gives
+    // roll and pitch the same way as Fusion_Math_GetTilt does.
+    int32_t vx = 2 * (pMultiply(x, z) - pMultiply(w, y));
+    int32_t vy = 2 * (pMultiply(w, x) + pMultiply(y, z));
+    int32_t vz = pMultiply(w, w) - pMultiply(x, x) - pMultiply(y, y) + pMultiply(z, z);
+
+    // cos(pitch) = sqrt(vy^2 + vz^2), in Q15 so the squares fit 32 bits
+    int32_t vy15 = vy >> 15;
+    int32_t vz15 = vz >> 15;
+    uint32_t cosPitch = Fusion_Math_Sqrt((uint32_t)(vy15 * vy15) + (uint32_t)(vz15 * vz15));
+
+    orientation->roll  = Fusion_Math_Atan2(vy, vz);
+    orientation->pitch = Fusion_Math_Atan2(-vx, (int32_t)cosPitch << 15);
+
+    // yaw = atan2(2(wz + xy), 1 - 2(y^2 + z^2)), both halved so they fit
+    orientation->yaw   = Fusion_Math_Atan2(pMultiply(w, z) + pMultiply(x, y),
+                                           (Q30_ONE >> 1) - (pMultiply(y, y) + pMultiply(z, z)));
+
+    // The rates of the last sample, with the estimated bias taken out
+    orientation->rollRate  = (int16_t)(GYRO_LSB_TO_CDEG_PER_S(mLastGyro.xData) + ((mBias[0] * HALF_STEP_TO_CDEG_PER_S) >> HALF_STEP_TO_CDEG_SHIFT));
+    orientation->pitchRate = (int16_t)(GYRO_LSB_TO_CDEG_PER_S(mLastGyro.yData) + ((mBias[1] * HALF_STEP_TO_CDEG_PER_S) >> HALF_STEP_TO_CDEG_SHIFT));
+    orientation->yawRate   = (int16_t)(GYRO_LSB_TO_CDEG_PER_S(mLastGyro.zData) + ((mBias[2] * HALF_STEP_TO_CDEG_PER_S) >> HALF_STEP_TO_CDEG_SHIFT));
+}
+
+/*****************************************************************************
+ * Description: Rotates the quaternion by a small rotation about the glove   *
+ *              axes, given as half angles in Q30 radians:                   *
+ *                  q = q + q * (0, hx, hy, hz)                              *
+ *****************************************************************************/
+static void pRotate(int32_t hx, int32_t hy, int32_t hz)
+{
+    int32_t w = mQ[0];
+    int32_t x = mQ[1];
+    int32_t y = mQ[2];
+    int32_t z = mQ[3];
+
+    mQ[0] = w - pMultiply(x, hx) - pMultiply(y, hy) - pMultiply(z, hz);
+    mQ[1] = x + pMultiply(w, hx) + pMultiply(y, hz) - pMultiply(z, hy);
+    mQ[2] = y + pMultiply(w, hy) - pMultiply(x, hz) + pMultiply(z, hx);
+    mQ[3] = z + pMultiply(w, hz) + pMultiply(x, hy) - pMultiply(y, hx);
+}
+
+/*****************************************************************************
+ * Description: Brings the quaternion back to unit length. It only drifts a  *
+ *              little per batch, so one Newton step of 1/sqrt is enough:    *
+ *                  q = q * (3 - |q|^2) / 2                                  *
+ *****************************************************************************/
+static void pNormalizeQuaternion()
+{
+    int32_t normSquared = pMultiply(mQ[0], mQ[0]) + pMultiply(mQ[1], mQ[1]) +
+                          pMultiply(mQ[2], mQ[2]) + pMultiply(mQ[3], mQ[3]);
+    int32_t scale = Q30_ONE + ((Q30_ONE - normSquared) >> 1);
+
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        mQ[i] = pMultiply(mQ[i], scale);
+    }
+}
+
+/*****************************************************************************
+ * Description: Rotates the quaternion about the world Z axis by -yaw, so    *
+ *              that its yaw is 0 and its roll and pitch are unchanged:      *
+ *                  q = (cos(yaw/2), 0, 0, -sin(yaw/2)) * q                  *
+ *****************************************************************************/
+static void pRemoveYaw()
+{
+    int32_t w = mQ[0];
+    int32_t x = mQ[1];
+    int32_t y = mQ[2];
+    int32_t z = mQ[3];
+
+    // cos(yaw) and sin(yaw) as a Q30 unit vector (see GetOrientation)
+    int32_t yaw[3];
+    if(!pNormalizeVector(((Q30_ONE >> 1) - (pMultiply(y, y) + pMultiply(z, z))) >> 15,
+                         (pMultiply(w, z) + pMultiply(x, y)) >> 15, 0, yaw))
+    {
+        return;
+    }
+
+    // Half angle: cos(yaw/2) = sqrt((1 + cos(yaw)) / 2),
+    //             sin(yaw/2) = sin(yaw) / (2 cos(yaw/2))
+    int32_t cosHalf15 = Fusion_Math_Sqrt((uint32_t)((Q30_ONE >> 1) + (yaw[0] >> 1)));
+    int32_t cosHalf;
+    int32_t sinHalf;
+    if(cosHalf15 == 0)
+    {
+        // yaw is 180
+        cosHalf = 0;
+        sinHalf = Q30_ONE;
+    }
+    else
+    {
+        cosHalf = cosHalf15 << 15;
+        sinHalf = (int32_t)(((int64_t)yaw[1] << 14) / cosHalf15);
+    }
+
+    mQ[0] = pMultiply(cosHalf, w) + pMultiply(sinHalf, z);
+    mQ[1] = pMultiply(cosHalf, x) + pMultiply(sinHalf, y);
+    mQ[2] = pMultiply(cosHalf, y) - pMultiply(sinHalf, x);
+    mQ[3] = pMultiply(cosHalf, z) - pMultiply(sinHalf, w);
+}
+
+/*****************************************************************************
+ * Description: Scales a vector of raw sensor counts to unit length in Q30.  *
+ *              The parts must be 16 bit. Returns false if the vector is 0.  *
+ *****************************************************************************/
+static bool pNormalizeVector(int32_t x, int32_t y, int32_t z, int32_t * unit)
+{
+    // The counts are 16 bit, so the sum of squares is at most 3 * 2^30
+    uint32_t norm = Fusion_Math_Sqrt((uint32_t)(x * x) + (uint32_t)(y * y) + (uint32_t)(z * z));
+    if(norm == 0)
+    {
+        return false;
+    }
+
+    unit[0] = (int32_t)(((int64_t)x << 30) / norm);
+    unit[1] = (int32_t)(((int64_t)y << 30) / norm);
+    unit[2] = (int32_t)(((int64_t)z << 30) / norm);
+    return true;
+}
+
+/*****************************************************************************
+ * Description: Multiplies two Q30 values                                    *
+ *****************************************************************************/
+static int32_t pMultiply(int32_t a, int32_t b)
+{
+    return (int32_t)(((int64_t)a * b) >> 30);
+}
+
+/*****************************************************************************
+ * Description: Limits a gyroscope bias estimate to +/-BIAS_LIMIT            *
+ *****************************************************************************/
+static int32_t pClampBias(int32_t bias)
+{
+    if(bias > BIAS_LIMIT)
+    {
+        return BIAS_LIMIT;
+    }
+    if(bias < -BIAS_LIMIT)
+    {
+        return -BIAS_LIMIT;
+    }
+    return bias;
+}
@@ -0,0 +1,109 @@
+/*****************************************************************************
+* FILENAME: Fusion_Quaternion.h                                              *
+*                                                                            *
+* DESCRIPTION: Fixed point quaternion orientation engine (Mahony filter)     *
+*              for the full 3 axis pose of the hand. The gyroscope is        *
+*              integrated on every sample, and the accelerometer corrects    *
+*              roll and pitch (and the gyroscope bias) once per batch. Yaw   *
+*              has no absolute reference, so it will drift slowly.           *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 16Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef FUSION_QUATERNION_H__
+#define FUSION_QUATERNION_H__
+
+#include <stdint.h>
+
+#include "Sensors_AccelGyro.h"
+
+// The time constant of the accelerometer correction in samples (0.5s)
+#ifndef FUSION_QUATERNION_KP_SAMPLES
+    #define FUSION_QUATERNION_KP_SAMPLES (SENSORS_ACCELGYRO_SAMPLE_RATE_HZ / 2)
+#endif
+
+// The time constant of the gyroscope bias estimate in samples (10s)
+#ifndef FUSION_QUATERNION_KI_SAMPLES
+    #define FUSION_QUATERNION_KI_SAMPLES (SENSORS_ACCELGYRO_SAMPLE_RATE_HZ * 10)
+#endif
+
+// A unit quaternion in Q15 (32767 = 1.0), rotating the world into the glove
+typedef struct
+{
+    int16_t w;
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} Fusion_Quaternion_t;
+
+// The orientation of the glove as angles and rates
+typedef struct
+{
+    int16_t roll;       // Rotation about X, centidegrees (-18000 to 18000)
+    int16_t pitch;      // Rotation about Y, centidegrees (-9000 to 9000)
+    int16_t yaw;        // Rotation about Z, centidegrees (-18000 to 18000), relative to start up
+    int16_t rollRate;   // Angular rate about X, centidegrees per second
+    int16_t pitchRate;  // Angular rate about Y, centidegrees per second
+    int16_t yawRate;    // Angular rate about Z, centidegrees per second
+} Fusion_Orientation_t;
+
+/*****************************************************************************
+ * Description: Resets the engine. The roll and pitch are taken from the     *
+ *              accelerometer on the next update, and yaw is set to 0.       *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Quaternion_Reset();
+
+/*****************************************************************************
+ * Description: Updates the orientation with a batch of samples from the     *
+ *              FIFO.                                                        *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  batch - The samples, evenly spaced at SENSORS_ACCELGYRO_SAMPLE_RATE_HZ   *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Quaternion_Update(const Sensors_AccelGyro_Batch_t * batch);
+
+/*****************************************************************************
+ * Description: Gets the orientation as a Q15 quaternion.                    *
+ *                                                                           *
+ * Returns: None (the quaternion is returned via 'quaternion')               *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  quaternion - Where to place the quaternion                               *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Quaternion_Get(Fusion_Quaternion_t * quaternion);
+
+/*****************************************************************************
+ * Description: Gets the orientation as Euler angles (Z-Y-X order) and the   *
+ *              bias corrected angular rates of the last sample.             *
+ *              Note: Roll and yaw are not meaningful when pitch is close    *
+ *                    to +/-90                                               *
+ *                                                                           *
+ * Returns: None (the orientation is returned via 'orientation')             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  orientation - Where to place the orientation                             *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Quaternion_GetOrientation(Fusion_Orientation_t * orientation);
+
+#endif /* FUSION_QUATERNION_H__ */
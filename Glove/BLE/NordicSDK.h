@@ -17,6 +17,10 @@
 * | @01     | 10Apr17  | BNordland  | Added ADC driver                    |  *
 * | N/A     | 18Apr17  | Bnordland  | Removing bsp.h, bsp_btn_ble.h and   |  *
 * |         |          |            | sensorsim.h                         |  *
+* | @02     | 16Oct26  | BNordland  | Added GPIOTE driver and delay       |  *
+* | @03     | 16Oct26  | BNordland  | Added critical regions              |  *
+* | @04     | 17Oct26  | BNordland  | Added TIMER and PPI drivers         |  *
+* | @05     | 17Oct26  | BNordland  | Added radio notification            |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
@@ -56,4 +60,20 @@
 // Nordic ADC
 #include "nrf_drv_adc.h" // @01a
 
+// Nordic GPIOTE (pin interrupts) @02a
+#include "nrf_drv_gpiote.h"
+
+// Nordic busy wait delays @02a
+#include "nrf_delay.h"
+
+// Nordic critical regions (CRITICAL_REGION_ENTER/EXIT) @03a
+#include "app_util_platform.h"
+
+// Nordic TIMER and PPI (hardware triggered ADC scan) @04a
+#include "nrf_drv_timer.h"
+#include "nrf_drv_ppi.h"
+
+// Nordic radio notification (connection event timing) @05a
+#include "ble_radio_notification.h"
+
 #endif
@@ -17,22 +17,87 @@
 * | Flag    | (DDMYY)  | Author     | Description                         |  *
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 09Apr17  | BNordland  | Initial creation                    |  *
+* | @01     | 16Oct26  | BNordland  | Burst read of output registers      |  *
+* | @02     | 16Oct26  | BNordland  | Hardware FIFO streaming mode        |  *
+* | @03     | 16Oct26  | BNordland  | INT1 data ready, bounded init probe |  *
+* | @04     | 16Oct26  | BNordland  | Asynchronous chained FIFO reads     |  *
+* | @05     | 16Oct26  | BNordland  | Enabled the gyroscope               |  *
+* | @06     | 17Oct26  | BNordland  | Calibration offsets                 |  *
+* | @07     | 17Oct26  | BNordland  | Wake up on motion from system off   |  *
+* | @08     | 17Oct26  | BNordland  | Every batch has its index, overrun  |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
 #include "Sensors_AccelGyro.h"
 
+#include <stdbool.h>
+#include <string.h> // @06a For memset
+
 #include "Comm_SPI.h" // For SPI communication
+#include "NordicSDK.h" // @02a For app_timer_cnt_get
+#include "Config_Hardware.h" // @03a For the INT1 pin
 
 // Register Definitions
+#define FIFO_CTRL1      0x06    // @02a FIFO threshold level FTH[7:0] (in 16 bit words)
+#define FIFO_CTRL2      0x07    // @02a FIFO threshold level FTH[11:8]
+#define FIFO_CTRL3      0x08    // @02a FIFO decimation for gyroscope (bits 5:3) and accelerometer (bits 2:0)
+    #define DEC_FIFO_GYRO_NONE  0x08 // Gyroscope in FIFO, no decimation
+    #define DEC_FIFO_XL_NONE    0x01 // Accelerometer in FIFO, no decimation
+#define FIFO_CTRL5      0x0A    // @02a FIFO ODR (bits 6:3) and mode (bits 2:0)
+    #define ODR_FIFO_416HZ      0x30 // FIFO ODR is 416Hz (matches CTRL1_XL)
+    #define FIFO_MODE_BYPASS    0x00 // FIFO disabled (also clears its content)
+    #define FIFO_MODE_CONTINUOUS 0x06 // If the FIFO is full, the new sample overwrites the oldest one
+#define INT1_CTRL       0x0D    // @03a INT1 pad control register
+    #define INT1_FTH            0x08 // FIFO threshold interrupt on INT1
+    #define INT1_DRDY_XL        0x01 // Accelerometer data ready on INT1
 #define WHO_AM_I        0x0F    // The device SPI WHO_AM_I register
 
 #define CTRL1_XL        0x10    // Control register 1
+    #define ODR_XL_26HZ         0x20 // @07a 26Hz, +/-2g (low power once XL_HM_MODE is set)
+#define CTRL2_G         0x11    // Control register 2 @05a
+#define CTRL3_C         0x12    // Control register 3 @01a
+    #define BDU             0x40 // Block data update: output registers are not updated until both bytes are read
+    #define IF_INC          0x04 // Register address automatically incremented during a multiple byte access
+#define CTRL6_C         0x15    // Control register 6 @07a
+    #define XL_HM_MODE      0x10 // Accelerometer high performance mode disabled
 #define CTRL9_XL        0x18    // Control register 9
+#define CTRL10_C        0x19    // Control register 10 @05a
+
+// Wake up (motion) detection registers @07a
+#define TAP_CFG         0x58
+    #define INTERRUPTS_ENABLE   0x80 // Enables the wake up, tap and free fall functions
+#define WAKE_UP_THS     0x5B    // Wake up threshold (bits 5:0, 1/64 of full scale)
+    #define WAKE_UP_THS_MASK    0x3F
+#define WAKE_UP_DUR     0x5C    // Wake up duration (bits 6:5, 1/ODR)
+#define MD1_CFG         0x5E    // Functions routed to INT1
+    #define INT1_WU             0x20 // Wake up event on INT1
 
 #define STATUS_REG      0x1E    // The status register
     #define XLDA            0x1 // Accelerometer Data Available bit
 
+// FIFO status registers @02a
+// Note: Read as a block of 4 starting at FIFO_STATUS1
+#define FIFO_STATUS1    0x3A    // DIFF_FIFO[7:0]: number of unread words in the FIFO
+#define FIFO_STATUS2    0x3B
+    #define FIFO_WTM            0x80 // FIFO watermark level reached
+    #define FIFO_OVER_RUN       0x40 // FIFO is completely filled and at least one sample has been overwritten
+    #define FIFO_EMPTY          0x10 // FIFO is empty
+    #define DIFF_FIFO_H_MASK    0x0F // DIFF_FIFO[11:8]
+#define FIFO_STATUS3    0x3C    // FIFO_PATTERN[7:0]: which word will be read next
+#define FIFO_STATUS4    0x3D    // FIFO_PATTERN[9:8]
+    #define FIFO_PATTERN_H_MASK 0x03
+
+// FIFO data output register @02a
+// Note: With IF_INC set, a burst read from FIFO_DATA_OUT_L rolls back to
+//       FIFO_DATA_OUT_L after FIFO_DATA_OUT_H, so any number of words can be
+//       read in a single transaction.
+#define FIFO_DATA_OUT_L 0x3E
+
+// Gyroscope Output registers @01a
+// Note: These are directly before the accelerometer output registers, so
+//       both can be read in a single burst starting at OUTX_L_G.
+#define OUTX_L_G        0x22
+
 // Accelerometer Output registers
 #define OUTX_L_XL       0x28
 #define OUTX_H_XL       0x29
@@ -43,30 +108,76 @@
 
 // Constants
 #define WHO_AM_I_ID     0x69    // The device SPI WHO_AM_I ID that should be in the WHO_AM_I register
+#define AXES_BYTES      6       // @01a The number of bytes in the output registers for the 3 axes of one sensor
+#define AXES_WORDS      3       // @02a The number of FIFO words for the 3 axes of one sensor
+#define FIFO_STATUS_BYTES 4     // @02a FIFO_STATUS1 to FIFO_STATUS4
+#define FIFO_MAX_WORDS  4095    // @02a The maximum FIFO threshold (12 bits)
+#define FIFO_MAX_SKIP_WORDS 5   // @04a The most words dropped to realign on a sample
+#define WAKE_UP_SETTLE_MS 80     // @07a Two samples at 26Hz, for the slope filter to settle
+
+// @04a Command byte + the most words read from the FIFO in one batch
+#define FIFO_READ_BYTES (1 + (FIFO_MAX_SKIP_WORDS + SENSORS_ACCELGYRO_FIFO_BATCH_SIZE * 2 * AXES_WORDS) * 2)
+#if FIFO_READ_BYTES > COMM_SPI_MAX_TRANSFER_BYTES
+    #error "SENSORS_ACCELGYRO_FIFO_BATCH_SIZE does not fit in one SPI transaction"
+#endif
 
 // Private functions:
 uint8_t pReadRegister(uint8_t registerAddress); // reads a register
+void pReadRegisters(uint8_t startAddress, uint8_t * buffer, uint8_t length); // @01a reads consecutive registers
 void pWriteRegister(uint8_t registerAddress, uint8_t value);
+static int16_t pDecodeAxis(const uint8_t * raw, int16_t offset); // @01a converts a little endian register pair @06c and removes the offset
+static uint8_t pFifoWordsPerSample(); // @02a the number of FIFO words that make up one sample
+static void pConfigureInt1(); // @03a selects the INT1 source
+static void pWaitForAccelData(); // @03a waits for a new accelerometer sample
+static void pInt1EventHandler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action); // @03a GPIOTE handler
+static void pFifoStatusComplete(Comm_SPI_Transaction_t * transaction); // @04a FIFO status has been read
+static void pFifoDataComplete(Comm_SPI_Transaction_t * transaction); // @04a FIFO samples have been read
+static void pFifoFinish(); // @04a ends the FIFO read in progress
+static void pFifoSyncComplete(Sensors_AccelGyro_Batch_t * batch); // @04a handler for blocking FIFO reads
+
+// Private variables
+static bool mGyroEnabled = false; // @01a Indicates if the gyroscope has been enabled
+static uint32_t mFifoSampleIndex = 0; // @02a Running index of the next sample to be read from the FIFO
+static bool mFifoOverrun = false; // @02a Set when samples are lost, until reported in a batch
+static uint8_t mFifoBuffer[FIFO_READ_BYTES]; // @02a Raw FIFO data of one batch @04c (and status)
+static Comm_SPI_Transaction_t mFifoTransaction; // @04a The SPI transaction of the FIFO read in progress
+static uint8_t mFifoCommand; // @04a The command byte of mFifoTransaction
+static Sensors_AccelGyro_Batch_t * volatile mFifoBatch = NULL; // @04a The batch being read, NULL if no read is in progress
+static Sensors_AccelGyro_BatchHandler_t mFifoHandler; // @04a Called once mFifoBatch is complete
+static uint16_t mFifoSkipWords; // @04a Words dropped at the start of the read to realign on a sample
+static volatile bool mFifoSyncComplete; // @04a Set when a blocking FIFO read is complete
+static bool mFifoEnabled = false; // @03a Indicates if the FIFO has been enabled
+static Sensors_AccelGyro_DataReadyHandler_t mDataReadyHandler = NULL; // @03a Application INT1 handler, NULL if not routed
+static Sensors_AccelGyro_Calibration_t mCalibration; // @06a Offsets removed from every sample (0 until set)
 
 /*****************************************************************************
  * Description: Initializes the device, and waits for the device to come     *
  *              online successfully.                                         *
- *              Note: If the device is not connected, this will not return   *
+ *              Note: @03c If the device does not respond within             *
+ *                    SENSORS_ACCELGYRO_PROBE_ATTEMPTS, this returns false   *
+ *                    and the device is not configured.                      *
  *                                                                           *
- * Returns: None                                                             *
+ * Returns: true if the device was found and configured, otherwise false     *
  *                                                                           *
  * Parameters: None                                                          *
  *                                                                           *
  *****************************************************************************/
-void Sensors_AccelGyro_Init()
+bool Sensors_AccelGyro_Init()
 {
     // Initialize Accelerometer via SPI
     Comm_SPI_Init(); // init SPI interface
 
-    // Wait for accelerometer SPI device to become active.
-    uint8_t data = 0x00;
-    while(data != WHO_AM_I_ID)
+    // Wait for accelerometer SPI device to become active. @03c
+    // Give up after a bounded number of attempts so that a missing or
+    // miswired sensor is reported instead of hanging the application.
+    uint8_t data = pReadRegister(WHO_AM_I);
+    for(uint8_t attempt = 1; data != WHO_AM_I_ID; attempt++)
     {
+        if(attempt >= SENSORS_ACCELGYRO_PROBE_ATTEMPTS)
+        {
+            return false;
+        }
+        nrf_delay_ms(1);
         data = pReadRegister(WHO_AM_I);
     }
 
@@ -78,6 +189,29 @@ void Sensors_AccelGyro_Init()
 
     // 2. Write CTRL1_XL = 60h // Put the accelerometer in 416Hz (High-Performance mode)
     pWriteRegister(CTRL1_XL,0x60);
+
+    // 3. @01a Write CTRL3_C = 44h // Enable block data update and register address
+    //    auto-increment so that all output registers can be read in one burst
+    //    without the low and high bytes coming from different samples.
+    pWriteRegister(CTRL3_C, BDU | IF_INC);
+
+    // @05a As per the application note to enable gyroscope
+    // 4. Write CTRL10_C = 38h // Enable gyroscope axis X, Y and Z
+    pWriteRegister(CTRL10_C,0x38);
+
+    // 5. Write CTRL2_G = 60h // Put the gyroscope in 416Hz (High-Performance mode), 245 dps
+    pWriteRegister(CTRL2_G,0x60);
+    mGyroEnabled = true;
+
+    // @07a The device stays powered while the glove is in system off, so
+    // after a wake up it still has the wake up settings; put it back to
+    // high performance with only what INT1 is set up for below.
+    pWriteRegister(CTRL6_C, 0x00);
+    pWriteRegister(MD1_CFG, 0x00);
+    pWriteRegister(TAP_CFG, 0x00);
+    pWriteRegister(INT1_CTRL, 0x00);
+
+    return true;
 }
 
 /*****************************************************************************
@@ -92,17 +226,473 @@ void Sensors_AccelGyro_Init()
  *****************************************************************************/
 void Sensors_AccelGyro_GetAccelerometerData(Sensors_Accel_Data_t * data)
 {
-    // While there is no data available, keep waiting for XLDA to be 1
-    while((pReadRegister(STATUS_REG) & XLDA) == 0)
+    pWaitForAccelData(); // @03c
+
+    // @01c Read all of the accelerometer output registers (OUTX_L_XL to OUTZ_H_XL)
+    // in one burst, rather than one transfer per register.
+    uint8_t raw[AXES_BYTES];
+    pReadRegisters(OUTX_L_XL, raw, AXES_BYTES);
+
+    data->xData = pDecodeAxis(&raw[0], mCalibration.accelOffset[0]);
+    data->yData = pDecodeAxis(&raw[2], mCalibration.accelOffset[1]);
+    data->zData = pDecodeAxis(&raw[4], mCalibration.accelOffset[2]);
+}
+
+/*****************************************************************************
+ * Description: Gets the accelerometer and gyroscope data in a single burst  *
+ *              read, so that both come from the same sample. If the         *
+ *              gyroscope is not enabled, only the accelerometer registers   *
+ *              are read and the gyroscope data is set to 0. If data is not  *
+ *              available, this will block until data is available.     @01a *
+ *                                                                           *
+ * Returns: None (data is returned via 'accel' and 'gyro' parameters)        *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  Sensors_Accel_Data_t* accel - The accelerometer data                     *
+ *  Sensors_Gyro_Data_t* gyro   - The gyroscope data                         *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_AccelGyro_GetData(Sensors_Accel_Data_t * accel, Sensors_Gyro_Data_t * gyro)
+{
+    if(!mGyroEnabled)
+    {
+        gyro->xData = 0;
+        gyro->yData = 0;
+        gyro->zData = 0;
+        Sensors_AccelGyro_GetAccelerometerData(accel);
+        return;
+    }
+
+    pWaitForAccelData(); // @03c
+
+    // The gyroscope output registers (OUTX_L_G to OUTZ_H_G) are directly
+    // followed by the accelerometer output registers, so read all 12 at once.
+    uint8_t raw[2 * AXES_BYTES];
+    pReadRegisters(OUTX_L_G, raw, sizeof(raw));
+
+    gyro->xData  = pDecodeAxis(&raw[0], mCalibration.gyroOffset[0]);
+    gyro->yData  = pDecodeAxis(&raw[2], mCalibration.gyroOffset[1]);
+    gyro->zData  = pDecodeAxis(&raw[4], mCalibration.gyroOffset[2]);
+    accel->xData = pDecodeAxis(&raw[6], mCalibration.accelOffset[0]);
+    accel->yData = pDecodeAxis(&raw[8], mCalibration.accelOffset[1]);
+    accel->zData = pDecodeAxis(&raw[10], mCalibration.accelOffset[2]);
+}
+
+/*****************************************************************************
+ * Description: Configures the on-chip FIFO in continuous mode at the full   *
+ *              sample rate, with a watermark. Once enabled, samples should  *
+ *              be drained with Sensors_AccelGyro_ReadFifo rather than the   *
+ *              single sample functions above.                          @02a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  watermarkSamples - The number of samples in the FIFO that raises the     *
+ *                     FIFO watermark flag (and interrupt when routed)       *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_AccelGyro_EnableFifo(uint8_t watermarkSamples)
+{
+    // Going through bypass mode empties the FIFO, so that the first sample
+    // read afterwards is aligned on the start of the pattern.
+    pWriteRegister(FIFO_CTRL5, FIFO_MODE_BYPASS);
+
+    // The threshold is in words, not samples
+    uint16_t threshold = (uint16_t)watermarkSamples * pFifoWordsPerSample();
+    if(threshold > FIFO_MAX_WORDS)
+    {
+        threshold = FIFO_MAX_WORDS;
+    }
+    pWriteRegister(FIFO_CTRL1, (uint8_t)(threshold & 0xFF));
+    pWriteRegister(FIFO_CTRL2, (uint8_t)(threshold >> 8));
+
+    // Only store the gyroscope in the FIFO if it is running, otherwise
+    // every sample would carry 3 words of stale data.
+    pWriteRegister(FIFO_CTRL3, (mGyroEnabled ? DEC_FIFO_GYRO_NONE : 0) | DEC_FIFO_XL_NONE);
+
+    mFifoSampleIndex = 0;
+    mFifoOverrun = false;
+    pWriteRegister(FIFO_CTRL5, ODR_FIFO_416HZ | FIFO_MODE_CONTINUOUS);
+
+    // @03a If INT1 is already routed, switch it to the FIFO watermark
+    mFifoEnabled = true;
+    pConfigureInt1();
+}
+
+/*****************************************************************************
+ * Description: Drains up to SENSORS_ACCELGYRO_FIFO_BATCH_SIZE samples from  *
+ *              the FIFO in a single SPI burst. This does not block waiting  *
+ *              for data. If more samples remain in the FIFO than fit in the *
+ *              batch, call again.                                      @02a *
+ *              @04c This waits for Sensors_AccelGyro_ReadFifoAsync to       *
+ *              complete, so it must not be called from an interrupt.        *
+ *                                                                           *
+ * Returns: The number of samples placed in the batch (0 if FIFO is empty)   *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  Sensors_AccelGyro_Batch_t* batch - Where to place the samples            *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t Sensors_AccelGyro_ReadFifo(Sensors_AccelGyro_Batch_t * batch)
+{
+    mFifoSyncComplete = false;
+    if(Sensors_AccelGyro_ReadFifoAsync(batch, pFifoSyncComplete) != NRF_SUCCESS)
+    {
+        return 0;
+    }
+
+    // wait for the batch to be complete
+    while(!mFifoSyncComplete)
+    {
+        __WFE();
+    }
+
+    return batch->count;
+}
+
+/*****************************************************************************
+ * Description: Starts draining up to SENSORS_ACCELGYRO_FIFO_BATCH_SIZE      *
+ *              samples from the FIFO and returns without waiting. The FIFO  *
+ *              status and the samples are read as two chained SPI           *
+ *              transactions, started from the SPI interrupt, and the        *
+ *              handler is called from the SPI interrupt when the batch is   *
+ *              complete. This can be called from any context, including     *
+ *              the handler itself.                                     @04a *
+ *                                                                           *
+ * Returns: NRF_SUCCESS, or NRF_ERROR_BUSY if a read is already in progress  *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  Sensors_AccelGyro_Batch_t* batch - Where to place the samples. Must not  *
+ *                                     be used until the handler is called.  *
+ *  handler - Called with the batch once complete (may be NULL)              *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t Sensors_AccelGyro_ReadFifoAsync(Sensors_AccelGyro_Batch_t * batch, Sensors_AccelGyro_BatchHandler_t handler)
+{
+    bool busy;
+
+    CRITICAL_REGION_ENTER();
+    busy = (mFifoBatch != NULL);
+    if(!busy)
     {
+        mFifoBatch = batch;
     }
+    CRITICAL_REGION_EXIT();
 
-    // Note: Looking at the data sheet it appears as though we may be able to read more
-    //       efficiently if we set a control register appropriately, to be able to read the
-    //       entire set of registers in one read.
-    data->xData = ((uint16_t)pReadRegister(OUTX_H_XL) << 8) | (uint16_t)pReadRegister(OUTX_L_XL);
-    data->yData = ((uint16_t)pReadRegister(OUTY_H_XL) << 8) | (uint16_t)pReadRegister(OUTY_L_XL);
-    data->zData = ((uint16_t)pReadRegister(OUTZ_H_XL) << 8) | (uint16_t)pReadRegister(OUTZ_L_XL);
+    if(busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    mFifoHandler = handler;
+    batch->count = 0;
+    app_timer_cnt_get(&batch->timestamp);
+
+    // First get the number of unread words, and the word that will be read next
+    mFifoCommand = 0x80 | FIFO_STATUS1;
+    mFifoTransaction.txBuffer = &mFifoCommand;
+    mFifoTransaction.txBytes  = 1;
+    mFifoTransaction.rxBuffer = mFifoBuffer;
+    mFifoTransaction.rxBytes  = 1 + FIFO_STATUS_BYTES;
+    mFifoTransaction.callback = pFifoStatusComplete;
+
+    uint32_t errCode = Comm_SPI_Schedule(&mFifoTransaction);
+    if(errCode != NRF_SUCCESS)
+    {
+        mFifoBatch = NULL;
+    }
+    return errCode;
+}
+
+/*****************************************************************************
+ * Description: Called from the SPI interrupt once the FIFO status has been  *
+ *              read. Works out how many samples to read, and chains the     *
+ *              read of the samples.                                    @04a *
+ *****************************************************************************/
+static void pFifoStatusComplete(Comm_SPI_Transaction_t * transaction)
+{
+    // skip the byte that was received during the command byte
+    const uint8_t * status = &mFifoBuffer[1];
+    uint8_t wordsPerSample = pFifoWordsPerSample();
+
+    uint16_t words   = ((uint16_t)(status[1] & DIFF_FIFO_H_MASK) << 8) | status[0];
+    uint16_t pattern = ((uint16_t)(status[3] & FIFO_PATTERN_H_MASK) << 8) | status[2];
+    if((status[1] & FIFO_OVER_RUN) != 0)
+    {
+        mFifoOverrun = true;
+    }
+    if((status[1] & FIFO_EMPTY) != 0)
+    {
+        words = 0;
+    }
+
+    // After an overrun the oldest sample may have been partially overwritten,
+    // so the words before the start of the next sample are read and dropped.
+    mFifoSkipWords = 0;
+    if(pattern != 0 && pattern < wordsPerSample)
+    {
+        mFifoSkipWords = wordsPerSample - pattern;
+        mFifoOverrun = true; // @08c also when the read ends here
+        if(mFifoSkipWords > words)
+        {
+            pFifoFinish();
+            return;
+        }
+        words -= mFifoSkipWords;
+    }
+
+    uint16_t samples = words / wordsPerSample;
+    if(samples > SENSORS_ACCELGYRO_FIFO_BATCH_SIZE)
+    {
+        samples = SENSORS_ACCELGYRO_FIFO_BATCH_SIZE;
+    }
+    if(samples == 0)
+    {
+        pFifoFinish();
+        return;
+    }
+    mFifoBatch->count = (uint8_t)samples;
+
+    // Read the dropped words and the whole batch in one burst
+    mFifoCommand = 0x80 | FIFO_DATA_OUT_L;
+    transaction->rxBytes  = 1 + (mFifoSkipWords + samples * wordsPerSample) * 2;
+    transaction->callback = pFifoDataComplete;
+    APP_ERROR_CHECK(Comm_SPI_Schedule(transaction));
+}
+
+/*****************************************************************************
+ * Description: Called from the SPI interrupt once the samples have been     *
+ *              read. Decodes them into the batch.                      @04a *
+ *****************************************************************************/
+static void pFifoDataComplete(Comm_SPI_Transaction_t * transaction)
+{
+    Sensors_AccelGyro_Batch_t * batch = mFifoBatch;
+
+    // When both are stored, each sample is the gyroscope X,Y,Z followed by
+    // the accelerometer X,Y,Z.
+    const uint8_t * raw = &mFifoBuffer[1 + mFifoSkipWords * 2];
+    for(uint8_t i = 0; i < batch->count; i++)
+    {
+        if(mGyroEnabled)
+        {
+            batch->gyro[i].xData = pDecodeAxis(&raw[0], mCalibration.gyroOffset[0]);
+            batch->gyro[i].yData = pDecodeAxis(&raw[2], mCalibration.gyroOffset[1]);
+            batch->gyro[i].zData = pDecodeAxis(&raw[4], mCalibration.gyroOffset[2]);
+            raw += AXES_BYTES;
+        }
+        else
+        {
+            batch->gyro[i].xData = 0;
+            batch->gyro[i].yData = 0;
+            batch->gyro[i].zData = 0;
+        }
+        batch->accel[i].xData = pDecodeAxis(&raw[0], mCalibration.accelOffset[0]);
+        batch->accel[i].yData = pDecodeAxis(&raw[2], mCalibration.accelOffset[1]);
+        batch->accel[i].zData = pDecodeAxis(&raw[4], mCalibration.accelOffset[2]);
+        raw += AXES_BYTES;
+    }
+
+    pFifoFinish();
+}
+
+/*****************************************************************************
+ * Description: Ends the FIFO read in progress and passes the batch to its   *
+ *              handler. A new read can be started from the handler.    @04a *
+ *              @08c The index and overrun are set here, so that a batch     *
+ *              with no samples has them too.                                *
+ *****************************************************************************/
+static void pFifoFinish()
+{
+    Sensors_AccelGyro_Batch_t * batch = mFifoBatch;
+    Sensors_AccelGyro_BatchHandler_t handler = mFifoHandler;
+
+    batch->firstSampleIndex = mFifoSampleIndex;
+    batch->overrun = mFifoOverrun;
+    mFifoSampleIndex += batch->count;
+    mFifoOverrun = false;
+
+    mFifoBatch = NULL;
+    if(handler != NULL)
+    {
+        handler(batch);
+    }
+}
+
+/*****************************************************************************
+ * Description: Handler of the FIFO reads started by                         *
+ *              Sensors_AccelGyro_ReadFifo.                             @04a *
+ *****************************************************************************/
+static void pFifoSyncComplete(Sensors_AccelGyro_Batch_t * batch)
+{
+    mFifoSyncComplete = true;
+}
+
+/*****************************************************************************
+ * Description: Routes the device INT1 pin to a GPIOTE event, so that the    *
+ *              application is told when data is ready rather than polling.  *
+ *              If the FIFO is enabled, INT1 is raised when the FIFO         *
+ *              watermark is reached, otherwise when a new accelerometer     *
+ *              sample is ready.                                        @03a *
+ *                                                                           *
+ *              Note: The GPIOTE driver is initialized if it is not already. *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  handler - Called from interrupt context on each rising edge of INT1      *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_AccelGyro_EnableDataReadyInterrupt(Sensors_AccelGyro_DataReadyHandler_t handler)
+{
+    if(!nrf_drv_gpiote_is_init())
+    {
+        APP_ERROR_CHECK(nrf_drv_gpiote_init());
+    }
+
+    // INT1 is push-pull, active high. A low power (PORT) event is enough as
+    // the pin stays high until the data is read.
+    nrf_drv_gpiote_in_config_t config = GPIOTE_CONFIG_IN_SENSE_LOTOHI(false);
+    config.pull = NRF_GPIO_PIN_NOPULL;
+    APP_ERROR_CHECK(nrf_drv_gpiote_in_init(HDW_CONFIG_ACCEL_INT1_PIN, &config, pInt1EventHandler));
+
+    mDataReadyHandler = handler;
+    pConfigureInt1();
+
+    nrf_drv_gpiote_in_event_enable(HDW_CONFIG_ACCEL_INT1_PIN, true);
+}
+
+/*****************************************************************************
+ * Description: Sets the offsets that are subtracted from every sample as it *
+ *              is decoded, by the single sample and FIFO reads alike.  @06a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  calibration - The offsets, or NULL to return raw samples                 *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_AccelGyro_SetCalibration(const Sensors_AccelGyro_Calibration_t * calibration)
+{
+    // A FIFO read may be decoding in the SPI interrupt, so swap all of the
+    // offsets at once.
+    CRITICAL_REGION_ENTER();
+    if(calibration != NULL)
+    {
+        mCalibration = *calibration;
+    }
+    else
+    {
+        memset(&mCalibration, 0x00, sizeof(mCalibration));
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+/*****************************************************************************
+ * Description: Stops the FIFO and the gyroscope, puts the accelerometer in  *
+ *              low power mode and raises INT1 when it is moved. INT1 is set *
+ *              to wake the nRF51 from system off. The data ready interrupt  *
+ *              is no longer routed, and Sensors_AccelGyro_Init must be      *
+ *              called again to read samples.                           @07a *
+ *              Note: Call this from the main loop, not an interrupt, as it  *
+ *                    waits for a FIFO read in progress to finish.           *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_AccelGyro_EnableWakeUp()
+{
+    // No new reads are started once INT1 is no longer routed
+    if(mDataReadyHandler != NULL)
+    {
+        nrf_drv_gpiote_in_uninit(HDW_CONFIG_ACCEL_INT1_PIN);
+        mDataReadyHandler = NULL;
+    }
+    while(mFifoBatch != NULL)
+    {
+        __WFE();
+    }
+
+    pWriteRegister(INT1_CTRL, 0x00);
+    pWriteRegister(FIFO_CTRL5, FIFO_MODE_BYPASS);
+    mFifoEnabled = false;
+    pWriteRegister(CTRL2_G, 0x00);
+    mGyroEnabled = false;
+
+    // The wake up function compares the slope of consecutive samples with
+    // the threshold, so 26Hz is quick enough for a hand picking up the glove.
+    pWriteRegister(CTRL6_C, XL_HM_MODE);
+    pWriteRegister(CTRL1_XL, ODR_XL_26HZ);
+    pWriteRegister(WAKE_UP_DUR, 0x00);
+    pWriteRegister(WAKE_UP_THS, SENSORS_ACCELGYRO_WAKE_UP_THRESHOLD & WAKE_UP_THS_MASK);
+    pWriteRegister(TAP_CFG, INTERRUPTS_ENABLE); // Not latched, INT1 falls once still
+    pWriteRegister(MD1_CFG, INT1_WU);
+
+    // The first slope after the rate change is not a real movement
+    nrf_delay_ms(WAKE_UP_SETTLE_MS);
+
+    // The pin sense is what wakes the nRF51; the GPIOTE PORT event is not
+    // running in system off.
+    nrf_gpio_cfg_sense_input(HDW_CONFIG_ACCEL_INT1_PIN, NRF_GPIO_PIN_NOPULL, NRF_GPIO_PIN_SENSE_HIGH);
+}
+
+/*****************************************************************************
+ * Description: Selects what raises INT1: the FIFO watermark if the FIFO is  *
+ *              enabled, otherwise accelerometer data ready. Does nothing if *
+ *              INT1 is not routed.                                     @03a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *****************************************************************************/
+static void pConfigureInt1()
+{
+    if(mDataReadyHandler != NULL)
+    {
+        pWriteRegister(INT1_CTRL, mFifoEnabled ? INT1_FTH : INT1_DRDY_XL);
+    }
+}
+
+/*****************************************************************************
+ * Description: Waits for a new accelerometer sample. If INT1 is routed as   *
+ *              data ready, this sleeps until the pin is raised, otherwise   *
+ *              the STATUS_REG is polled over SPI.                      @03a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *****************************************************************************/
+static void pWaitForAccelData()
+{
+    if(mDataReadyHandler != NULL && !mFifoEnabled)
+    {
+        // Data ready is latched on the pin until the output is read, and
+        // the rising edge raises a GPIOTE interrupt which ends the __WFE.
+        while(!nrf_gpio_pin_read(HDW_CONFIG_ACCEL_INT1_PIN))
+        {
+            __WFE();
+        }
+    }
+    else
+    {
+        // While there is no data available, keep waiting for XLDA to be 1
+        while((pReadRegister(STATUS_REG) & XLDA) == 0)
+        {
+        }
+    }
+}
+
+/*****************************************************************************
+ * Description: Handles the GPIOTE event of the INT1 pin and passes it on to *
+ *              the application.                                        @03a *
+ *****************************************************************************/
+static void pInt1EventHandler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    if(mDataReadyHandler != NULL)
+    {
+        mDataReadyHandler();
+    }
 }
 
 /*****************************************************************************
@@ -124,6 +714,65 @@ uint8_t pReadRegister(uint8_t registerAddress)
     return rx;
 }
 
+/*****************************************************************************
+ * Description: Reads consecutive registers from the device in a single      *
+ *              transaction. Requires IF_INC to be set in CTRL3_C.      @01a *
+ *                                                                           *
+ * Returns: None (data is returned via 'buffer' parameter)                   *
+ *                                                                           *
+ * Parameters:                                                               *
+ *      startAddress - The first register to read                            *
+ *      buffer       - Where to place the register values                    *
+ *      length       - The number of registers to read                       *
+ *****************************************************************************/
+void pReadRegisters(uint8_t startAddress, uint8_t * buffer, uint8_t length)
+{
+    // bit0=1 for read, bit1-7 for the start address
+    Comm_SPI_ReadBurst(0x80 | startAddress, buffer, length);
+}
+
+/*****************************************************************************
+ * Description: Converts a pair of output registers (low byte first) into    *
+ *              a signed value.                                         @01a *
+ *              @06a The calibration offset is removed, saturating at the    *
+ *              limits of the range rather than wrapping around.             *
+ *                                                                           *
+ * Returns: The axis value                                                   *
+ *                                                                           *
+ * Parameters:                                                               *
+ *      raw    - Pointer to the low byte of the register pair                *
+ *      offset - The calibration offset of the axis                     @06a *
+ *****************************************************************************/
+static int16_t pDecodeAxis(const uint8_t * raw, int16_t offset)
+{
+    int32_t value = (int16_t)(((uint16_t)raw[1] << 8) | (uint16_t)raw[0]);
+
+    // @06a
+    value -= offset;
+    if(value > INT16_MAX)
+    {
+        value = INT16_MAX;
+    }
+    else if(value < INT16_MIN)
+    {
+        value = INT16_MIN;
+    }
+    return (int16_t)value;
+}
+
+/*****************************************************************************
+ * Description: Gets the number of 16 bit FIFO words that make up one        *
+ *              sample, based on which sensors are stored in the FIFO.  @02a *
+ *                                                                           *
+ * Returns: The number of words per sample                                   *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *****************************************************************************/
+static uint8_t pFifoWordsPerSample()
+{
+    return mGyroEnabled ? (2 * AXES_WORDS) : AXES_WORDS;
+}
+
 /*****************************************************************************
  * Description: Writes a register value to the device                        *
  *                                                                           *
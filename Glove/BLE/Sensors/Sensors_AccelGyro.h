@@ -17,6 +17,14 @@
 * | Flag    | (DDMYY)  | Author     | Description                         |  *
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 09Apr17  | BNordland  | Initial creation                    |  *
+* | @01     | 16Oct26  | BNordland  | Burst read of output registers      |  *
+* | @02     | 16Oct26  | BNordland  | Hardware FIFO streaming mode        |  *
+* | @03     | 16Oct26  | BNordland  | INT1 data ready, bounded init probe |  *
+* | @04     | 16Oct26  | BNordland  | Asynchronous chained FIFO reads     |  *
+* | @05     | 16Oct26  | BNordland  | Enabled the gyroscope               |  *
+* | @06     | 17Oct26  | BNordland  | Calibration offsets                 |  *
+* | @07     | 17Oct26  | BNordland  | Wake up on motion from system off   |  *
+* | @08     | 17Oct26  | BNordland  | Lower wake up threshold             |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
@@ -24,6 +32,43 @@
 #define _SENSORS_ACCELGYRO_H
 
 #include <stdint.h>
+#include <stdbool.h>
+
+// @02a The output data rate of the sensor (CTRL1_XL = 0x60)
+// @05c The gyroscope runs at the same rate (CTRL2_G = 0x60)
+#define SENSORS_ACCELGYRO_SAMPLE_RATE_HZ    416
+
+// @05a Sensitivity of the raw data at the configured full scale
+#define SENSORS_ACCELGYRO_ACCEL_UG_PER_LSB      61      // +/-2g: 0.061 mg/LSB
+#define SENSORS_ACCELGYRO_GYRO_UDPS_PER_LSB     8750    // 245 dps: 8.75 mdps/LSB
+
+// @02a The maximum number of samples returned in one FIFO batch.
+// Each sample is 12 bytes (gyro + accel), and one batch is read in a single
+// SPI burst, so this must fit in COMM_SPI_MAX_TRANSFER_BYTES. @04c
+#ifndef SENSORS_ACCELGYRO_FIFO_BATCH_SIZE
+    #define SENSORS_ACCELGYRO_FIFO_BATCH_SIZE 16
+#endif
+
+// @03a The number of times to read WHO_AM_I (1ms apart) before giving up.
+// The device boot time is 15ms after power up.
+#ifndef SENSORS_ACCELGYRO_PROBE_ATTEMPTS
+    #define SENSORS_ACCELGYRO_PROBE_ATTEMPTS 50
+#endif
+
+// @07a The wake up threshold, in 1/64 of the accelerometer full scale
+// (31.25mg at +/-2g), up to 63. The glove wakes from system off when
+// the slope, half the change between two samples at 26Hz, is more than this.
+// @08c At 1, turns from 100 dps wake it (190 dps at 2); see
+// test/Test_Sensors_AccelGyro.c.
+#ifndef SENSORS_ACCELGYRO_WAKE_UP_THRESHOLD
+    #define SENSORS_ACCELGYRO_WAKE_UP_THRESHOLD 1
+#endif
+
+// @03a Called from the GPIOTE interrupt when the device raises INT1.
+// Note: The blocking read functions must not be called from this handler, as
+//       it runs at the same priority as the SPI interrupt. @04c Start a read
+//       with Sensors_AccelGyro_ReadFifoAsync instead.
+typedef void (*Sensors_AccelGyro_DataReadyHandler_t)(void);
 
 // A structure that holds accelerometer data
 typedef struct
@@ -33,17 +78,54 @@ typedef struct
     int16_t    zData;
 } Sensors_Accel_Data_t;
 
+// A structure that holds gyroscope data @01a
+typedef struct
+{
+    int16_t    xData;
+    int16_t    yData;
+    int16_t    zData;
+} Sensors_Gyro_Data_t;
+
+// A batch of evenly spaced samples drained from the sensor FIFO @02a
+// Samples are in the order they were taken (oldest first). The sample
+// index is counted in sensor samples (1/SENSORS_ACCELGYRO_SAMPLE_RATE_HZ)
+// and can be used to time stamp each sample without any jitter:
+//      sample i was taken at sample index (firstSampleIndex + i).
+typedef struct
+{
+    uint32_t                firstSampleIndex; // Running sample index of accel[0]/gyro[0]
+    uint32_t                timestamp;        // app_timer (RTC1) ticks when the batch was drained
+    uint8_t                 count;            // Number of valid samples in the batch
+    bool                    overrun;          // True if the FIFO overflowed and samples were lost before this batch
+    Sensors_Accel_Data_t    accel[SENSORS_ACCELGYRO_FIFO_BATCH_SIZE];
+    Sensors_Gyro_Data_t     gyro[SENSORS_ACCELGYRO_FIFO_BATCH_SIZE]; // 0 if the gyroscope is not enabled
+} Sensors_AccelGyro_Batch_t;
+
+// @06a Offsets subtracted from every raw sample, in raw LSBs
+typedef struct
+{
+    int16_t    accelOffset[3];  // X, Y, Z
+    int16_t    gyroOffset[3];   // X, Y, Z (bias at rest)
+} Sensors_AccelGyro_Calibration_t;
+
+// @04a Called from the SPI interrupt when an asynchronous FIFO read is done.
+// If batch->count is SENSORS_ACCELGYRO_FIFO_BATCH_SIZE, more samples may be
+// waiting in the FIFO.
+typedef void (*Sensors_AccelGyro_BatchHandler_t)(Sensors_AccelGyro_Batch_t * batch);
+
 /*****************************************************************************
  * Description: Initializes the device, and waits for the device to come     *
  *              online successfully.                                         *
- *              Note: If the device is not connected, this will not return   *
+ *              Note: @03c If the device does not respond within             *
+ *                    SENSORS_ACCELGYRO_PROBE_ATTEMPTS, this returns false   *
+ *                    and the device is not configured.                      *
  *                                                                           *
- * Returns: None                                                             *
+ * Returns: true if the device was found and configured, otherwise false     *
  *                                                                           *
  * Parameters: None                                                          *
  *                                                                           *
  *****************************************************************************/
-void Sensors_AccelGyro_Init();
+bool Sensors_AccelGyro_Init();
 
 /*****************************************************************************
  * Description: Gets the accelerometer data. If data is not available,       *
@@ -57,4 +139,115 @@ void Sensors_AccelGyro_Init();
  *****************************************************************************/
 void Sensors_AccelGyro_GetAccelerometerData(Sensors_Accel_Data_t * data);
 
+/*****************************************************************************
+ * Description: Gets the accelerometer and gyroscope data in a single burst  *
+ *              read, so that both come from the same sample. If the         *
+ *              gyroscope is not enabled, only the accelerometer registers   *
+ *              are read and the gyroscope data is set to 0. If data is not  *
+ *              available, this will block until data is available.     @01a *
+ *                                                                           *
+ * Returns: None (data is returned via 'accel' and 'gyro' parameters)        *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  Sensors_Accel_Data_t* accel - The accelerometer data                     *
+ *  Sensors_Gyro_Data_t* gyro   - The gyroscope data                         *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_AccelGyro_GetData(Sensors_Accel_Data_t * accel, Sensors_Gyro_Data_t * gyro);
+
+/*****************************************************************************
+ * Description: Configures the on-chip FIFO in continuous mode at the full   *
+ *              sample rate, with a watermark. Once enabled, samples should  *
+ *              be drained with Sensors_AccelGyro_ReadFifo rather than the   *
+ *              single sample functions above.                          @02a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  watermarkSamples - The number of samples in the FIFO that raises the     *
+ *                     FIFO watermark flag (and interrupt when routed)       *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_AccelGyro_EnableFifo(uint8_t watermarkSamples);
+
+/*****************************************************************************
+ * Description: Drains up to SENSORS_ACCELGYRO_FIFO_BATCH_SIZE samples from  *
+ *              the FIFO in a single SPI burst. This does not block waiting  *
+ *              for data. If more samples remain in the FIFO than fit in the *
+ *              batch, call again.                                      @02a *
+ *              @04c This waits for Sensors_AccelGyro_ReadFifoAsync to       *
+ *              complete, so it must not be called from an interrupt.        *
+ *                                                                           *
+ * Returns: The number of samples placed in the batch (0 if FIFO is empty)   *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  Sensors_AccelGyro_Batch_t* batch - Where to place the samples            *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t Sensors_AccelGyro_ReadFifo(Sensors_AccelGyro_Batch_t * batch);
+
+/*****************************************************************************
+ * Description: Starts draining up to SENSORS_ACCELGYRO_FIFO_BATCH_SIZE      *
+ *              samples from the FIFO and returns without waiting. The FIFO  *
+ *              status and the samples are read as two chained SPI           *
+ *              transactions, started from the SPI interrupt, and the        *
+ *              handler is called from the SPI interrupt when the batch is   *
+ *              complete. This can be called from any context, including     *
+ *              the handler itself.                                     @04a *
+ *                                                                           *
+ * Returns: NRF_SUCCESS, or NRF_ERROR_BUSY if a read is already in progress  *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  Sensors_AccelGyro_Batch_t* batch - Where to place the samples. Must not  *
+ *                                     be used until the handler is called.  *
+ *  handler - Called with the batch once complete (may be NULL)              *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t Sensors_AccelGyro_ReadFifoAsync(Sensors_AccelGyro_Batch_t * batch, Sensors_AccelGyro_BatchHandler_t handler);
+
+/*****************************************************************************
+ * Description: Routes the device INT1 pin to a GPIOTE event, so that the    *
+ *              application is told when data is ready rather than polling.  *
+ *              If the FIFO is enabled, INT1 is raised when the FIFO         *
+ *              watermark is reached, otherwise when a new accelerometer     *
+ *              sample is ready.                                        @03a *
+ *                                                                           *
+ *              Note: The GPIOTE driver is initialized if it is not already. *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  handler - Called from interrupt context on each rising edge of INT1      *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_AccelGyro_EnableDataReadyInterrupt(Sensors_AccelGyro_DataReadyHandler_t handler);
+
+/*****************************************************************************
+ * Description: Sets the offsets that are subtracted from every sample as it *
+ *              is decoded, by the single sample and FIFO reads alike.  @06a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  calibration - The offsets, or NULL to return raw samples                 *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_AccelGyro_SetCalibration(const Sensors_AccelGyro_Calibration_t * calibration);
+
+/*****************************************************************************
+ * Description: Stops the FIFO and the gyroscope, puts the accelerometer in  *
+ *              low power mode and raises INT1 when it is moved. INT1 is set *
+ *              to wake the nRF51 from system off. The data ready interrupt  *
+ *              is no longer routed, and Sensors_AccelGyro_Init must be      *
+ *              called again to read samples.                           @07a *
+ *              Note: Call this from the main loop, not an interrupt, as it  *
+ *                    waits for a FIFO read in progress to finish.           *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_AccelGyro_EnableWakeUp();
+
 #endif // _SENSORS_ACCELGYRO_H
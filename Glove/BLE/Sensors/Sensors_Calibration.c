@@ -0,0 +1,277 @@
+/*****************************************************************************
+* FILENAME: Sensors_Calibration.c                                            *
+*                                                                            *
+* DESCRIPTION: Calibration of the accelerometer offsets and gyroscope bias.  *
+*              The offsets are estimated in the background the first time    *
+*              the glove is held flat and still, saved to flash, and loaded  *
+*              into the sensor driver at start up.                           *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Sensors_Calibration.h"
+
+#include <string.h>
+
+#include "Storage_Flash.h"
+
+// Constants
+#define RECORD_VERSION  1       // Changed whenever the meaning of the record changes
+#define AXES            3       // X, Y, Z
+#define Z_AXIS          2
+
+// 1g in raw accelerometer LSBs. Held flat, Z reads 1g and X and Y read 0.
+#define ACCEL_ONE_G_LSB ((1000000L + SENSORS_ACCELGYRO_ACCEL_UG_PER_LSB / 2) / SENSORS_ACCELGYRO_ACCEL_UG_PER_LSB)
+
+// The calibration as it is stored in flash (a multiple of 4 bytes)
+typedef struct
+{
+    uint16_t                        version;    // RECORD_VERSION
+    uint16_t                        reserved;   // 0
+    Sensors_AccelGyro_Calibration_t offsets;
+} Record_t;
+
+// Private functions
+static void pRestart(); // starts a new still period
+static bool pIsValid(const Sensors_AccelGyro_Calibration_t * offsets); // checks the offsets are plausible
+static int16_t pAverage(int32_t sum, int32_t count); // rounded average
+static bool pAddSample(const int16_t * accel, const int16_t * gyro); // adds a sample to the still period
+static void pTrack(int16_t value, int16_t * low, int16_t * high); // tracks the range of an axis
+
+// Private variables
+static bool mRunning = false; // A calibration is in progress
+static uint16_t mStillSamples; // The number of samples in the current still period
+static int32_t mAccelSum[AXES]; // Sums of the samples of the still period
+static int32_t mGyroSum[AXES];
+static int16_t mAccelLow[AXES]; // The range of the samples of the still period
+static int16_t mAccelHigh[AXES];
+static int16_t mGyroLow[AXES];
+static int16_t mGyroHigh[AXES];
+
+/*****************************************************************************
+ * Description: Loads the calibration from flash into the sensor driver. If  *
+ *              there is no valid calibration, the raw samples are used and  *
+ *              a background calibration is started.                         *
+ *              Note: Storage_Flash_Init must be called first.               *
+ *                                                                           *
+ * Returns: true if a calibration was loaded, false if it will be estimated  *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+bool Sensors_Calibration_Init()
+{
+    Record_t record;
+
+    if(Storage_Flash_Read(STORAGE_FLASH_KEY_IMU_CALIBRATION, &record, sizeof(record)) &&
+       record.version == RECORD_VERSION && pIsValid(&record.offsets))
+    {
+        Sensors_AccelGyro_SetCalibration(&record.offsets);
+        mRunning = false;
+        return true;
+    }
+
+    Sensors_Calibration_Start();
+    return false;
+}
+
+/*****************************************************************************
+ * Description: Discards the current calibration and starts a new one. The   *
+ *              glove must then be held flat and still.                      *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_Calibration_Start()
+{
+    // The estimate is made from raw samples
+    Sensors_AccelGyro_SetCalibration(NULL);
+    pRestart();
+    mRunning = true;
+}
+
+/*****************************************************************************
+ * Description: Feeds a batch of samples to the calibration in progress.     *
+ *              Once the glove has been still for                            *
+ *              SENSORS_CALIBRATION_STILL_SAMPLES, the averages are applied  *
+ *              to the sensor driver and saved to flash. Returns straight    *
+ *              away if no calibration is in progress.                       *
+ *                                                                           *
+ * Returns: true if a new calibration was applied by this batch (later       *
+ *          batches are offset), otherwise false                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  batch - The samples from the FIFO                                        *
+ *                                                                           *
+ *****************************************************************************/
+bool Sensors_Calibration_Update(const Sensors_AccelGyro_Batch_t * batch)
+{
+    if(!mRunning)
+    {
+        return false;
+    }
+
+    // Samples were lost, so the still period can not be trusted
+    if(batch->overrun)
+    {
+        pRestart();
+    }
+
+    for(uint8_t i = 0; i < batch->count; i++)
+    {
+        const int16_t accel[AXES] = {batch->accel[i].xData, batch->accel[i].yData, batch->accel[i].zData};
+        const int16_t gyro[AXES]  = {batch->gyro[i].xData,  batch->gyro[i].yData,  batch->gyro[i].zData};
+
+        if(!pAddSample(accel, gyro))
+        {
+            // The glove moved, start again from this sample
+            pRestart();
+            pAddSample(accel, gyro);
+        }
+
+        if(mStillSamples >= SENSORS_CALIBRATION_STILL_SAMPLES)
+        {
+            Record_t record;
+            memset(&record, 0x00, sizeof(record));
+            record.version = RECORD_VERSION;
+
+            for(uint8_t axis = 0; axis < AXES; axis++)
+            {
+                int32_t accelSum = mAccelSum[axis];
+                if(axis == Z_AXIS)
+                {
+                    accelSum -= ACCEL_ONE_G_LSB * mStillSamples;
+                }
+                record.offsets.accelOffset[axis] = pAverage(accelSum, mStillSamples);
+                record.offsets.gyroOffset[axis]  = pAverage(mGyroSum[axis], mStillSamples);
+            }
+
+            if(!pIsValid(&record.offsets))
+            {
+                // Still, but not held flat (or a faulty sensor)
+                pRestart();
+                return false;
+            }
+
+            Sensors_AccelGyro_SetCalibration(&record.offsets);
+            mRunning = false;
+
+            // If it can not be saved, it is estimated again on the next start
+            (void)Storage_Flash_Write(STORAGE_FLASH_KEY_IMU_CALIBRATION, &record, sizeof(record));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*****************************************************************************
+ * Description: Starts a new still period                                    *
+ *****************************************************************************/
+static void pRestart()
+{
+    mStillSamples = 0;
+    memset(mAccelSum, 0x00, sizeof(mAccelSum));
+    memset(mGyroSum, 0x00, sizeof(mGyroSum));
+}
+
+/*****************************************************************************
+ * Description: Adds a sample to the still period, unless it moves one of    *
+ *              the axes too far from the other samples of the period.       *
+ *                                                                           *
+ * Returns: true if the sample was added, false if the glove moved           *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  accel - The accelerometer X, Y, Z                                        *
+ *  gyro  - The gyroscope X, Y, Z                                            *
+ *****************************************************************************/
+static bool pAddSample(const int16_t * accel, const int16_t * gyro)
+{
+    for(uint8_t axis = 0; axis < AXES; axis++)
+    {
+        if(mStillSamples == 0)
+        {
+            mAccelLow[axis] = mAccelHigh[axis] = accel[axis];
+            mGyroLow[axis]  = mGyroHigh[axis]  = gyro[axis];
+        }
+        pTrack(accel[axis], &mAccelLow[axis], &mAccelHigh[axis]);
+        pTrack(gyro[axis],  &mGyroLow[axis],  &mGyroHigh[axis]);
+
+        if((int32_t)mAccelHigh[axis] - mAccelLow[axis] > SENSORS_CALIBRATION_ACCEL_STILL_LSB ||
+           (int32_t)mGyroHigh[axis]  - mGyroLow[axis]  > SENSORS_CALIBRATION_GYRO_STILL_LSB)
+        {
+            return false;
+        }
+    }
+
+    for(uint8_t axis = 0; axis < AXES; axis++)
+    {
+        mAccelSum[axis] += accel[axis];
+        mGyroSum[axis]  += gyro[axis];
+    }
+    mStillSamples++;
+    return true;
+}
+
+/*****************************************************************************
+ * Description: Checks that offsets are within what the sensor can have.     *
+ *                                                                           *
+ * Returns: true if every offset is plausible                                *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  offsets - The offsets to check                                           *
+ *****************************************************************************/
+static bool pIsValid(const Sensors_AccelGyro_Calibration_t * offsets)
+{
+    for(uint8_t axis = 0; axis < AXES; axis++)
+    {
+        if(offsets->accelOffset[axis] > SENSORS_CALIBRATION_MAX_ACCEL_OFFSET_LSB ||
+           offsets->accelOffset[axis] < -SENSORS_CALIBRATION_MAX_ACCEL_OFFSET_LSB ||
+           offsets->gyroOffset[axis]  > SENSORS_CALIBRATION_MAX_GYRO_BIAS_LSB ||
+           offsets->gyroOffset[axis]  < -SENSORS_CALIBRATION_MAX_GYRO_BIAS_LSB)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*****************************************************************************
+ * Description: Divides a sum by a count, rounding to the nearest value      *
+ *****************************************************************************/
+static int16_t pAverage(int32_t sum, int32_t count)
+{
+    if(sum >= 0)
+    {
+        return (int16_t)((sum + count / 2) / count);
+    }
+    return (int16_t)((sum - count / 2) / count);
+}
+
+/*****************************************************************************
+ * Description: Widens the range of an axis to include a value               *
+ *****************************************************************************/
+static void pTrack(int16_t value, int16_t * low, int16_t * high)
+{
+    if(value < *low)
+    {
+        *low = value;
+    }
+    if(value > *high)
+    {
+        *high = value;
+    }
+}
@@ -0,0 +1,88 @@
+/*****************************************************************************
+* FILENAME: Sensors_Calibration.h                                            *
+*                                                                            *
+* DESCRIPTION: Calibration of the accelerometer offsets and gyroscope bias.  *
+*              The offsets are estimated in the background the first time    *
+*              the glove is held flat and still, saved to flash, and loaded  *
+*              into the sensor driver at start up.                           *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef SENSORS_CALIBRATION_H__
+#define SENSORS_CALIBRATION_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Sensors_AccelGyro.h"
+
+// How long the glove must be held still to be calibrated (2s)
+#ifndef SENSORS_CALIBRATION_STILL_SAMPLES
+    #define SENSORS_CALIBRATION_STILL_SAMPLES   (2 * SENSORS_ACCELGYRO_SAMPLE_RATE_HZ)
+#endif
+
+// The most each axis may move while still, from its lowest to its highest
+// sample, in raw LSBs: about 2 dps for the gyroscope and 0.05g for the
+// accelerometer.
+#define SENSORS_CALIBRATION_GYRO_STILL_LSB      229
+#define SENSORS_CALIBRATION_ACCEL_STILL_LSB     820
+
+// The largest offsets that are accepted, in raw LSBs. The LSM6DS33 zero
+// rate level is at most 10 dps, and the accelerometer offset includes how
+// far the sensor is tilted on the glove (0.25g is about 15 degrees).
+#define SENSORS_CALIBRATION_MAX_GYRO_BIAS_LSB   1143
+#define SENSORS_CALIBRATION_MAX_ACCEL_OFFSET_LSB 4096
+
+/*****************************************************************************
+ * Description: Loads the calibration from flash into the sensor driver. If  *
+ *              there is no valid calibration, the raw samples are used and  *
+ *              a background calibration is started.                         *
+ *              Note: Storage_Flash_Init must be called first.               *
+ *                                                                           *
+ * Returns: true if a calibration was loaded, false if it will be estimated  *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+bool Sensors_Calibration_Init();
+
+/*****************************************************************************
+ * Description: Discards the current calibration and starts a new one. The   *
+ *              glove must then be held flat and still.                      *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_Calibration_Start();
+
+/*****************************************************************************
+ * Description: Feeds a batch of samples to the calibration in progress.     *
+ *              Once the glove has been still for                            *
+ *              SENSORS_CALIBRATION_STILL_SAMPLES, the averages are applied  *
+ *              to the sensor driver and saved to flash. Returns straight    *
+ *              away if no calibration is in progress.                       *
+ *                                                                           *
+ * Returns: true if a new calibration was applied by this batch (later       *
+ *          batches are offset), otherwise false                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  batch - The samples from the FIFO                                        *
+ *                                                                           *
+ *****************************************************************************/
+bool Sensors_Calibration_Update(const Sensors_AccelGyro_Batch_t * batch);
+
+#endif /* SENSORS_CALIBRATION_H__ */
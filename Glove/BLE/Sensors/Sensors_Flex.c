@@ -0,0 +1,505 @@
+/*****************************************************************************
+* FILENAME: Sensors_Flex.c                                                   *
+*                                                                            *
+* DESCRIPTION: Interprets the flex sensors of the glove. Each sensor is      *
+*              calibrated by flexing it fully a few times, which gives its   *
+*              straight and bent readings. A response table is built from    *
+*              them and stored in flash, so converting a reading to a bend   *
+*              is a table lookup.                                            *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Timed ADC scan with filtering       |  *
+* | @02     | 17Oct26  | BNordland  | Power down before system off        |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Sensors_Flex.h"
+
+#include <string.h>
+
+#include "NordicSDK.h" // For app_timer_cnt_get @01c and the ADC, TIMER and PPI drivers
+#include "Config_Hardware.h" // @01a For the flex sensor channels
+#include "Storage_Flash.h"
+
+// Constants
+#define RECORD_VERSION      1   // Changed whenever the meaning of the record changes
+#define TIMER_PRESCALER     0   // The app_timer prescaler set up by main
+
+// The table has a point every 16 ADC counts, plus one past the last
+// reading so every reading lies between two points.
+#define TABLE_SHIFT         4
+#define TABLE_STEP          (1 << TABLE_SHIFT)
+#define TABLE_POINTS        ((SENSORS_FLEX_ADC_MAX >> TABLE_SHIFT) + 2)
+
+// The flex sensor resistance as a fraction of the divider resistor, with
+// 10 fraction bits
+#define RESISTANCE_SHIFT    10
+
+// @01a The filtered readings have 4 fraction bits, so that the first order
+// filter still moves for small changes.
+#define FILTER_FRACTION_BITS 4
+
+// @01a Each buffer holds one filtered reading of every sensor, as
+// consecutive scans of all the channels.
+#define SCAN_BUFFER_SIZE    (SENSORS_FLEX_CHANNEL_COUNT << SENSORS_FLEX_DECIMATION_SHIFT)
+#define SCAN_BUFFERS        2
+
+// The calibration of one sensor as it is stored in flash
+typedef struct
+{
+    uint16_t    version;                // RECORD_VERSION
+    uint16_t    bent;                   // The reading when fully bent
+    uint16_t    straight;               // The reading when straight
+    uint8_t     table[TABLE_POINTS];    // The bend at each point
+} Record_t;
+
+// Private functions
+static void pBuildTable(Record_t * record, uint16_t bent, uint16_t straight); // fills in a response table
+static uint32_t pResistance(uint16_t adc); // the relative flex resistance of a reading
+static uint8_t pLookup(const uint8_t * table, uint16_t adc); // interpolates a response table
+static void pFinishCalibration(); // builds and saves the tables of the calibrated sensors
+static void pStartScan(); // @01a starts the timed ADC scan
+static void pAdcEventHandler(nrf_drv_adc_evt_t const * event); // @01a a buffer of scans is complete
+static void pScanTimerHandler(nrf_timer_event_t event, void * context); // @01a unused, required by the driver
+static void pFilterScans(const nrf_adc_value_t * buffer); // @01a filters a buffer of scans
+
+// Private variables
+static Record_t mRecords[SENSORS_FLEX_CHANNEL_COUNT]; // The calibration of each sensor
+static bool mBent[SENSORS_FLEX_CHANNEL_COUNT]; // The bent state of each sensor
+static bool mCalibrating = false; // A calibration is in progress
+static uint32_t mCalibrationStart; // app_timer ticks when the calibration started
+static uint16_t mLow[SENSORS_FLEX_CHANNEL_COUNT]; // The lowest reading while calibrating
+static uint16_t mHigh[SENSORS_FLEX_CHANNEL_COUNT]; // The highest reading while calibrating
+static nrf_drv_adc_channel_t mAdcChannels[] = HDW_CONFIG_FLEX_ADC_CHANNELS; // @01a The scan list (linked by the driver)
+static const uint32_t mPowerPins[] = HDW_CONFIG_FLEX_VIN_PINS; // @01a The power pin of each sensor
+static const nrf_drv_timer_t mScanTimer = NRF_DRV_TIMER_INSTANCE(1); // @01a Starts each scan (TIMER0 belongs to the SoftDevice)
+static nrf_adc_value_t mScanBuffers[SCAN_BUFFERS][SCAN_BUFFER_SIZE]; // @01a The ADC fills one while the other is filtered
+static uint8_t mNextScanBuffer; // @01a The buffer the ADC fills next
+static bool mFilterPrimed = false; // @01a mFiltered holds a reading
+static uint16_t mFiltered[SENSORS_FLEX_CHANNEL_COUNT]; // @01a The filtered reading of each sensor
+static volatile uint8_t mBend[SENSORS_FLEX_CHANNEL_COUNT]; // @01a The bend of each sensor from the last filtered reading
+
+// @01a Every channel needs a sensor in Sensors_Flex_Channel_t and a power pin
+STATIC_ASSERT(ARRAY_SIZE(mAdcChannels) == SENSORS_FLEX_CHANNEL_COUNT);
+STATIC_ASSERT(ARRAY_SIZE(mPowerPins) == SENSORS_FLEX_CHANNEL_COUNT);
+
+/*****************************************************************************
+ * Description: Loads the response tables from flash. If any sensor has not  *
+ *              been calibrated, a calibration is started.                   *
+ *              @01a Powers the sensors and starts scanning them; each       *
+ *              filtered reading is passed to Sensors_Flex_Update from the   *
+ *              ADC interrupt.                                               *
+ *              Note: Storage_Flash_Init must be called first. @01c The      *
+ *              SoftDevice must be enabled, as it owns the PPI channels.     *
+ *                                                                           *
+ * Returns: true if every sensor was calibrated, false if calibrating        *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+bool Sensors_Flex_Init()
+{
+    bool calibrated = true;
+
+    for(uint8_t channel = 0; channel < SENSORS_FLEX_CHANNEL_COUNT; channel++)
+    {
+        Record_t * record = &mRecords[channel];
+        mBent[channel] = false;
+
+        if(!Storage_Flash_Read(STORAGE_FLASH_KEY_FLEX_CALIBRATION + channel, record, sizeof(Record_t)) ||
+           record->version != RECORD_VERSION)
+        {
+            pBuildTable(record, SENSORS_FLEX_DEFAULT_BENT, SENSORS_FLEX_DEFAULT_STRAIGHT);
+            calibrated = false;
+        }
+    }
+
+    if(!calibrated)
+    {
+        Sensors_Flex_StartCalibration();
+    }
+
+    // @01a Apply power to the sensors, then sample them
+    for(uint8_t channel = 0; channel < SENSORS_FLEX_CHANNEL_COUNT; channel++)
+    {
+        nrf_gpio_cfg_output(mPowerPins[channel]);
+        nrf_gpio_pin_set(mPowerPins[channel]);
+    }
+    pStartScan();
+
+    return calibrated;
+}
+
+/*****************************************************************************
+ * Description: Starts learning the straight and bent readings of every      *
+ *              sensor. The sensors should be flexed fully a few times over  *
+ *              the next SENSORS_FLEX_CALIBRATION_MS. The sensors report no  *
+ *              bend until the calibration is done.                          *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_Flex_StartCalibration()
+{
+    for(uint8_t channel = 0; channel < SENSORS_FLEX_CHANNEL_COUNT; channel++)
+    {
+        mLow[channel] = SENSORS_FLEX_ADC_MAX;
+        mHigh[channel] = 0;
+        mBent[channel] = false;
+    }
+
+    APP_ERROR_CHECK(app_timer_cnt_get(&mCalibrationStart));
+    mCalibrating = true;
+}
+
+/*****************************************************************************
+ * Description: Passes a new reading of a sensor. This tracks the bent state *
+ *              of the sensor and, while calibrating, its range. Once the    *
+ *              calibration time is up, the tables are built and saved.      *
+ *                                                                           *
+ * Returns: The bend of the sensor, 0 (straight) to SENSORS_FLEX_BEND_MAX    *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  channel - The sensor                                                     *
+ *  adc     - The ADC reading of the sensor                                  *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t Sensors_Flex_Update(Sensors_Flex_Channel_t channel, uint16_t adc)
+{
+    if(adc > SENSORS_FLEX_ADC_MAX)
+    {
+        adc = SENSORS_FLEX_ADC_MAX;
+    }
+
+    if(mCalibrating)
+    {
+        if(adc < mLow[channel])
+        {
+            mLow[channel] = adc;
+        }
+        if(adc > mHigh[channel])
+        {
+            mHigh[channel] = adc;
+        }
+
+        uint32_t now;
+        uint32_t elapsed;
+        APP_ERROR_CHECK(app_timer_cnt_get(&now));
+        APP_ERROR_CHECK(app_timer_cnt_diff_compute(now, mCalibrationStart, &elapsed));
+        if(elapsed < APP_TIMER_TICKS(SENSORS_FLEX_CALIBRATION_MS, TIMER_PRESCALER))
+        {
+            return 0;
+        }
+        pFinishCalibration();
+    }
+
+    uint8_t bend = pLookup(mRecords[channel].table, adc);
+
+    if(bend >= SENSORS_FLEX_BENT_ON)
+    {
+        mBent[channel] = true;
+    }
+    else if(bend <= SENSORS_FLEX_BENT_OFF)
+    {
+        mBent[channel] = false;
+    }
+
+    return bend;
+}
+
+/*****************************************************************************
+ * Description: Gets the bend of a sensor, as of its last filtered           *
+ *              reading.                                                @01a *
+ *                                                                           *
+ * Returns: The bend of the sensor, 0 (straight) to SENSORS_FLEX_BEND_MAX    *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  channel - The sensor                                                     *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t Sensors_Flex_GetBend(Sensors_Flex_Channel_t channel)
+{
+    return mBend[channel];
+}
+
+/*****************************************************************************
+ * Description: Gets whether a sensor is bent, with hysteresis between       *
+ *              SENSORS_FLEX_BENT_ON and SENSORS_FLEX_BENT_OFF, as of the    *
+ *              last Sensors_Flex_Update.                                    *
+ *                                                                           *
+ * Returns: true if the sensor is bent                                       *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  channel - The sensor                                                     *
+ *                                                                           *
+ *****************************************************************************/
+bool Sensors_Flex_IsBent(Sensors_Flex_Channel_t channel)
+{
+    return mBent[channel];
+}
+
+/*****************************************************************************
+ * Description: Gets whether a calibration is in progress                    *
+ *                                                                           *
+ * Returns: true while calibrating                                           *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+bool Sensors_Flex_IsCalibrating()
+{
+    return mCalibrating;
+}
+
+/*****************************************************************************
+ * Description: Stops the scan and removes the power from the sensors. The   *
+ *              pins keep their state in system off, so this must be called  *
+ *              before it, or the sensors drain the battery while the glove  *
+ *              is off.                                                 @02a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_Flex_PowerDown()
+{
+    nrf_drv_timer_disable(&mScanTimer);
+
+    for(uint8_t channel = 0; channel < SENSORS_FLEX_CHANNEL_COUNT; channel++)
+    {
+        nrf_gpio_pin_clear(mPowerPins[channel]);
+    }
+}
+
+/*****************************************************************************
+ * Description: Starts the timed ADC scan. TIMER1 raises a compare event at  *
+ *              SENSORS_FLEX_SCAN_RATE_HZ, which PPI connects to the ADC     *
+ *              START task. The driver converts the channels of the scan     *
+ *              list one after another, and interrupts once a buffer of      *
+ *              scans is full.                                          @01a *
+ *****************************************************************************/
+static void pStartScan()
+{
+    ret_code_t err_code;
+
+    nrf_drv_adc_config_t adcConfig = NRF_DRV_ADC_DEFAULT_CONFIG;
+    err_code = nrf_drv_adc_init(&adcConfig, pAdcEventHandler);
+    APP_ERROR_CHECK(err_code);
+
+    for(uint8_t channel = 0; channel < SENSORS_FLEX_CHANNEL_COUNT; channel++)
+    {
+        nrf_drv_adc_channel_enable(&mAdcChannels[channel]);
+    }
+
+    mNextScanBuffer = 1;
+    err_code = nrf_drv_adc_buffer_convert(mScanBuffers[0], SCAN_BUFFER_SIZE);
+    APP_ERROR_CHECK(err_code);
+
+    // The timer only drives PPI, its interrupt is not enabled
+    nrf_drv_timer_config_t timerConfig = NRF_DRV_TIMER_DEFAULT_CONFIG;
+    timerConfig.frequency = NRF_TIMER_FREQ_31250Hz;
+    timerConfig.bit_width = NRF_TIMER_BIT_WIDTH_16;
+    err_code = nrf_drv_timer_init(&mScanTimer, &timerConfig, pScanTimerHandler);
+    APP_ERROR_CHECK(err_code);
+
+    nrf_drv_timer_extended_compare(&mScanTimer, NRF_TIMER_CC_CHANNEL0,
+                                   nrf_drv_timer_us_to_ticks(&mScanTimer, 1000000 / SENSORS_FLEX_SCAN_RATE_HZ),
+                                   NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK, false);
+
+    err_code = nrf_drv_ppi_init();
+    if(err_code != NRF_ERROR_MODULE_ALREADY_INITIALIZED)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    nrf_ppi_channel_t ppiChannel;
+    err_code = nrf_drv_ppi_channel_alloc(&ppiChannel);
+    APP_ERROR_CHECK(err_code);
+    err_code = nrf_drv_ppi_channel_assign(ppiChannel,
+                                          nrf_drv_timer_compare_event_address_get(&mScanTimer, NRF_TIMER_CC_CHANNEL0),
+                                          nrf_drv_adc_start_task_get());
+    APP_ERROR_CHECK(err_code);
+    err_code = nrf_drv_ppi_channel_enable(ppiChannel);
+    APP_ERROR_CHECK(err_code);
+
+    nrf_drv_timer_enable(&mScanTimer);
+}
+
+/*****************************************************************************
+ * Description: Called from the ADC interrupt when a buffer of scans is      *
+ *              full. The other buffer is handed to the driver straight      *
+ *              away, so no scan is missed while this one is filtered.  @01a *
+ *****************************************************************************/
+static void pAdcEventHandler(nrf_drv_adc_evt_t const * event)
+{
+    if(event->type != NRF_DRV_ADC_EVT_DONE)
+    {
+        return;
+    }
+
+    APP_ERROR_CHECK(nrf_drv_adc_buffer_convert(mScanBuffers[mNextScanBuffer], SCAN_BUFFER_SIZE));
+    mNextScanBuffer = (mNextScanBuffer + 1) % SCAN_BUFFERS;
+
+    pFilterScans(event->data.done.p_buffer);
+}
+
+/*****************************************************************************
+ * Description: TIMER1 event handler. The compare interrupt is not enabled,  *
+ *              so this is never called.                                @01a *
+ *****************************************************************************/
+static void pScanTimerHandler(nrf_timer_event_t event, void * context)
+{
+    // No implementation needed.
+}
+
+/*****************************************************************************
+ * Description: Averages the scans of each sensor, smooths the average with  *
+ *              a first order filter and passes it to Sensors_Flex_Update.   *
+ *              Only shifts are used, as the number of scans and the filter  *
+ *              weight are powers of 2.                                 @01a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  buffer - SCAN_BUFFER_SIZE conversions, one scan of every channel after   *
+ *           another                                                         *
+ *****************************************************************************/
+static void pFilterScans(const nrf_adc_value_t * buffer)
+{
+    for(uint8_t channel = 0; channel < SENSORS_FLEX_CHANNEL_COUNT; channel++)
+    {
+        uint32_t sum = 0;
+        for(uint16_t i = channel; i < SCAN_BUFFER_SIZE; i += SENSORS_FLEX_CHANNEL_COUNT)
+        {
+            sum += (uint16_t)buffer[i];
+        }
+
+        // The average, with FILTER_FRACTION_BITS fraction bits
+        int32_t average = (int32_t)((sum << FILTER_FRACTION_BITS) >> SENSORS_FLEX_DECIMATION_SHIFT);
+        if(!mFilterPrimed)
+        {
+            mFiltered[channel] = (uint16_t)average;
+        }
+        else
+        {
+            mFiltered[channel] += (average - mFiltered[channel]) >> SENSORS_FLEX_FILTER_SHIFT;
+        }
+
+        uint16_t adc = (mFiltered[channel] + (1 << (FILTER_FRACTION_BITS - 1))) >> FILTER_FRACTION_BITS;
+        mBend[channel] = Sensors_Flex_Update((Sensors_Flex_Channel_t)channel, adc);
+    }
+    mFilterPrimed = true;
+}
+
+/*****************************************************************************
+ * Description: Ends the calibration. Each sensor that was flexed through at *
+ *              least SENSORS_FLEX_MIN_SPAN gets a new table, which is saved *
+ *              to flash. The others keep their previous table.              *
+ *****************************************************************************/
+static void pFinishCalibration()
+{
+    mCalibrating = false;
+
+    for(uint8_t channel = 0; channel < SENSORS_FLEX_CHANNEL_COUNT; channel++)
+    {
+        if(mHigh[channel] < mLow[channel] + SENSORS_FLEX_MIN_SPAN)
+        {
+            continue;
+        }
+
+        pBuildTable(&mRecords[channel], mLow[channel], mHigh[channel]);
+
+        // If it can not be saved, the sensors are calibrated again on the next start
+        (void)Storage_Flash_Write(STORAGE_FLASH_KEY_FLEX_CALIBRATION + channel, &mRecords[channel], sizeof(Record_t));
+    }
+}
+
+/*****************************************************************************
+ * Description: Fills in the response table of a sensor. The flex sensor is  *
+ *              the top of a divider, so its resistance, which grows evenly  *
+ *              with the bend, is a curve of the reading:                    *
+ *                  R = Rdivider * (1024 - adc) / adc                        *
+ *              Each point of the table is the bend at that reading, as a    *
+ *              fraction of the resistance between straight and bent.        *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  record   - The record to fill in                                         *
+ *  bent     - The reading when fully bent                                   *
+ *  straight - The reading when straight                                     *
+ *****************************************************************************/
+static void pBuildTable(Record_t * record, uint16_t bent, uint16_t straight)
+{
+    uint32_t straightResistance = pResistance(straight);
+    uint32_t span = pResistance(bent) - straightResistance;
+
+    memset(record, 0x00, sizeof(Record_t));
+    record->version = RECORD_VERSION;
+    record->bent = bent;
+    record->straight = straight;
+
+    for(uint8_t i = 0; i < TABLE_POINTS; i++)
+    {
+        uint16_t adc = (uint16_t)i << TABLE_SHIFT;
+
+        if(adc <= bent)
+        {
+            record->table[i] = SENSORS_FLEX_BEND_MAX;
+        }
+        else if(adc >= straight)
+        {
+            record->table[i] = 0;
+        }
+        else
+        {
+            uint32_t resistance = pResistance(adc) - straightResistance;
+            record->table[i] = (uint8_t)((resistance * SENSORS_FLEX_BEND_MAX + span / 2) / span);
+        }
+    }
+}
+
+/*****************************************************************************
+ * Description: Gets the flex sensor resistance of a reading, relative to    *
+ *              the divider resistor, with RESISTANCE_SHIFT fraction bits    *
+ *****************************************************************************/
+static uint32_t pResistance(uint16_t adc)
+{
+    if(adc == 0)
+    {
+        adc = 1;
+    }
+    return ((uint32_t)((SENSORS_FLEX_ADC_MAX + 1) - adc) << RESISTANCE_SHIFT) / adc;
+}
+
+/*****************************************************************************
+ * Description: Gets the bend of a reading from a response table, by         *
+ *              interpolating between the two points around the reading.     *
+ *                                                                           *
+ * Returns: The bend, 0 to SENSORS_FLEX_BEND_MAX                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  table - The response table                                               *
+ *  adc   - The reading, at most SENSORS_FLEX_ADC_MAX                        *
+ *****************************************************************************/
+static uint8_t pLookup(const uint8_t * table, uint16_t adc)
+{
+    uint8_t index = adc >> TABLE_SHIFT;
+    int16_t start = table[index];
+    int16_t step = (int16_t)table[index + 1] - start;
+
+    return (uint8_t)(start + ((step * (int16_t)(adc & (TABLE_STEP - 1)) + TABLE_STEP / 2) >> TABLE_SHIFT));
+}
@@ -0,0 +1,169 @@
+/*****************************************************************************
+* FILENAME: Sensors_Flex.h                                                   *
+*                                                                            *
+* DESCRIPTION: Interprets the flex sensors of the glove. Each sensor is      *
+*              calibrated by flexing it fully a few times, which gives its   *
+*              straight and bent readings. A response table is built from    *
+*              them and stored in flash, so converting a reading to a bend   *
+*              is a table lookup.                                            *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Timed ADC scan with filtering       |  *
+* | @02     | 17Oct26  | BNordland  | Power down before system off        |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef SENSORS_FLEX_H__
+#define SENSORS_FLEX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The flex sensors on the glove
+// @01a In the order of HDW_CONFIG_FLEX_ADC_CHANNELS
+typedef enum
+{
+    SENSORS_FLEX_THROTTLE = 0,
+    SENSORS_FLEX_DIRECTION,
+    SENSORS_FLEX_CHANNEL_COUNT
+} Sensors_Flex_Channel_t;
+
+// @01a Every sensor is converted this often. The conversions are started
+// by TIMER1 through PPI, so the CPU is not involved in the timing.
+#ifndef SENSORS_FLEX_SCAN_RATE_HZ
+    #define SENSORS_FLEX_SCAN_RATE_HZ       400
+#endif
+
+// @01a Each filtered reading is the average of 2^shift scans (50Hz), which
+// is then smoothed by a first order filter that moves 1/2^shift of the way
+// to each new average.
+#define SENSORS_FLEX_DECIMATION_SHIFT       3
+#define SENSORS_FLEX_FILTER_SHIFT           2
+
+// The largest ADC reading (10 bit conversions)
+#define SENSORS_FLEX_ADC_MAX                1023
+
+// The bend reported for a fully bent sensor
+#define SENSORS_FLEX_BEND_MAX               100
+
+// How long the sensors are flexed for calibration
+#ifndef SENSORS_FLEX_CALIBRATION_MS
+    #define SENSORS_FLEX_CALIBRATION_MS     5000
+#endif
+
+// The smallest difference between the straight and bent readings of a
+// calibrated sensor. Less than this and the sensor was not flexed.
+#define SENSORS_FLEX_MIN_SPAN               64
+
+// The readings used until a sensor is calibrated
+#define SENSORS_FLEX_DEFAULT_BENT           750
+#define SENSORS_FLEX_DEFAULT_STRAIGHT       1023
+
+// The bend at which a sensor counts as bent, and the bend it must return
+// below to count as straight again, so a sensor held near one threshold
+// does not flicker between the two.
+#define SENSORS_FLEX_BENT_ON                60
+#define SENSORS_FLEX_BENT_OFF               40
+
+/*****************************************************************************
+ * Description: Loads the response tables from flash. If any sensor has not  *
+ *              been calibrated, a calibration is started.                   *
+ *              @01a Powers the sensors and starts scanning them; each       *
+ *              filtered reading is passed to Sensors_Flex_Update from the   *
+ *              ADC interrupt.                                               *
+ *              Note: Storage_Flash_Init must be called first. @01c The      *
+ *              SoftDevice must be enabled, as it owns the PPI channels.     *
+ *                                                                           *
+ * Returns: true if every sensor was calibrated, false if calibrating        *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+bool Sensors_Flex_Init();
+
+/*****************************************************************************
+ * Description: Starts learning the straight and bent readings of every      *
+ *              sensor. The sensors should be flexed fully a few times over  *
+ *              the next SENSORS_FLEX_CALIBRATION_MS. The sensors report no  *
+ *              bend until the calibration is done.                          *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_Flex_StartCalibration();
+
+/*****************************************************************************
+ * Description: Passes a new reading of a sensor. This tracks the bent state *
+ *              of the sensor and, while calibrating, its range. Once the    *
+ *              calibration time is up, the tables are built and saved.      *
+ *                                                                           *
+ * Returns: The bend of the sensor, 0 (straight) to SENSORS_FLEX_BEND_MAX    *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  channel - The sensor                                                     *
+ *  adc     - The ADC reading of the sensor                                  *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t Sensors_Flex_Update(Sensors_Flex_Channel_t channel, uint16_t adc);
+
+/*****************************************************************************
+ * Description: Gets the bend of a sensor, as of its last filtered           *
+ *              reading.                                                @01a *
+ *                                                                           *
+ * Returns: The bend of the sensor, 0 (straight) to SENSORS_FLEX_BEND_MAX    *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  channel - The sensor                                                     *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t Sensors_Flex_GetBend(Sensors_Flex_Channel_t channel);
+
+/*****************************************************************************
+ * Description: Gets whether a sensor is bent, with hysteresis between       *
+ *              SENSORS_FLEX_BENT_ON and SENSORS_FLEX_BENT_OFF, as of the    *
+ *              last Sensors_Flex_Update.                                    *
+ *                                                                           *
+ * Returns: true if the sensor is bent                                       *
+ *                                                                           *
+ * Parameters:                                                               *
+ *  channel - The sensor                                                     *
+ *                                                                           *
+ *****************************************************************************/
+bool Sensors_Flex_IsBent(Sensors_Flex_Channel_t channel);
+
+/*****************************************************************************
+ * Description: Gets whether a calibration is in progress                    *
+ *                                                                           *
+ * Returns: true while calibrating                                           *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+bool Sensors_Flex_IsCalibrating();
+
+/*****************************************************************************
+ * Description: Stops the scan and removes the power from the sensors. The   *
+ *              pins keep their state in system off, so this must be called  *
+ *              before it, or the sensors drain the battery while the glove  *
+ *              is off.                                                 @02a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Sensors_Flex_PowerDown();
+
+#endif /* SENSORS_FLEX_H__ */
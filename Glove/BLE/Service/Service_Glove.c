@@ -15,6 +15,15 @@
 * | Flag    | (DDMYY)  | Author     | Description                         |  *
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 09Apr17  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Added Orientation characteristic    |  *
+* | @02     | 17Oct26  | BNordland  | Packed control frame characteristic |  *
+* | @03     | 17Oct26  | BNordland  | Notification TX flow control        |  *
+* | @04     | 17Oct26  | BNordland  | Telemetry characteristic            |  *
+* | @05     | 17Oct26  | BNordland  | Connection profile telemetry        |  *
+* | @06     | 17Oct26  | BNordland  | Raw IMU stream characteristic       |  *
+* | @07     | 17Oct26  | BNordland  | Wake up time telemetry              |  *
+* | @08     | 17Oct26  | BNordland  | Reconnect time telemetry            |  *
+* | @09     | 17Oct26  | BNordland  | Database version characteristic     |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
@@ -23,27 +32,89 @@
 #include "Service_Glove.h"
 #include "ble_srv_common.h"
 #include "app_error.h"
+#include "app_util_platform.h" // @03a Critical regions
+#include "Service_Stream.h" // @06a Stream frame length
 
 // 16-bit characteristic UUIDs
-#define BLE_UUID_GLOVE_ANGLEPITCH_CHARACTERISTC_UUID          0x1001 // Glove Service AnglePitch Characterstic
-#define BLE_UUID_GLOVE_THROTTLE_CHARACTERISTC_UUID          0x10A0 // Glove Service Throttle Characterstic
-#define BLE_UUID_GLOVE_DIRECTION_CHARACTERISTC_UUID          0x10A1 // Glove Service Direction Characterstic
+// @02c AnglePitch (0x1001), Throttle (0x10A0) and Direction (0x10A1) are
+//      replaced by the Control characteristic.
+#define BLE_UUID_GLOVE_ORIENTATION_CHARACTERISTC_UUID        0x1002 // Glove Service Orientation Characterstic @01a
+#define BLE_UUID_GLOVE_CONTROL_CHARACTERISTC_UUID            0x10B0 // Glove Service Control Characterstic @02a
+#define BLE_UUID_GLOVE_TELEMETRY_CHARACTERISTC_UUID          0x10B1 // Glove Service Telemetry Characterstic @04a
+#define BLE_UUID_GLOVE_STREAM_CHARACTERISTC_UUID             0x10B2 // Glove Service Stream Characterstic @06a
+#define BLE_UUID_GLOVE_DB_VERSION_CHARACTERISTC_UUID         0x10B3 // Glove Service Database Version Characterstic @09a
+
+// Length of the Orientation characteristic: 6 x int16 @01a
+#define ORIENTATION_LEN                                      12
+
+// @03a Largest notification with the default ATT MTU
+#define NOTIFICATION_MAX_LEN                                 (GATT_MTU_SIZE_DEFAULT - 3)
+STATIC_ASSERT(SERVICE_GLOVE_CONTROL_LEN <= NOTIFICATION_MAX_LEN);
+STATIC_ASSERT(ORIENTATION_LEN <= NOTIFICATION_MAX_LEN);
+STATIC_ASSERT(SERVICE_GLOVE_TELEMETRY_LEN <= NOTIFICATION_MAX_LEN); // @04a
+STATIC_ASSERT(SERVICE_STREAM_FRAME_LEN <= NOTIFICATION_MAX_LEN); // @06a
+
+// @06a Stream frames waiting for a TX buffer (about 40ms of samples).
+// Unlike the other notifications every frame is sent, in order.
+#define STREAM_QUEUE_LEN                                     16
+
+// @03a The notifications of the service, in the order they are sent when
+// TX buffers free up. Control goes first as the vehicle drives from it.
+typedef enum
+{
+    NOTIFICATION_CONTROL = 0,
+    NOTIFICATION_ORIENTATION,
+    NOTIFICATION_TELEMETRY,     // @04a
+    NOTIFICATION_COUNT
+} Notification_t;
+
+// @03a A notification waiting for a TX buffer. Only the newest value is
+// kept, a new value replaces one that was not sent yet.
+typedef struct
+{
+    uint16_t    handle;                        // Value handle of the characteristic
+    uint8_t     value[NOTIFICATION_MAX_LEN];   // The newest value
+    uint16_t    length;                        // Length of the value
+    bool        pending;                       // The value is waiting to be sent
+} Notification_Pending_t;
+
+// @06a A stream frame waiting for a TX buffer
+typedef struct
+{
+    uint8_t     value[SERVICE_STREAM_FRAME_LEN]; // The frame
+    uint16_t    length;                          // Length of the frame
+} Stream_Frame_t;
 
 // Type Definitions (Private service variables)
 typedef struct
 {
     uint16_t    conn_handle;         // Current Connection Handle -> provided by bluetooth stack.
     uint16_t    service_handle;      // Handle for the Glove Service -> provided by the bluetooth stack.
-    ble_gatts_char_handles_t anglePitch_char_handles; // Handle for the pitch characteristic
-    ble_gatts_char_handles_t direction_char_handles; // Handle for the direction characteristic
-    ble_gatts_char_handles_t throttle_char_handles; // Handle for the throttle characteristic
+    ble_gatts_char_handles_t orientation_char_handles; // Handle for the orientation characteristic @01a
+    ble_gatts_char_handles_t control_char_handles; // Handle for the control characteristic @02a
+    ble_gatts_char_handles_t telemetry_char_handles; // Handle for the telemetry characteristic @04a
+    uint8_t     control_sequence;    // Sequence number of the next control frame @02a
+    Notification_Pending_t notifications[NOTIFICATION_COUNT]; // Notifications waiting for a TX buffer @03a
+    uint8_t     tx_buffers_free;     // TX buffers the SoftDevice has left for this connection @03a
+    ble_gatts_char_handles_t stream_char_handles; // Handle for the stream characteristic @06a
+    Stream_Frame_t stream_frames[STREAM_QUEUE_LEN]; // Stream frames waiting for a TX buffer @06a
+    uint8_t     stream_head;         // Oldest frame in stream_frames @06a
+    uint8_t     stream_count;        // Frames in stream_frames @06a
+    ble_gatts_char_handles_t db_version_char_handles; // Handle for the database version characteristic @09a
 } Service_Glove_t;
 
 
 // Internal Function Definitions
 uint32_t pAddCharacteristics();
 uint32_t pAddCharacteristicImpl(uint16_t characteristicUUID, char user_desc[],
-                                    uint8_t attributeMaxLen, uint8_t attributeInitLen, uint8_t * attributeValue, ble_gatts_char_handles_t* char_handles);
+                                    uint8_t attributeMaxLen, uint8_t attributeInitLen, uint8_t * attributeValue, ble_gatts_char_handles_t* char_handles,
+                                    bool notify); // @09c
+static uint8_t * pEncodeInt16(uint8_t * buffer, int16_t value); // @01a Little endian encoding
+static uint8_t * pEncodeUInt32(uint8_t * buffer, uint32_t value); // @02a Little endian encoding
+static void pQueueNotification(Notification_t notification, const uint8_t * value, uint16_t length); // @03a
+static void pSendNotifications(); // @03a Sends queued notifications while there are TX buffers
+static void pResetNotifications(); // @03a Drops queued notifications
+static void pSendStream(); // @06a Sends queued stream frames while there are TX buffers
 
 // Internal Global Variables
 static Service_Glove_t mGloveService;
@@ -64,9 +135,25 @@ void Service_Glove_BluetoothEventHandler(ble_evt_t * event)
     {
         case BLE_GAP_EVT_CONNECTED:
             mGloveService.conn_handle = event->evt.gap_evt.conn_handle;
+
+            // @03a Start with the TX buffers the SoftDevice has for the link.
+            // If the count is unknown, assume one; a BLE_ERROR_NO_TX_PACKETS
+            // then means a packet is in flight and a TX complete will follow.
+            pResetNotifications();
+            if(sd_ble_tx_packet_count_get(mGloveService.conn_handle, &mGloveService.tx_buffers_free) != NRF_SUCCESS)
+            {
+                mGloveService.tx_buffers_free = 1;
+            }
             break;
         case BLE_GAP_EVT_DISCONNECTED:
             mGloveService.conn_handle = BLE_CONN_HANDLE_INVALID;
+            pResetNotifications(); // @03a
+            break;
+        case BLE_EVT_TX_COMPLETE:
+            // @03a Buffers were freed, send what is waiting right away
+            // rather than at the next timer tick.
+            mGloveService.tx_buffers_free += event->evt.common_evt.params.tx_complete.count;
+            pSendNotifications();
             break;
         default:
             // No implementation needed.
@@ -119,90 +206,178 @@ bool Service_Glove_IsConnected()
 }
 
 /*****************************************************************************
- * Description: Updates the AnglePitch Characteristic and sends it to         *
- *              connected bluetooth device                                   *
+ * Description: Updates the Control Characteristic and sends it to           *
+ *              connected bluetooth device in a single notification.    @02a *
+ *              @02c Replaces the AnglePitch, Throttle and Direction         *
+ *              characteristics.                                             *
  *                                                                           *
  * Returns: None                                                             *
  *                                                                           *
  * Parameters:                                                               *
- *      int16_t *anglePitch - The Pitch angle of the glove                     *
+ *      Service_Glove_Control_t *control - The control inputs of the glove   *
  *                                                                           *
  *****************************************************************************/
-void Service_Glove_SetAnglePitch(int16_t *anglePitch)
+void Service_Glove_SetControl(const Service_Glove_Control_t *control)
 {
     // Update characteristic value
     if (mGloveService.conn_handle != BLE_CONN_HANDLE_INVALID)
     {
-        uint16_t               len = 2;
-        ble_gatts_hvx_params_t hvx_params;
-        memset(&hvx_params, 0, sizeof(hvx_params));
-
-        hvx_params.handle = mGloveService.anglePitch_char_handles.value_handle;
-        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-        hvx_params.offset = 0;
-        hvx_params.p_len  = &len;
-        hvx_params.p_data = (uint8_t*)anglePitch;
-
-        sd_ble_gatts_hvx(mGloveService.conn_handle, &hvx_params);
+        // Encode explicitly, see SERVICE_GLOVE_CONTROL_LEN for the layout
+        uint8_t value[SERVICE_GLOVE_CONTROL_LEN];
+        uint8_t * next = value;
+        *next++ = SERVICE_GLOVE_CONTROL_VERSION;
+        *next++ = mGloveService.control_sequence++;
+        next = pEncodeUInt32(next, control->timestamp);
+        next = pEncodeInt16(next, control->pitch);
+        next = pEncodeInt16(next, control->roll);
+        *next++ = control->throttle;
+        *next++ = control->direction;
+
+        // @03c Sent as soon as there is a TX buffer
+        pQueueNotification(NOTIFICATION_CONTROL, value, SERVICE_GLOVE_CONTROL_LEN);
     }
 }
 
 /*****************************************************************************
- * Description: Updates the Throttle Characteristic and sends it to          *
- *              connected bluetooth device                                   *
+ * Description: Updates the Orientation Characteristic and sends it to       *
+ *              connected bluetooth device. The value is 6 little endian     *
+ *              int16: roll, pitch, yaw (centidegrees), then roll rate,      *
+ *              pitch rate, yaw rate (centidegrees per second).         @01a *
  *                                                                           *
  * Returns: None                                                             *
  *                                                                           *
  * Parameters:                                                               *
- *      uint8_t *throttle - The throttle value of the glove                  *
+ *      Fusion_Orientation_t *orientation - The orientation of the glove     *
  *                                                                           *
  *****************************************************************************/
-void Service_Glove_SetThrottle(uint8_t *throttle)
+void Service_Glove_SetOrientation(Fusion_Orientation_t *orientation)
 {
     // Update characteristic value
     if (mGloveService.conn_handle != BLE_CONN_HANDLE_INVALID)
     {
-        uint16_t               len = 1;
-        ble_gatts_hvx_params_t hvx_params;
-        memset(&hvx_params, 0, sizeof(hvx_params));
-
-        hvx_params.handle = mGloveService.throttle_char_handles.value_handle;
-        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-        hvx_params.offset = 0;
-        hvx_params.p_len  = &len;
-        hvx_params.p_data = (uint8_t*)throttle;
-
-        sd_ble_gatts_hvx(mGloveService.conn_handle, &hvx_params);
+        // Encode explicitly, rather than sending the struct, so the layout
+        // does not depend on the compiler.
+        uint8_t value[ORIENTATION_LEN];
+        uint8_t * next = value;
+        next = pEncodeInt16(next, orientation->roll);
+        next = pEncodeInt16(next, orientation->pitch);
+        next = pEncodeInt16(next, orientation->yaw);
+        next = pEncodeInt16(next, orientation->rollRate);
+        next = pEncodeInt16(next, orientation->pitchRate);
+        next = pEncodeInt16(next, orientation->yawRate);
+
+        // @03c Sent as soon as there is a TX buffer
+        pQueueNotification(NOTIFICATION_ORIENTATION, value, ORIENTATION_LEN);
     }
 }
 
 /*****************************************************************************
- * Description: Updates the Direction Characteristic and sends it to         *
- *              connected bluetooth device                                   *
+ * Description: Updates the Telemetry Characteristic and sends it to         *
+ *              connected bluetooth device, after any control or             *
+ *              orientation notification waiting for a TX buffer.       @04a *
  *                                                                           *
  * Returns: None                                                             *
  *                                                                           *
  * Parameters:                                                               *
- *      uint8_t *throttle - The throttle value of the glove                  *
+ *      Service_Glove_Telemetry_t *telemetry - The debug statistics          *
  *                                                                           *
  *****************************************************************************/
-void Service_Glove_SetDirection(uint8_t *direction)
+void Service_Glove_SetTelemetry(const Service_Glove_Telemetry_t *telemetry)
 {
     // Update characteristic value
     if (mGloveService.conn_handle != BLE_CONN_HANDLE_INVALID)
     {
-        uint16_t               len = 1;
-        ble_gatts_hvx_params_t hvx_params;
-        memset(&hvx_params, 0, sizeof(hvx_params));
+        uint8_t value[SERVICE_GLOVE_TELEMETRY_LEN];
+        uint8_t * next = value;
+        *next++ = SERVICE_GLOVE_TELEMETRY_VERSION;
+        next = pEncodeInt16(next, (int16_t)telemetry->sampleAge);
+        next = pEncodeInt16(next, (int16_t)telemetry->sampleAgeAvg);
+        next = pEncodeInt16(next, (int16_t)telemetry->sampleAgeMax);
+        next = pEncodeInt16(next, (int16_t)telemetry->interval); // @05a
+        *next++ = telemetry->profile; // @05a
+        next = pEncodeUInt32(next, telemetry->profileTime); // @05a
+        next = pEncodeInt16(next, (int16_t)telemetry->streamDropped); // @06a
+        next = pEncodeInt16(next, (int16_t)telemetry->wakeTime); // @07a
+        *next++ = telemetry->wakeCause; // @07a @08c
+
+        // Also set the value, so it can be read without notifications
+        ble_gatts_value_t gatts_value;
+        memset(&gatts_value, 0, sizeof(gatts_value));
+        gatts_value.len     = SERVICE_GLOVE_TELEMETRY_LEN;
+        gatts_value.offset  = 0;
+        gatts_value.p_value = value;
+        sd_ble_gatts_value_set(mGloveService.conn_handle, mGloveService.telemetry_char_handles.value_handle, &gatts_value);
+
+        pQueueNotification(NOTIFICATION_TELEMETRY, value, SERVICE_GLOVE_TELEMETRY_LEN);
+    }
+}
 
-        hvx_params.handle = mGloveService.direction_char_handles.value_handle;
-        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-        hvx_params.offset = 0;
-        hvx_params.p_len  = &len;
-        hvx_params.p_data = (uint8_t*)direction;
+/*****************************************************************************
+ * Description: Indicates if the vehicle has enabled the notifications of    *
+ *              the Stream characteristic. Read from the CCCD itself, so it  *
+ *              also holds for a bonded vehicle whose CCCDs were restored.   *
+ *                                                                      @06a *
+ *                                                                           *
+ * Returns: true if stream frames should be sent                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+bool Service_Glove_IsStreaming()
+{
+    if (mGloveService.conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return false;
+    }
+
+    uint8_t cccd[BLE_CCCD_VALUE_LEN];
+    ble_gatts_value_t gatts_value;
+    memset(&gatts_value, 0, sizeof(gatts_value));
+    gatts_value.len     = BLE_CCCD_VALUE_LEN;
+    gatts_value.offset  = 0;
+    gatts_value.p_value = cccd;
 
-        sd_ble_gatts_hvx(mGloveService.conn_handle, &hvx_params);
+    if(sd_ble_gatts_value_get(mGloveService.conn_handle, mGloveService.stream_char_handles.cccd_handle, &gatts_value) != NRF_SUCCESS)
+    {
+        return false;
     }
+    return ble_srv_is_notification_enabled(cccd);
+}
+
+/*****************************************************************************
+ * Description: Queues a stream frame, sent after the other notifications    *
+ *              when there are TX buffers to spare.                     @06a *
+ *                                                                           *
+ * Returns: true if the frame was queued, false if the queue is full or the  *
+ *          stream is not connected                                          *
+ *                                                                           *
+ * Parameters:                                                               *
+ *      frame  - The encoded stream frame (see Service_Stream.h)             *
+ *      length - The length of the frame                                     *
+ *                                                                           *
+ *****************************************************************************/
+bool Service_Glove_QueueStream(const uint8_t * frame, uint16_t length)
+{
+    bool queued = false;
+
+    CRITICAL_REGION_ENTER();
+    if(mGloveService.conn_handle != BLE_CONN_HANDLE_INVALID
+        && mGloveService.stream_count < STREAM_QUEUE_LEN
+        && length <= SERVICE_STREAM_FRAME_LEN)
+    {
+        uint8_t tail = (mGloveService.stream_head + mGloveService.stream_count) % STREAM_QUEUE_LEN;
+        memcpy(mGloveService.stream_frames[tail].value, frame, length);
+        mGloveService.stream_frames[tail].length = length;
+        mGloveService.stream_count++;
+        queued = true;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if(queued)
+    {
+        pSendNotifications();
+    }
+    return queued;
 }
 
 /*****************************************************************************
@@ -216,17 +391,33 @@ void Service_Glove_SetDirection(uint8_t *direction)
  *****************************************************************************/
 uint32_t pAddCharacteristics()
 {
-    // Add the AnglePitch characteristic and set the initial value to 0
-    uint8_t anglePitchValue[2]            = {0x00,0x00};
-    pAddCharacteristicImpl(BLE_UUID_GLOVE_ANGLEPITCH_CHARACTERISTC_UUID, "AnglePitch",2, 2, anglePitchValue, &mGloveService.anglePitch_char_handles);
-
-    // Add the Direction characteristic and set the initial value to 0
-    uint8_t DirectionValue[1]            = {0x00};
-    pAddCharacteristicImpl(BLE_UUID_GLOVE_DIRECTION_CHARACTERISTC_UUID, "Direction",1, 1, DirectionValue, &mGloveService.direction_char_handles);
-
-    // Add the Throttle characteristic and set the initial value to 0
-    uint8_t ThrottleValue[1]             = {0x00};
-    pAddCharacteristicImpl(BLE_UUID_GLOVE_THROTTLE_CHARACTERISTC_UUID, "Throttle",1, 1, ThrottleValue, &mGloveService.throttle_char_handles);
+    // @02a Add the Control characteristic and set the initial value to a
+    // frame with everything at 0
+    uint8_t ControlValue[SERVICE_GLOVE_CONTROL_LEN] = {SERVICE_GLOVE_CONTROL_VERSION};
+    pAddCharacteristicImpl(BLE_UUID_GLOVE_CONTROL_CHARACTERISTC_UUID, "Control",SERVICE_GLOVE_CONTROL_LEN, SERVICE_GLOVE_CONTROL_LEN, ControlValue, &mGloveService.control_char_handles, true);
+
+    // @01a Add the Orientation characteristic and set the initial value to 0
+    uint8_t OrientationValue[ORIENTATION_LEN] = {0x00};
+    pAddCharacteristicImpl(BLE_UUID_GLOVE_ORIENTATION_CHARACTERISTC_UUID, "Orientation",ORIENTATION_LEN, ORIENTATION_LEN, OrientationValue, &mGloveService.orientation_char_handles, true);
+
+    // @04a Add the Telemetry characteristic
+    uint8_t TelemetryValue[SERVICE_GLOVE_TELEMETRY_LEN] = {SERVICE_GLOVE_TELEMETRY_VERSION};
+    pAddCharacteristicImpl(BLE_UUID_GLOVE_TELEMETRY_CHARACTERISTC_UUID, "Telemetry",SERVICE_GLOVE_TELEMETRY_LEN, SERVICE_GLOVE_TELEMETRY_LEN, TelemetryValue, &mGloveService.telemetry_char_handles, true);
+
+    // @06a Add the Stream characteristic. Frames vary in length, so it
+    // starts out empty.
+    uint8_t StreamValue[SERVICE_STREAM_FRAME_LEN] = {0x00};
+    pAddCharacteristicImpl(BLE_UUID_GLOVE_STREAM_CHARACTERISTC_UUID, "Stream",SERVICE_STREAM_FRAME_LEN, 0, StreamValue, &mGloveService.stream_char_handles, true);
+
+    // @09a Add the Database Version characteristic. It never changes, so
+    // it is only read.
+    uint8_t DbVersionValue[1] = {SERVICE_GLOVE_DB_VERSION};
+    pAddCharacteristicImpl(BLE_UUID_GLOVE_DB_VERSION_CHARACTERISTC_UUID, "Database Version",sizeof(DbVersionValue), sizeof(DbVersionValue), DbVersionValue, &mGloveService.db_version_char_handles, false);
+
+    // @03a Where each queued notification goes
+    mGloveService.notifications[NOTIFICATION_CONTROL].handle = mGloveService.control_char_handles.value_handle;
+    mGloveService.notifications[NOTIFICATION_ORIENTATION].handle = mGloveService.orientation_char_handles.value_handle;
+    mGloveService.notifications[NOTIFICATION_TELEMETRY].handle = mGloveService.telemetry_char_handles.value_handle; // @04a
 
     return NRF_SUCCESS;
 }
@@ -245,10 +436,12 @@ uint32_t pAddCharacteristics()
  *     attributeValue - The initial value of the attribute                   *
  *     char_hanldes - The BLE characteristic handle type to give to the      *
  *                    bluetooth stack.                                       *
+ *     notify - true if the characteristic notifies, and so has a CCCD  @09a *
  *                                                                           *
  *****************************************************************************/
 uint32_t pAddCharacteristicImpl(uint16_t characteristicUUID, char user_desc[],
-                                    uint8_t attributeMaxLen, uint8_t attributeInitLen, uint8_t * attributeValue, ble_gatts_char_handles_t* char_handles)
+                                    uint8_t attributeMaxLen, uint8_t attributeInitLen, uint8_t * attributeValue, ble_gatts_char_handles_t* char_handles,
+                                    bool notify)
 {
     // Add a custom characteristic UUID
     uint32_t            err_code;
@@ -274,13 +467,14 @@ uint32_t pAddCharacteristicImpl(uint16_t characteristicUUID, char user_desc[],
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.write_perm);
     cccd_md.vloc                = BLE_GATTS_VLOC_STACK;
-    char_md.p_cccd_md           = &cccd_md;
-    char_md.char_props.notify   = 1;
+    char_md.p_cccd_md           = notify ? &cccd_md : NULL; // @09c
+    char_md.char_props.notify   = notify;
 
     // Configure the attribute metadata
     ble_gatts_attr_md_t attr_md;
     memset(&attr_md, 0, sizeof(attr_md));
     attr_md.vloc        = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen        = (attributeInitLen != attributeMaxLen); // @06a Variable length, e.g. the stream frames
 
 
     // Set read security levels to our characteristic
@@ -306,3 +500,191 @@ uint32_t pAddCharacteristicImpl(uint16_t characteristicUUID, char user_desc[],
 
     return NRF_SUCCESS;
 }
+
+/*****************************************************************************
+ * Description: Queues a notification and sends it if there is a TX buffer.  *
+ *              A value still waiting from before is replaced, so a          *
+ *              congested link only ever sends the newest value.        @03a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters:                                                               *
+ *     notification - Which notification                                     *
+ *     value        - The encoded characteristic value                       *
+ *     length       - The length of the value                                *
+ *                                                                           *
+ *****************************************************************************/
+static void pQueueNotification(Notification_t notification, const uint8_t * value, uint16_t length)
+{
+    Notification_Pending_t * pending = &mGloveService.notifications[notification];
+
+    // The TX complete event may be sending at the same time
+    CRITICAL_REGION_ENTER();
+    memcpy(pending->value, value, length);
+    pending->length = length;
+    pending->pending = true;
+    CRITICAL_REGION_EXIT();
+
+    pSendNotifications();
+}
+
+/*****************************************************************************
+ * Description: Hands the queued notifications to the SoftDevice, in order,  *
+ *              while it has TX buffers left. Called when a value is queued  *
+ *              and when the SoftDevice reports sent packets.           @03a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pSendNotifications()
+{
+    CRITICAL_REGION_ENTER();
+    for(uint8_t i = 0; i < NOTIFICATION_COUNT; i++)
+    {
+        Notification_Pending_t * pending = &mGloveService.notifications[i];
+
+        if(mGloveService.conn_handle == BLE_CONN_HANDLE_INVALID || mGloveService.tx_buffers_free == 0)
+        {
+            break;
+        }
+        if(!pending->pending)
+        {
+            continue;
+        }
+
+        uint16_t               len = pending->length;
+        ble_gatts_hvx_params_t hvx_params;
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = pending->handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = pending->value;
+
+        uint32_t err_code = sd_ble_gatts_hvx(mGloveService.conn_handle, &hvx_params);
+        if(err_code == BLE_ERROR_NO_TX_PACKETS)
+        {
+            // The count was off; wait for the next TX complete
+            mGloveService.tx_buffers_free = 0;
+        }
+        else
+        {
+            // Sent, or it can't be sent at all (e.g. the vehicle has not
+            // enabled notifications). Either way this value is done.
+            pending->pending = false;
+            if(err_code == NRF_SUCCESS)
+            {
+                mGloveService.tx_buffers_free--;
+            }
+        }
+    }
+
+    // @06a The stream gets whatever TX buffers are left
+    pSendStream();
+    CRITICAL_REGION_EXIT();
+}
+
+/*****************************************************************************
+ * Description: Hands the queued stream frames to the SoftDevice, oldest     *
+ *              first, while it has TX buffers left. Called from             *
+ *              pSendNotifications, inside its critical region.         @06a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pSendStream()
+{
+    while(mGloveService.conn_handle != BLE_CONN_HANDLE_INVALID
+        && mGloveService.tx_buffers_free > 0
+        && mGloveService.stream_count > 0)
+    {
+        Stream_Frame_t *       frame = &mGloveService.stream_frames[mGloveService.stream_head];
+        uint16_t               len = frame->length;
+        ble_gatts_hvx_params_t hvx_params;
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = mGloveService.stream_char_handles.value_handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = frame->value;
+
+        uint32_t err_code = sd_ble_gatts_hvx(mGloveService.conn_handle, &hvx_params);
+        if(err_code == BLE_ERROR_NO_TX_PACKETS)
+        {
+            mGloveService.tx_buffers_free = 0;
+            break;
+        }
+
+        // Sent, or it can't be sent at all; the receiver sees the gap in
+        // the sequence numbers either way.
+        mGloveService.stream_head = (mGloveService.stream_head + 1) % STREAM_QUEUE_LEN;
+        mGloveService.stream_count--;
+        if(err_code == NRF_SUCCESS)
+        {
+            mGloveService.tx_buffers_free--;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Description: Drops all queued notifications and the TX buffer count, for  *
+ *              a new or closed connection.                             @03a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pResetNotifications()
+{
+    CRITICAL_REGION_ENTER();
+    for(uint8_t i = 0; i < NOTIFICATION_COUNT; i++)
+    {
+        mGloveService.notifications[i].pending = false;
+    }
+    mGloveService.stream_count = 0; // @06a
+    mGloveService.tx_buffers_free = 0;
+    CRITICAL_REGION_EXIT();
+}
+
+/*****************************************************************************
+ * Description: Writes a value to a buffer, low byte first.             @01a *
+ *                                                                           *
+ * Returns: The position in the buffer after the value                       *
+ *                                                                           *
+ * Parameters:                                                               *
+ *     buffer - Where to write the value                                     *
+ *     value  - The value to write                                           *
+ *                                                                           *
+ *****************************************************************************/
+static uint8_t * pEncodeInt16(uint8_t * buffer, int16_t value)
+{
+    buffer[0] = (uint8_t)((uint16_t)value & 0xFF);
+    buffer[1] = (uint8_t)((uint16_t)value >> 8);
+    return &buffer[2];
+}
+
+/*****************************************************************************
+ * Description: Writes a value to a buffer, low byte first.             @02a *
+ *                                                                           *
+ * Returns: The position in the buffer after the value                       *
+ *                                                                           *
+ * Parameters:                                                               *
+ *     buffer - Where to write the value                                     *
+ *     value  - The value to write                                           *
+ *                                                                           *
+ *****************************************************************************/
+static uint8_t * pEncodeUInt32(uint8_t * buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value & 0xFF);
+    buffer[1] = (uint8_t)((value >> 8) & 0xFF);
+    buffer[2] = (uint8_t)((value >> 16) & 0xFF);
+    buffer[3] = (uint8_t)(value >> 24);
+    return &buffer[4];
+}
@@ -15,6 +15,14 @@
 * | Flag    | (DDMYY)  | Author     | Description                         |  *
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 09Apr17  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Added Orientation characteristic    |  *
+* | @02     | 17Oct26  | BNordland  | Packed control frame characteristic |  *
+* | @03     | 17Oct26  | BNordland  | Telemetry characteristic            |  *
+* | @04     | 17Oct26  | BNordland  | Connection profile telemetry        |  *
+* | @05     | 17Oct26  | BNordland  | Raw IMU stream characteristic       |  *
+* | @06     | 17Oct26  | BNordland  | Wake up time telemetry              |  *
+* | @07     | 17Oct26  | BNordland  | Reconnect time telemetry            |  *
+* | @08     | 17Oct26  | BNordland  | Database version characteristic     |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
@@ -24,6 +32,7 @@
 #include <stdint.h>
 #include "ble.h"
 #include "ble_srv_common.h"
+#include "Fusion_Quaternion.h" // @01a For Fusion_Orientation_t
 
 // UUID Definitions
 #define BLE_UUID_GLOVE_BASE_UUID              {{0x76, 0xdb, 0xcd, 0xad, 0x65, 0x39, \
@@ -32,6 +41,75 @@
 
 #define BLE_UUID_GLOVE_SERVICE                0x1000 // 16-bit Glove service UUID
 
+// @08a The version of the attribute table of the glove service, readable
+// in the Database Version characteristic. The vehicle caches the handles
+// it discovers, and on a reconnect reads this to check they still apply.
+// Bump it whenever a characteristic is added, removed or reordered, and
+// set CLIENT_GLOVE_DB_VERSION of the vehicle to match.
+#define SERVICE_GLOVE_DB_VERSION              2
+
+// @02a The control frame: every control input of the glove in a single
+// notification, so the vehicle never mixes a new pitch with an old throttle.
+// All values are little endian:
+//      byte 0      version (SERVICE_GLOVE_CONTROL_VERSION)
+//      byte 1      sequence number, incremented for every frame
+//      bytes 2-5   timestamp: IMU sample index of the angles (1/416s)
+//      bytes 6-7   pitch in centidegrees (int16)
+//      bytes 8-9   roll in centidegrees (int16)
+//      byte 10     throttle, 0 to 100
+//      byte 11     direction: forward(1) or backward(0)
+// New fields are added to the end; a receiver ignores bytes it does not
+// know. The version changes only if an existing field changes.
+#define SERVICE_GLOVE_CONTROL_VERSION         1
+#define SERVICE_GLOVE_CONTROL_LEN             12
+
+// @02a The control inputs of the glove, sent in the control frame
+typedef struct
+{
+    uint32_t    timestamp;  // IMU sample index the angles were computed from
+    int16_t     pitch;      // Pitch in centidegrees
+    int16_t     roll;       // Roll in centidegrees
+    uint8_t     throttle;   // 0 to 100
+    uint8_t     direction;  // forward(1) or backward(0)
+} Service_Glove_Control_t;
+
+// @03a The telemetry frame: debug statistics of the glove, sent about once
+// a second. Little endian, and extended the same way as the control frame:
+//      byte 0      version (SERVICE_GLOVE_TELEMETRY_VERSION)
+//      bytes 1-2   sample age of the last control frame (10us units)
+//      bytes 3-4   average sample age (10us units)
+//      bytes 5-6   largest sample age since the last telemetry frame
+//      bytes 7-8   @04a connection interval (1.25ms units)
+//      byte 9      @04a connection profile (Service_Profile_t)
+//      bytes 10-13 @04a time in that profile (ms)
+//      bytes 14-15 @05a IMU samples the stream dropped (Service_Stream.h)
+//      bytes 16-17 @06a time from start up to the first control notification
+//                  (ms), 0 until it is sent. @07c After a reconnect, from
+//                  the link loss instead.
+//      byte 18     @06a @07c what that was timed from (SERVICE_GLOVE_WAKE_...)
+// The sample age is the time from reading the IMU FIFO to the start of the
+// connection event the frame was sent in.
+#define SERVICE_GLOVE_TELEMETRY_VERSION       1
+#define SERVICE_GLOVE_TELEMETRY_LEN           19 // @06c
+
+// @07a What the wake time in the telemetry frame was timed from
+#define SERVICE_GLOVE_WAKE_POWER_ON           0 // Start up after a reset
+#define SERVICE_GLOVE_WAKE_MOTION             1 // Start up on motion from system off
+#define SERVICE_GLOVE_WAKE_RECONNECT          2 // The link loss, for a reconnect
+
+// @03a The debug statistics of the glove, sent in the telemetry frame
+typedef struct
+{
+    uint16_t    sampleAge;      // Sample age of the last control frame (10us)
+    uint16_t    sampleAgeAvg;   // Average sample age (10us)
+    uint16_t    sampleAgeMax;   // Largest sample age since the last frame (10us)
+    uint16_t    interval;       // @04a Connection interval (1.25ms)
+    uint8_t     profile;        // @04a Connection profile
+    uint32_t    profileTime;    // @04a Time in that profile (ms)
+    uint16_t    streamDropped;  // @05a IMU samples the stream dropped
+    uint16_t    wakeTime;       // @06a Start up to the first control notification (ms)
+    uint8_t     wakeCause;      // @07c What wakeTime was timed from
+} Service_Glove_Telemetry_t;
 
 /*****************************************************************************
  * Description: Handles all events from the Nordic bluetooth static related  *
@@ -67,39 +145,70 @@ void Service_Glove_Init();
 bool Service_Glove_IsConnected();
 
 /*****************************************************************************
- * Description: Updates the AnglePitch Characteristic and sends it to         *
- *              connected bluetooth device                                   *
+ * Description: Updates the Control Characteristic and sends it to           *
+ *              connected bluetooth device in a single notification.    @02a *
+ *              @02c Replaces the AnglePitch, Throttle and Direction         *
+ *              characteristics.                                             *
  *                                                                           *
  * Returns: None                                                             *
  *                                                                           *
  * Parameters:                                                               *
- *      int16_t *anglePitch - The Pitch angle of the glove                     *
+ *      Service_Glove_Control_t *control - The control inputs of the glove   *
  *                                                                           *
  *****************************************************************************/
-void Service_Glove_SetAnglePitch(int16_t *anglePitch);
+void Service_Glove_SetControl(const Service_Glove_Control_t *control);
 
 /*****************************************************************************
- * Description: Updates the Throttle Characteristic and sends it to          *
- *              connected bluetooth device                                   *
+ * Description: Updates the Orientation Characteristic and sends it to       *
+ *              connected bluetooth device. The value is 6 little endian     *
+ *              int16: roll, pitch, yaw (centidegrees), then roll rate,      *
+ *              pitch rate, yaw rate (centidegrees per second).         @01a *
  *                                                                           *
  * Returns: None                                                             *
  *                                                                           *
  * Parameters:                                                               *
- *      uint8_t *throttle - The throttle value of the glove                  *
+ *      Fusion_Orientation_t *orientation - The orientation of the glove     *
  *                                                                           *
  *****************************************************************************/
-void Service_Glove_SetThrottle(uint8_t *throttle);
+void Service_Glove_SetOrientation(Fusion_Orientation_t *orientation);
 
 /*****************************************************************************
- * Description: Updates the Direction Characteristic and sends it to         *
- *              connected bluetooth device                                   *
+ * Description: Updates the Telemetry Characteristic and sends it to         *
+ *              connected bluetooth device, after any control or             *
+ *              orientation notification waiting for a TX buffer.       @03a *
  *                                                                           *
  * Returns: None                                                             *
  *                                                                           *
  * Parameters:                                                               *
- *      uint8_t *throttle - The throttle value of the glove                  *
+ *      Service_Glove_Telemetry_t *telemetry - The debug statistics          *
+ *                                                                           *
+ *****************************************************************************/
+void Service_Glove_SetTelemetry(const Service_Glove_Telemetry_t *telemetry);
+
+/*****************************************************************************
+ * Description: Indicates if the vehicle has enabled the notifications of    *
+ *              the Stream characteristic.                              @05a *
+ *                                                                           *
+ * Returns: true if stream frames should be sent                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+bool Service_Glove_IsStreaming();
+
+/*****************************************************************************
+ * Description: Queues a stream frame, sent after the other notifications    *
+ *              when there are TX buffers to spare. Every queued frame is    *
+ *              sent, in order.                                         @05a *
+ *                                                                           *
+ * Returns: true if the frame was queued, false if the queue is full or the  *
+ *          stream is not connected                                          *
+ *                                                                           *
+ * Parameters:                                                               *
+ *      frame  - The encoded stream frame (see Service_Stream.h)             *
+ *      length - The length of the frame                                     *
  *                                                                           *
  *****************************************************************************/
-void Service_Glove_SetDirection(uint8_t *direction);
+bool Service_Glove_QueueStream(const uint8_t * frame, uint16_t length);
 
 #endif  /* _ SERVICE_GLOVE_H__ */
@@ -0,0 +1,190 @@
+/*****************************************************************************
+* FILENAME: Service_Profile.c                                                *
+*                                                                            *
+* DESCRIPTION: Connection parameter profiles of the glove, see               *
+*              Service_Profile.h.                                            *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Service_Profile.h"
+
+#include "ble_conn_params.h"
+
+#define MS_PER_SECOND           1000
+
+// The parameters asked for in each profile
+static const ble_gap_conn_params_t mProfileParams[SERVICE_PROFILE_COUNT] =
+{
+    [SERVICE_PROFILE_DRIVE] =
+    {
+        .min_conn_interval = (uint16_t)SERVICE_PROFILE_DRIVE_MIN_INTERVAL,
+        .max_conn_interval = (uint16_t)SERVICE_PROFILE_DRIVE_MAX_INTERVAL,
+        .slave_latency     = SERVICE_PROFILE_DRIVE_SLAVE_LATENCY,
+        .conn_sup_timeout  = (uint16_t)SERVICE_PROFILE_DRIVE_SUP_TIMEOUT
+    },
+    [SERVICE_PROFILE_IDLE] =
+    {
+        .min_conn_interval = (uint16_t)SERVICE_PROFILE_IDLE_MIN_INTERVAL,
+        .max_conn_interval = (uint16_t)SERVICE_PROFILE_IDLE_MAX_INTERVAL,
+        .slave_latency     = SERVICE_PROFILE_IDLE_SLAVE_LATENCY,
+        .conn_sup_timeout  = (uint16_t)SERVICE_PROFILE_IDLE_SUP_TIMEOUT
+    }
+};
+
+// Private variables
+static Service_Profile_t    mProfile = SERVICE_PROFILE_DRIVE;   // The profile last asked for
+static uint16_t             mInterval = 0;                      // The interval the vehicle chose (1.25ms)
+static uint32_t             mTimeInProfile = 0;                 // Time since the profile was asked for (ms)
+static uint32_t             mIdleTime = 0;                      // Time since the glove was last in use (ms)
+static int16_t              mPreviousPitch = 0;                 // The pitch at the previous update
+
+// Private functions
+static void pRequestProfile(Service_Profile_t profile); // Asks the vehicle for a profile
+
+/*****************************************************************************
+ ****************Start of Public Function Implementations ********************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Handles the bluetooth events that start a connection or      *
+ *              change its parameters, to track the active interval.         *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: event -> event from the bluetooth stack                       *
+ *                                                                           *
+ *****************************************************************************/
+void Service_Profile_BluetoothEventHandler(ble_evt_t * event)
+{
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            // Connections start with the drive profile (the preferred
+            // parameters of the GAP setup), as the glove is about to be used.
+            mInterval = event->evt.gap_evt.params.connected.conn_params.max_conn_interval;
+            mProfile = SERVICE_PROFILE_DRIVE;
+            mTimeInProfile = 0;
+            mIdleTime = 0;
+            break;
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            mInterval = event->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval;
+            break;
+        case BLE_GAP_EVT_DISCONNECTED:
+            mInterval = 0;
+            break;
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+/*****************************************************************************
+ * Description: Called every SERVICE_PROFILE_UPDATE_MS while connected.      *
+ *              Decides if the glove is in use, and asks the vehicle for     *
+ *              the other profile when that changes.                         *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: throttle -> the throttle, 0 to 100                            *
+ *             pitch    -> the pitch in centidegrees                         *
+ *                                                                           *
+ *****************************************************************************/
+void Service_Profile_Update(uint8_t throttle, int16_t pitch)
+{
+    int32_t pitchChange = (int32_t)pitch - mPreviousPitch;
+    pitchChange = (pitchChange < 0) ? -pitchChange : pitchChange;
+    mPreviousPitch = pitch;
+
+    bool active = (throttle > SERVICE_PROFILE_ACTIVE_THROTTLE)
+        || (pitchChange * MS_PER_SECOND >= (int32_t)SERVICE_PROFILE_ACTIVE_PITCH_RATE * SERVICE_PROFILE_UPDATE_MS);
+
+    mTimeInProfile += SERVICE_PROFILE_UPDATE_MS;
+    mIdleTime = active ? 0 : (mIdleTime + SERVICE_PROFILE_UPDATE_MS);
+
+    if(active && mProfile != SERVICE_PROFILE_DRIVE)
+    {
+        pRequestProfile(SERVICE_PROFILE_DRIVE);
+    }
+    else if(mIdleTime >= SERVICE_PROFILE_IDLE_DELAY_MS && mProfile != SERVICE_PROFILE_IDLE)
+    {
+        pRequestProfile(SERVICE_PROFILE_IDLE);
+    }
+}
+
+/*****************************************************************************
+ * Description: The profile last asked for                                   *
+ *                                                                           *
+ * Returns: The profile                                                      *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+Service_Profile_t Service_Profile_GetActive()
+{
+    return mProfile;
+}
+
+/*****************************************************************************
+ * Description: The connection interval the vehicle chose                    *
+ *                                                                           *
+ * Returns: The interval in units of 1.25ms (0 if not connected)             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+uint16_t Service_Profile_GetInterval()
+{
+    return mInterval;
+}
+
+/*****************************************************************************
+ * Description: How long the active profile has been asked for               *
+ *                                                                           *
+ * Returns: The time in milliseconds                                         *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t Service_Profile_GetTimeInProfile()
+{
+    return mTimeInProfile;
+}
+
+/*****************************************************************************
+ ****************Start of Private Function Implementations *******************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Asks the vehicle for the parameters of a profile. This goes  *
+ *              through the connection parameters module, so it also checks  *
+ *              the result and asks again if the vehicle chose otherwise.    *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: profile -> the profile to ask for                             *
+ *                                                                           *
+ *****************************************************************************/
+static void pRequestProfile(Service_Profile_t profile)
+{
+    ble_gap_conn_params_t params = mProfileParams[profile];
+
+    // If the request can't be made now (e.g. one is already in progress),
+    // it is made again on the next update.
+    if(ble_conn_params_change_conn_params(&params) == NRF_SUCCESS)
+    {
+        mProfile = profile;
+        mTimeInProfile = 0;
+    }
+}
@@ -0,0 +1,121 @@
+/*****************************************************************************
+* FILENAME: Service_Profile.h                                                *
+*                                                                            *
+* DESCRIPTION: Connection parameter profiles of the glove. While the glove   *
+*              is in use it asks the vehicle for the shortest connection     *
+*              interval, so control frames are late by as little as         *
+*              possible. When it has not been used for a while it asks for   *
+*              a long interval with slave latency to save power.             *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef SERVICE_PROFILE_H__
+#define SERVICE_PROFILE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+
+// The connection parameter profiles. The vehicle has the same ones (see
+// Client_Profile.h), and chooses within them.
+typedef enum
+{
+    SERVICE_PROFILE_DRIVE = 0,  // Shortest interval, no latency
+    SERVICE_PROFILE_IDLE,       // Long interval, with slave latency
+    SERVICE_PROFILE_COUNT
+} Service_Profile_t;
+
+// Drive: 7.5ms (the shortest allowed) to 15ms
+#define SERVICE_PROFILE_DRIVE_MIN_INTERVAL      MSEC_TO_UNITS(7.5, UNIT_1_25_MS)
+#define SERVICE_PROFILE_DRIVE_MAX_INTERVAL      MSEC_TO_UNITS(15, UNIT_1_25_MS)
+#define SERVICE_PROFILE_DRIVE_SLAVE_LATENCY     0
+#define SERVICE_PROFILE_DRIVE_SUP_TIMEOUT       MSEC_TO_UNITS(4000, UNIT_10_MS)
+
+// Idle: 100ms to 200ms, and the glove may skip 4 events in a row when it
+// has nothing to send, so it wakes at least once a second.
+#define SERVICE_PROFILE_IDLE_MIN_INTERVAL       MSEC_TO_UNITS(100, UNIT_1_25_MS)
+#define SERVICE_PROFILE_IDLE_MAX_INTERVAL       MSEC_TO_UNITS(200, UNIT_1_25_MS)
+#define SERVICE_PROFILE_IDLE_SLAVE_LATENCY      4
+#define SERVICE_PROFILE_IDLE_SUP_TIMEOUT        MSEC_TO_UNITS(6000, UNIT_10_MS)
+
+// How often Service_Profile_Update is called
+#define SERVICE_PROFILE_UPDATE_MS               100
+
+// The glove is in use while the throttle is above this, or while the
+// pitch changes at least this fast (centidegrees per second).
+#define SERVICE_PROFILE_ACTIVE_THROTTLE         0
+#define SERVICE_PROFILE_ACTIVE_PITCH_RATE       2000
+
+// How long the glove must be unused before asking for the idle profile.
+// The drive profile is asked for as soon as it is used again.
+#ifndef SERVICE_PROFILE_IDLE_DELAY_MS
+    #define SERVICE_PROFILE_IDLE_DELAY_MS       5000
+#endif
+
+/*****************************************************************************
+ * Description: Handles the bluetooth events that start a connection or      *
+ *              change its parameters, to track the active interval.         *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: event -> event from the bluetooth stack                       *
+ *                                                                           *
+ *****************************************************************************/
+void Service_Profile_BluetoothEventHandler(ble_evt_t * event);
+
+/*****************************************************************************
+ * Description: Called every SERVICE_PROFILE_UPDATE_MS while connected.      *
+ *              Decides if the glove is in use, and asks the vehicle for     *
+ *              the other profile when that changes.                         *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: throttle -> the throttle, 0 to 100                            *
+ *             pitch    -> the pitch in centidegrees                         *
+ *                                                                           *
+ *****************************************************************************/
+void Service_Profile_Update(uint8_t throttle, int16_t pitch);
+
+/*****************************************************************************
+ * Description: The profile last asked for                                   *
+ *                                                                           *
+ * Returns: The profile                                                      *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+Service_Profile_t Service_Profile_GetActive();
+
+/*****************************************************************************
+ * Description: The connection interval the vehicle chose                    *
+ *                                                                           *
+ * Returns: The interval in units of 1.25ms (0 if not connected)             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+uint16_t Service_Profile_GetInterval();
+
+/*****************************************************************************
+ * Description: How long the active profile has been asked for               *
+ *                                                                           *
+ * Returns: The time in milliseconds                                         *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t Service_Profile_GetTimeInProfile();
+
+#endif
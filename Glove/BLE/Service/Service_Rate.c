@@ -0,0 +1,155 @@
+/*****************************************************************************
+* FILENAME: Service_Rate.c                                                   *
+*                                                                            *
+* DESCRIPTION: Decides when a control frame is worth sending, see            *
+*              Service_Rate.h.                                               *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Updates timed by connection events  |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Service_Rate.h"
+
+#define MS_PER_SECOND           1000
+
+// Private variables
+static bool                     mHasSent = false;    // A frame was sent since the last reset
+static Service_Glove_Control_t  mSent;               // The last frame sent
+static Service_Glove_Control_t  mPrevious;           // The inputs of the previous tick
+static uint16_t                 mMsSinceSent;        // @01c Time since the last frame was sent
+static uint16_t                 mMotionMs;           // @01c Time left until the hand counts as still
+
+// Private functions
+static uint16_t pDifference(int16_t a, int16_t b); // Absolute difference
+static bool pIsFast(uint16_t change, uint16_t elapsedMs, uint16_t rate); // @01a Rate of change check
+
+/*****************************************************************************
+ ****************Start of Public Function Implementations ********************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Forgets the last frame sent, so the next update sends.       *
+ *              Called whenever there is no connection.                      *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Service_Rate_Reset()
+{
+    mHasSent = false;
+    mMsSinceSent = 0;
+    mMotionMs = 0;
+}
+
+/*****************************************************************************
+ * Description: Called before each connection event with the current control *
+ *              inputs. Decides if they should be sent now.                  *
+ *              @01c Was called on a fixed timer tick.                       *
+ *                                                                           *
+ * Returns: true if the frame should be sent. It is then taken as sent, and  *
+ *          later changes are measured from it.                              *
+ *                                                                           *
+ * Parameters:                                                               *
+ *      control   - The current control inputs of the glove                  *
+ *      elapsedMs - Time since the previous update                           *
+ *                                                                           *
+ *****************************************************************************/
+bool Service_Rate_Update(const Service_Glove_Control_t * control, uint16_t elapsedMs)
+{
+    if(!mHasSent)
+    {
+        // Nothing to compare to, send straight away
+        mHasSent = true;
+        mSent = *control;
+        mPrevious = *control;
+        mMsSinceSent = 0;
+        return true;
+    }
+
+    // Is the hand moving? Measured against the previous update, so a slow
+    // drift does not count, however far it goes.
+    if(pIsFast(pDifference(control->pitch, mPrevious.pitch), elapsedMs, SERVICE_RATE_MOTION_PITCH)
+        || pIsFast(pDifference(control->throttle, mPrevious.throttle), elapsedMs, SERVICE_RATE_MOTION_THROTTLE))
+    {
+        mMotionMs = SERVICE_RATE_MOTION_HOLD_MS;
+    }
+    else
+    {
+        mMotionMs = (mMotionMs > elapsedMs) ? (mMotionMs - elapsedMs) : 0;
+    }
+    mPrevious = *control;
+
+    // Has anything changed enough since the last frame sent? A change of
+    // direction always counts.
+    bool changed = (control->direction != mSent.direction)
+        || pDifference(control->pitch, mSent.pitch) >= SERVICE_RATE_DEADBAND_PITCH
+        || pDifference(control->throttle, mSent.throttle) >= SERVICE_RATE_DEADBAND_THROTTLE;
+
+    mMsSinceSent = (mMsSinceSent < UINT16_MAX - elapsedMs) ? (mMsSinceSent + elapsedMs) : UINT16_MAX;
+
+    bool send;
+    if(changed)
+    {
+        // Every connection event while moving, otherwise at the idle rate
+        send = (mMotionMs > 0) || (mMsSinceSent >= SERVICE_RATE_IDLE_INTERVAL_MS);
+    }
+    else
+    {
+        send = (mMsSinceSent >= SERVICE_RATE_KEEPALIVE_MS);
+    }
+
+    if(send)
+    {
+        mSent = *control;
+        mMsSinceSent = 0;
+    }
+
+    return send;
+}
+
+/*****************************************************************************
+ ****************Start of Private Function Implementations *******************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: The absolute difference of two values                        *
+ *                                                                           *
+ * Returns: |a - b|                                                          *
+ *                                                                           *
+ * Parameters: a, b -> the values                                            *
+ *                                                                           *
+ *****************************************************************************/
+static uint16_t pDifference(int16_t a, int16_t b)
+{
+    int32_t difference = (int32_t)a - (int32_t)b;
+    return (uint16_t)((difference < 0) ? -difference : difference);
+}
+
+/*****************************************************************************
+ * Description: Checks if a change over some time is at least a given rate.  *
+ *                                                                      @01a *
+ *                                                                           *
+ * Returns: true if change / elapsedMs >= rate / 1000                        *
+ *                                                                           *
+ * Parameters: change    -> the change                                       *
+ *             elapsedMs -> the time it took                                 *
+ *             rate      -> the rate, per second                             *
+ *                                                                           *
+ *****************************************************************************/
+static bool pIsFast(uint16_t change, uint16_t elapsedMs, uint16_t rate)
+{
+    return (change > 0) && (((uint32_t)change * MS_PER_SECOND) >= ((uint32_t)rate * elapsedMs));
+}
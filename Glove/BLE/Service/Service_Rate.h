@@ -0,0 +1,86 @@
+/*****************************************************************************
+* FILENAME: Service_Rate.h                                                   *
+*                                                                            *
+* DESCRIPTION: Decides when a control frame is worth sending. While the hand *
+*              moves, frames go out on every connection event, when it is   *
+*              still they slow down to a keep-alive. Changes smaller than a  *
+*              deadband are never sent on their own.                         *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Updates timed by connection events  |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef SERVICE_RATE_H__
+#define SERVICE_RATE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Service_Glove.h"
+
+// Changes smaller than these are not sent (pitch in centidegrees, throttle
+// in percent). The vehicle works in whole degrees, so less than a degree
+// of pitch would not change what it does.
+#ifndef SERVICE_RATE_DEADBAND_PITCH
+    #define SERVICE_RATE_DEADBAND_PITCH         100
+#endif
+#ifndef SERVICE_RATE_DEADBAND_THROTTLE
+    #define SERVICE_RATE_DEADBAND_THROTTLE      2
+#endif
+
+// The hand counts as moving while pitch or throttle change at least this
+// fast. @01c Rates rather than steps, as the connection interval varies.
+#define SERVICE_RATE_MOTION_PITCH               2000 // centidegrees per second
+#define SERVICE_RATE_MOTION_THROTTLE            50   // percent per second
+
+// How long the hand still counts as moving after the last fast change, so
+// the end of a movement is sent at the fast rate too.
+#define SERVICE_RATE_MOTION_HOLD_MS             500
+
+// While the hand is still, changes past the deadband are sent at most this
+// often, and a frame is sent at least this often even without changes so
+// the vehicle knows the glove is there.
+#ifndef SERVICE_RATE_IDLE_INTERVAL_MS
+    #define SERVICE_RATE_IDLE_INTERVAL_MS       200
+#endif
+#ifndef SERVICE_RATE_KEEPALIVE_MS
+    #define SERVICE_RATE_KEEPALIVE_MS           1000
+#endif
+
+/*****************************************************************************
+ * Description: Forgets the last frame sent, so the next update sends.       *
+ *              Called whenever there is no connection.                      *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void Service_Rate_Reset();
+
+/*****************************************************************************
+ * Description: Called before each connection event with the current control *
+ *              inputs. Decides if they should be sent now.                  *
+ *              @01c Was called on a fixed timer tick.                       *
+ *                                                                           *
+ * Returns: true if the frame should be sent. It is then taken as sent, and  *
+ *          later changes are measured from it.                              *
+ *                                                                           *
+ * Parameters:                                                               *
+ *      control   - The current control inputs of the glove                  *
+ *      elapsedMs - Time since the previous update                           *
+ *                                                                           *
+ *****************************************************************************/
+bool Service_Rate_Update(const Service_Glove_Control_t * control, uint16_t elapsedMs);
+
+#endif
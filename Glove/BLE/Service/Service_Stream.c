@@ -0,0 +1,309 @@
+/*****************************************************************************
+* FILENAME: Service_Stream.c                                                 *
+*                                                                            *
+* DESCRIPTION: Raw IMU stream, see Service_Stream.h.                         *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Scaled deltas                       |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "Service_Stream.h"
+#include "Service_Glove.h"
+#include "app_util_platform.h"
+
+STATIC_ASSERT(SERVICE_STREAM_KEY_LEN <= SERVICE_STREAM_FRAME_LEN);
+STATIC_ASSERT(SERVICE_STREAM_DELTA_SAMPLES <= SERVICE_STREAM_COUNT_MASK);
+STATIC_ASSERT((SERVICE_STREAM_MAX_SHIFT << SERVICE_STREAM_SHIFT_POS) <= SERVICE_STREAM_SHIFT_MASK);
+
+// Private variables, only used from the IMU batch handler
+static uint8_t      mFrame[SERVICE_STREAM_FRAME_LEN];   // The frame being filled
+static uint8_t      mFrameSamples = 0;                  // Samples in the delta frame being filled
+static int16_t      mPending[SERVICE_STREAM_DELTA_SAMPLES][SERVICE_STREAM_AXES]; // @01a Its samples
+static int16_t      mPrevious[SERVICE_STREAM_AXES];     // @01c The last sample as the receiver rebuilds it
+static uint32_t     mNextIndex = 0;                     // Sample index the next batch should start at
+static uint8_t      mSequence = 0;                      // Sequence number of the next frame
+static uint8_t      mFramesSinceKey = 0;                // Frames sent since the last key frame
+static bool         mForceKey = true;                   // The next sample must go in a key frame
+static bool         mStreaming = false;                 // The stream was enabled at the last batch
+static uint16_t     mDropped = 0;                       // Samples dropped since the stream was enabled
+
+// Private functions
+static void pAddSample(uint32_t index, const int16_t * sample); // Adds a sample to a frame
+static void pFlush(); // Sends the delta frame being filled
+static bool pEncodeDeltas(uint8_t shift, bool commit); // @01a Encodes the pending samples
+static void pSend(uint8_t length, uint8_t samples); // Queues the frame
+static uint8_t * pEncodeInt16(uint8_t * buffer, int16_t value);
+static uint8_t * pEncodeUInt32(uint8_t * buffer, uint32_t value);
+
+/*****************************************************************************
+ ****************Start of Public Function Implementations ********************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Packs a batch of samples into stream frames and queues them  *
+ *              for sending. Called with every batch drained from the IMU    *
+ *              FIFO. Does nothing unless the stream is enabled.             *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: batch -> the samples read from the FIFO                       *
+ *                                                                           *
+ *****************************************************************************/
+void Service_Stream_AddBatch(const Sensors_AccelGyro_Batch_t * batch)
+{
+    if(!Service_Glove_IsStreaming())
+    {
+        mStreaming = false;
+        return;
+    }
+
+    if(!mStreaming)
+    {
+        // Just enabled, start over from a key frame
+        mStreaming = true;
+        mSequence = 0;
+        mDropped = 0;
+        mFrameSamples = 0;
+        mForceKey = true;
+    }
+
+    // Samples were lost in the IMU, so the next one can't follow on
+    if(batch->overrun || batch->firstSampleIndex != mNextIndex)
+    {
+        pFlush();
+        mForceKey = true;
+    }
+
+    for(uint8_t i = 0; i < batch->count; i++)
+    {
+        const int16_t sample[SERVICE_STREAM_AXES] =
+        {
+            batch->accel[i].xData, batch->accel[i].yData, batch->accel[i].zData,
+            batch->gyro[i].xData,  batch->gyro[i].yData,  batch->gyro[i].zData
+        };
+        pAddSample(batch->firstSampleIndex + i, sample);
+    }
+
+    mNextIndex = batch->firstSampleIndex + batch->count;
+}
+
+/*****************************************************************************
+ * Description: Samples dropped because the link could not keep up, since    *
+ *              the stream was last enabled. Wraps around.                   *
+ *                                                                           *
+ * Returns: The number of samples                                            *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+uint16_t Service_Stream_GetDropped()
+{
+    return mDropped;
+}
+
+/*****************************************************************************
+ ****************Start of Private Function Implementations *******************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Adds a sample to the delta frame being filled, or sends it   *
+ *              in a key frame if it can't follow on from the last one.      *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: index  -> the IMU sample index of the sample                  *
+ *             sample -> accel x, y, z, then gyro x, y, z                    *
+ *                                                                           *
+ *****************************************************************************/
+static void pAddSample(uint32_t index, const int16_t * sample)
+{
+    if(!mForceKey && mFramesSinceKey < SERVICE_STREAM_KEY_INTERVAL)
+    {
+        // @01c The sample follows on if the frame still fits the largest shift
+        memcpy(mPending[mFrameSamples], sample, sizeof(mPending[0]));
+        mFrameSamples++;
+        if(pEncodeDeltas(SERVICE_STREAM_MAX_SHIFT, false))
+        {
+            if(mFrameSamples == SERVICE_STREAM_DELTA_SAMPLES)
+            {
+                pFlush();
+            }
+            return;
+        }
+        mFrameSamples--;
+    }
+
+    pFlush();
+
+    uint8_t * next = &mFrame[SERVICE_STREAM_HEADER_LEN];
+    next = pEncodeUInt32(next, index);
+    for(uint8_t axis = 0; axis < SERVICE_STREAM_AXES; axis++)
+    {
+        next = pEncodeInt16(next, sample[axis]);
+        mPrevious[axis] = sample[axis];
+    }
+    next = pEncodeInt16(next, (int16_t)mDropped);
+
+    mFrame[1] = SERVICE_STREAM_KEY_FLAG | 1;
+    mForceKey = false;
+    mFramesSinceKey = 0;
+    pSend(SERVICE_STREAM_KEY_LEN, 1);
+}
+
+/*****************************************************************************
+ * Description: Sends the delta frame being filled, if it has any samples.   *
+ *              @01a Its deltas are encoded with the smallest shift they     *
+ *              fit in.                                                      *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pFlush()
+{
+    uint8_t shift = 0;
+
+    if(mFrameSamples == 0)
+    {
+        return;
+    }
+
+    // pAddSample only keeps samples that fit SERVICE_STREAM_MAX_SHIFT
+    while(shift < SERVICE_STREAM_MAX_SHIFT && !pEncodeDeltas(shift, false))
+    {
+        shift++;
+    }
+    (void)pEncodeDeltas(shift, true);
+
+    mFrame[1] = (uint8_t)(shift << SERVICE_STREAM_SHIFT_POS) | mFrameSamples;
+    pSend(SERVICE_STREAM_HEADER_LEN + (mFrameSamples * SERVICE_STREAM_AXES), mFrameSamples);
+    mFrameSamples = 0;
+}
+
+/*****************************************************************************
+ * Description: Works out the deltas of the pending samples at a shift. Each *
+ *              delta is rounded, and taken from the sample before as the    *
+ *              receiver rebuilds it, so the rounding does not build up.     *
+ *                                                                      @01a *
+ *                                                                           *
+ * Returns: true if every delta fits in an int8                              *
+ *                                                                           *
+ * Parameters: shift  -> the shift of the frame                              *
+ *             commit -> write the deltas to the frame and move mPrevious    *
+ *                       on to the last sample; only once they are known to  *
+ *                       fit                                                 *
+ *                                                                           *
+ *****************************************************************************/
+static bool pEncodeDeltas(uint8_t shift, bool commit)
+{
+    const int32_t round = (1 << shift) >> 1;
+
+    for(uint8_t axis = 0; axis < SERVICE_STREAM_AXES; axis++)
+    {
+        int32_t rebuilt = mPrevious[axis];
+
+        for(uint8_t i = 0; i < mFrameSamples; i++)
+        {
+            // Arithmetic shift, so this rounds to the nearest step
+            int32_t delta = ((int32_t)mPending[i][axis] - rebuilt + round) >> shift;
+            if(delta < INT8_MIN || delta > INT8_MAX)
+            {
+                return false;
+            }
+            rebuilt += delta * (1 << shift);
+            if(rebuilt < INT16_MIN || rebuilt > INT16_MAX)
+            {
+                return false; // Rounded past a saturated sample
+            }
+            if(commit)
+            {
+                mFrame[SERVICE_STREAM_HEADER_LEN + (i * SERVICE_STREAM_AXES) + axis] = (uint8_t)(int8_t)delta;
+            }
+        }
+
+        if(commit)
+        {
+            mPrevious[axis] = (int16_t)rebuilt;
+        }
+    }
+
+    return true;
+}
+
+/*****************************************************************************
+ * Description: Queues the frame for sending. If the queue is full, the      *
+ *              samples are dropped, and the next sample goes in a key frame *
+ *              so the receiver never applies deltas across the gap.         *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: length  -> the length of the frame                            *
+ *             samples -> the samples in the frame                           *
+ *                                                                           *
+ *****************************************************************************/
+static void pSend(uint8_t length, uint8_t samples)
+{
+    mFrame[0] = mSequence;
+
+    if(Service_Glove_QueueStream(mFrame, length))
+    {
+        mSequence++;
+        mFramesSinceKey++;
+    }
+    else
+    {
+        mDropped += samples;
+        mForceKey = true;
+    }
+}
+
+/*****************************************************************************
+ * Description: Writes a value to a buffer, low byte first.                  *
+ *                                                                           *
+ * Returns: The position in the buffer after the value                       *
+ *                                                                           *
+ * Parameters:                                                               *
+ *     buffer - Where to write the value                                     *
+ *     value  - The value to write                                           *
+ *                                                                           *
+ *****************************************************************************/
+static uint8_t * pEncodeInt16(uint8_t * buffer, int16_t value)
+{
+    buffer[0] = (uint8_t)((uint16_t)value & 0xFF);
+    buffer[1] = (uint8_t)((uint16_t)value >> 8);
+    return &buffer[2];
+}
+
+/*****************************************************************************
+ * Description: Writes a value to a buffer, low byte first.                  *
+ *                                                                           *
+ * Returns: The position in the buffer after the value                       *
+ *                                                                           *
+ * Parameters:                                                               *
+ *     buffer - Where to write the value                                     *
+ *     value  - The value to write                                           *
+ *                                                                           *
+ *****************************************************************************/
+static uint8_t * pEncodeUInt32(uint8_t * buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value & 0xFF);
+    buffer[1] = (uint8_t)((value >> 8) & 0xFF);
+    buffer[2] = (uint8_t)((value >> 16) & 0xFF);
+    buffer[3] = (uint8_t)(value >> 24);
+    return &buffer[4];
+}
@@ -0,0 +1,92 @@
+/*****************************************************************************
+* FILENAME: Service_Stream.h                                                 *
+*                                                                            *
+* DESCRIPTION: Raw IMU stream, for tuning the filters and gestures. Every    *
+*              sample drained from the IMU FIFO is packed into stream frames *
+*              and sent on the Stream characteristic, but only while the     *
+*              vehicle has its notifications enabled.                        *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Scaled deltas                       |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef SERVICE_STREAM_H__
+#define SERVICE_STREAM_H__
+
+#include <stdint.h>
+#include "Sensors_AccelGyro.h"
+
+// The stream frame. All values are little endian:
+//      byte 0      sequence number, incremented for every frame sent
+//      byte 1      bit 7 set for a key frame, @01a bits 4-6 the shift of a
+//                  delta frame, bits 0-3 samples in the frame
+// A key frame holds one sample in full:
+//      bytes 2-5   IMU sample index of the sample (1/416s)
+//      bytes 6-17  accel x, y, z, then gyro x, y, z (int16, sensor counts
+//                  with the calibration offsets removed)
+//      bytes 18-19 samples the glove dropped since the stream started
+// A delta frame holds up to SERVICE_STREAM_DELTA_SAMPLES samples, 6 bytes
+// each: the change of every axis from the sample before (int8). The first
+// one follows on from the last sample of the previous frame, and each is
+// one sample index after the one before.
+// @01a Each change is shifted left by the frame's shift before it is
+// added: sample = previous + (change << shift). The glove picks the
+// smallest shift the frame's changes fit in, so a slow frame is exact and
+// a fast one is within 2^(shift - 1) counts of the sample. The error does
+// not build up, as the glove takes its deltas from what the receiver
+// rebuilt, not from the samples. An int8 on its own is only 1.1 dps of
+// gyro or 7.7 mg of accel change per sample, less than a hand turning.
+// A key frame is sent at least every SERVICE_STREAM_KEY_INTERVAL frames,
+// and whenever the samples can't follow on from the previous frame (a
+// change too large for the largest shift, or samples lost). A receiver
+// that sees a gap in the sequence numbers waits for the next key frame.
+#define SERVICE_STREAM_FRAME_LEN                20 // One notification with the default ATT MTU
+#define SERVICE_STREAM_HEADER_LEN               2
+#define SERVICE_STREAM_KEY_FLAG                 0x80
+#define SERVICE_STREAM_COUNT_MASK               0x0F
+#define SERVICE_STREAM_SHIFT_MASK               0x70 // @01a
+#define SERVICE_STREAM_SHIFT_POS                4    // @01a
+#define SERVICE_STREAM_MAX_SHIFT                7    // @01a
+#define SERVICE_STREAM_AXES                     6
+#define SERVICE_STREAM_KEY_LEN                  (SERVICE_STREAM_HEADER_LEN + 4 + (2 * SERVICE_STREAM_AXES) + 2)
+#define SERVICE_STREAM_DELTA_SAMPLES            ((SERVICE_STREAM_FRAME_LEN - SERVICE_STREAM_HEADER_LEN) / SERVICE_STREAM_AXES)
+
+#ifndef SERVICE_STREAM_KEY_INTERVAL
+    #define SERVICE_STREAM_KEY_INTERVAL         32
+#endif
+
+/*****************************************************************************
+ * Description: Packs a batch of samples into stream frames and queues them  *
+ *              for sending. Called with every batch drained from the IMU    *
+ *              FIFO. Does nothing unless the stream is enabled.             *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: batch -> the samples read from the FIFO                       *
+ *                                                                           *
+ *****************************************************************************/
+void Service_Stream_AddBatch(const Sensors_AccelGyro_Batch_t * batch);
+
+/*****************************************************************************
+ * Description: Samples dropped because the link could not keep up, since    *
+ *              the stream was last enabled. Wraps around.                   *
+ *                                                                           *
+ * Returns: The number of samples                                            *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+uint16_t Service_Stream_GetDropped();
+
+#endif
@@ -0,0 +1,47 @@
+/*****************************************************************************
+* FILENAME: Storage_Config.h                                                 *
+*                                                                            *
+* DESCRIPTION: The glove's flash records, for the shared Storage_Flash in    *
+*              Common/Storage. The fds library is shared with the peer       *
+*              manager.                                                      *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation, from              |  *
+* |         |          |            | Storage_Flash.h                     |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef STORAGE_CONFIG_H__
+#define STORAGE_CONFIG_H__
+
+// The fds file that holds all of the glove records. The peer manager uses
+// file IDs from 0xC000, so this must be below that.
+#define STORAGE_FLASH_FILE_ID               0x1000
+
+// The keys of the glove records (0x0000 is not a valid key)
+#define STORAGE_FLASH_KEY_IMU_CALIBRATION   0x0001  // Sensors_Calibration
+#define STORAGE_FLASH_KEY_FLEX_CALIBRATION  0x0010  // Sensors_Flex, plus the channel
+#define STORAGE_FLASH_KEY_VEHICLE_ADDRESS   0x0020  // The last vehicle connected to (main.c)
+
+// The largest record that can be written, in bytes. Large enough for a flex
+// sensor response table.
+#ifndef STORAGE_FLASH_MAX_RECORD_BYTES
+    #define STORAGE_FLASH_MAX_RECORD_BYTES  96
+#endif
+
+// The number of writes that can be in progress at the same time. One per
+// flex sensor, the IMU calibration and the vehicle address.
+#ifndef STORAGE_FLASH_WRITE_SLOTS
+    #define STORAGE_FLASH_WRITE_SLOTS       4
+#endif
+
+#endif /* STORAGE_CONFIG_H__ */
@@ -33,18 +33,29 @@
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 31Mar17  | BNordland  | Initial creation                    |  *
 * | None    | 18Apr17  | Bnordland  | Removed bsp (board support package) |  *
+* | @01     | 16Oct26  | BNordland  | Drain accelerometer from the FIFO   |  *
+* | @02     | 16Oct26  | BNordland  | Drain IMU on INT1 FIFO watermark    |  *
+* | @03     | 16Oct26  | BNordland  | Drain IMU from interrupts           |  *
+* | @04     | 16Oct26  | BNordland  | Integer only pitch calculation      |  *
+* | @05     | 16Oct26  | BNordland  | Complementary filter for pitch      |  *
+* | @06     | 17Oct26  | BNordland  | Quaternion orientation engine       |  *
+* | @07     | 17Oct26  | BNordland  | Stored IMU calibration              |  *
+* | @08     | 17Oct26  | BNordland  | Calibrated flex sensor tables       |  *
+* | @09     | 17Oct26  | BNordland  | Timer triggered flex sensor scan    |  *
+* | @10     | 17Oct26  | BNordland  | Single packed control notification  |  *
+* | @11     | 17Oct26  | BNordland  | Motion adaptive notification rate   |  *
+* | @12     | 17Oct26  | BNordland  | Sensor reads timed to radio events  |  *
+* | @13     | 17Oct26  | BNordland  | Drive and idle connection profiles  |  *
+* | @14     | 17Oct26  | BNordland  | Raw IMU stream                      |  *
+* | @15     | 17Oct26  | BNordland  | Wake on motion, staged advertising  |  *
+* | @16     | 17Oct26  | BNordland  | Directed advertising to the vehicle |  *
+* | @17     | 17Oct26  | BNordland  | Fusion cycle benchmark              |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
-#include "math.h"
-
-// Need PI defined for some sensor calculations
-#ifndef M_PI
-#    define M_PI 3.14159265358979323846
-#endif
 
 // Include the NordicSDK
 #include "NordicSDK.h"
@@ -57,27 +68,61 @@
 
 // Include Sensors
 #include "Sensors_AccelGyro.h"
+#include "Sensors_Calibration.h" // @07a
+#include "Sensors_Flex.h" // @08a
+
+// Include persistent storage @07a
+#include "Storage_Flash.h"
+
+// Include Sensor Fusion @04a
+#include "Fusion_Math.h"
+#include "Fusion_Complementary.h" // @05a
+#include "Fusion_Quaternion.h" // @06a
+#include "Fusion_Benchmark.h" // @17a
+
+// Include the notification rate control @11a
+#include "Service_Rate.h"
+
+// Include the connection profiles @13a
+#include "Service_Profile.h"
+
+// Include the raw IMU stream @14a
+#include "Service_Stream.h"
 
 // Global Constants
 #define DEVICE_NAME                      "Glove"                                    // Name of the bluetooth device
 #define APP_TIMER_PRESCALER              0                                          // Timer prescaler (RTC1 PRESCALER register)
 #define APP_TIMER_OP_QUEUE_SIZE          4                                          // Timer operation queue size
-#define GLOVE_TIMER_INTERVAL             APP_TIMER_TICKS(100, APP_TIMER_PRESCALER)  // Set the timer interval
+#define GLOVE_TIMER_INTERVAL             APP_TIMER_TICKS(SERVICE_PROFILE_UPDATE_MS, APP_TIMER_PRESCALER) // @13c Set the timer interval (100ms)
+#define GLOVE_TELEMETRY_TICKS            10                                         // @12a Timer ticks between telemetry frames (1s)
+#define GLOVE_TIMER_TICKS_PER_SECOND     (APP_TIMER_CLOCK_FREQ / (APP_TIMER_PRESCALER + 1)) // @12a app_timer counter rate
+#define GLOVE_IMU_FIFO_WATERMARK         SENSORS_ACCELGYRO_FIFO_BATCH_SIZE          // @01a Samples per IMU batch (~38ms at 416Hz)
+#define GLOVE_WAKE_TIME_MAX_TICKS        (GLOVE_TIMER_TICKS_PER_SECOND * 65)        // @15a Longest wake time that fits in the telemetry (ms)
+
+// @12a How long before each connection event the IMU is read. Long enough to
+// read the FIFO, run the filters over a connection interval of samples and
+// queue the notification.
+#define GLOVE_RADIO_LEAD_DISTANCE        NRF_RADIO_NOTIFICATION_DISTANCE_2680US
+#define GLOVE_RADIO_LEAD_US              2680
 
 // Global Variables
 static uint16_t  mConnectionHandle = BLE_CONN_HANDLE_INVALID;   // Bluetooth stack connection handle
 APP_TIMER_DEF(mTimerId); // The timer
-static Sensors_Accel_Data_t accel_data; // accelerometer data
-
-// Channel for Throttle
-static nrf_drv_adc_channel_t mThrottleADCChannelConfig = NRF_DRV_ADC_DEFAULT_CHANNEL(HDW_CONFIG_THROTTLE_FLEX_ADC_PIN);
-static nrf_adc_value_t mThrottleAdcValue;
-static uint8_t mThrottleValue; // The interpreted throttle value: 0 to 100
-
-// Channel for Direction
-static nrf_drv_adc_channel_t mDirectionADCChannelConfig = NRF_DRV_ADC_DEFAULT_CHANNEL(HDW_CONFIG_DIR_FLEX_ADC_PIN);
-static nrf_adc_value_t mDirectionAdcValue;
-static uint8_t mDirectionValue; // The interpreted direction value: 1 for forward, 0 for backward
+static Sensors_AccelGyro_Batch_t mImuBatch; // @01a The last batch of samples drained from the IMU FIFO
+static bool mImuDataPending = false; // @03a INT1 was raised while a FIFO read was already in progress
+static volatile uint32_t mImuSampleIndex = 0; // @10a Sample index of the newest sample in the filters
+static bool mControlPending = false; // @12a A connection event is coming, send a control frame once the FIFO is read
+static uint32_t mRadioEventTicks = 0; // @12a app_timer count at the last connection event notification
+static uint16_t mRadioElapsedMs = 0; // @12a Time between the last two connection events
+static bool mControlQueued = false; // @12a A control frame is queued for the next connection event
+static uint32_t mControlSampleTicks = 0; // @12a app_timer count when the FIFO was read for that frame
+static Service_Glove_Telemetry_t mTelemetry; // @12a Sample age statistics
+static uint8_t mWakeCause = SERVICE_GLOVE_WAKE_POWER_ON; // @15a @16c What mStartTicks is (SERVICE_GLOVE_WAKE_...)
+static uint32_t mStartTicks = 0; // @15a app_timer count when the timers were started @16c or the link was lost
+static uint16_t mWakeTimeMs = 0; // @15a Time from mStartTicks to the first control notification
+static ble_gap_addr_t mVehicleAddress; // @16a The last vehicle connected to, for directed advertising
+static bool mVehicleKnown = false; // @16a mVehicleAddress is valid
+static volatile bool mSystemOffPending = false; // @15a Advertising timed out, go to system off
 
 // Function Definitions
     // Functions Required for Setup
@@ -89,12 +134,17 @@ static uint8_t mDirectionValue; // The interpreted direction value: 1 for forwar
     static void pSetupBluetoothAdvertising(); // Called to set up bluetooth device advertising
     static void pSetupConnectionParameters(); // Called to set up the connection parameters
     static void pSetupFlexSensors(); // Called to set up the flex sensors
+    static void pSetupRadioNotification(); // @12a Called to set up the connection event notifications
 
     // Required for Starting
     static void pStartTimers(); // Called to start timers
 
     // Functions required for Runtime
     static void pMainTimerHandler(void * p_context); // Main application timer
+    static void pSendControl(uint32_t sampleTicks); // @12a Queues a control frame for the next connection event
+    static void pUpdateSampleAge(uint32_t sampleTicks, uint32_t nowTicks); // @12a Sample age statistics
+    static void pEnterSystemOff(); // @15a Powers down and waits for motion
+    static void pRememberVehicle(const ble_gap_addr_t * address); // @16a Stores the vehicle address
 
     // Functions for Event Handling
     static void pBLEEventHandler(ble_evt_t * event); // Dispatches bluetooth events to all modules
@@ -103,13 +153,13 @@ static uint8_t mDirectionValue; // The interpreted direction value: 1 for forwar
     static void pPeerManagerEventHandler(pm_evt_t const * event); // Handles peer manager events
     static void pAdvertisingEventHandler(ble_adv_evt_t event); // Handles advertising events
     static void pConnectionParametersEventHandler(ble_conn_params_evt_t* event); // Handles connection parameters events
+    static void pImuDataReadyHandler(void); // @02a Handles the IMU FIFO watermark interrupt
+    static void pImuBatchHandler(Sensors_AccelGyro_Batch_t * batch); // @03a Handles a batch read from the IMU FIFO
+    static void pRadioNotificationHandler(bool radioActive); // @12a Called before and after each radio event
 
     // Functions for Error Handling
     static void pConnectionParametersErrorHandler(uint32_t nrf_error);
 
-    // Helper functions
-    static uint16_t pInterpretFlexSensorValue(uint16_t input, uint16_t inputMin, uint16_t inputMax, uint16_t outputMin, uint16_t outputMax);
-
 /*****************************************************************************
  * Description: Main application entry point                                 *
  *                                                                           *
@@ -122,50 +172,80 @@ int main(void)
 {
     uint32_t err_code;
 
+    // @15a Find out why we started before the SoftDevice owns the POWER
+    // registers. The reset reasons are cumulative, so clear them.
+    if((NRF_POWER->RESETREAS & POWER_RESETREAS_OFF_Msk) != 0)
+    {
+        mWakeCause = SERVICE_GLOVE_WAKE_MOTION;
+    }
+    NRF_POWER->RESETREAS = NRF_POWER->RESETREAS;
+
+    // @17a Count the cycles of the fusion math while nothing can interrupt
+    // it (only built in with "make FUSION_BENCHMARK=1")
+    Fusion_Benchmark_Run();
+
     // Initialize Hardware
     pSetupTimers();
     pSetupBLEStack();
+    // @15c The timers count from the low frequency clock, which starts with
+    // the SoftDevice. Start them as early as that, so the wake time covers
+    // the rest of the start up.
+    pStartTimers();
+    app_timer_cnt_get(&mStartTicks);
     pSetupPeerManager();
+    Storage_Flash_Init(); // @07a
+    mVehicleKnown = Storage_Flash_Read(STORAGE_FLASH_KEY_VEHICLE_ADDRESS, &mVehicleAddress, sizeof(mVehicleAddress)); // @16a
     pSetupGAPParameters();
     pSetupBluetoothServices();
     pSetupBluetoothAdvertising();
     pSetupConnectionParameters();
+    pSetupRadioNotification(); // @12a
 
     // turn on the LED
     nrf_gpio_cfg_output(HDW_CONFIG_ONBOARD_LED_PIN);
     nrf_gpio_pin_clear(HDW_CONFIG_ONBOARD_LED_PIN);
 
     // Initialize Accelerometer via SPI
-    Sensors_AccelGyro_Init();
+    // @02c If the accelerometer does not respond, report it rather than
+    // powering the flex sensors for a glove that is not wired correctly.
+    if(!Sensors_AccelGyro_Init())
+    {
+        APP_ERROR_HANDLER(NRF_ERROR_NOT_FOUND);
+    }
+    // @07a Use the stored offsets, or estimate them the first time the
+    // glove is held flat and still.
+    Sensors_Calibration_Init();
+    Sensors_AccelGyro_EnableFifo(GLOVE_IMU_FIFO_WATERMARK); // @01a
+    Sensors_AccelGyro_EnableDataReadyInterrupt(pImuDataReadyHandler); // @02a
+    pImuDataReadyHandler(); // @03a In case INT1 rose before it was routed
 
     // For protection, Only set up flex sensors after we
     // have determined that we are connected to sensors
     // This is because this applies power to pins
     pSetupFlexSensors();
 
-    // Start execution of bluetooth and timers
-    pStartTimers();
-    err_code = ble_advertising_start(BLE_ADV_MODE_FAST);
+    // Start execution of bluetooth @15c (the timers are already running)
+    // @16c Directed at the last vehicle first, if there is one; the
+    // advertising module goes on to fast advertising if not.
+    err_code = ble_advertising_start(BLE_ADV_MODE_DIRECTED);
     APP_ERROR_CHECK(err_code);
 
     // Enter main loop.
     // All interaction is currently done via
     // interrupts and timers
+    // @09c including the flex sensors, which are sampled by the ADC on a
+    // hardware timer and filtered in the ADC interrupt
     while(1)
     {
-        // ADC
-        nrf_drv_adc_sample_convert(&mThrottleADCChannelConfig,&mThrottleAdcValue);
-        nrf_drv_adc_sample_convert(&mDirectionADCChannelConfig,&mDirectionAdcValue);
-
-        // interpret the values
-        mThrottleValue = pInterpretFlexSensorValue(mThrottleAdcValue, 750, 1023, 0, 100);
-        mDirectionValue = (mDirectionAdcValue < 800) ? 1 : 0; // if the sensor is bent, then go forward(1), else go backward (0)
-
-        // TODO: we should also be using a complimentary filter and gyroscope data.
-        Sensors_AccelGyro_GetAccelerometerData(&accel_data); // TODO: probably want to move this to a timer
         // Perform device power management
         uint32_t err_code = sd_app_evt_wait();
         APP_ERROR_CHECK(err_code);
+
+        // @15a Nobody connected while advertising, wait for motion instead
+        if(mSystemOffPending)
+        {
+            pEnterSystemOff();
+        }
     }
 }
 
@@ -173,6 +253,132 @@ int main(void)
  ********************Start of Runtime Functions*******************************
  *****************************************************************************/
 
+/*****************************************************************************
+ * Description: Called from the GPIOTE interrupt when the IMU FIFO reaches   *
+ *              its watermark. @03c Starts draining the FIFO without         *
+ *              waiting; the batches are handled in pImuBatchHandler.   @02a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pImuDataReadyHandler(void)
+{
+    // If a read is already in progress, it is not known if it saw these
+    // samples, so have it read again once it is done.
+    if(Sensors_AccelGyro_ReadFifoAsync(&mImuBatch, pImuBatchHandler) == NRF_ERROR_BUSY)
+    {
+        mImuDataPending = true;
+    }
+}
+
+/*****************************************************************************
+ * Description: Called from the SPI interrupt with each batch drained from   *
+ *              the IMU FIFO. Keeps reading until the FIFO is below the      *
+ *              watermark, so INT1 goes low and the next watermark gives a   *
+ *              new rising edge.                                        @03a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: batch -> the samples read from the FIFO                       *
+ *                                                                           *
+ *****************************************************************************/
+static void pImuBatchHandler(Sensors_AccelGyro_Batch_t * batch)
+{
+    // @14a Every sample goes out on the stream, if the vehicle asked for it
+    Service_Stream_AddBatch(batch);
+
+    // @07a While calibrating, the raw samples are averaged. Once the new
+    // offsets are applied, the filters start again from calibrated samples.
+    // @07c This batch was decoded before the new offsets, so it is left out.
+    if(Sensors_Calibration_Update(batch))
+    {
+        Fusion_Complementary_Reset();
+        Fusion_Quaternion_Reset();
+    }
+    else
+    {
+        // @05c Every sample goes through the complementary filter
+        Fusion_Complementary_Update(batch);
+
+        // @06a and the full 3 axis orientation engine
+        Fusion_Quaternion_Update(batch);
+    }
+
+    // @10a Timestamp for the control frame
+    if(batch->count > 0)
+    {
+        mImuSampleIndex = batch->firstSampleIndex + batch->count - 1;
+    }
+
+    if(mImuDataPending || batch->count == SENSORS_ACCELGYRO_FIFO_BATCH_SIZE)
+    {
+        mImuDataPending = false;
+        APP_ERROR_CHECK(Sensors_AccelGyro_ReadFifoAsync(batch, pImuBatchHandler));
+    }
+    else if(mControlPending)
+    {
+        // @12a The FIFO is drained ahead of a connection event, so the
+        // frame goes out with the newest samples.
+        mControlPending = false;
+        pSendControl(batch->timestamp);
+    }
+}
+
+/*****************************************************************************
+ * Description: Called from the radio notification interrupt before and      *
+ *              after each radio event. Before a connection event, starts a  *
+ *              FIFO read; once it is done pImuBatchHandler sends the        *
+ *              control frame, in time for the event.                   @12a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: radioActive -> true before the radio event, false after it    *
+ *                                                                           *
+ *****************************************************************************/
+static void pRadioNotificationHandler(bool radioActive)
+{
+    if(!radioActive || !Service_Glove_IsConnected())
+    {
+        return;
+    }
+
+    uint32_t now;
+    uint32_t elapsed;
+    app_timer_cnt_get(&now);
+
+    // A frame queued before this notification goes out in this event
+    if(mControlQueued)
+    {
+        mControlQueued = false;
+        pUpdateSampleAge(mControlSampleTicks, now);
+
+        // @15a The first one since start up gives the wake time, @16c or
+        // since the link was lost, the reconnect time
+        if(mWakeTimeMs == 0)
+        {
+            app_timer_cnt_diff_compute(now, mStartTicks, &elapsed);
+            elapsed = (elapsed < GLOVE_WAKE_TIME_MAX_TICKS) ? elapsed : GLOVE_WAKE_TIME_MAX_TICKS;
+            mWakeTimeMs = (uint16_t)((elapsed * 1000) / GLOVE_TIMER_TICKS_PER_SECOND);
+        }
+    }
+
+    app_timer_cnt_diff_compute(now, mRadioEventTicks, &elapsed);
+    mRadioEventTicks = now;
+    // Capped at a second (after a reconnect) so the conversion can't overflow
+    elapsed = (elapsed < GLOVE_TIMER_TICKS_PER_SECOND) ? elapsed : GLOVE_TIMER_TICKS_PER_SECOND;
+    mRadioElapsedMs = (uint16_t)((elapsed * 1000) / GLOVE_TIMER_TICKS_PER_SECOND);
+
+    // If a read is already in progress, have it read again once it is
+    // done, as it may have started before the newest samples.
+    mControlPending = true;
+    if(Sensors_AccelGyro_ReadFifoAsync(&mImuBatch, pImuBatchHandler) == NRF_ERROR_BUSY)
+    {
+        mImuDataPending = true;
+    }
+}
+
 /*****************************************************************************
  * Description: Main application timer. Responsible for LED control and      *
  *              for updating characteristics                                 *
@@ -189,33 +395,174 @@ static void pMainTimerHandler(void * p_context)
         // If we have a connection, the LED is solid
         nrf_gpio_pin_clear(HDW_CONFIG_ONBOARD_LED_PIN);
 
-        int16_t pitch = atan2(-accel_data.xData, sqrt(accel_data.yData*accel_data.yData + accel_data.zData*accel_data.zData)) * 180/M_PI;
-        Service_Glove_SetAnglePitch(&pitch);
-        Service_Glove_SetThrottle(&mThrottleValue);
-        Service_Glove_SetDirection(&mDirectionValue);
+        // @13a Drive profile while the glove is used, idle otherwise
+        int16_t pitch;
+        Fusion_Complementary_GetAngles(&pitch, NULL);
+        Service_Profile_Update(Sensors_Flex_GetBend(SENSORS_FLEX_THROTTLE), pitch);
+
+        // @12c The control frames are sent before each connection event,
+        // see pRadioNotificationHandler. The timer sends the telemetry.
+        static uint8_t telemetryTicks = 0;
+        if(++telemetryTicks >= GLOVE_TELEMETRY_TICKS)
+        {
+            Service_Glove_Telemetry_t telemetry;
+
+            telemetryTicks = 0;
+            CRITICAL_REGION_ENTER();
+            telemetry = mTelemetry;
+            mTelemetry.sampleAgeMax = 0;
+            CRITICAL_REGION_EXIT();
+            telemetry.interval = Service_Profile_GetInterval(); // @13a
+            telemetry.profile = (uint8_t)Service_Profile_GetActive(); // @13a
+            telemetry.profileTime = Service_Profile_GetTimeInProfile(); // @13a
+            telemetry.streamDropped = Service_Stream_GetDropped(); // @14a
+            telemetry.wakeTime = mWakeTimeMs; // @15a
+            telemetry.wakeCause = mWakeCause; // @15a @16c
+            Service_Glove_SetTelemetry(&telemetry);
+        }
     }
     else
     {
+        // @11a The first frame of the next connection is sent right away
+        Service_Rate_Reset();
+        mControlQueued = false; // @12a
+
         // If we do not have a connection, toggle the LED.
         nrf_gpio_pin_toggle(HDW_CONFIG_ONBOARD_LED_PIN);
     }
 }
 
 /*****************************************************************************
- *************************Start of Helper Functions***************************
+ * Description: Builds the control frame from the filters and the flex       *
+ *              sensors, and queues it if the rate control says it is worth  *
+ *              sending. Called from the SPI interrupt just before a         *
+ *              connection event.                                       @12a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: sampleTicks -> app_timer count when the FIFO was read         *
+ *                                                                           *
  *****************************************************************************/
+static void pSendControl(uint32_t sampleTicks)
+{
+    // @10c Every control input goes out in one frame, so the vehicle
+    // always sees values from the same tick. The angles are sent in
+    // centidegrees; the vehicle rounds them to what it needs.
+    Service_Glove_Control_t control;
+    control.timestamp = mImuSampleIndex;
+
+    // @05c From the complementary filter rather than one accelerometer sample
+    Fusion_Complementary_GetAngles(&control.pitch, &control.roll);
+
+    // @09c The latest filtered flex sensor readings
+    control.throttle = Sensors_Flex_GetBend(SENSORS_FLEX_THROTTLE); // 0 to 100
+    control.direction = Sensors_Flex_IsBent(SENSORS_FLEX_DIRECTION) ? 1 : 0; // if the sensor is bent, then go forward(1), else go backward (0)
+
+    // @11c Only sent when the rate control says it is worth it: every
+    // connection event while the hand moves, a keep-alive while it is still.
+    if(Service_Rate_Update(&control, mRadioElapsedMs))
+    {
+        Service_Glove_SetControl(&control);
+
+        // @06a Full orientation for roll and yaw rate control axes
+        Fusion_Orientation_t orientation;
+        Fusion_Quaternion_GetOrientation(&orientation);
+        Service_Glove_SetOrientation(&orientation);
+
+        mControlQueued = true;
+        mControlSampleTicks = sampleTicks;
+    }
+}
+
+/*****************************************************************************
+ * Description: Adds the sample age of a control frame to the telemetry.     *
+ *              The age runs from the FIFO read to the start of the          *
+ *              connection event, which is GLOVE_RADIO_LEAD_US after the     *
+ *              notification. The newest sample in the FIFO is up to one     *
+ *              sample period older than the read.                      @12a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: sampleTicks -> app_timer count when the FIFO was read         *
+ *             nowTicks    -> app_timer count at the radio notification      *
+ *                                                                           *
+ *****************************************************************************/
+static void pUpdateSampleAge(uint32_t sampleTicks, uint32_t nowTicks)
+{
+    uint32_t ticks;
+    app_timer_cnt_diff_compute(nowTicks, sampleTicks, &ticks);
+
+    // In units of 10us; capped first so the multiplication can't overflow
+    uint32_t age = (ticks < GLOVE_TIMER_TICKS_PER_SECOND) ? ticks : GLOVE_TIMER_TICKS_PER_SECOND;
+    age = (age * 100000) / GLOVE_TIMER_TICKS_PER_SECOND;
+    age += GLOVE_RADIO_LEAD_US / 10;
+    if(age > UINT16_MAX)
+    {
+        age = UINT16_MAX;
+    }
+
+    // The average moves an eighth of the way to each new age
+    int32_t average = mTelemetry.sampleAgeAvg;
+    average += ((int32_t)age - average) / 8;
+
+    CRITICAL_REGION_ENTER();
+    mTelemetry.sampleAge = (uint16_t)age;
+    mTelemetry.sampleAgeAvg = (uint16_t)average;
+    if(age > mTelemetry.sampleAgeMax)
+    {
+        mTelemetry.sampleAgeMax = (uint16_t)age;
+    }
+    CRITICAL_REGION_EXIT();
+}
 
-uint16_t pInterpretFlexSensorValue(uint16_t input, uint16_t inputMin, uint16_t inputMax, uint16_t outputMin, uint16_t outputMax)
+/*****************************************************************************
+ * Description: Called from the main loop once advertising has timed out.    *
+ *              Powers down the flex sensors and the LED, sets the IMU to    *
+ *              raise INT1 on motion, and goes to system off. INT1 wakes the *
+ *              glove with a reset, so this does not return.            @15a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pEnterSystemOff()
 {
-    // The map formula does not work well without bounding
-    if(input > inputMax) input = inputMax;
-    if(input < inputMin) input = inputMin;
+    uint32_t err_code;
+
+    // The pins keep their state in system off
+    Sensors_Flex_PowerDown();
+    nrf_gpio_pin_set(HDW_CONFIG_ONBOARD_LED_PIN);
 
-    // the following formula was taken from https://www.arduino.cc/en/Reference/Map
-  uint16_t value = (input - inputMin) * (outputMax - outputMin) / (inputMax - inputMin) + outputMin;
+    Sensors_AccelGyro_EnableWakeUp();
 
-  // The value will be inverted from where we want since high is not bent, so invert the value
-  return 100 - value;
+    err_code = sd_power_system_off();
+    APP_ERROR_CHECK(err_code);
+}
+
+/*****************************************************************************
+ * Description: Keeps the address of the vehicle that connected, for the     *
+ *              directed advertising after a link loss. It is also stored in *
+ *              flash, so that it is still known after system off; only when *
+ *              it changes, to save flash writes.                       @16a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: address -> the address of the vehicle                         *
+ *                                                                           *
+ *****************************************************************************/
+static void pRememberVehicle(const ble_gap_addr_t * address)
+{
+    if(mVehicleKnown && memcmp(&mVehicleAddress, address, sizeof(mVehicleAddress)) == 0)
+    {
+        return;
+    }
+
+    mVehicleAddress = *address;
+    mVehicleKnown = true;
+
+    // If it can't be written now, it is tried again on the next connection
+    (void)Storage_Flash_Write(STORAGE_FLASH_KEY_VEHICLE_ADDRESS, &mVehicleAddress, sizeof(mVehicleAddress));
 }
 
 /*****************************************************************************
@@ -246,6 +593,9 @@ static void pBLEEventHandler(ble_evt_t* event)
 
     // Call glove service event handling (our event handler)
     Service_Glove_BluetoothEventHandler(event);
+
+    // @13a Tracks the connection interval of the profiles
+    Service_Profile_BluetoothEventHandler(event);
 }
 
 /*****************************************************************************
@@ -263,10 +613,21 @@ static void pBLEEventHandlerImpl(ble_evt_t * event)
     {
         case BLE_GAP_EVT_CONNECTED:
             mConnectionHandle = event->evt.gap_evt.conn_handle;
+            pRememberVehicle(&event->evt.gap_evt.params.connected.peer_addr); // @16a
             break;
         case BLE_GAP_EVT_DISCONNECTED:
+        {
             mConnectionHandle = BLE_CONN_HANDLE_INVALID;
+
+            // @16a Time the reconnect from here. The advertising module
+            // restarts advertising directed at the vehicle after this.
+            CRITICAL_REGION_ENTER();
+            app_timer_cnt_get(&mStartTicks);
+            mWakeTimeMs = 0;
+            mWakeCause = SERVICE_GLOVE_WAKE_RECONNECT;
+            CRITICAL_REGION_EXIT();
             break;
+        }
         default:
             break;
     }
@@ -312,16 +673,25 @@ static void pPeerManagerEventHandler(pm_evt_t const * event)
  *****************************************************************************/
 static void pAdvertisingEventHandler(ble_adv_evt_t event)
 {
-    uint32_t err_code;
-
     switch (event)
     {
+        case BLE_ADV_EVT_PEER_ADDR_REQUEST: // @16a
+            // Without a reply, directed advertising is skipped
+            if(mVehicleKnown)
+            {
+                APP_ERROR_CHECK(ble_advertising_peer_addr_reply(&mVehicleAddress));
+            }
+            break;
+        case BLE_ADV_EVT_DIRECTED: // @16a
+            break;
         case BLE_ADV_EVT_FAST:
             break;
+        case BLE_ADV_EVT_SLOW: // @15a
+            break;
         case BLE_ADV_EVT_IDLE:
-            // Go to system-off mode (this function will not return; wakeup will cause a reset).
-            err_code = sd_power_system_off();
-            APP_ERROR_CHECK(err_code);
+            // @15c Go to system-off mode from the main loop. The IMU is set up
+            // to wake us over blocking SPI, which can't complete from here.
+            mSystemOffPending = true;
             break;
         default:
             break;
@@ -330,12 +700,10 @@ static void pAdvertisingEventHandler(ble_adv_evt_t event)
 
 /*****************************************************************************
  * Description: Handles Connection Parameters Events                         *
- *              Note from Nordic examples:                                   *
- *              All this function does is to disconnect. This could have     *
- *              been done by simply setting the disconnect_on_fail config    *
- *              parameter, but instead we use the event handler mechanism to *
- *              demonstrate its use.                                         *
- *              TODO: switch to use disconnect_on_fail config parameter      *
+ *              @13c Used to disconnect when the negotiation failed. The     *
+ *              profiles are preferences; the vehicle may keep other         *
+ *              parameters (e.g. the drive profile while its motors run),    *
+ *              which is no reason to drop the connection.                   *
  * Returns: None                                                             *
  *                                                                           *
  * Parameters: event -> event details                                        *
@@ -343,13 +711,8 @@ static void pAdvertisingEventHandler(ble_adv_evt_t event)
  *****************************************************************************/
 static void pConnectionParametersEventHandler(ble_conn_params_evt_t* event)
 {
-    uint32_t err_code;
-
-    if (event->evt_type == BLE_CONN_PARAMS_EVT_FAILED)
-    {
-        err_code = sd_ble_gap_disconnect(mConnectionHandle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
-        APP_ERROR_CHECK(err_code);
-    }
+    // A failed negotiation keeps the parameters the vehicle chose
+    UNUSED_PARAMETER(event);
 }
 
 
@@ -541,10 +904,21 @@ static void pSetupBluetoothAdvertising()
     advdata.include_appearance      = true;
 
     ble_adv_modes_config_t options = {0};
+
+    // @16a High duty directed advertising to the last vehicle (1.28s), so
+    // it can connect on the first packet it hears after a link loss.
+    options.ble_adv_directed_enabled = true;
+
     options.ble_adv_fast_enabled  = true;
     options.ble_adv_fast_interval = APP_ADV_INTERVAL;
     options.ble_adv_fast_timeout  = APP_ADV_TIMEOUT_IN_SECONDS;
 
+    // @15a Then slower, so a vehicle switched on later still finds the
+    // glove, before it waits for motion in system off.
+    options.ble_adv_slow_enabled  = true;
+    options.ble_adv_slow_interval = APP_ADV_SLOW_INTERVAL;
+    options.ble_adv_slow_timeout  = APP_ADV_SLOW_TIMEOUT_IN_SECONDS;
+
     // Declare variable holding glove service UUID
     ble_uuid_t m_adv_uuids[] = {{BLE_UUID_GLOVE_SERVICE, BLE_UUID_TYPE_VENDOR_BEGIN}};
 
@@ -588,6 +962,25 @@ static void pSetupConnectionParameters()
     APP_ERROR_CHECK(err_code);
 }
 
+/*****************************************************************************
+ * Description: Set up the radio notifications, which start the IMU reads    *
+ *              ahead of each connection event.                         @12a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pSetupRadioNotification()
+{
+    // Same priority as the SPI interrupt, so the handler and the FIFO reads
+    // never preempt each other.
+    uint32_t err_code = ble_radio_notification_init(APP_IRQ_PRIORITY_LOW,
+                                                    GLOVE_RADIO_LEAD_DISTANCE,
+                                                    pRadioNotificationHandler);
+    APP_ERROR_CHECK(err_code);
+}
+
 /*****************************************************************************
  * Description: Set up flex sensors                                          *
  *                                                                           *
@@ -598,18 +991,12 @@ static void pSetupConnectionParameters()
  *****************************************************************************/
 static void pSetupFlexSensors()
 {
-    // Apply Power to the flex sensors
-    nrf_gpio_cfg_output(HDW_CONFIG_DIR_FLEX_VIN_PIN);
-    nrf_gpio_pin_set(HDW_CONFIG_DIR_FLEX_VIN_PIN);
-    nrf_gpio_cfg_output(HDW_CONFIG_THROTTLE_FLEX_VIN_PIN);
-    nrf_gpio_pin_set(HDW_CONFIG_THROTTLE_FLEX_VIN_PIN);
-
-    // init ADC driver
-    ret_code_t ret_code;
-    nrf_drv_adc_config_t config = NRF_DRV_ADC_DEFAULT_CONFIG;
-
-    ret_code = nrf_drv_adc_init(&config, NULL);
-    APP_ERROR_CHECK(ret_code);
+    // @09c Sensors_Flex applies power to the flex sensors (from the channel
+    // table in Config_Hardware.h) and starts the timed ADC scan.
+
+    // @08a Load the response tables, or learn them while the glove is
+    // flexed for the first few seconds.
+    Sensors_Flex_Init();
 }
 
 /*****************************************************************************
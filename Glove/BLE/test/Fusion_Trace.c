@@ -0,0 +1,312 @@
+/*****************************************************************************
+* FILENAME: Fusion_Trace.c                                                   *
+*                                                                            *
+* DESCRIPTION: IMU traces for the host tests of the fusion filters, see      *
+*              Fusion_Trace.h. The true orientation is integrated in double  *
+*              precision, as a quaternion rotating the glove into the world, *
+*              which is the convention of Fusion_Quaternion.c.               *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Fusion_Trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define PI              3.14159265358979323846
+#define TO_RADIANS      (PI / 180.0)
+#define TO_DEGREES      (180.0 / PI)
+
+// Private functions
+static void pMultiply(const double * a, const double * b, double * product); // quaternion product
+static void pGetAngles(const double * q, Fusion_Trace_Angles_t * angles); // Z-Y-X angles of a quaternion
+static double pGaussian(); // normal noise, rms 1
+static int16_t pCounts(double value); // rounds and saturates to int16
+
+// Private variables
+static uint32_t mRandom; // State of the noise generator
+
+/*****************************************************************************
+ * Description: Makes a trace of a glove that starts at an orientation and   *
+ *              turns at the rates of a motion. The accelerometer only sees  *
+ *              gravity.                                                     *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: samples -> where to place the trace                           *
+ *             count   -> the number of samples                              *
+ *             start   -> the orientation at the start                       *
+ *             motion  -> the rates, NULL for a glove held still             *
+ *             sensor  -> the noise and bias                                 *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Trace_Make(Fusion_Trace_Sample_t * samples, int count, const Fusion_Trace_Angles_t * start,
+                       Fusion_Trace_Motion_t motion, const Fusion_Trace_Sensor_t * sensor)
+{
+    const double period = 1.0 / SENSORS_ACCELGYRO_SAMPLE_RATE_HZ;
+    double q[4];
+
+    // q = yaw about Z * pitch about Y * roll about X
+    double yaw[4]   = { cos(start->yaw * TO_RADIANS / 2), 0, 0, sin(start->yaw * TO_RADIANS / 2) };
+    double pitch[4] = { cos(start->pitch * TO_RADIANS / 2), 0, sin(start->pitch * TO_RADIANS / 2), 0 };
+    double roll[4]  = { cos(start->roll * TO_RADIANS / 2), sin(start->roll * TO_RADIANS / 2), 0, 0 };
+    double yawPitch[4];
+    pMultiply(yaw, pitch, yawPitch);
+    pMultiply(yawPitch, roll, q);
+
+    mRandom = (sensor->seed == 0) ? 1 : sensor->seed;
+    for(int i = 0; i < count; i++)
+    {
+        double rate[3] = { 0, 0, 0 };
+        if(motion != NULL)
+        {
+            motion(i * period, rate);
+        }
+
+        // Turn by the rate over the sample: q = q * (cos(a/2), sin(a/2) axis)
+        double angle = sqrt((rate[0] * rate[0]) + (rate[1] * rate[1]) + (rate[2] * rate[2])) * TO_RADIANS * period;
+        if(angle > 0)
+        {
+            double scale = sin(angle / 2) / (angle / (TO_RADIANS * period));
+            double step[4] = { cos(angle / 2), rate[0] * scale, rate[1] * scale, rate[2] * scale };
+            double turned[4];
+            pMultiply(q, step, turned);
+            memcpy(q, turned, sizeof(q));
+        }
+
+        // Gravity in the glove frame, +1g on Z when flat
+        double gravity[3] =
+        {
+            2 * ((q[1] * q[3]) - (q[0] * q[2])),
+            2 * ((q[0] * q[1]) + (q[2] * q[3])),
+            (q[0] * q[0]) - (q[1] * q[1]) - (q[2] * q[2]) + (q[3] * q[3])
+        };
+
+        for(int axis = 0; axis < 3; axis++)
+        {
+            samples[i].accel[axis] = pCounts((gravity[axis] * FUSION_TRACE_ACCEL_LSB_PER_G) +
+                                             (sensor->accelNoiseLsb * pGaussian()));
+            samples[i].gyro[axis]  = pCounts(((rate[axis] + sensor->gyroBiasDps[axis]) * FUSION_TRACE_GYRO_LSB_PER_DPS) +
+                                             (sensor->gyroNoiseLsb * pGaussian()));
+        }
+        samples[i].hasTruth = true;
+        pGetAngles(q, &samples[i].truth);
+    }
+}
+
+/*****************************************************************************
+ * Description: Puts the next samples of a trace in a batch, as the FIFO     *
+ *              read would. The sample index counts from the trace start.    *
+ *                                                                           *
+ * Returns: The number of samples in the batch, 0 at the end of the trace    *
+ *                                                                           *
+ * Parameters: samples -> the trace                                          *
+ *             count   -> the number of samples in the trace                 *
+ *             first   -> the first sample to put in the batch               *
+ *             batch   -> the batch                                          *
+ *                                                                           *
+ *****************************************************************************/
+int Fusion_Trace_Batch(const Fusion_Trace_Sample_t * samples, int count, int first,
+                       Sensors_AccelGyro_Batch_t * batch)
+{
+    memset(batch, 0x00, sizeof(*batch));
+    batch->firstSampleIndex = (uint32_t)first;
+    while((batch->count < SENSORS_ACCELGYRO_FIFO_BATCH_SIZE) && (first + batch->count < count))
+    {
+        const Fusion_Trace_Sample_t * sample = &samples[first + batch->count];
+        batch->accel[batch->count].xData = sample->accel[0];
+        batch->accel[batch->count].yData = sample->accel[1];
+        batch->accel[batch->count].zData = sample->accel[2];
+        batch->gyro[batch->count].xData = sample->gyro[0];
+        batch->gyro[batch->count].yData = sample->gyro[1];
+        batch->gyro[batch->count].zData = sample->gyro[2];
+        batch->count++;
+    }
+    return batch->count;
+}
+
+/*****************************************************************************
+ * Description: Writes a trace to a file, one sample per line:               *
+ *                  ax ay az gx gy gz [roll pitch yaw]                       *
+ *              in sensor counts and degrees. A recording from the glove has *
+ *              no angles.                                                   *
+ *                                                                           *
+ * Returns: true if the file was written                                     *
+ *                                                                           *
+ * Parameters: path    -> the file                                           *
+ *             samples -> the trace                                          *
+ *             count   -> the number of samples                              *
+ *                                                                           *
+ *****************************************************************************/
+bool Fusion_Trace_Save(const char * path, const Fusion_Trace_Sample_t * samples, int count)
+{
+    FILE * file = fopen(path, "w");
+    if(file == NULL)
+    {
+        return false;
+    }
+
+    fprintf(file, "# %d Hz, ax ay az gx gy gz in counts, roll pitch yaw in degrees\n",
+            SENSORS_ACCELGYRO_SAMPLE_RATE_HZ);
+    for(int i = 0; i < count; i++)
+    {
+        fprintf(file, "%d %d %d %d %d %d", samples[i].accel[0], samples[i].accel[1], samples[i].accel[2],
+                samples[i].gyro[0], samples[i].gyro[1], samples[i].gyro[2]);
+        if(samples[i].hasTruth)
+        {
+            fprintf(file, " %.4f %.4f %.4f", samples[i].truth.roll, samples[i].truth.pitch, samples[i].truth.yaw);
+        }
+        fprintf(file, "\n");
+    }
+    return (fclose(file) == 0);
+}
+
+/*****************************************************************************
+ * Description: Reads a trace written by Fusion_Trace_Save, or recorded in   *
+ *              the same format. Lines starting with # are skipped.          *
+ *                                                                           *
+ * Returns: The number of samples read, -1 if the file can't be read         *
+ *                                                                           *
+ * Parameters: path    -> the file                                           *
+ *             samples -> where to place the trace                           *
+ *             max     -> the most samples to read                           *
+ *                                                                           *
+ *****************************************************************************/
+int Fusion_Trace_Load(const char * path, Fusion_Trace_Sample_t * samples, int max)
+{
+    FILE * file = fopen(path, "r");
+    char line[160];
+    int count = 0;
+
+    if(file == NULL)
+    {
+        return -1;
+    }
+
+    while((count < max) && (fgets(line, sizeof(line), file) != NULL))
+    {
+        int counts[6];
+        Fusion_Trace_Angles_t truth;
+        int read;
+
+        if(line[0] == '#')
+        {
+            continue;
+        }
+        read = sscanf(line, "%d %d %d %d %d %d %lf %lf %lf", &counts[0], &counts[1], &counts[2],
+                      &counts[3], &counts[4], &counts[5], &truth.roll, &truth.pitch, &truth.yaw);
+        if(read < 6)
+        {
+            continue;
+        }
+
+        for(int axis = 0; axis < 3; axis++)
+        {
+            samples[count].accel[axis] = pCounts(counts[axis]);
+            samples[count].gyro[axis] = pCounts(counts[axis + 3]);
+        }
+        samples[count].hasTruth = (read == 9);
+        samples[count].truth = samples[count].hasTruth ? truth : (Fusion_Trace_Angles_t){ 0, 0, 0 };
+        count++;
+    }
+    fclose(file);
+    return count;
+}
+
+/*****************************************************************************
+ * Description: The difference of two angles in degrees, the short way       *
+ *              around.                                                      *
+ *                                                                           *
+ * Returns: a - b, -180 to 180                                               *
+ *                                                                           *
+ * Parameters: a, b -> the angles                                            *
+ *                                                                           *
+ *****************************************************************************/
+double Fusion_Trace_AngleError(double a, double b)
+{
+    double error = fmod(a - b, 360.0);
+    if(error > 180.0)
+    {
+        error -= 360.0;
+    }
+    else if(error < -180.0)
+    {
+        error += 360.0;
+    }
+    return error;
+}
+
+/*****************************************************************************
+ * Description: The product of two quaternions (w, x, y, z)                  *
+ *****************************************************************************/
+static void pMultiply(const double * a, const double * b, double * product)
+{
+    product[0] = (a[0] * b[0]) - (a[1] * b[1]) - (a[2] * b[2]) - (a[3] * b[3]);
+    product[1] = (a[0] * b[1]) + (a[1] * b[0]) + (a[2] * b[3]) - (a[3] * b[2]);
+    product[2] = (a[0] * b[2]) - (a[1] * b[3]) + (a[2] * b[0]) + (a[3] * b[1]);
+    product[3] = (a[0] * b[3]) + (a[1] * b[2]) - (a[2] * b[1]) + (a[3] * b[0]);
+}
+
+/*****************************************************************************
+ * Description: The Z-Y-X angles of a quaternion, with the formulas of       *
+ *              Fusion_Quaternion_GetOrientation.                            *
+ *****************************************************************************/
+static void pGetAngles(const double * q, Fusion_Trace_Angles_t * angles)
+{
+    double vx = 2 * ((q[1] * q[3]) - (q[0] * q[2]));
+    double vy = 2 * ((q[0] * q[1]) + (q[2] * q[3]));
+    double vz = (q[0] * q[0]) - (q[1] * q[1]) - (q[2] * q[2]) + (q[3] * q[3]);
+
+    angles->roll  = atan2(vy, vz) * TO_DEGREES;
+    angles->pitch = atan2(-vx, sqrt((vy * vy) + (vz * vz))) * TO_DEGREES;
+    angles->yaw   = atan2(2 * ((q[0] * q[3]) + (q[1] * q[2])),
+                          1 - (2 * ((q[2] * q[2]) + (q[3] * q[3])))) * TO_DEGREES;
+}
+
+/*****************************************************************************
+ * Description: Normal noise with an rms of 1 (Box-Muller), from a generator *
+ *              of its own so a trace is the same on every host.             *
+ *****************************************************************************/
+static double pGaussian()
+{
+    double u[2];
+    for(int i = 0; i < 2; i++)
+    {
+        // xorshift32
+        mRandom ^= mRandom << 13;
+        mRandom ^= mRandom >> 17;
+        mRandom ^= mRandom << 5;
+        u[i] = ((mRandom & 0xFFFFFFu) + 0.5) / 16777216.0;
+    }
+    return sqrt(-2.0 * log(u[0])) * cos(2 * PI * u[1]);
+}
+
+/*****************************************************************************
+ * Description: Rounds a value to sensor counts, saturating as the sensor    *
+ *              does.                                                        *
+ *****************************************************************************/
+static int16_t pCounts(double value)
+{
+    if(value >= INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    if(value <= INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+    return (int16_t)lround(value);
+}
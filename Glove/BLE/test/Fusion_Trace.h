@@ -0,0 +1,142 @@
+/*****************************************************************************
+* FILENAME: Fusion_Trace.h                                                   *
+*                                                                            *
+* DESCRIPTION: IMU traces for the host tests of the fusion filters. A trace  *
+*              is either made here, from a motion and a model of the         *
+*              LSM6DS33 (noise, gyroscope bias), with the true angles kept   *
+*              alongside, or loaded from a file recorded from the glove.     *
+*              Either way it is replayed to a filter in FIFO sized batches,  *
+*              the way main.c feeds it.                                      *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef FUSION_TRACE_H__
+#define FUSION_TRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Sensors_AccelGyro.h"
+
+// The sensor scale, from the configuration in Sensors_AccelGyro.h
+#define FUSION_TRACE_ACCEL_LSB_PER_G    (1000000.0 / SENSORS_ACCELGYRO_ACCEL_UG_PER_LSB)
+#define FUSION_TRACE_GYRO_LSB_PER_DPS   (1000000.0 / SENSORS_ACCELGYRO_GYRO_UDPS_PER_LSB)
+
+// The LSM6DS33 noise at 416Hz, in LSBs rms: 90 ug/sqrt(Hz) and
+// 7 mdps/sqrt(Hz) over the 208Hz bandwidth
+#define FUSION_TRACE_ACCEL_NOISE_LSB    21.0
+#define FUSION_TRACE_GYRO_NOISE_LSB     11.5
+
+// Angles in degrees, in the Z-Y-X order of Fusion_Orientation_t
+typedef struct
+{
+    double      roll;
+    double      pitch;
+    double      yaw;
+} Fusion_Trace_Angles_t;
+
+// One sample of a trace
+typedef struct
+{
+    int16_t                 accel[3];   // X, Y, Z in sensor counts
+    int16_t                 gyro[3];    // X, Y, Z in sensor counts
+    bool                    hasTruth;   // The true angles are known
+    Fusion_Trace_Angles_t   truth;      // The true angles after the sample
+} Fusion_Trace_Sample_t;
+
+// The sensor a trace is made with
+typedef struct
+{
+    double      gyroBiasDps[3];     // Added to every gyroscope sample
+    double      accelNoiseLsb;      // Gaussian, rms
+    double      gyroNoiseLsb;       // Gaussian, rms
+    unsigned    seed;               // For the noise, so a trace can be made again
+} Fusion_Trace_Sensor_t;
+
+// The motion of a trace: the rates about the glove axes (dps) at a time
+// from the start (s)
+typedef void (*Fusion_Trace_Motion_t)(double seconds, double * rateDps);
+
+/*****************************************************************************
+ * Description: Makes a trace of a glove that starts at an orientation and   *
+ *              turns at the rates of a motion. The accelerometer only sees  *
+ *              gravity.                                                     *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: samples -> where to place the trace                           *
+ *             count   -> the number of samples                              *
+ *             start   -> the orientation at the start                       *
+ *             motion  -> the rates, NULL for a glove held still             *
+ *             sensor  -> the noise and bias                                 *
+ *                                                                           *
+ *****************************************************************************/
+void Fusion_Trace_Make(Fusion_Trace_Sample_t * samples, int count, const Fusion_Trace_Angles_t * start,
+                       Fusion_Trace_Motion_t motion, const Fusion_Trace_Sensor_t * sensor);
+
+/*****************************************************************************
+ * Description: Puts the next samples of a trace in a batch, as the FIFO     *
+ *              read would. The sample index counts from the trace start.    *
+ *                                                                           *
+ * Returns: The number of samples in the batch, 0 at the end of the trace    *
+ *                                                                           *
+ * Parameters: samples -> the trace                                          *
+ *             count   -> the number of samples in the trace                 *
+ *             first   -> the first sample to put in the batch               *
+ *             batch   -> the batch                                          *
+ *                                                                           *
+ *****************************************************************************/
+int Fusion_Trace_Batch(const Fusion_Trace_Sample_t * samples, int count, int first,
+                       Sensors_AccelGyro_Batch_t * batch);
+
+/*****************************************************************************
+ * Description: Writes a trace to a file, one sample per line:               *
+ *                  ax ay az gx gy gz [roll pitch yaw]                       *
+ *              in sensor counts and degrees. A recording from the glove has *
+ *              no angles.                                                   *
+ *                                                                           *
+ * Returns: true if the file was written                                     *
+ *                                                                           *
+ * Parameters: path    -> the file                                           *
+ *             samples -> the trace                                          *
+ *             count   -> the number of samples                              *
+ *                                                                           *
+ *****************************************************************************/
+bool Fusion_Trace_Save(const char * path, const Fusion_Trace_Sample_t * samples, int count);
+
+/*****************************************************************************
+ * Description: Reads a trace written by Fusion_Trace_Save, or recorded in   *
+ *              the same format. Lines starting with # are skipped.          *
+ *                                                                           *
+ * Returns: The number of samples read, -1 if the file can't be read         *
+ *                                                                           *
+ * Parameters: path    -> the file                                           *
+ *             samples -> where to place the trace                           *
+ *             max     -> the most samples to read                           *
+ *                                                                           *
+ *****************************************************************************/
+int Fusion_Trace_Load(const char * path, Fusion_Trace_Sample_t * samples, int max);
+
+/*****************************************************************************
+ * Description: The difference of two angles in degrees, the short way       *
+ *              around.                                                      *
+ *                                                                           *
+ * Returns: a - b, -180 to 180                                               *
+ *                                                                           *
+ * Parameters: a, b -> the angles                                            *
+ *                                                                           *
+ *****************************************************************************/
+double Fusion_Trace_AngleError(double a, double b);
+
+#endif /* FUSION_TRACE_H__ */
@@ -0,0 +1,410 @@
+/*****************************************************************************
+* FILENAME: Test_Comm_SPI.c                                                  *
+*                                                                            *
+* DESCRIPTION: Host test of the SPI transaction queue, see Comm_SPI.h, on a  *
+*              fake of the SDK SPI master driver. A transfer started on the  *
+*              fake stays on the bus until the test runs its interrupt, so   *
+*              the queue can be filled, and the order of the transfers and   *
+*              of the callbacks checked. The blocking functions wait with    *
+*              __WFE, which runs the interrupt of the transfer on the bus.   *
+*              Built and run with "make test" in this directory.             *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Comm_SPI.h"
+#include "NordicSDK.h"
+#include "Config_Hardware.h"
+#include "Test_Check.h"
+
+// The most interrupts a blocking call may wait for before the test gives up
+#define MAX_WAITS               16
+
+// The fake driver
+static nrf_drv_spi_config_t     mConfig;
+static nrf_drv_spi_handler_t    mHandler;
+static bool                     mOnBus;             // A transfer is on the bus
+static nrf_drv_spi_evt_t        mEvent;             // Its done event
+static uint8_t                  mMosi[COMM_SPI_MAX_TRANSFER_BYTES]; // Bytes clocked out by the last transfer
+static uint8_t                  mStarts;            // Transfers started
+static uint8_t                  mInterrupts;        // Transfers done
+static uint8_t                  mWaits;             // Calls of __WFE
+static uint8_t                  mAppErrors;         // Failed APP_ERROR_CHECKs
+static uint32_t                 mLastError;
+
+// The transactions of the tests, and the order their callbacks were called
+static Comm_SPI_Transaction_t   mTransactions[3];
+static uint8_t                  mTx[3][COMM_SPI_MAX_TRANSFER_BYTES];
+static uint8_t                  mRx[3][COMM_SPI_MAX_TRANSFER_BYTES];
+static char                     mCallbacks[8];      // The names of the transactions, in order
+static uint8_t                  mCallbackCount;
+static uint8_t                  mStartsAtCallback;  // mStarts when the last callback was called
+static uint8_t                  mRepeats;           // Times a transaction scheduled itself again
+
+/*****************************************************************************
+ ****************Start of Fake Implementations *******************************
+ *****************************************************************************/
+
+void Fake_AppError(uint32_t errorCode, const char * file, int line)
+{
+    mAppErrors++;
+    mLastError = errorCode;
+    printf("APP_ERROR_CHECK 0x%04X at %s:%d\n", (unsigned)errorCode, file, line);
+}
+
+uint32_t nrf_drv_spi_init(nrf_drv_spi_t const * const p_instance, nrf_drv_spi_config_t const * p_config,
+                          nrf_drv_spi_handler_t handler)
+{
+    (void)p_instance;
+    mConfig = *p_config;
+    mHandler = handler;
+    return NRF_SUCCESS;
+}
+
+uint32_t nrf_drv_spi_transfer(nrf_drv_spi_t const * const p_instance,
+                              uint8_t const * p_tx_buffer, uint8_t tx_buffer_length,
+                              uint8_t * p_rx_buffer, uint8_t rx_buffer_length)
+{
+    (void)p_instance;
+    if(mOnBus)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    mOnBus = true;
+    mStarts++;
+    mEvent.type = NRF_DRV_SPI_EVENT_DONE;
+    mEvent.data.done.p_tx_buffer = p_tx_buffer;
+    mEvent.data.done.tx_length = tx_buffer_length;
+    mEvent.data.done.p_rx_buffer = p_rx_buffer;
+    mEvent.data.done.rx_length = rx_buffer_length;
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+ * Description: The byte the slave sends at a position of a transfer.        *
+ *                                                                           *
+ *****************************************************************************/
+static uint8_t pMiso(uint8_t position)
+{
+    return (uint8_t)(0x5A ^ position);
+}
+
+/*****************************************************************************
+ * Description: Clocks the transfer on the bus, and runs its interrupt.      *
+ *                                                                           *
+ * Returns: false if there was no transfer on the bus                        *
+ *                                                                           *
+ *****************************************************************************/
+static bool pSpiInterrupt()
+{
+    const nrf_drv_spi_xfer_desc_t * done = &mEvent.data.done;
+    uint8_t length = (done->tx_length > done->rx_length) ? done->tx_length : done->rx_length;
+    uint8_t i;
+
+    if(!mOnBus)
+    {
+        return false;
+    }
+
+    for(i = 0; i < length; i++)
+    {
+        mMosi[i] = (i < done->tx_length) ? done->p_tx_buffer[i] : mConfig.orc;
+        if(i < done->rx_length)
+        {
+            done->p_rx_buffer[i] = pMiso(i);
+        }
+    }
+
+    mOnBus = false;
+    mInterrupts++;
+    mHandler(&mEvent);
+    return true;
+}
+
+void Fake_WFE(void)
+{
+    if(++mWaits > MAX_WAITS || !pSpiInterrupt())
+    {
+        printf("FAIL: waiting for an interrupt that will never come\n");
+        exit(1);
+    }
+}
+
+/*****************************************************************************
+ ****************Start of Test Helpers ***************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Records the callback of a transaction, by its name in        *
+ *              context.                                                     *
+ *                                                                           *
+ *****************************************************************************/
+static void pRecord(Comm_SPI_Transaction_t * transaction)
+{
+    if(mCallbackCount < sizeof(mCallbacks) - 1)
+    {
+        mCallbacks[mCallbackCount++] = *(const char *)transaction->context;
+    }
+    mStartsAtCallback = mStarts;
+}
+
+/*****************************************************************************
+ * Description: A callback that schedules its own transaction again, then    *
+ *              the next one, as the FIFO read chains its status and data.   *
+ *                                                                           *
+ *****************************************************************************/
+static void pRepeat(Comm_SPI_Transaction_t * transaction)
+{
+    pRecord(transaction);
+    if(++mRepeats < 4)
+    {
+        CHECK(Comm_SPI_Schedule(transaction) == NRF_SUCCESS);
+    }
+    else
+    {
+        CHECK(Comm_SPI_Schedule(&mTransactions[1]) == NRF_SUCCESS);
+    }
+}
+
+/*****************************************************************************
+ * Description: Sets up the fake driver and the transactions: each sends     *
+ *              txBytes and receives rxBytes, and is named A, B and C.       *
+ *                                                                           *
+ *****************************************************************************/
+static void pSetUp(uint8_t txBytes, uint8_t rxBytes)
+{
+    static const char names[] = "ABC";
+    uint8_t i, j;
+
+    memset(&mConfig, 0x00, sizeof(mConfig));
+    mHandler = NULL;
+    mOnBus = false;
+    mStarts = 0;
+    mInterrupts = 0;
+    mWaits = 0;
+    mAppErrors = 0;
+    mLastError = NRF_SUCCESS;
+    memset(mCallbacks, 0x00, sizeof(mCallbacks));
+    mCallbackCount = 0;
+    mRepeats = 0;
+
+    Comm_SPI_Init();
+
+    for(i = 0; i < 3; i++)
+    {
+        for(j = 0; j < txBytes; j++)
+        {
+            mTx[i][j] = (uint8_t)((0x10 * (i + 1)) + j);
+        }
+        memset(mRx[i], 0x00, sizeof(mRx[i]));
+        mTransactions[i].txBuffer = mTx[i];
+        mTransactions[i].txBytes = txBytes;
+        mTransactions[i].rxBuffer = mRx[i];
+        mTransactions[i].rxBytes = rxBytes;
+        mTransactions[i].callback = pRecord;
+        mTransactions[i].context = (void *)&names[i];
+    }
+}
+
+/*****************************************************************************
+ * Description: Runs the interrupts until the bus is idle.                   *
+ *                                                                           *
+ *****************************************************************************/
+static void pRunInterrupts()
+{
+    while(pSpiInterrupt())
+    {
+    }
+}
+
+/*****************************************************************************
+ ****************Start of Tests **********************************************
+ *****************************************************************************/
+
+static void pTestInit()
+{
+    pSetUp(1, 4);
+    CHECK(mHandler != NULL);
+    CHECK(mConfig.ss_pin == HDW_CONFIG_SPI_SS_PIN);
+    CHECK(mConfig.miso_pin == HDW_CONFIG_SPI_MISO_PIN);
+    CHECK(mConfig.mosi_pin == HDW_CONFIG_SPI_MOSI_PIN);
+    CHECK(mConfig.sck_pin == HDW_CONFIG_SPI_SCK_PIN);
+}
+
+// Transactions wait their turn, and each next one is on the bus before the
+// callback of the one before it is called
+static void pTestQueue()
+{
+    uint8_t i;
+    bool received = true;
+
+    pSetUp(1, 4);
+    CHECK(Comm_SPI_Schedule(&mTransactions[0]) == NRF_SUCCESS);
+    CHECK(Comm_SPI_Schedule(&mTransactions[1]) == NRF_SUCCESS);
+    CHECK(Comm_SPI_Schedule(&mTransactions[2]) == NRF_SUCCESS);
+    CHECK(mStarts == 1);
+    CHECK(mEvent.data.done.p_tx_buffer == mTx[0]);
+
+    CHECK(pSpiInterrupt());
+    CHECK(strcmp(mCallbacks, "A") == 0);
+    CHECK(mStartsAtCallback == 2);
+    CHECK(mEvent.data.done.p_tx_buffer == mTx[1]);
+
+    pRunInterrupts();
+    CHECK(strcmp(mCallbacks, "ABC") == 0);
+    CHECK(mStarts == 3);
+    for(i = 0; i < 4; i++)
+    {
+        received = received && (mRx[0][i] == pMiso(i)) && (mRx[2][i] == pMiso(i));
+    }
+    CHECK(received);
+    CHECK(mAppErrors == 0);
+}
+
+// Callbacks schedule the next transactions from the interrupt, so they run
+// back to back without the main loop
+static void pTestChain()
+{
+    pSetUp(1, 13);
+    mTransactions[0].callback = pRepeat;
+    CHECK(Comm_SPI_Schedule(&mTransactions[0]) == NRF_SUCCESS);
+    pRunInterrupts();
+    CHECK(strcmp(mCallbacks, "AAAAB") == 0);
+    CHECK(mInterrupts == 5);
+    CHECK(mWaits == 0);
+
+    // The queue is empty again, so the next transaction starts at once
+    CHECK(Comm_SPI_Schedule(&mTransactions[2]) == NRF_SUCCESS);
+    CHECK(mStarts == 6);
+    pRunInterrupts();
+}
+
+static void pTestScheduleLengths()
+{
+    pSetUp(0, 0);
+    CHECK(Comm_SPI_Schedule(&mTransactions[0]) == NRF_ERROR_INVALID_LENGTH);
+    CHECK(mStarts == 0);
+
+    pSetUp(COMM_SPI_MAX_TRANSFER_BYTES, COMM_SPI_MAX_TRANSFER_BYTES);
+    CHECK(Comm_SPI_Schedule(&mTransactions[0]) == NRF_SUCCESS);
+    pRunInterrupts();
+    CHECK(memcmp(mMosi, mTx[0], COMM_SPI_MAX_TRANSFER_BYTES) == 0);
+    CHECK(mRx[0][COMM_SPI_MAX_TRANSFER_BYTES - 1] == pMiso(COMM_SPI_MAX_TRANSFER_BYTES - 1));
+}
+
+// Any length up to COMM_SPI_MAX_TRANSFER_BYTES in one chip select window,
+// and only the bytes after the ones sent are returned
+static void pTestTransfer()
+{
+    uint8_t tx[COMM_SPI_MAX_TRANSFER_BYTES];
+    uint8_t rx[COMM_SPI_MAX_TRANSFER_BYTES];
+    uint8_t i;
+    bool filled = true;
+    bool received = true;
+
+    for(i = 0; i < 200; i++)
+    {
+        tx[i] = (uint8_t)(i * 3);
+    }
+
+    pSetUp(1, 4);
+    memset(rx, 0x00, sizeof(rx));
+    Comm_SPI_Transfer(tx, 200, rx, 55);
+    CHECK(mStarts == 1);
+    CHECK(mEvent.data.done.tx_length == 200);
+    CHECK(mEvent.data.done.rx_length == 255);
+    CHECK(memcmp(mMosi, tx, 200) == 0);
+    for(i = 0; i < 55; i++)
+    {
+        filled = filled && (mMosi[200 + i] == 0xFF);
+        received = received && (rx[i] == pMiso((uint8_t)(200 + i)));
+    }
+    CHECK(filled);
+    CHECK(received);
+    CHECK(mWaits == 1);
+
+    // Write only
+    Comm_SPI_Transfer(tx, 2, NULL, 0);
+    CHECK(mStarts == 2);
+    CHECK(mEvent.data.done.rx_length == 0);
+    CHECK(mEvent.data.done.p_rx_buffer == NULL);
+
+    // Too long, reported and not started
+    Comm_SPI_Transfer(tx, 200, rx, 56);
+    CHECK(mAppErrors == 1);
+    CHECK(mLastError == NRF_ERROR_INVALID_LENGTH);
+    CHECK(mStarts == 2);
+}
+
+static void pTestReadBurst()
+{
+    uint8_t rx[COMM_SPI_MAX_BURST_BYTES];
+    uint8_t i;
+    bool received = true;
+
+    pSetUp(1, 4);
+    Comm_SPI_ReadBurst(0xA2, rx, 12);
+    CHECK(mStarts == 1);
+    CHECK(mEvent.data.done.tx_length == 1);
+    CHECK(mEvent.data.done.rx_length == 13);
+    CHECK(mMosi[0] == 0xA2);
+    for(i = 0; i < 12; i++)
+    {
+        received = received && (rx[i] == pMiso((uint8_t)(i + 1)));
+    }
+    CHECK(received);
+
+    Comm_SPI_ReadBurst(0xA2, rx, COMM_SPI_MAX_BURST_BYTES);
+    CHECK(mStarts == 2);
+    CHECK(rx[COMM_SPI_MAX_BURST_BYTES - 1] == pMiso(COMM_SPI_MAX_BURST_BYTES));
+
+    Comm_SPI_ReadBurst(0xA2, rx, 0);
+    Comm_SPI_ReadBurst(0xA2, rx, COMM_SPI_MAX_BURST_BYTES + 1);
+    CHECK(mAppErrors == 2);
+    CHECK(mStarts == 2);
+}
+
+// A blocking call waits behind the queued transactions
+static void pTestBlockingBehindQueue()
+{
+    uint8_t rx[4];
+
+    pSetUp(1, 4);
+    CHECK(Comm_SPI_Schedule(&mTransactions[0]) == NRF_SUCCESS);
+    CHECK(Comm_SPI_Schedule(&mTransactions[1]) == NRF_SUCCESS);
+    Comm_SPI_ReadBurst(0x8F, rx, sizeof(rx));
+    CHECK(strcmp(mCallbacks, "AB") == 0);
+    CHECK(mStarts == 3);
+    CHECK(mWaits == 3);
+    CHECK(mMosi[0] == 0x8F);
+    CHECK(rx[0] == pMiso(1));
+    CHECK(!mOnBus);
+}
+
+int main()
+{
+    pTestInit();
+    pTestQueue();
+    pTestChain();
+    pTestScheduleLengths();
+    pTestTransfer();
+    pTestReadBurst();
+    pTestBlockingBehindQueue();
+
+    return Test_Check_Summary("Comm_SPI");
+}
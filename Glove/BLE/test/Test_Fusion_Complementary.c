@@ -0,0 +1,377 @@
+/*****************************************************************************
+* FILENAME: Test_Fusion_Complementary.c                                      *
+*                                                                            *
+* DESCRIPTION: Trace replay harness of the complementary filter, see         *
+*              Fusion_Complementary.h. Traces from Fusion_Trace.h are fed to *
+*              it in FIFO batches, and its lag and noise are measured        *
+*              against the truth, and against the accelerometer only angle   *
+*              taken every 100ms that it replaced. Built and run with        *
+*              "make test" in this directory.                                *
+*              "make replay TRACE=<file>" replays a recorded trace instead   *
+*              (see Fusion_Trace_Save for the format; a recording of the     *
+*              Stream characteristic is in the same counts) and prints the   *
+*              angles of every batch.                                        *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "Fusion_Complementary.h"
+#include "Fusion_Math.h"
+#include "Fusion_Trace.h"
+#include "Test_Check.h"
+
+#define PI                  3.14159265358979323846
+#define SAMPLE_RATE         SENSORS_ACCELGYRO_SAMPLE_RATE_HZ
+#define MAX_SAMPLES         (60 * SAMPLE_RATE)
+#define MAX_BATCHES         (MAX_SAMPLES / SENSORS_ACCELGYRO_FIFO_BATCH_SIZE + 1)
+
+// The accelerometer only angle main.c took before: one sample every 100ms
+#define ACCEL_ONLY_PERIOD   (SAMPLE_RATE / 10)
+
+// The longest lag looked for, in samples
+#define MAX_LAG             (SAMPLE_RATE / 4)
+
+#define TRACE_FILE          "_build/Fusion_Trace_Swing.txt"
+
+// The pitch and roll of a filter after each batch, in degrees
+typedef struct
+{
+    int         batches;
+    int         end[MAX_BATCHES];       // The last sample of the batch
+    double      pitch[MAX_BATCHES];
+    double      roll[MAX_BATCHES];
+} Replay_Angles_t;
+
+static Fusion_Trace_Sample_t    mTrace[MAX_SAMPLES];
+static Fusion_Trace_Sample_t    mLoaded[MAX_SAMPLES];
+static Replay_Angles_t          mFiltered;
+static Replay_Angles_t          mAccelOnly;
+static const Fusion_Trace_Sensor_t mSensor =
+{
+    { 0, 0, 0 }, FUSION_TRACE_ACCEL_NOISE_LSB, FUSION_TRACE_GYRO_NOISE_LSB, 416
+};
+
+/*****************************************************************************
+ ****************Start of Test Helpers ***************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Feeds a trace to a reset filter, a batch at a time, and      *
+ *              keeps the angles after each batch. Alongside, keeps the      *
+ *              accelerometer only angle of the last 100ms sample.           *
+ *                                                                           *
+ * Returns: None (the angles are left in mFiltered and mAccelOnly)           *
+ *                                                                           *
+ * Parameters: trace -> the trace                                            *
+ *             count -> the number of samples                                *
+ *                                                                           *
+ *****************************************************************************/
+static void pReplay(const Fusion_Trace_Sample_t * trace, int count)
+{
+    Sensors_AccelGyro_Batch_t batch;
+    int16_t pitch = 0;
+    int16_t roll = 0;
+    int16_t heldPitch = 0;
+    int16_t heldRoll = 0;
+
+    mFiltered.batches = 0;
+    mAccelOnly.batches = 0;
+    Fusion_Complementary_Reset();
+    for(int first = 0; Fusion_Trace_Batch(trace, count, first, &batch) > 0; first += batch.count)
+    {
+        int b = mFiltered.batches;
+
+        Fusion_Complementary_Update(&batch);
+        Fusion_Complementary_GetAngles(&pitch, &roll);
+        mFiltered.end[b] = first + batch.count - 1;
+        mFiltered.pitch[b] = pitch / 100.0;
+        mFiltered.roll[b] = roll / 100.0;
+        mFiltered.batches++;
+
+        for(int i = 0; i < batch.count; i++)
+        {
+            if((first + i) % ACCEL_ONLY_PERIOD == 0)
+            {
+                Fusion_Math_GetTilt(&batch.accel[i], &heldPitch, &heldRoll);
+            }
+        }
+        mAccelOnly.end[b] = mFiltered.end[b];
+        mAccelOnly.pitch[b] = heldPitch / 100.0;
+        mAccelOnly.roll[b] = heldRoll / 100.0;
+        mAccelOnly.batches++;
+    }
+}
+
+/*****************************************************************************
+ * Description: The lag of the pitch of a replay: the delay of the truth     *
+ *              that the angles are closest to, from the settling time on.   *
+ *                                                                           *
+ * Returns: The lag in samples; the rms error at that lag via 'rms'          *
+ *                                                                           *
+ * Parameters: angles -> the replay                                          *
+ *             trace  -> the trace, with the truth                           *
+ *             settle -> the samples before the errors are counted           *
+ *             rms    -> where to place the rms error, in degrees            *
+ *                                                                           *
+ *****************************************************************************/
+static int pPitchLag(const Replay_Angles_t * angles, const Fusion_Trace_Sample_t * trace, int settle, double * rms)
+{
+    int best = 0;
+    double bestSquares = INFINITY;
+
+    for(int lag = 0; lag <= MAX_LAG; lag++)
+    {
+        double squares = 0;
+        int compared = 0;
+        for(int b = 0; b < angles->batches; b++)
+        {
+            if(angles->end[b] >= settle)
+            {
+                double error = angles->pitch[b] - trace[angles->end[b] - lag].truth.pitch;
+                squares += error * error;
+                compared++;
+            }
+        }
+        squares /= compared;
+        if(squares < bestSquares)
+        {
+            bestSquares = squares;
+            best = lag;
+        }
+    }
+    *rms = sqrt(bestSquares);
+    return best;
+}
+
+/*****************************************************************************
+ * Description: The noise of the angles of a replay held still: the rms of   *
+ *              their difference from the average, from the settling time    *
+ *              on. The average error is returned too.                       *
+ *                                                                           *
+ * Returns: The noise in degrees; the average error via 'offset'             *
+ *                                                                           *
+ * Parameters: angles -> the replay                                          *
+ *             trace  -> the trace, with the truth                           *
+ *             settle -> the samples before the errors are counted           *
+ *             offset -> where to place the largest average error, degrees   *
+ *                                                                           *
+ *****************************************************************************/
+static double pNoise(const Replay_Angles_t * angles, const Fusion_Trace_Sample_t * trace, int settle, double * offset)
+{
+    double sum[2] = { 0, 0 };
+    double squares[2] = { 0, 0 };
+    int compared = 0;
+
+    for(int b = 0; b < angles->batches; b++)
+    {
+        if(angles->end[b] >= settle)
+        {
+            double pitch = angles->pitch[b] - trace[angles->end[b]].truth.pitch;
+            double roll = angles->roll[b] - trace[angles->end[b]].truth.roll;
+            sum[0] += pitch;
+            sum[1] += roll;
+            squares[0] += pitch * pitch;
+            squares[1] += roll * roll;
+            compared++;
+        }
+    }
+
+    for(int i = 0; i < 2; i++)
+    {
+        sum[i] /= compared;
+        squares[i] = (squares[i] / compared) - (sum[i] * sum[i]);
+    }
+    *offset = fmax(fabs(sum[0]), fabs(sum[1]));
+    return sqrt(fmax(squares[0], squares[1]));
+}
+
+/*****************************************************************************
+ * Description: The motions of the traces.                                   *
+ *                                                                           *
+ *****************************************************************************/
+static void pPitchSwing(double seconds, double * rateDps)
+{
+    // 20 degrees either way at 1Hz, up to 126 dps
+    rateDps[1] = 20.0 * 2 * PI * cos(2 * PI * seconds);
+}
+
+static void pHandMotion(double seconds, double * rateDps)
+{
+    // As Test_Fusion_Quaternion, without the turn about Z
+    rateDps[0] = 100.0 * sin(2 * PI * 0.7 * seconds);
+    rateDps[1] = 60.0 * cos(2 * PI * 0.4 * seconds);
+}
+
+/*****************************************************************************
+ ****************Start of Tests **********************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Held still at a tilt, the filter has a small fraction of the *
+ *              noise of a single accelerometer sample, and no offset.       *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestNoise()
+{
+    const Fusion_Trace_Angles_t start = { 20, -30, 0 };
+    const int count = 10 * SAMPLE_RATE;
+    double filteredNoise;
+    double accelNoise;
+    double filteredOffset;
+    double accelOffset;
+
+    Fusion_Trace_Make(mTrace, count, &start, NULL, &mSensor);
+    pReplay(mTrace, count);
+    filteredNoise = pNoise(&mFiltered, mTrace, 2 * SAMPLE_RATE, &filteredOffset);
+    accelNoise = pNoise(&mAccelOnly, mTrace, 2 * SAMPLE_RATE, &accelOffset);
+
+    CHECK(filteredNoise < accelNoise / 4);
+    CHECK(filteredOffset < 0.05);
+    printf("Fusion_Complementary: still, noise %.3f degrees rms (accelerometer only %.3f), offset %.3f\n",
+           filteredNoise, accelNoise, filteredOffset);
+}
+
+/*****************************************************************************
+ * Description: Swinging in pitch at up to 126 dps, the filter lags the hand *
+ *              by less than a batch, where the accelerometer only angle     *
+ *              lagged by half its 100ms period.                             *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestLag()
+{
+    const Fusion_Trace_Angles_t start = { 0, 0, 0 };
+    const int count = 10 * SAMPLE_RATE;
+    double filteredRms;
+    double accelRms;
+    int filteredLag;
+    int accelLag;
+
+    Fusion_Trace_Make(mTrace, count, &start, pPitchSwing, &mSensor);
+    pReplay(mTrace, count);
+    filteredLag = pPitchLag(&mFiltered, mTrace, 2 * SAMPLE_RATE, &filteredRms);
+    accelLag = pPitchLag(&mAccelOnly, mTrace, 2 * SAMPLE_RATE, &accelRms);
+
+    CHECK(filteredLag < SENSORS_ACCELGYRO_FIFO_BATCH_SIZE / 2);
+    CHECK(filteredRms < 0.1);
+    CHECK(accelLag > filteredLag);
+    printf("Fusion_Complementary: 1Hz swing, lag %.1f ms and %.2f degrees rms (accelerometer only %.1f ms, %.2f)\n",
+           1000.0 * filteredLag / SAMPLE_RATE, filteredRms, 1000.0 * accelLag / SAMPLE_RATE, accelRms);
+}
+
+/*****************************************************************************
+ * Description: Moving like a hand about X and Y. The filter takes each      *
+ *              gyroscope axis as the rate of its angle, which is only right *
+ *              close to level, so it is not as close as the quaternion      *
+ *              engine; this bounds how far off that makes it.               *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestHandMotion()
+{
+    const Fusion_Trace_Angles_t start = { 10, -5, 0 };
+    const int count = 20 * SAMPLE_RATE;
+    double pitchWorst = 0;
+    double rollWorst = 0;
+
+    Fusion_Trace_Make(mTrace, count, &start, pHandMotion, &mSensor);
+    pReplay(mTrace, count);
+    for(int b = 0; b < mFiltered.batches; b++)
+    {
+        if(mFiltered.end[b] >= SAMPLE_RATE)
+        {
+            const Fusion_Trace_Angles_t * truth = &mTrace[mFiltered.end[b]].truth;
+            pitchWorst = fmax(pitchWorst, fabs(mFiltered.pitch[b] - truth->pitch));
+            rollWorst = fmax(rollWorst, fabs(Fusion_Trace_AngleError(mFiltered.roll[b], truth->roll)));
+        }
+    }
+
+    CHECK(pitchWorst < 6.0);
+    CHECK(rollWorst < 6.0);
+    printf("Fusion_Complementary: hand motion, pitch within %.2f degrees, roll within %.2f\n", pitchWorst, rollWorst);
+}
+
+/*****************************************************************************
+ * Description: A trace saved to a file and loaded back replays the same.    *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestSaveLoad()
+{
+    const Fusion_Trace_Angles_t start = { 0, 0, 0 };
+    const int count = 4 * SAMPLE_RATE;
+    int loaded;
+    int differences = 0;
+
+    Fusion_Trace_Make(mTrace, count, &start, pPitchSwing, &mSensor);
+    CHECK(Fusion_Trace_Save(TRACE_FILE, mTrace, count));
+    loaded = Fusion_Trace_Load(TRACE_FILE, mLoaded, MAX_SAMPLES);
+    CHECK(loaded == count);
+
+    for(int i = 0; (i < count) && (i < loaded); i++)
+    {
+        differences += (memcmp(mTrace[i].accel, mLoaded[i].accel, sizeof(mTrace[i].accel)) != 0);
+        differences += (memcmp(mTrace[i].gyro, mLoaded[i].gyro, sizeof(mTrace[i].gyro)) != 0);
+        differences += !mLoaded[i].hasTruth;
+        differences += (fabs(mTrace[i].truth.pitch - mLoaded[i].truth.pitch) > 0.0001);
+    }
+    CHECK(differences == 0);
+    CHECK(Fusion_Trace_Load("_build/missing.txt", mLoaded, MAX_SAMPLES) == -1);
+}
+
+/*****************************************************************************
+ * Description: Replays a recorded trace and prints the filter and the       *
+ *              accelerometer only angles of every batch, and the truth if   *
+ *              the trace has it.                                            *
+ *                                                                           *
+ *****************************************************************************/
+static int pReplayFile(const char * path)
+{
+    int count = Fusion_Trace_Load(path, mLoaded, MAX_SAMPLES);
+    if(count <= 0)
+    {
+        printf("Can't read a trace from %s\n", path);
+        return 1;
+    }
+
+    pReplay(mLoaded, count);
+    printf("# seconds, pitch, roll, accelerometer only pitch, roll[, true pitch, roll]\n");
+    for(int b = 0; b < mFiltered.batches; b++)
+    {
+        const Fusion_Trace_Sample_t * sample = &mLoaded[mFiltered.end[b]];
+        printf("%.4f %.2f %.2f %.2f %.2f", (double)mFiltered.end[b] / SAMPLE_RATE, mFiltered.pitch[b],
+               mFiltered.roll[b], mAccelOnly.pitch[b], mAccelOnly.roll[b]);
+        if(sample->hasTruth)
+        {
+            printf(" %.2f %.2f", sample->truth.pitch, sample->truth.roll);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+int main(int argc, char * argv[])
+{
+    if(argc > 1)
+    {
+        return pReplayFile(argv[1]);
+    }
+
+    pTestNoise();
+    pTestLag();
+    pTestHandMotion();
+    pTestSaveLoad();
+
+    return Test_Check_Summary("Fusion_Complementary");
+}
@@ -0,0 +1,297 @@
+/*****************************************************************************
+* FILENAME: Test_Fusion_Math.c                                               *
+*                                                                            *
+* DESCRIPTION: Host accuracy test of the integer attitude math, see          *
+*              Fusion_Math.h. Every result is compared with the double       *
+*              precision formula rounded to centidegrees, over a grid of the *
+*              inputs and the cases most likely to be off: small vectors,    *
+*              the ends of the range, the axes and the rounding boundaries.  *
+*              Built and run with "make test" in this directory.             *
+*              The cycles on the nRF51 come from Fusion_Benchmark.h on the   *
+*              board; the host times printed here only compare the two.     *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "Fusion_Math.h"
+#include "Test_Check.h"
+
+#define PI                  3.14159265358979323846
+#define TO_CENTIDEGREES     (18000.0 / PI)
+
+// The grid steps. Prime, so the grid does not line up with powers of 2.
+#define ATAN2_GRID_STEP     61
+#define TILT_GRID_STEP      1021
+
+static long     mCompared;      // Results compared with the formula
+static long     mWrong;         // Results more than a centidegree off
+static int      mWorstError;    // Largest difference, in centidegrees
+static double   mSink;          // Keeps the timed results from being optimized out
+
+/*****************************************************************************
+ ****************Start of Test Helpers ***************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Compares a result with the formula in double precision. The  *
+ *              first few that are off are printed.                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pCompare(int16_t result, double reference, const char * what, double y, double x)
+{
+    int error = abs(result - (int)lround(reference * TO_CENTIDEGREES));
+
+    mCompared++;
+    if(error > mWorstError)
+    {
+        mWorstError = error;
+    }
+    if(error > 1 && mWrong++ < 5)
+    {
+        printf("%s(%.0f, %.0f) = %d, expected %.2f\n", what, y, x, result, reference * TO_CENTIDEGREES);
+    }
+}
+
+/*****************************************************************************
+ * Description: Compares both tilt angles of a sample with the formula.      *
+ *                                                                           *
+ *****************************************************************************/
+static void pCompareTilt(int32_t x, int32_t y, int32_t z)
+{
+    Sensors_Accel_Data_t accel = { (int16_t)x, (int16_t)y, (int16_t)z };
+    int16_t pitch;
+    int16_t roll;
+    double yz = sqrt(((double)y * y) + ((double)z * z));
+
+    Fusion_Math_GetTilt(&accel, &pitch, &roll);
+    pCompare(pitch, atan2(-(double)x, yz), "pitch", -x, yz);
+    pCompare(roll, atan2((double)y, (double)z), "roll", y, z);
+}
+
+/*****************************************************************************
+ * Description: Starts counting the results of a test.                       *
+ *                                                                           *
+ *****************************************************************************/
+static void pSetUp()
+{
+    mCompared = 0;
+    mWrong = 0;
+    mWorstError = 0;
+}
+
+/*****************************************************************************
+ * Description: Seconds of processor time used so far.                       *
+ *                                                                           *
+ *****************************************************************************/
+static double pSeconds()
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/*****************************************************************************
+ ****************Start of Tests **********************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: The square root is exact at, and on both sides of, every     *
+ *              perfect square, and at the ends of the range.                *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestSqrt()
+{
+    long wrong = 0;
+
+    for(uint32_t root = 1; root <= 0xFFFF; root++)
+    {
+        uint32_t square = root * root;
+        wrong += (Fusion_Math_Sqrt(square) != root);
+        wrong += (Fusion_Math_Sqrt(square - 1) != root - 1);
+        wrong += (Fusion_Math_Sqrt(square + root) != root); // Just below the next square
+    }
+    CHECK(wrong == 0);
+    CHECK(Fusion_Math_Sqrt(0) == 0);
+    CHECK(Fusion_Math_Sqrt(0xFFFFFFFFUL) == 0xFFFF);
+}
+
+/*****************************************************************************
+ * Description: atan2 over a grid of every int16 input, every small vector,  *
+ *              the ends of the int32 range, and vectors on either side of   *
+ *              each half centidegree, where the rounding decides.           *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestAtan2()
+{
+    const int32_t extremes[] = { INT32_MIN, INT32_MIN + 1, -65536, -1, 0, 1, 65535, INT32_MAX - 1, INT32_MAX };
+    const uint8_t count = sizeof(extremes) / sizeof(extremes[0]);
+
+    pSetUp();
+    for(int32_t y = INT16_MIN; y <= INT16_MAX; y += ATAN2_GRID_STEP)
+    {
+        for(int32_t x = INT16_MIN; x <= INT16_MAX; x += ATAN2_GRID_STEP)
+        {
+            pCompare(Fusion_Math_Atan2(y, x), atan2(y, x), "atan2", y, x);
+        }
+    }
+    for(int32_t y = -64; y <= 64; y++)
+    {
+        for(int32_t x = -64; x <= 64; x++)
+        {
+            if(x != 0 || y != 0)
+            {
+                pCompare(Fusion_Math_Atan2(y, x), atan2(y, x), "atan2", y, x);
+            }
+        }
+    }
+    for(uint8_t i = 0; i < count; i++)
+    {
+        for(uint8_t j = 0; j < count; j++)
+        {
+            if(extremes[i] != 0 || extremes[j] != 0)
+            {
+                pCompare(Fusion_Math_Atan2(extremes[i], extremes[j]),
+                         atan2(extremes[i], extremes[j]), "atan2", extremes[i], extremes[j]);
+            }
+        }
+    }
+    for(int32_t half = -35999; half <= 35999; half += 2)
+    {
+        // Half way between two centidegrees, nudged either way
+        for(int nudge = -1; nudge <= 1; nudge += 2)
+        {
+            double angle = ((half / 2.0) + (nudge * 0.0001)) / TO_CENTIDEGREES;
+            int32_t y = (int32_t)lround(sin(angle) * 1e9);
+            int32_t x = (int32_t)lround(cos(angle) * 1e9);
+            pCompare(Fusion_Math_Atan2(y, x), atan2(y, x), "atan2", y, x);
+        }
+    }
+    CHECK(Fusion_Math_Atan2(0, 0) == 0);
+    CHECK(mWrong == 0);
+    printf("Fusion_Math: atan2 %ld compared, worst error %d centidegrees\n", mCompared, mWorstError);
+}
+
+/*****************************************************************************
+ * Description: Both tilt angles over a grid of accelerometer samples, every *
+ *              small sample, and the samples at full scale, where y*y + z*z *
+ *              is at the top of its 32 bits.                                *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestTilt()
+{
+    const int32_t extremes[] = { INT16_MIN, INT16_MIN + 1, -1, 0, 1, INT16_MAX - 1, INT16_MAX };
+    const uint8_t count = sizeof(extremes) / sizeof(extremes[0]);
+
+    pSetUp();
+    for(int32_t x = INT16_MIN; x <= INT16_MAX; x += TILT_GRID_STEP)
+    {
+        for(int32_t y = INT16_MIN; y <= INT16_MAX; y += TILT_GRID_STEP)
+        {
+            for(int32_t z = INT16_MIN; z <= INT16_MAX; z += TILT_GRID_STEP)
+            {
+                pCompareTilt(x, y, z);
+            }
+        }
+    }
+    for(int32_t x = -16; x <= 16; x++)
+    {
+        for(int32_t y = -16; y <= 16; y++)
+        {
+            for(int32_t z = -16; z <= 16; z++)
+            {
+                if(y != 0 || z != 0)
+                {
+                    pCompareTilt(x, y, z);
+                }
+            }
+        }
+    }
+    for(uint8_t i = 0; i < count; i++)
+    {
+        for(uint8_t j = 0; j < count; j++)
+        {
+            for(uint8_t k = 0; k < count; k++)
+            {
+                if(extremes[j] != 0 || extremes[k] != 0)
+                {
+                    pCompareTilt(extremes[i], extremes[j], extremes[k]);
+                }
+            }
+        }
+    }
+    CHECK(mWrong == 0);
+    printf("Fusion_Math: tilt %ld compared, worst error %d centidegrees\n", mCompared, mWorstError);
+}
+
+/*****************************************************************************
+ * Description: Times the tilt of a grid of samples on the host, against the *
+ *              double precision formula.                                    *
+ *                                                                           *
+ *****************************************************************************/
+static void pTimeTilt()
+{
+    const int rounds = 20;
+    double start;
+    double integer;
+    double floating;
+    long calls = 0;
+
+    start = pSeconds();
+    for(int round = 0; round < rounds; round++)
+    {
+        for(int32_t x = INT16_MIN; x <= INT16_MAX; x += TILT_GRID_STEP)
+        {
+            for(int32_t y = INT16_MIN; y <= INT16_MAX; y += TILT_GRID_STEP)
+            {
+                Sensors_Accel_Data_t accel = { (int16_t)x, (int16_t)y, (int16_t)(round * 100) };
+                int16_t pitch;
+                int16_t roll;
+                Fusion_Math_GetTilt(&accel, &pitch, &roll);
+                mSink += pitch + roll;
+                calls++;
+            }
+        }
+    }
+    integer = pSeconds() - start;
+
+    start = pSeconds();
+    for(int round = 0; round < rounds; round++)
+    {
+        for(int32_t x = INT16_MIN; x <= INT16_MAX; x += TILT_GRID_STEP)
+        {
+            for(int32_t y = INT16_MIN; y <= INT16_MAX; y += TILT_GRID_STEP)
+            {
+                double z = round * 100;
+                mSink += atan2(-(double)x, sqrt(((double)y * y) + (z * z))) * TO_CENTIDEGREES;
+                mSink += atan2((double)y, z) * TO_CENTIDEGREES;
+            }
+        }
+    }
+    floating = pSeconds() - start;
+
+    printf("Fusion_Math: host %.0f ns per tilt, %.0f ns in double (with an FPU)\n",
+           1e9 * integer / calls, 1e9 * floating / calls);
+}
+
+int main()
+{
+    pTestSqrt();
+    pTestAtan2();
+    pTestTilt();
+    pTimeTilt();
+
+    return Test_Check_Summary("Fusion_Math");
+}
@@ -0,0 +1,328 @@
+/*****************************************************************************
+* FILENAME: Test_Fusion_Quaternion.c                                         *
+*                                                                            *
+* DESCRIPTION: Host test of the quaternion orientation engine, see           *
+*              Fusion_Quaternion.h. Traces from Fusion_Trace.h, with the     *
+*              noise of the LSM6DS33, are fed to it in FIFO batches and the  *
+*              angles and rates are compared with the truth: held still at a *
+*              tilt, turning about Z, with a gyroscope bias, and moving like *
+*              a hand. Built and run with "make test" in this directory.     *
+*              The cycles on the nRF51 come from Fusion_Benchmark.h on the   *
+*              board; the host time printed here only compares builds.       *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "Fusion_Quaternion.h"
+#include "Fusion_Trace.h"
+#include "Test_Check.h"
+
+#define PI                  3.14159265358979323846
+#define SAMPLE_RATE         SENSORS_ACCELGYRO_SAMPLE_RATE_HZ
+#define MAX_SAMPLES         (60 * SAMPLE_RATE)
+
+// The errors of a replay, in degrees and degrees per second, from the end
+// of the settling time to the end of the trace
+typedef struct
+{
+    double      rollMax;
+    double      pitchMax;
+    double      yawMax;
+    double      rollRms;
+    double      pitchRms;
+    double      rateAverage[3];     // Average of the rates, X, Y, Z
+} Replay_Errors_t;
+
+static Fusion_Trace_Sample_t    mTrace[MAX_SAMPLES];
+static const Fusion_Trace_Sensor_t mSensor =
+{
+    { 0, 0, 0 }, FUSION_TRACE_ACCEL_NOISE_LSB, FUSION_TRACE_GYRO_NOISE_LSB, 416
+};
+
+/*****************************************************************************
+ ****************Start of Test Helpers ***************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Feeds a trace to a reset engine, a batch at a time, and      *
+ *              compares the orientation after each batch with the truth at  *
+ *              its last sample.                                             *
+ *                                                                           *
+ * Returns: None (the errors are returned via 'errors')                      *
+ *                                                                           *
+ * Parameters: count  -> the samples of mTrace to feed                       *
+ *             settle -> the samples before the errors are counted           *
+ *             errors -> where to place the errors                           *
+ *                                                                           *
+ *****************************************************************************/
+static void pReplay(int count, int settle, Replay_Errors_t * errors)
+{
+    Sensors_AccelGyro_Batch_t batch;
+    Fusion_Orientation_t orientation;
+    double rollSquares = 0;
+    double pitchSquares = 0;
+    double yawStart = 0;
+    int compared = 0;
+
+    *errors = (Replay_Errors_t){ 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    Fusion_Quaternion_Reset();
+    for(int first = 0; Fusion_Trace_Batch(mTrace, count, first, &batch) > 0; first += batch.count)
+    {
+        const Fusion_Trace_Angles_t * truth = &mTrace[first + batch.count - 1].truth;
+        double roll;
+        double pitch;
+        double yaw;
+
+        Fusion_Quaternion_Update(&batch);
+        Fusion_Quaternion_GetOrientation(&orientation);
+        if(first == 0)
+        {
+            // Yaw is 0 from the end of the first batch, as the engine only
+            // takes roll and pitch from it
+            yawStart = truth->yaw;
+        }
+        if(first < settle)
+        {
+            continue;
+        }
+
+        roll  = fabs(Fusion_Trace_AngleError(orientation.roll / 100.0, truth->roll));
+        pitch = fabs(Fusion_Trace_AngleError(orientation.pitch / 100.0, truth->pitch));
+        yaw   = Fusion_Trace_AngleError(orientation.yaw / 100.0, truth->yaw - yawStart);
+        errors->rollMax  = fmax(errors->rollMax, roll);
+        errors->pitchMax = fmax(errors->pitchMax, pitch);
+        errors->yawMax   = fmax(errors->yawMax, fabs(yaw));
+        rollSquares  += roll * roll;
+        pitchSquares += pitch * pitch;
+        errors->rateAverage[0] += orientation.rollRate / 100.0;
+        errors->rateAverage[1] += orientation.pitchRate / 100.0;
+        errors->rateAverage[2] += orientation.yawRate / 100.0;
+        compared++;
+    }
+
+    if(compared > 0)
+    {
+        errors->rollRms  = sqrt(rollSquares / compared);
+        errors->pitchRms = sqrt(pitchSquares / compared);
+        for(int axis = 0; axis < 3; axis++)
+        {
+            errors->rateAverage[axis] /= compared;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Description: The motions of the traces.                                   *
+ *                                                                           *
+ *****************************************************************************/
+static void pTurnAboutZ(double seconds, double * rateDps)
+{
+    (void)seconds;
+    rateDps[2] = 90.0;
+}
+
+static void pHandMotion(double seconds, double * rateDps)
+{
+    // Up to 100 dps, a few tens of degrees about each axis
+    rateDps[0] = 100.0 * sin(2 * PI * 0.7 * seconds);
+    rateDps[1] = 60.0 * cos(2 * PI * 0.4 * seconds);
+    rateDps[2] = 90.0 * sin(2 * PI * 0.25 * seconds);
+}
+
+/*****************************************************************************
+ * Description: Seconds of processor time used so far.                       *
+ *                                                                           *
+ *****************************************************************************/
+static double pSeconds()
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/*****************************************************************************
+ ****************Start of Tests **********************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Held still at a tilt, roll and pitch are those of the        *
+ *              accelerometer from the first batch on, and yaw stays at the  *
+ *              0 it starts from. Covers upside down and close to vertical.  *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestStaticTilt()
+{
+    const Fusion_Trace_Angles_t tilts[] =
+    {
+        { 0, 0, 0 }, { 30, 0, 0 }, { 0, -45, 0 }, { -60, 20, 0 }, { 150, 10, 0 }, { 180, 0, 0 }, { 10, 75, 0 }
+    };
+    const int count = 4 * SAMPLE_RATE;
+    double worst = 0;
+    double worstYaw = 0;
+
+    for(unsigned i = 0; i < sizeof(tilts) / sizeof(tilts[0]); i++)
+    {
+        Replay_Errors_t errors;
+
+        Fusion_Trace_Make(mTrace, count, &tilts[i], NULL, &mSensor);
+        pReplay(count, 0, &errors);
+        worst = fmax(worst, fmax(errors.rollMax, errors.pitchMax));
+        worstYaw = fmax(worstYaw, errors.yawMax);
+        if(fmax(errors.rollMax, errors.pitchMax) >= 0.5 || errors.yawMax >= 0.5)
+        {
+            printf("Tilt %.0f/%.0f: roll %.2f, pitch %.2f, yaw %.2f degrees off\n",
+                   tilts[i].roll, tilts[i].pitch, errors.rollMax, errors.pitchMax, errors.yawMax);
+        }
+    }
+    CHECK(worst < 0.5);
+    CHECK(worstYaw < 0.5);
+    printf("Fusion_Quaternion: static tilt within %.2f degrees, yaw within %.2f\n", worst, worstYaw);
+}
+
+/*****************************************************************************
+ * Description: Turning level about Z at 90 dps, the yaw rate is 90 dps, the *
+ *              other rates 0, and yaw follows the turn around the circle    *
+ *              with roll and pitch undisturbed.                             *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestYawRate()
+{
+    const Fusion_Trace_Angles_t start = { 0, 0, 0 };
+    const int count = 8 * SAMPLE_RATE; // Two turns
+    Replay_Errors_t errors;
+
+    Fusion_Trace_Make(mTrace, count, &start, pTurnAboutZ, &mSensor);
+    pReplay(count, 0, &errors);
+
+    CHECK(fabs(errors.rateAverage[2] - 90.0) < 0.2);
+    CHECK(fabs(errors.rateAverage[0]) < 0.2);
+    CHECK(fabs(errors.rateAverage[1]) < 0.2);
+    CHECK(errors.yawMax < 1.0);
+    CHECK(fmax(errors.rollMax, errors.pitchMax) < 0.5);
+    printf("Fusion_Quaternion: yaw rate %.2f dps, yaw within %.2f degrees over two turns\n",
+           errors.rateAverage[2], errors.yawMax);
+}
+
+/*****************************************************************************
+ * Description: With a gyroscope bias the accelerometer alone would leave    *
+ *              roll and pitch off by the bias times KP; the bias estimate   *
+ *              takes that out and the rates read 0 when still. The bias     *
+ *              about the direction of gravity can't be seen by the          *
+ *              accelerometer, so it stays in the yaw rate and yaw drifts:   *
+ *              only the rate across gravity is checked.                     *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestBias()
+{
+    const Fusion_Trace_Angles_t start = { 20, -15, 0 };
+    const int count = 60 * SAMPLE_RATE;
+    const int settle = 50 * SAMPLE_RATE;
+    Fusion_Trace_Sensor_t sensor = mSensor;
+    Replay_Errors_t errors;
+    double gravity[3];
+    double along = 0;
+    double across = 0;
+
+    sensor.gyroBiasDps[0] = 1.5;
+    sensor.gyroBiasDps[1] = -1.0;
+    sensor.gyroBiasDps[2] = 0.8;
+    Fusion_Trace_Make(mTrace, count, &start, NULL, &sensor);
+    pReplay(count, settle, &errors);
+
+    // Gravity in the glove frame, and the rate error along and across it
+    gravity[0] = -sin(start.pitch * PI / 180);
+    gravity[1] = sin(start.roll * PI / 180) * cos(start.pitch * PI / 180);
+    gravity[2] = cos(start.roll * PI / 180) * cos(start.pitch * PI / 180);
+    for(int axis = 0; axis < 3; axis++)
+    {
+        along += errors.rateAverage[axis] * gravity[axis];
+    }
+    for(int axis = 0; axis < 3; axis++)
+    {
+        double part = errors.rateAverage[axis] - (along * gravity[axis]);
+        across += part * part;
+    }
+    across = sqrt(across);
+
+    CHECK(fmax(errors.rollMax, errors.pitchMax) < 0.3); // Bias times KP is 0.9 degrees
+    CHECK(across < 0.1);
+    printf("Fusion_Quaternion: with a 1.9 dps bias, roll/pitch within %.2f degrees after 50s, rate %.3f dps across"
+           " gravity, %.2f dps along it (yaw drift)\n", fmax(errors.rollMax, errors.pitchMax), across, along);
+}
+
+/*****************************************************************************
+ * Description: Moving like a hand, at up to 100 dps about every axis, the   *
+ *              angles stay with the truth. The first batch is already       *
+ *              moving, so its tilt is half a batch old; that is corrected   *
+ *              within a second.                                             *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestHandMotion()
+{
+    const Fusion_Trace_Angles_t start = { 10, -5, 0 };
+    const int count = 20 * SAMPLE_RATE;
+    Replay_Errors_t errors;
+
+    Fusion_Trace_Make(mTrace, count, &start, pHandMotion, &mSensor);
+    pReplay(count, SAMPLE_RATE, &errors);
+
+    CHECK(errors.rollMax < 0.5);
+    CHECK(errors.pitchMax < 0.5);
+    CHECK(errors.yawMax < 1.0);
+    printf("Fusion_Quaternion: hand motion roll %.2f rms/%.2f max, pitch %.2f/%.2f, yaw %.2f max degrees\n",
+           errors.rollRms, errors.rollMax, errors.pitchRms, errors.pitchMax, errors.yawMax);
+}
+
+/*****************************************************************************
+ * Description: Times an update of a full batch on the host.                 *
+ *                                                                           *
+ *****************************************************************************/
+static void pTimeUpdate()
+{
+    const Fusion_Trace_Angles_t start = { 10, -5, 0 };
+    const int count = 20 * SAMPLE_RATE;
+    const int rounds = 20;
+    Sensors_AccelGyro_Batch_t batch;
+    long updates = 0;
+    double seconds;
+
+    Fusion_Trace_Make(mTrace, count, &start, pHandMotion, &mSensor);
+    Fusion_Quaternion_Reset();
+    seconds = pSeconds();
+    for(int round = 0; round < rounds; round++)
+    {
+        for(int first = 0; Fusion_Trace_Batch(mTrace, count, first, &batch) == SENSORS_ACCELGYRO_FIFO_BATCH_SIZE;
+            first += batch.count)
+        {
+            Fusion_Quaternion_Update(&batch);
+            updates++;
+        }
+    }
+    seconds = pSeconds() - seconds;
+
+    printf("Fusion_Quaternion: host %.0f ns per batch of %d (with copying the batch)\n",
+           1e9 * seconds / updates, SENSORS_ACCELGYRO_FIFO_BATCH_SIZE);
+}
+
+int main()
+{
+    pTestStaticTilt();
+    pTestYawRate();
+    pTestBias();
+    pTestHandMotion();
+    pTimeUpdate();
+
+    return Test_Check_Summary("Fusion_Quaternion");
+}
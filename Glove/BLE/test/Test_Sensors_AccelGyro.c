@@ -0,0 +1,738 @@
+/*****************************************************************************
+* FILENAME: Test_Sensors_AccelGyro.c                                         *
+*                                                                            *
+* DESCRIPTION: Host test of the single sample reads of the LSM6DS33, see     *
+*              Sensors_AccelGyro.h, through the real Comm_SPI on a fake SPI  *
+*              driver with a register-level fake of the sensor on the bus.   *
+*              The fake decodes the command byte of each transaction, reads  *
+*              or writes its registers, and increments the address only when *
+*              IF_INC is set in CTRL3_C, as the device does.                 *
+*                                                                            *
+*              A new sample is put in the output registers at the end of     *
+*              every transaction, which is the worst case for a reader that  *
+*              splits a sample across transactions: its axes then come from  *
+*              different samples. The same samples are also read one         *
+*              register per transaction, the way the glove did before the    *
+*              burst read, to put both side by side.                         *
+*                                                                            *
+*              The fake also runs the wake up function from its registers    *
+*              once the glove is set up for system off, on motions made      *
+*              with Fusion_Trace.h, for the first part of the time from      *
+*              picking up the glove to its first notification.          @01a *
+*              Also a FIFO read that ends without a whole sample.       @02a *
+*              Built and run with "make test" in this directory.             *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Wake up detection time              |  *
+* | @02     | 17Oct26  | BNordland  | FIFO read without a whole sample    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Sensors_AccelGyro.h"
+#include "Comm_SPI.h"
+#include "NordicSDK.h"
+#include "Config_Hardware.h"
+#include "Fusion_Trace.h"
+#include "Test_Check.h"
+
+// The registers of the LSM6DS33 the test looks at, from the datasheet
+#define WHO_AM_I                0x0F
+    #define WHO_AM_I_ID             0x69
+#define CTRL1_XL                0x10
+#define CTRL2_G                 0x11
+#define CTRL3_C                 0x12
+    #define BDU                     0x40
+    #define IF_INC                  0x04
+#define STATUS_REG              0x1E
+    #define XLDA                    0x01
+#define OUTX_L_G                0x22
+#define OUTX_L_XL               0x28
+#define OUTPUT_BYTES            12      // OUTX_L_G to OUTZ_H_XL
+#define FIFO_CTRL5              0x0A    // @01a
+#define INT1_CTRL               0x0D    // @01a
+#define CTRL6_C                 0x15    // @01a
+    #define XL_HM_MODE              0x10
+#define TAP_CFG                 0x58    // @01a
+    #define INTERRUPTS_ENABLE       0x80
+#define WAKE_UP_THS             0x5B    // @01a
+    #define WAKE_UP_THS_MASK        0x3F
+#define WAKE_UP_DUR             0x5C    // @01a
+#define MD1_CFG                 0x5E    // @01a
+    #define INT1_WU                 0x20
+#define FIFO_STATUS1            0x3A    // @02a Unread words
+#define FIFO_STATUS2            0x3B    // @02a
+    #define FIFO_EMPTY              0x10
+#define FIFO_STATUS3            0x3C    // @02a The word read next in a sample
+
+// @01a The wake up function: the accelerometer in low power at the rate of
+// CTRL1_XL, and a slope of (a[n] - a[n-1]) / 2 on any axis over WAKE_UP_THS
+// in 1/64 of the +/-2g full scale raises INT1 (AN4682, 5.5)
+#define WAKE_ODR_HZ             26
+#define WAKE_DECIMATION         (SENSORS_ACCELGYRO_SAMPLE_RATE_HZ / WAKE_ODR_HZ)
+#define WAKE_FULL_SCALE_G       2.0
+#define WAKE_MOTION_START_S     1.0     // Motions start after the slope filter has settled
+#define WAKE_STILL_S            60
+#define WAKE_TRACE_S            3
+
+// The samples read by each test
+#define SAMPLES                 100
+
+// The most interrupts a blocking call may wait for before the test gives up
+#define MAX_WAITS               16
+
+// The fake driver
+static nrf_drv_spi_config_t     mConfig;
+static nrf_drv_spi_handler_t    mHandler;
+static bool                     mOnBus;             // A transfer is on the bus
+static nrf_drv_spi_evt_t        mEvent;             // Its done event
+static uint8_t                  mWaits;             // Calls of __WFE since the last interrupt
+static uint8_t                  mAppErrors;         // Failed APP_ERROR_CHECKs
+static uint32_t                 mDelays;            // Calls of nrf_delay_ms
+
+// The fake sensor
+static uint8_t                  mRegisters[0x80];
+static uint32_t                 mSample;            // The sample in the output registers
+static uint8_t                  mNotReady;          // STATUS_REG reads left without XLDA
+static uint32_t                 mTransactions;      // Chip select windows
+static uint32_t                 mBusBytes;          // Bytes clocked
+static uint32_t                 mWhoAmIReads;
+static uint32_t                 mBurstSample;       // The sample in the registers when the last
+                                                    // output read started
+static uint8_t                  mBurstStart;        // The first register of the last output read
+static uint8_t                  mBurstBytes;        // Registers read by it
+static uint32_t                 mLastDelayMs;       // @01a
+static uint32_t                 mSensePin;          // @01a The pin set to wake from system off
+static nrf_gpio_pin_sense_t     mSense;             // @01a
+static uint8_t                  mBatches;           // @02a Batches passed to pBatchDone
+
+// @01a The motions for the wake up function
+static Fusion_Trace_Sample_t    mTrace[WAKE_STILL_S * SENSORS_ACCELGYRO_SAMPLE_RATE_HZ];
+static double                   mTurnDps;           // Rate of a 90 degree turn about X
+static const Fusion_Trace_Sensor_t mNoise =
+{
+    { 0, 0, 0 }, FUSION_TRACE_ACCEL_NOISE_LSB, FUSION_TRACE_GYRO_NOISE_LSB, 11
+};
+
+/*****************************************************************************
+ ****************Start of Fake Implementations *******************************
+ *****************************************************************************/
+
+void Fake_AppError(uint32_t errorCode, const char * file, int line)
+{
+    mAppErrors++;
+    printf("APP_ERROR_CHECK 0x%04X at %s:%d\n", (unsigned)errorCode, file, line);
+}
+
+void nrf_delay_ms(uint32_t volatile number_of_ms)
+{
+    mLastDelayMs = number_of_ms;
+    mDelays++;
+}
+
+uint32_t app_timer_cnt_get(uint32_t * p_ticks)
+{
+    *p_ticks = 0;
+    return NRF_SUCCESS;
+}
+
+// INT1 is not routed in these tests
+uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+    (void)pin_number;
+    return 0;
+}
+
+void nrf_gpio_cfg_sense_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config,
+                              nrf_gpio_pin_sense_t sense_config)
+{
+    (void)pull_config;
+    mSensePin = pin_number;
+    mSense = sense_config;
+}
+
+bool nrf_drv_gpiote_is_init(void)
+{
+    return true;
+}
+
+uint32_t nrf_drv_gpiote_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t nrf_drv_gpiote_in_init(nrf_drv_gpiote_pin_t pin, nrf_drv_gpiote_in_config_t const * p_config,
+                                nrf_drv_gpiote_evt_handler_t evt_handler)
+{
+    (void)pin;
+    (void)p_config;
+    (void)evt_handler;
+    return NRF_SUCCESS;
+}
+
+void nrf_drv_gpiote_in_event_enable(nrf_drv_gpiote_pin_t pin, bool int_enable)
+{
+    (void)pin;
+    (void)int_enable;
+}
+
+void nrf_drv_gpiote_in_uninit(nrf_drv_gpiote_pin_t pin)
+{
+    (void)pin;
+}
+
+uint32_t nrf_drv_spi_init(nrf_drv_spi_t const * const p_instance, nrf_drv_spi_config_t const * p_config,
+                          nrf_drv_spi_handler_t handler)
+{
+    (void)p_instance;
+    mConfig = *p_config;
+    mHandler = handler;
+    return NRF_SUCCESS;
+}
+
+uint32_t nrf_drv_spi_transfer(nrf_drv_spi_t const * const p_instance,
+                              uint8_t const * p_tx_buffer, uint8_t tx_buffer_length,
+                              uint8_t * p_rx_buffer, uint8_t rx_buffer_length)
+{
+    (void)p_instance;
+    if(mOnBus)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    mOnBus = true;
+    mEvent.type = NRF_DRV_SPI_EVENT_DONE;
+    mEvent.data.done.p_tx_buffer = p_tx_buffer;
+    mEvent.data.done.tx_length = tx_buffer_length;
+    mEvent.data.done.p_rx_buffer = p_rx_buffer;
+    mEvent.data.done.rx_length = rx_buffer_length;
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+ * Description: The value of an axis of a sample: gyroscope X, Y, Z are axes *
+ *              0 to 2, accelerometer X, Y, Z 3 to 5. Both bytes change from *
+ *              one sample to the next.                                      *
+ *                                                                           *
+ *****************************************************************************/
+static int16_t pAxis(uint32_t sample, uint8_t axis)
+{
+    return (int16_t)(uint16_t)((0x1357 * (sample + 1)) + (0x2468 * axis));
+}
+
+/*****************************************************************************
+ * Description: Puts the next sample in the output registers.                *
+ *                                                                           *
+ *****************************************************************************/
+static void pNextSample()
+{
+    uint8_t axis;
+
+    mSample++;
+    for(axis = 0; axis < 6; axis++)
+    {
+        uint16_t value = (uint16_t)pAxis(mSample, axis);
+        mRegisters[OUTX_L_G + (2 * axis)] = (uint8_t)(value & 0xFF);
+        mRegisters[OUTX_L_G + (2 * axis) + 1] = (uint8_t)(value >> 8);
+    }
+}
+
+/*****************************************************************************
+ * Description: The sensor side of a transaction. The first byte is the      *
+ *              command: bit 7 set to read, and the register address.        *
+ *                                                                           *
+ *****************************************************************************/
+static void pSensorTransaction(const nrf_drv_spi_xfer_desc_t * done)
+{
+    uint8_t length = (done->tx_length > done->rx_length) ? done->tx_length : done->rx_length;
+    bool read = (done->p_tx_buffer[0] & 0x80) != 0;
+    uint8_t address = done->p_tx_buffer[0] & 0x7F;
+    uint8_t i;
+
+    if(done->rx_length > 0)
+    {
+        done->p_rx_buffer[0] = 0x00; // Clocked in during the command
+    }
+    if(read && address == WHO_AM_I)
+    {
+        mWhoAmIReads++;
+    }
+    if(read && address >= OUTX_L_G && address < OUTX_L_G + OUTPUT_BYTES)
+    {
+        mBurstSample = mSample;
+        mBurstStart = address;
+        mBurstBytes = length - 1;
+    }
+
+    for(i = 1; i < length; i++)
+    {
+        if(read && i < done->rx_length)
+        {
+            uint8_t value = mRegisters[address];
+            if(address == STATUS_REG && mNotReady > 0)
+            {
+                mNotReady--;
+                value &= (uint8_t)~XLDA;
+            }
+            done->p_rx_buffer[i] = value;
+        }
+        else if(!read && i < done->tx_length)
+        {
+            mRegisters[address] = done->p_tx_buffer[i];
+        }
+
+        if(mRegisters[CTRL3_C] & IF_INC)
+        {
+            address = (address + 1) & 0x7F;
+        }
+    }
+
+    mTransactions++;
+    mBusBytes += length;
+    pNextSample();
+}
+
+/*****************************************************************************
+ * Description: Runs the transaction on the bus, and the SPI interrupt.      *
+ *                                                                           *
+ * Returns: false if there was no transfer on the bus                        *
+ *                                                                           *
+ *****************************************************************************/
+static bool pSpiInterrupt()
+{
+    if(!mOnBus)
+    {
+        return false;
+    }
+
+    pSensorTransaction(&mEvent.data.done);
+    mOnBus = false;
+    mWaits = 0;
+    mHandler(&mEvent);
+    return true;
+}
+
+void Fake_WFE(void)
+{
+    if(++mWaits > MAX_WAITS || !pSpiInterrupt())
+    {
+        printf("FAIL: waiting for an interrupt that will never come\n");
+        exit(1);
+    }
+}
+
+/*****************************************************************************
+ * Description: Runs the wake up function of the fake on a trace, as set in  *
+ *              its registers, from one of the 416Hz samples.           @01a *
+ *                                                                           *
+ * Returns: The time of the trace INT1 is raised at (s), or -1 if it is not  *
+ *                                                                           *
+ *****************************************************************************/
+static double pWakeUp(const Fusion_Trace_Sample_t * trace, int count, int phase)
+{
+    double threshold = (mRegisters[WAKE_UP_THS] & WAKE_UP_THS_MASK)
+                     * (WAKE_FULL_SCALE_G / 64) * FUSION_TRACE_ACCEL_LSB_PER_G;
+    int i, axis;
+
+    if((mRegisters[TAP_CFG] & INTERRUPTS_ENABLE) == 0 || (mRegisters[MD1_CFG] & INT1_WU) == 0
+        || mRegisters[WAKE_UP_DUR] != 0)
+    {
+        return -1;
+    }
+
+    for(i = phase + WAKE_DECIMATION; i < count; i += WAKE_DECIMATION)
+    {
+        for(axis = 0; axis < 3; axis++)
+        {
+            double slope = (trace[i].accel[axis] - trace[i - WAKE_DECIMATION].accel[axis]) / 2.0;
+            if(fabs(slope) > threshold)
+            {
+                return (double)i / SENSORS_ACCELGYRO_SAMPLE_RATE_HZ;
+            }
+        }
+    }
+    return -1;
+}
+
+/*****************************************************************************
+ * Description: A 90 degree turn about X at mTurnDps.                   @01a *
+ *                                                                           *
+ *****************************************************************************/
+static void pTurn(double seconds, double * rateDps)
+{
+    double end = WAKE_MOTION_START_S + (90.0 / mTurnDps);
+
+    rateDps[0] = (seconds >= WAKE_MOTION_START_S && seconds < end) ? mTurnDps : 0;
+    rateDps[1] = 0;
+    rateDps[2] = 0;
+}
+
+/*****************************************************************************
+ * Description: Makes a trace of the glove lying flat, lifted straight up    *
+ *              with a half sine of acceleration.                       @01a *
+ *                                                                           *
+ *****************************************************************************/
+static int pMakeLift(double peakG, double seconds)
+{
+    static const Fusion_Trace_Angles_t flat = { 0, 0, 0 };
+    int count = WAKE_TRACE_S * SENSORS_ACCELGYRO_SAMPLE_RATE_HZ;
+    int i;
+
+    Fusion_Trace_Make(mTrace, count, &flat, NULL, &mNoise);
+    for(i = 0; i < count; i++)
+    {
+        double t = ((double)i / SENSORS_ACCELGYRO_SAMPLE_RATE_HZ) - WAKE_MOTION_START_S;
+        if(t >= 0 && t < seconds)
+        {
+            mTrace[i].accel[2] += (int16_t)(peakG * sin(3.14159265358979 * t / seconds) * FUSION_TRACE_ACCEL_LSB_PER_G);
+        }
+    }
+    return count;
+}
+
+/*****************************************************************************
+ * Description: The time from the start of a motion to INT1, over every      *
+ *              phase of the motion against the 26Hz samples.           @01a *
+ *                                                                           *
+ * Returns: The number of phases INT1 was raised for (of WAKE_DECIMATION)    *
+ *                                                                           *
+ *****************************************************************************/
+static int pWakeLatency(int count, double * meanMs, double * worstMs)
+{
+    int phase, woken = 0;
+
+    *meanMs = 0;
+    *worstMs = 0;
+    for(phase = 0; phase < WAKE_DECIMATION; phase++)
+    {
+        double wake = pWakeUp(mTrace, count, phase);
+        if(wake >= WAKE_MOTION_START_S)
+        {
+            double ms = (wake - WAKE_MOTION_START_S) * 1000;
+            *meanMs += ms;
+            *worstMs = (ms > *worstMs) ? ms : *worstMs;
+            woken++;
+        }
+    }
+    if(woken > 0)
+    {
+        *meanMs /= woken;
+    }
+    return woken;
+}
+
+/*****************************************************************************
+ ****************Start of Test Helpers ***************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Powers up the fake sensor, with its registers at their       *
+ *              reset values, and initializes the glove side.                *
+ *                                                                           *
+ * Returns: The result of Sensors_AccelGyro_Init                             *
+ *                                                                           *
+ *****************************************************************************/
+static bool pSetUp(uint8_t whoAmI)
+{
+    bool found;
+
+    memset(mRegisters, 0x00, sizeof(mRegisters));
+    mRegisters[WHO_AM_I] = whoAmI;
+    mRegisters[CTRL3_C] = IF_INC;
+    mRegisters[STATUS_REG] = XLDA;
+    mSample = 0;
+    pNextSample();
+    mNotReady = 0;
+    mAppErrors = 0;
+    mDelays = 0;
+    mWhoAmIReads = 0;
+
+    found = Sensors_AccelGyro_Init();
+    Sensors_AccelGyro_SetCalibration(NULL);
+    mTransactions = 0;
+    mBusBytes = 0;
+    return found;
+}
+
+/*****************************************************************************
+ * Description: Whether the accelerometer axes are those of a sample.        *
+ *                                                                           *
+ *****************************************************************************/
+static bool pIsAccel(const Sensors_Accel_Data_t * data, uint32_t sample)
+{
+    return data->xData == pAxis(sample, 3) && data->yData == pAxis(sample, 4)
+        && data->zData == pAxis(sample, 5);
+}
+
+/*****************************************************************************
+ * Description: Reads the accelerometer as the glove did before the burst    *
+ *              read: the status, then each output register in its own       *
+ *              transaction.                                                 *
+ *                                                                           *
+ *****************************************************************************/
+static void pReadOneByOne(Sensors_Accel_Data_t * data)
+{
+    uint8_t raw[6];
+    uint8_t tx, i;
+
+    do
+    {
+        tx = 0x80 | STATUS_REG;
+        Comm_SPI_Transfer(&tx, 1, &raw[0], 1);
+    } while((raw[0] & XLDA) == 0);
+
+    for(i = 0; i < 6; i++)
+    {
+        tx = 0x80 | (OUTX_L_XL + i);
+        Comm_SPI_Transfer(&tx, 1, &raw[i], 1);
+    }
+
+    data->xData = (int16_t)(((uint16_t)raw[1] << 8) | raw[0]);
+    data->yData = (int16_t)(((uint16_t)raw[3] << 8) | raw[2]);
+    data->zData = (int16_t)(((uint16_t)raw[5] << 8) | raw[4]);
+}
+
+/*****************************************************************************
+ * Description: Handler of the FIFO reads; counts the batches.          @02a *
+ *                                                                           *
+ *****************************************************************************/
+static void pBatchDone(Sensors_AccelGyro_Batch_t * batch)
+{
+    (void)batch;
+    mBatches++;
+}
+
+/*****************************************************************************
+ ****************Start of Tests **********************************************
+ *****************************************************************************/
+
+// Auto-increment and block data update are on before the first read
+static void pTestInit()
+{
+    CHECK(pSetUp(WHO_AM_I_ID));
+    CHECK(mRegisters[CTRL3_C] == (BDU | IF_INC));
+    CHECK(mRegisters[CTRL1_XL] == 0x60);
+    CHECK(mRegisters[CTRL2_G] == 0x60);
+    CHECK(mAppErrors == 0);
+
+    // No sensor on the bus: a bounded number of tries
+    CHECK(!pSetUp(0x00));
+    CHECK(mWhoAmIReads == SENSORS_ACCELGYRO_PROBE_ATTEMPTS);
+    CHECK(mDelays == SENSORS_ACCELGYRO_PROBE_ATTEMPTS - 1);
+}
+
+// The accelerometer block in one transaction, side by side with one
+// register per transaction
+static void pTestAccelerometer()
+{
+    Sensors_Accel_Data_t data;
+    uint32_t burstTransactions, burstBytes;
+    int i, whole = 0, torn = 0;
+
+    pSetUp(WHO_AM_I_ID);
+    mNotReady = 2;
+    Sensors_AccelGyro_GetAccelerometerData(&data);
+    CHECK(mTransactions == 4); // Three status reads, then the output
+    CHECK(mBurstStart == OUTX_L_XL);
+    CHECK(mBurstBytes == 6);
+    CHECK(pIsAccel(&data, mBurstSample));
+
+    mTransactions = 0;
+    mBusBytes = 0;
+    for(i = 0; i < SAMPLES; i++)
+    {
+        Sensors_AccelGyro_GetAccelerometerData(&data);
+        whole += pIsAccel(&data, mBurstSample) ? 1 : 0;
+    }
+    CHECK(whole == SAMPLES);
+    CHECK(mTransactions == 2 * SAMPLES);
+    CHECK(mAppErrors == 0);
+    burstTransactions = mTransactions;
+    burstBytes = mBusBytes;
+
+    mTransactions = 0;
+    mBusBytes = 0;
+    for(i = 0; i < SAMPLES; i++)
+    {
+        uint32_t first = mSample + 1; // The status read brings a new sample
+        pReadOneByOne(&data);
+        torn += pIsAccel(&data, first) ? 0 : 1;
+    }
+    CHECK(mTransactions == 7 * SAMPLES);
+    CHECK(torn == SAMPLES); // The fake shows the tearing the burst read avoids
+
+    printf("Sensors_AccelGyro: accelerometer, burst %lu transactions and %lu bytes per sample, "
+           "0 of %d torn; one register at a time %lu and %lu, %d torn\n",
+           (unsigned long)(burstTransactions / SAMPLES), (unsigned long)(burstBytes / SAMPLES), SAMPLES,
+           (unsigned long)(mTransactions / SAMPLES), (unsigned long)(mBusBytes / SAMPLES), torn);
+}
+
+// The gyroscope and accelerometer blocks in one transaction, from the same
+// sample
+static void pTestAccelGyro()
+{
+    Sensors_Accel_Data_t accel;
+    Sensors_Gyro_Data_t gyro;
+    int i, whole = 0;
+
+    pSetUp(WHO_AM_I_ID);
+    for(i = 0; i < SAMPLES; i++)
+    {
+        Sensors_AccelGyro_GetData(&accel, &gyro);
+        whole += (pIsAccel(&accel, mBurstSample) && gyro.xData == pAxis(mBurstSample, 0)
+                  && gyro.yData == pAxis(mBurstSample, 1) && gyro.zData == pAxis(mBurstSample, 2)) ? 1 : 0;
+    }
+    CHECK(whole == SAMPLES);
+    CHECK(mBurstStart == OUTX_L_G);
+    CHECK(mBurstBytes == OUTPUT_BYTES);
+    CHECK(mTransactions == 2 * SAMPLES);
+    CHECK(mBusBytes == (2 + 1 + OUTPUT_BYTES) * SAMPLES);
+
+    printf("Sensors_AccelGyro: gyroscope and accelerometer, %lu transactions and %lu bytes per sample "
+           "(%d and %d one register at a time)\n",
+           (unsigned long)(mTransactions / SAMPLES), (unsigned long)(mBusBytes / SAMPLES),
+           1 + OUTPUT_BYTES, 2 * (1 + OUTPUT_BYTES));
+}
+
+// The calibration offsets come off every axis of the burst
+static void pTestCalibration()
+{
+    Sensors_AccelGyro_Calibration_t calibration = {{10, -20, 30}, {-1, 2, -3}};
+    Sensors_Accel_Data_t accel;
+    Sensors_Gyro_Data_t gyro;
+
+    pSetUp(WHO_AM_I_ID);
+    Sensors_AccelGyro_SetCalibration(&calibration);
+    Sensors_AccelGyro_GetData(&accel, &gyro);
+    CHECK(accel.xData == (int16_t)(pAxis(mBurstSample, 3) - 10));
+    CHECK(accel.yData == (int16_t)(pAxis(mBurstSample, 4) + 20));
+    CHECK(gyro.zData == (int16_t)(pAxis(mBurstSample, 2) + 3));
+}
+
+// @01a The glove set up for system off, and how quickly the sensor raises
+// INT1 for motions. The rest of the time to the first notification (the
+// nRF51 start up, advertising, the connection and the CCCD writes) needs the
+// board: the glove sends it in the telemetry, bytes 16-17 (ms).
+static void pTestWakeUp()
+{
+    static const Fusion_Trace_Angles_t flat = { 0, 0, 0 };
+    double mean, worst, grabMean, grabWorst;
+    int count, woken, slowWoken, phase, falseWakes = 0;
+    double slowTurn = 0;
+
+    pSetUp(WHO_AM_I_ID);
+    Sensors_AccelGyro_EnableFifo(SENSORS_ACCELGYRO_FIFO_BATCH_SIZE);
+    Sensors_AccelGyro_EnableWakeUp();
+    CHECK(mRegisters[FIFO_CTRL5] == 0x00);
+    CHECK(mRegisters[CTRL2_G] == 0x00);
+    CHECK(mRegisters[INT1_CTRL] == 0x00);
+    CHECK((mRegisters[CTRL1_XL] >> 4) == 2); // 26Hz
+    CHECK(mRegisters[CTRL6_C] == XL_HM_MODE);
+    CHECK(mRegisters[WAKE_UP_THS] == SENSORS_ACCELGYRO_WAKE_UP_THRESHOLD);
+    CHECK(mSensePin == HDW_CONFIG_ACCEL_INT1_PIN);
+    CHECK(mSense == NRF_GPIO_PIN_SENSE_HIGH);
+    CHECK(mLastDelayMs >= 2000 / WAKE_ODR_HZ); // The slope of the rate change is over
+    CHECK(mAppErrors == 0);
+
+    // Lying still, with the sensor noise
+    count = WAKE_STILL_S * SENSORS_ACCELGYRO_SAMPLE_RATE_HZ;
+    Fusion_Trace_Make(mTrace, count, &flat, NULL, &mNoise);
+    for(phase = 0; phase < WAKE_DECIMATION; phase++)
+    {
+        falseWakes += (pWakeUp(mTrace, count, phase) >= 0) ? 1 : 0;
+    }
+    CHECK(falseWakes == 0);
+
+    // Grabbed: 0.5g over 0.2s
+    count = pMakeLift(0.5, 0.2);
+    woken = pWakeLatency(count, &grabMean, &grabWorst);
+    CHECK(woken == WAKE_DECIMATION);
+    CHECK(grabWorst <= 2000.0 / WAKE_ODR_HZ);
+
+    // Lifted gently: 0.2g over 0.5s
+    count = pMakeLift(0.2, 0.5);
+    slowWoken = pWakeLatency(count, &mean, &worst);
+
+    // The slowest turn that wakes from every phase
+    count = WAKE_TRACE_S * SENSORS_ACCELGYRO_SAMPLE_RATE_HZ;
+    for(mTurnDps = 30; mTurnDps <= 720 && slowTurn == 0; mTurnDps += 10)
+    {
+        Fusion_Trace_Make(mTrace, count, &flat, pTurn, &mNoise);
+        if(pWakeLatency(count, &mean, &worst) == WAKE_DECIMATION)
+        {
+            slowTurn = mTurnDps;
+        }
+    }
+    CHECK(slowTurn > 0 && slowTurn <= 100); // A brisk pick up
+
+    printf("Sensors_AccelGyro: wake up at %d/64 of 2g, still %ds: %d false wakes; grab (0.5g, 0.2s) "
+           "INT1 after %.0f ms mean, %.0f worst; gentle lift (0.2g, 0.5s) wakes from %d of %d phases; "
+           "turns wake from %.0f dps\n",
+           SENSORS_ACCELGYRO_WAKE_UP_THRESHOLD, WAKE_STILL_S, falseWakes, grabMean, grabWorst,
+           slowWoken, WAKE_DECIMATION, slowTurn);
+}
+
+// @02a A FIFO read that finds less than the rest of a sample ends with no
+// samples, but the batch still has the index of the next sample and the
+// samples lost
+static void pTestFifoPartialSample()
+{
+    Sensors_AccelGyro_Batch_t batch;
+
+    pSetUp(WHO_AM_I_ID);
+    Sensors_AccelGyro_EnableFifo(SENSORS_ACCELGYRO_FIFO_BATCH_SIZE);
+    mRegisters[FIFO_STATUS1] = 1;
+    mRegisters[FIFO_STATUS3] = 1; // The second word of a sample, the first is lost
+    mBatches = 0;
+    batch.firstSampleIndex = 1234; // Left from an earlier read
+    batch.overrun = false;
+    CHECK(Sensors_AccelGyro_ReadFifoAsync(&batch, pBatchDone) == NRF_SUCCESS);
+    while(pSpiInterrupt())
+    {
+    }
+    CHECK(mBatches == 1);
+    CHECK(batch.count == 0);
+    CHECK(batch.firstSampleIndex == 0);
+    CHECK(batch.overrun);
+
+    // The loss is reported once
+    mRegisters[FIFO_STATUS1] = 0;
+    mRegisters[FIFO_STATUS2] = FIFO_EMPTY;
+    mRegisters[FIFO_STATUS3] = 0;
+    batch.firstSampleIndex = 1234;
+    batch.overrun = true;
+    CHECK(Sensors_AccelGyro_ReadFifoAsync(&batch, pBatchDone) == NRF_SUCCESS);
+    while(pSpiInterrupt())
+    {
+    }
+    CHECK(mBatches == 2);
+    CHECK(batch.count == 0);
+    CHECK(batch.firstSampleIndex == 0);
+    CHECK(!batch.overrun);
+    CHECK(mAppErrors == 0);
+}
+
+int main()
+{
+    pTestInit();
+    pTestAccelerometer();
+    pTestAccelGyro();
+    pTestCalibration();
+    pTestFifoPartialSample();
+    pTestWakeUp();
+
+    return Test_Check_Summary("Sensors_AccelGyro");
+}
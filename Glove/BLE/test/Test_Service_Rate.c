@@ -0,0 +1,378 @@
+/*****************************************************************************
+* FILENAME: Test_Service_Rate.c                                              *
+*                                                                            *
+* DESCRIPTION: Host simulation of the control frame rate, see                *
+*              Service_Rate.h, against the fixed 100ms timer it replaced.    *
+*              A hand motion trace from Fusion_Trace.h goes through the      *
+*              complementary filter as on the glove, with a squeeze of the   *
+*              throttle, and the frames each scheme sends are counted. The   *
+*              control latency is the time from a control input moving past  *
+*              its deadband from what the vehicle has, to a frame with it    *
+*              reaching the vehicle. Built and run with "make test" in this  *
+*              directory. "make simulate TRACE=<file>" runs a recorded trace *
+*              (see Fusion_Trace_Save) and prints the timeline per second;   *
+*              the test saves its own trace as _build/Service_Rate_Hand.txt. *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Service_Rate.h"
+#include "Fusion_Complementary.h"
+#include "Fusion_Trace.h"
+#include "Test_Check.h"
+
+#define PI                      3.14159265358979323846
+#define SAMPLE_RATE             SENSORS_ACCELGYRO_SAMPLE_RATE_HZ
+#define MAX_SECONDS             60
+#define MAX_SAMPLES             (MAX_SECONDS * SAMPLE_RATE)
+
+// The drive profile's connection interval, and how long before each event
+// the glove reads the FIFO and decides (GLOVE_RADIO_LEAD_US in main.c)
+#define CONNECTION_INTERVAL_US  7500
+#define RADIO_LEAD_US           2680
+#define MAX_DELIVERIES          ((MAX_SECONDS * 1000000) / CONNECTION_INTERVAL_US + 1)
+
+// The fixed timer: a frame every 100ms (GLOVE_TIMER_INTERVAL before the
+// rate control), sent on the next connection event
+#define FIXED_INTERVAL_US       100000
+
+#define TRACE_FILE              "_build/Service_Rate_Hand.txt"
+
+// A frame reaching the vehicle
+typedef struct
+{
+    uint32_t    timeUs;     // The connection event it went out in
+    int         sample;     // The sample its control inputs are from
+} Delivery_t;
+
+// What a scheme did over a trace. Moving is while the script moves the
+// hand or the throttle; still is the rest, including a slow tilt.
+typedef struct
+{
+    int         updates[2];                 // Frames sent, still [0] and moving [1]
+    uint32_t    worstUs[2];                 // Worst control latency, still and moving
+    int         secondUpdates[MAX_SECONDS]; // Frames sent in each second
+    uint32_t    secondWorstUs[MAX_SECONDS]; // Worst latency of a change in each second
+} Scheme_Result_t;
+
+static Fusion_Trace_Sample_t    mTrace[MAX_SAMPLES];
+static Service_Glove_Control_t  mControl[MAX_SAMPLES];
+static Delivery_t               mDeliveries[MAX_DELIVERIES];
+static const Fusion_Trace_Sensor_t mSensor =
+{
+    { 0, 0, 0 }, FUSION_TRACE_ACCEL_NOISE_LSB, FUSION_TRACE_GYRO_NOISE_LSB, 416
+};
+
+/*****************************************************************************
+ ****************Start of Test Helpers ***************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: The script of the test: still, a pitch swing (3-7s), still,  *
+ *              a slow tilt below the motion rate (10-13s), then a squeeze   *
+ *              of the throttle (14-16s) and a change of direction (17s).    *
+ *                                                                           *
+ *****************************************************************************/
+static void pHandMotion(double seconds, double * rateDps)
+{
+    if(seconds >= 3.0 && seconds < 7.0)
+    {
+        // 0 to 60 degrees and back, 3 times, up to 141 dps
+        rateDps[1] = 30.0 * 2 * PI * 0.75 * sin(2 * PI * 0.75 * (seconds - 3.0));
+    }
+    else if(seconds >= 10.0 && seconds < 13.0)
+    {
+        rateDps[1] = 3.0;
+    }
+}
+
+static uint8_t pThrottle(double seconds)
+{
+    double throttle = 0;
+
+    if(seconds >= 14.0 && seconds < 14.4)
+    {
+        throttle = 80.0 * (seconds - 14.0) / 0.4;
+    }
+    else if(seconds >= 14.4 && seconds < 15.4)
+    {
+        throttle = 80.0;
+    }
+    else if(seconds >= 15.4 && seconds < 15.8)
+    {
+        throttle = 80.0 * (15.8 - seconds) / 0.4;
+    }
+    return (uint8_t)lround(throttle);
+}
+
+static int pIsMoving(int sample)
+{
+    double seconds = (double)sample / SAMPLE_RATE;
+    return (seconds >= 3.0 && seconds < 7.0) || (seconds >= 14.0 && seconds < 14.4) ||
+           (seconds >= 15.4 && seconds < 15.8);
+}
+
+/*****************************************************************************
+ * Description: The control inputs after every sample of a trace, from the   *
+ *              complementary filter as on the glove. The glove drains the   *
+ *              FIFO right before deciding, so the newest sample is used.    *
+ *                                                                           *
+ *****************************************************************************/
+static void pMakeControls(int count)
+{
+    Sensors_AccelGyro_Batch_t batch;
+
+    Fusion_Complementary_Reset();
+    for(int i = 0; i < count; i++)
+    {
+        double seconds = (double)i / SAMPLE_RATE;
+
+        Fusion_Trace_Batch(mTrace, i + 1, i, &batch);
+        Fusion_Complementary_Update(&batch);
+        Fusion_Complementary_GetAngles(&mControl[i].pitch, &mControl[i].roll);
+        mControl[i].timestamp = (uint32_t)i;
+        mControl[i].throttle = pThrottle(seconds);
+        mControl[i].direction = (seconds < 17.0) ? 1 : 0;
+    }
+}
+
+/*****************************************************************************
+ * Description: The last sample taken by a time.                             *
+ *                                                                           *
+ *****************************************************************************/
+static int pSampleAt(uint32_t timeUs, int count)
+{
+    int sample = (int)(((uint64_t)timeUs * SAMPLE_RATE) / 1000000);
+    return (sample < count) ? sample : count - 1;
+}
+
+/*****************************************************************************
+ * Description: The frames of the fixed timer: the inputs every 100ms, sent  *
+ *              on the next connection event.                                *
+ *                                                                           *
+ * Returns: The number of frames                                             *
+ *                                                                           *
+ *****************************************************************************/
+static int pSimulateFixed(int count)
+{
+    uint32_t durationUs = (uint32_t)(((uint64_t)count * 1000000) / SAMPLE_RATE);
+    int deliveries = 0;
+
+    for(uint32_t tick = 0; tick < durationUs; tick += FIXED_INTERVAL_US)
+    {
+        uint32_t event = ((tick / CONNECTION_INTERVAL_US) + 1) * CONNECTION_INTERVAL_US;
+        mDeliveries[deliveries].timeUs = event;
+        mDeliveries[deliveries].sample = pSampleAt(tick, count);
+        deliveries++;
+    }
+    return deliveries;
+}
+
+/*****************************************************************************
+ * Description: The frames of the rate control, asked before every           *
+ *              connection event with the time since the one before, in the  *
+ *              whole milliseconds main.c gets from the RTC.                 *
+ *                                                                           *
+ * Returns: The number of frames                                             *
+ *                                                                           *
+ *****************************************************************************/
+static int pSimulateAdaptive(int count)
+{
+    uint32_t durationUs = (uint32_t)(((uint64_t)count * 1000000) / SAMPLE_RATE);
+    uint32_t previous = 0;
+    int deliveries = 0;
+
+    Service_Rate_Reset();
+    for(uint32_t event = CONNECTION_INTERVAL_US; event < durationUs; event += CONNECTION_INTERVAL_US)
+    {
+        int sample = pSampleAt(event - RADIO_LEAD_US, count);
+        uint16_t elapsedMs = (uint16_t)((event / 1000) - (previous / 1000));
+
+        previous = event;
+        if(Service_Rate_Update(&mControl[sample], elapsedMs))
+        {
+            mDeliveries[deliveries].timeUs = event;
+            mDeliveries[deliveries].sample = sample;
+            deliveries++;
+        }
+    }
+    return deliveries;
+}
+
+/*****************************************************************************
+ * Description: Whether the vehicle's inputs are past a deadband of the      *
+ *              glove's, as Service_Rate judges a change.                    *
+ *                                                                           *
+ *****************************************************************************/
+static int pIsOutOfDate(const Service_Glove_Control_t * glove, const Service_Glove_Control_t * vehicle)
+{
+    return (glove->direction != vehicle->direction) ||
+           (abs(glove->pitch - vehicle->pitch) >= SERVICE_RATE_DEADBAND_PITCH) ||
+           (abs(glove->throttle - vehicle->throttle) >= SERVICE_RATE_DEADBAND_THROTTLE);
+}
+
+/*****************************************************************************
+ * Description: Counts the frames of a scheme and measures the latency of    *
+ *              every change: from the sample where the glove's inputs move  *
+ *              past a deadband of the vehicle's, to the first frame from    *
+ *              that sample or later reaching the vehicle.                   *
+ *                                                                           *
+ * Returns: None (the result is returned via 'result')                       *
+ *                                                                           *
+ * Parameters: count      -> the samples of the trace                        *
+ *             deliveries -> the frames of the scheme, in mDeliveries        *
+ *             result     -> where to place the result                       *
+ *                                                                           *
+ *****************************************************************************/
+static void pMeasure(int count, int deliveries, Scheme_Result_t * result)
+{
+    int vehicle = -1;       // The sample the vehicle's inputs are from
+    int delivered = 0;
+    int changed = -1;       // The sample of a change not yet delivered
+    double changedUs = 0;
+
+    *result = (Scheme_Result_t){ { 0, 0 }, { 0, 0 }, { 0 }, { 0 } };
+    for(int d = 0; d < deliveries; d++)
+    {
+        int second = (int)(mDeliveries[d].timeUs / 1000000);
+        result->updates[pIsMoving(mDeliveries[d].sample)]++;
+        result->secondUpdates[(second < MAX_SECONDS) ? second : MAX_SECONDS - 1]++;
+    }
+
+    for(int i = 0; i < count; i++)
+    {
+        double nowUs = (i * 1000000.0) / SAMPLE_RATE;
+
+        while((delivered < deliveries) && (mDeliveries[delivered].timeUs <= nowUs))
+        {
+            vehicle = mDeliveries[delivered].sample;
+            if((changed >= 0) && (vehicle >= changed))
+            {
+                uint32_t latency = (uint32_t)lround(mDeliveries[delivered].timeUs - changedUs);
+                int moving = pIsMoving(changed);
+                int second = (int)(changedUs / 1000000);
+
+                result->worstUs[moving] = (latency > result->worstUs[moving]) ? latency : result->worstUs[moving];
+                if(latency > result->secondWorstUs[second])
+                {
+                    result->secondWorstUs[second] = latency;
+                }
+                changed = -1;
+            }
+            delivered++;
+        }
+
+        if((changed < 0) && (vehicle >= 0) && pIsOutOfDate(&mControl[i], &mControl[vehicle]))
+        {
+            changed = i;
+            changedUs = nowUs;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Description: Runs both schemes over the trace in mTrace.                  *
+ *                                                                           *
+ *****************************************************************************/
+static void pSimulate(int count, Scheme_Result_t * fixed, Scheme_Result_t * adaptive)
+{
+    pMakeControls(count);
+    pMeasure(count, pSimulateFixed(count), fixed);
+    pMeasure(count, pSimulateAdaptive(count), adaptive);
+}
+
+/*****************************************************************************
+ ****************Start of Tests **********************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: While the hand moves, changes reach the vehicle on the next  *
+ *              connection event instead of the next 100ms tick; while it is *
+ *              still, far fewer frames are sent, and a slow tilt still gets *
+ *              through within the idle interval.                            *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestHandMotion()
+{
+    const Fusion_Trace_Angles_t start = { 5, 0, 0 };
+    const int count = 20 * SAMPLE_RATE;
+    const uint32_t nextEventUs = CONNECTION_INTERVAL_US + RADIO_LEAD_US + (1000000 / SAMPLE_RATE);
+    Scheme_Result_t fixed;
+    Scheme_Result_t adaptive;
+    int moving = 0;
+
+    for(int i = 0; i < count; i++)
+    {
+        moving += pIsMoving(i);
+    }
+    Fusion_Trace_Make(mTrace, count, &start, pHandMotion, &mSensor);
+    CHECK(Fusion_Trace_Save(TRACE_FILE, mTrace, count));
+    pSimulate(count, &fixed, &adaptive);
+
+    CHECK(adaptive.worstUs[1] <= nextEventUs);
+    CHECK(adaptive.worstUs[0] <= (SERVICE_RATE_IDLE_INTERVAL_MS * 1000) + nextEventUs);
+    CHECK(adaptive.updates[0] * 4 < fixed.updates[0]);
+    CHECK(fixed.worstUs[1] > 4 * adaptive.worstUs[1]);
+    printf("Service_Rate: moving %.1fs, fixed %d frames, worst latency %.1f ms; adaptive %d frames, %.1f ms\n",
+           (double)moving / SAMPLE_RATE, fixed.updates[1], fixed.worstUs[1] / 1000.0,
+           adaptive.updates[1], adaptive.worstUs[1] / 1000.0);
+    printf("Service_Rate: still %.1fs, fixed %d frames, worst latency %.1f ms; adaptive %d frames, %.1f ms\n",
+           (double)(count - moving) / SAMPLE_RATE, fixed.updates[0], fixed.worstUs[0] / 1000.0,
+           adaptive.updates[0], adaptive.worstUs[0] / 1000.0);
+}
+
+/*****************************************************************************
+ * Description: Runs a recorded trace, with the throttle script, and prints  *
+ *              the frames and worst latency of each second.                 *
+ *                                                                           *
+ *****************************************************************************/
+static int pSimulateFile(const char * path)
+{
+    int count = Fusion_Trace_Load(path, mTrace, MAX_SAMPLES);
+    Scheme_Result_t fixed;
+    Scheme_Result_t adaptive;
+
+    if(count <= 0)
+    {
+        printf("Can't read a trace from %s\n", path);
+        return 1;
+    }
+
+    pSimulate(count, &fixed, &adaptive);
+    printf("# second, fixed frames, worst latency ms, adaptive frames, worst latency ms\n");
+    for(int second = 0; second * SAMPLE_RATE < count; second++)
+    {
+        printf("%2d %3d %6.1f %3d %6.1f\n", second, fixed.secondUpdates[second], fixed.secondWorstUs[second] / 1000.0,
+               adaptive.secondUpdates[second], adaptive.secondWorstUs[second] / 1000.0);
+    }
+    printf("# total, fixed %d frames, worst %.1f ms; adaptive %d frames, worst %.1f ms\n",
+           fixed.updates[0] + fixed.updates[1], fmax(fixed.worstUs[0], fixed.worstUs[1]) / 1000.0,
+           adaptive.updates[0] + adaptive.updates[1], fmax(adaptive.worstUs[0], adaptive.worstUs[1]) / 1000.0);
+    return 0;
+}
+
+int main(int argc, char * argv[])
+{
+    if(argc > 1)
+    {
+        return pSimulateFile(argv[1]);
+    }
+
+    pTestHandMotion();
+
+    return Test_Check_Summary("Service_Rate");
+}
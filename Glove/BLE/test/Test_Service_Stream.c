@@ -0,0 +1,336 @@
+/*****************************************************************************
+* FILENAME: Test_Service_Stream.c                                            *
+*                                                                            *
+* DESCRIPTION: Host test of the raw IMU stream, see Service_Stream.h. The    *
+*              frames are decoded the way the receiver does, and checked     *
+*              against the samples they were made from. A motion trace shows *
+*              how many key frames the scaled deltas save. Built and run     *
+*              with "make test" in this directory.                           *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Service_Stream.h"
+#include "Service_Glove.h"
+#include "Test_Check.h"
+
+#define PI                  3.14159265358979
+#define TRACE_SAMPLES       (5 * SENSORS_ACCELGYRO_SAMPLE_RATE_HZ) // 5s
+#define ACCEL_LSB_PER_G     (1000000.0 / SENSORS_ACCELGYRO_ACCEL_UG_PER_LSB)
+#define GYRO_LSB_PER_DPS    (1000000.0 / SENSORS_ACCELGYRO_GYRO_UDPS_PER_LSB)
+
+// The fake glove service
+static bool                 mStreamEnabled;     // The vehicle has notifications on
+static bool                 mQueueFull;         // Service_Glove_QueueStream refuses frames
+
+// The receiver
+static int16_t              mTrace[TRACE_SAMPLES][SERVICE_STREAM_AXES]; // What the glove sampled
+static int16_t              mRebuilt[SERVICE_STREAM_AXES]; // The last sample rebuilt
+static uint32_t             mNextIndex;         // Sample index of the next delta
+static bool                 mSynced;            // A key frame was seen since the last gap
+static uint8_t              mNextSequence;      // Sequence number expected next
+static int                  mFrames;            // Frames received
+static int                  mKeyFrames;         // Key frames received
+static int                  mSamples;           // Samples rebuilt
+static int                  mMaxError;          // Largest error of a rebuilt sample
+static int                  mMaxShift;          // Largest shift of a delta frame
+static int                  mErrors;            // Rebuilt samples outside the bound of their shift
+
+/*****************************************************************************
+ ****************Start of Fake Implementations *******************************
+ *****************************************************************************/
+
+bool Service_Glove_IsStreaming()
+{
+    return mStreamEnabled;
+}
+
+/*****************************************************************************
+ * Description: Receives the frame straight away, the way the vehicle would  *
+ *              once it is notified.                                         *
+ *                                                                           *
+ *****************************************************************************/
+bool Service_Glove_QueueStream(const uint8_t * frame, uint16_t length)
+{
+    uint8_t samples = frame[1] & SERVICE_STREAM_COUNT_MASK;
+
+    if(mQueueFull)
+    {
+        return false;
+    }
+
+    mFrames++;
+    if(frame[0] != mNextSequence)
+    {
+        mSynced = false;
+    }
+    mNextSequence = (uint8_t)(frame[0] + 1);
+
+    if(frame[1] & SERVICE_STREAM_KEY_FLAG)
+    {
+        mKeyFrames++;
+        if(length != SERVICE_STREAM_KEY_LEN || samples != 1)
+        {
+            mErrors++;
+            return true;
+        }
+        mNextIndex = (uint32_t)frame[2] | ((uint32_t)frame[3] << 8)
+                     | ((uint32_t)frame[4] << 16) | ((uint32_t)frame[5] << 24);
+        for(uint8_t axis = 0; axis < SERVICE_STREAM_AXES; axis++)
+        {
+            mRebuilt[axis] = (int16_t)(frame[6 + (2 * axis)] | (frame[7 + (2 * axis)] << 8));
+            mErrors += (mNextIndex >= TRACE_SAMPLES || mRebuilt[axis] != mTrace[mNextIndex][axis]);
+        }
+        mSynced = true;
+        mSamples++;
+        mNextIndex++;
+        return true;
+    }
+
+    uint8_t shift = (frame[1] & SERVICE_STREAM_SHIFT_MASK) >> SERVICE_STREAM_SHIFT_POS;
+    if(!mSynced || length != SERVICE_STREAM_HEADER_LEN + (samples * SERVICE_STREAM_AXES))
+    {
+        mErrors += mSynced; // Nothing to apply the deltas to is fine; a bad length is not
+        return true;
+    }
+    if(shift > mMaxShift)
+    {
+        mMaxShift = shift;
+    }
+
+    for(uint8_t i = 0; i < samples; i++, mNextIndex++)
+    {
+        for(uint8_t axis = 0; axis < SERVICE_STREAM_AXES; axis++)
+        {
+            int8_t delta = (int8_t)frame[SERVICE_STREAM_HEADER_LEN + (i * SERVICE_STREAM_AXES) + axis];
+            int error;
+
+            mRebuilt[axis] = (int16_t)(mRebuilt[axis] + (delta * (1 << shift)));
+            error = abs(mRebuilt[axis] - mTrace[mNextIndex % TRACE_SAMPLES][axis]);
+            mErrors += (error > ((1 << shift) >> 1));
+            if(error > mMaxError)
+            {
+                mMaxError = error;
+            }
+        }
+        mSamples++;
+    }
+    return true;
+}
+
+/*****************************************************************************
+ ****************Start of Test Helpers ***************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Starts a test: the stream is turned off and on, so the glove *
+ *              starts over, and the receiver is cleared.                    *
+ *                                                                           *
+ *****************************************************************************/
+static void pSetUp()
+{
+    Sensors_AccelGyro_Batch_t batch;
+
+    memset(&batch, 0x00, sizeof(batch));
+    mStreamEnabled = false;
+    Service_Stream_AddBatch(&batch);
+    mStreamEnabled = true;
+    mQueueFull = false;
+
+    mNextSequence = 0;
+    mSynced = false;
+    mFrames = 0;
+    mKeyFrames = 0;
+    mSamples = 0;
+    mMaxError = 0;
+    mMaxShift = 0;
+    mErrors = 0;
+}
+
+/*****************************************************************************
+ * Description: Sends trace samples to the stream in FIFO sized batches.     *
+ *                                                                           *
+ *****************************************************************************/
+static void pSendTrace(uint32_t first, uint32_t count, bool overrun)
+{
+    Sensors_AccelGyro_Batch_t batch;
+
+    while(count > 0)
+    {
+        memset(&batch, 0x00, sizeof(batch));
+        batch.firstSampleIndex = first;
+        batch.overrun = overrun;
+        batch.count = (count < SENSORS_ACCELGYRO_FIFO_BATCH_SIZE) ? count : SENSORS_ACCELGYRO_FIFO_BATCH_SIZE;
+        for(uint8_t i = 0; i < batch.count; i++)
+        {
+            const int16_t * sample = mTrace[first + i];
+            batch.accel[i].xData = sample[0];
+            batch.accel[i].yData = sample[1];
+            batch.accel[i].zData = sample[2];
+            batch.gyro[i].xData = sample[3];
+            batch.gyro[i].yData = sample[4];
+            batch.gyro[i].zData = sample[5];
+        }
+        Service_Stream_AddBatch(&batch);
+
+        first += batch.count;
+        count -= batch.count;
+        overrun = false;
+    }
+}
+
+/*****************************************************************************
+ * Description: A glove held still for 1s, waved up and down 20 degrees at   *
+ *              1.5Hz while turning 90 degrees for 3s, then held still for   *
+ *              1s. The noise is about that of the LSM6DS33 at 416Hz.        *
+ *                                                                           *
+ *****************************************************************************/
+static void pMakeMotionTrace()
+{
+    srand(1);
+    for(int i = 0; i < TRACE_SAMPLES; i++)
+    {
+        double t = (double)i / SENSORS_ACCELGYRO_SAMPLE_RATE_HZ;
+        double moving = (t >= 1.0 && t < 4.0) ? 1.0 : 0.0;
+        double w = 2.0 * PI * 1.5;
+        double pitch = moving * (20.0 * PI / 180.0) * sin(w * (t - 1.0));
+        double pitchRate = moving * 20.0 * w * cos(w * (t - 1.0));  // dps
+        double yawRate = moving * 30.0 * (1.0 - cos(2.0 * PI * (t - 1.0) / 3.0)); // dps, 90 degrees in all
+        double sample[SERVICE_STREAM_AXES] =
+        {
+            -sin(pitch) * ACCEL_LSB_PER_G, 0.0, cos(pitch) * ACCEL_LSB_PER_G,
+            0.0, pitchRate * GYRO_LSB_PER_DPS, yawRate * GYRO_LSB_PER_DPS
+        };
+
+        for(int axis = 0; axis < SERVICE_STREAM_AXES; axis++)
+        {
+            int noise = (axis < 3) ? 30 : 8;
+            mTrace[i][axis] = (int16_t)lround(sample[axis] + (rand() % (2 * noise + 1)) - noise);
+        }
+    }
+}
+
+/*****************************************************************************
+ ****************Start of Tests **********************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Every sample of the motion trace is rebuilt within the bound *
+ *              of its shift, and the only key frames are the periodic ones, *
+ *              with plain int8 deltas most of the moving samples would have *
+ *              gone in key frames.                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestMotionTrace()
+{
+    int int8Keys = 0;
+
+    pMakeMotionTrace();
+    for(int i = 1; i < TRACE_SAMPLES; i++)
+    {
+        for(int axis = 0; axis < SERVICE_STREAM_AXES; axis++)
+        {
+            if(abs(mTrace[i][axis] - mTrace[i - 1][axis]) > INT8_MAX)
+            {
+                int8Keys++; // This sample could not have followed on
+                break;
+            }
+        }
+    }
+
+    pSetUp();
+    pSendTrace(0, TRACE_SAMPLES, false);
+    CHECK(mSamples == TRACE_SAMPLES);
+    CHECK(mErrors == 0);
+    CHECK(mMaxShift > 0 && mMaxShift <= SERVICE_STREAM_MAX_SHIFT);
+    CHECK(mKeyFrames <= ((mFrames + SERVICE_STREAM_KEY_INTERVAL - 1) / SERVICE_STREAM_KEY_INTERVAL) + 1);
+    CHECK(int8Keys > SENSORS_ACCELGYRO_SAMPLE_RATE_HZ); // Over a third of the 3s of motion
+    printf("Service_Stream: %d samples in %d frames, %d key frames (%.1f%%); "
+           "%d samples (%.1f%%) would not fit int8 deltas; largest shift %d, error %d counts\n",
+           mSamples, mFrames, mKeyFrames, 100.0 * mKeyFrames / mFrames,
+           int8Keys, 100.0 * int8Keys / TRACE_SAMPLES, mMaxShift, mMaxError);
+
+    // Held still, the deltas are exact
+    pSetUp();
+    pSendTrace(0, SENSORS_ACCELGYRO_SAMPLE_RATE_HZ, false);
+    CHECK(mErrors == 0);
+    CHECK(mMaxShift == 0);
+    CHECK(mMaxError == 0);
+}
+
+/*****************************************************************************
+ * Description: Samples lost in the IMU, or dropped because the link is      *
+ *              full, are followed by a key frame, and the drops counted.    *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestGaps()
+{
+    pSetUp();
+    pSendTrace(0, 60, false);
+    CHECK(mKeyFrames == 1);
+
+    // Samples 60 to 99 are lost in the IMU
+    pSendTrace(100, 50, true);
+    CHECK(mKeyFrames == 2);
+    CHECK(mErrors == 0);
+
+    // The link is full for a batch
+    mQueueFull = true;
+    pSendTrace(150, 16, false);
+    CHECK(Service_Stream_GetDropped() > 0);
+    mQueueFull = false;
+    pSendTrace(166, 16, false);
+    CHECK(mKeyFrames == 3);
+    CHECK(mErrors == 0);
+
+    // Turning the stream off and on starts over
+    pSetUp();
+    pSendTrace(0, 1, false);
+    CHECK(Service_Stream_GetDropped() == 0);
+}
+
+/*****************************************************************************
+ * Description: A sample at the end of the range is not rounded past it.     *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestSaturated()
+{
+    for(int i = 0; i < 64; i++)
+    {
+        for(int axis = 0; axis < SERVICE_STREAM_AXES; axis++)
+        {
+            // Jumps of 302, which round to 304, that end on the limits
+            mTrace[i][axis] = (i % 2) ? ((axis % 2) ? INT16_MAX : INT16_MIN)
+                                      : ((axis % 2) ? INT16_MAX - 302 : INT16_MIN + 302);
+        }
+    }
+
+    pSetUp();
+    pSendTrace(0, 64, false);
+    CHECK(mSamples == 64);
+    CHECK(mErrors == 0);
+}
+
+int main()
+{
+    pTestMotionTrace();
+    pTestGaps();
+    pTestSaturated();
+
+    return Test_Check_Summary("Service_Stream");
+}
@@ -0,0 +1,172 @@
+/*****************************************************************************
+* FILENAME: NordicSDK.h                                                      *
+*                                                                            *
+* DESCRIPTION: Stands in for the Nordic SDK and SoftDevice headers in the    *
+*              host tests of the glove. Only what the tested modules use is  *
+*              declared, with the names and values of SDK12 / S130 (API      *
+*              version 2). The SDK calls are implemented by the test that    *
+*              needs them. ble.h, ble_srv_common.h and app_util_platform.h   *
+*              in this folder include this file.                             *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | SPI driver, critical regions, WFE   |  *
+* | @02     | 17Oct26  | BNordland  | GPIO, GPIOTE, delay and timer       |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef FAKE_NORDIC_SDK_H__
+#define FAKE_NORDIC_SDK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h> // @01a The SDK headers bring it in for the modules
+
+// Error codes (nrf_error.h)
+#define NRF_SUCCESS                         0
+#define NRF_ERROR_INVALID_LENGTH            9   // @01a
+#define NRF_ERROR_BUSY                      17
+
+// A failed APP_ERROR_CHECK is recorded by the test, rather than resetting
+void Fake_AppError(uint32_t errorCode, const char * file, int line);
+#define APP_ERROR_CHECK(err_code) \
+    do { uint32_t _err = (err_code); if(_err != NRF_SUCCESS) { Fake_AppError(_err, __FILE__, __LINE__); } } while(0)
+
+// app_util.h
+#define STATIC_ASSERT(EXPR)                 _Static_assert((EXPR), #EXPR)
+
+// @01a app_util_platform.h. There are no interrupts in the host tests, so
+// a critical region is only a block.
+#define CRITICAL_REGION_ENTER()             {
+#define CRITICAL_REGION_EXIT()              }
+
+// @01a The wait for an interrupt. The test runs the "interrupt" it waits for.
+void Fake_WFE(void);
+#define __WFE()                             Fake_WFE()
+
+// @01a nrf_drv_spi.h (SPI master, SDK12)
+typedef struct
+{
+    uint8_t         drv_inst_idx;
+} nrf_drv_spi_t;
+#define NRF_DRV_SPI_INSTANCE(id)            { .drv_inst_idx = (id) }
+
+#define NRF_DRV_SPI_PIN_NOT_USED            0xFF
+typedef struct
+{
+    uint8_t         sck_pin;
+    uint8_t         mosi_pin;
+    uint8_t         miso_pin;
+    uint8_t         ss_pin;
+    uint8_t         orc;        // Clocked out once the transmit buffer is sent
+} nrf_drv_spi_config_t;
+#define NRF_DRV_SPI_DEFAULT_CONFIG                                      \
+    {                                                                   \
+        .sck_pin  = NRF_DRV_SPI_PIN_NOT_USED,                           \
+        .mosi_pin = NRF_DRV_SPI_PIN_NOT_USED,                           \
+        .miso_pin = NRF_DRV_SPI_PIN_NOT_USED,                           \
+        .ss_pin   = NRF_DRV_SPI_PIN_NOT_USED,                           \
+        .orc      = 0xFF,                                               \
+    }
+
+typedef enum
+{
+    NRF_DRV_SPI_EVENT_DONE
+} nrf_drv_spi_evt_type_t;
+
+typedef struct
+{
+    uint8_t const * p_tx_buffer;
+    uint8_t         tx_length;
+    uint8_t *       p_rx_buffer;
+    uint8_t         rx_length;
+} nrf_drv_spi_xfer_desc_t;
+
+typedef struct
+{
+    nrf_drv_spi_evt_type_t  type;
+    union
+    {
+        nrf_drv_spi_xfer_desc_t done;
+    } data;
+} nrf_drv_spi_evt_t;
+
+typedef void (*nrf_drv_spi_handler_t)(nrf_drv_spi_evt_t const * p_event);
+
+uint32_t nrf_drv_spi_init(nrf_drv_spi_t const * const p_instance, nrf_drv_spi_config_t const * p_config,
+                          nrf_drv_spi_handler_t handler);
+uint32_t nrf_drv_spi_transfer(nrf_drv_spi_t const * const p_instance,
+                              uint8_t const * p_tx_buffer, uint8_t tx_buffer_length,
+                              uint8_t * p_rx_buffer, uint8_t rx_buffer_length);
+
+// @02a nrf_delay.h, app_timer.h
+void nrf_delay_ms(uint32_t volatile number_of_ms);
+uint32_t app_timer_cnt_get(uint32_t * p_ticks);
+
+// @02a nrf_gpio.h
+typedef enum
+{
+    NRF_GPIO_PIN_NOPULL     = 0,
+    NRF_GPIO_PIN_PULLDOWN   = 1,
+    NRF_GPIO_PIN_PULLUP     = 3
+} nrf_gpio_pin_pull_t;
+
+typedef enum
+{
+    NRF_GPIO_PIN_NOSENSE    = 0,
+    NRF_GPIO_PIN_SENSE_HIGH = 2,
+    NRF_GPIO_PIN_SENSE_LOW  = 3
+} nrf_gpio_pin_sense_t;
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+void nrf_gpio_cfg_sense_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config,
+                              nrf_gpio_pin_sense_t sense_config);
+
+// @02a nrf_drv_gpiote.h
+typedef uint32_t nrf_drv_gpiote_pin_t;
+
+typedef enum
+{
+    NRF_GPIOTE_POLARITY_LOTOHI = 1,
+    NRF_GPIOTE_POLARITY_HITOLO = 2,
+    NRF_GPIOTE_POLARITY_TOGGLE = 3
+} nrf_gpiote_polarity_t;
+
+typedef struct
+{
+    nrf_gpiote_polarity_t   sense;
+    nrf_gpio_pin_pull_t     pull;
+    bool                    is_watcher;
+    bool                    hi_accuracy;
+} nrf_drv_gpiote_in_config_t;
+#define GPIOTE_CONFIG_IN_SENSE_LOTOHI(hi_accu)                          \
+    {                                                                   \
+        .sense       = NRF_GPIOTE_POLARITY_LOTOHI,                      \
+        .pull        = NRF_GPIO_PIN_NOPULL,                             \
+        .is_watcher  = false,                                           \
+        .hi_accuracy = (hi_accu),                                       \
+    }
+
+typedef void (*nrf_drv_gpiote_evt_handler_t)(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
+
+bool nrf_drv_gpiote_is_init(void);
+uint32_t nrf_drv_gpiote_init(void);
+uint32_t nrf_drv_gpiote_in_init(nrf_drv_gpiote_pin_t pin, nrf_drv_gpiote_in_config_t const * p_config,
+                                nrf_drv_gpiote_evt_handler_t evt_handler);
+void nrf_drv_gpiote_in_event_enable(nrf_drv_gpiote_pin_t pin, bool int_enable);
+void nrf_drv_gpiote_in_uninit(nrf_drv_gpiote_pin_t pin);
+
+// ble.h; the tested modules only pass events on
+typedef struct ble_evt_s ble_evt_t;
+
+#endif /* FAKE_NORDIC_SDK_H__ */
@@ -0,0 +1,5 @@
+// Stands in for the SDK's app_util_platform.h in the host tests, see NordicSDK.h
+#ifndef FAKE_APP_UTIL_PLATFORM_H__
+#define FAKE_APP_UTIL_PLATFORM_H__
+#include "NordicSDK.h"
+#endif
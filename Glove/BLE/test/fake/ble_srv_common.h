@@ -0,0 +1,5 @@
+// Stands in for the SDK's ble_srv_common.h in the host tests, see NordicSDK.h
+#ifndef FAKE_BLE_SRV_COMMON_H__
+#define FAKE_BLE_SRV_COMMON_H__
+#include "NordicSDK.h"
+#endif
@@ -14,6 +14,7 @@
 * |---------|----------|------------|---------------------------------  *
 * | None    | 26Apr17  | BNordland  | Initial creation                | *
 * | @01     | 30Apr17  | BNordland  | Adding BLE Nano Power Wiring    | *
+* | @02     | 17Oct26  | BNordland  | Adding BLE Nano data ready line | *
 *  -------------------------------------------------------------------  *
 *************************************************************************/
 
@@ -51,4 +52,13 @@
     #define EXT_BLE_PORT PORTF
     #define EXT_BLE_PORTBIT  PORTF0
 
+    // BLE Nano data ready line, raised when it has a new frame  @02a
+    // Every pin change pin is taken (SPI, encoder, motor PWM), so
+    // it uses external interrupt INT2.
+    #define EXT_BLE_READY_DDR       DDRD
+    #define EXT_BLE_READY_DDRBIT    DDD2
+    #define EXT_BLE_READY_PIN       PIND
+    #define EXT_BLE_READY_PINBIT    PIND2
+    #define EXT_BLE_READY_INT       INT2
+
 #endif // _hardware_H_
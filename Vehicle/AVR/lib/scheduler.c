@@ -0,0 +1,311 @@
+/************************************************************************
+* FILENAME: scheduler.c													*
+*																		*
+* DESCRIPTION: Fixed Rate Task Scheduler Functions						*
+*              Implementation											*
+*																		*
+* LICENSE: The MIT License (MIT)										*
+*          Copyright (c) 2017 Brian Nordland       						*
+* 																		*
+* AUTHOR:  Brian Nordland												*
+*																		*
+* --------------------------------------------------------------------  *
+* | Change  | Date     |            |								  | *
+* | Flag    | (DDMYY)  | Author     | Description					  |	*
+* |---------|----------|------------|---------------------------------	*
+* | None    | 17Oct26  | BNordland  | Initial creation                | *
+*  -------------------------------------------------------------------	*
+*************************************************************************/
+
+#include "scheduler.h"
+#include "timer.h"
+#include "util.h"
+
+// AVR Includes
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+// integer types
+#include <stdint.h>
+
+// Constants
+#define SCHEDULER_PRESCALER		64 // timer3 counts at F_CPU/64
+#define SCHEDULER_US_PER_TICK	(SCHEDULER_TICK_MS * 1000UL)
+
+// Global Variables
+static SchedulerTask *		pSchedulerTasks = 0;
+static uint8_t				pSchedulerTaskCount = 0;
+static volatile uint32_t	pSchedulerTicks = 0;		// ticks since setup
+static uint16_t				pSchedulerCountsPerTick = 0;	// timer3 counts per tick
+static uint8_t				pSchedulerUsPerCount = 0;	// microseconds per timer3 count
+
+// Internal function definitions
+static bool pIsTaskDue();
+static void pRunTask(SchedulerTask * task);
+
+/*****************************************************************************
+ * Function Definition: setupScheduler(SchedulerTask * tasks, uint8_t count, *
+ *                                     uint32_t cpuFrequency)                *
+ *                                                                           *
+ * Description: Sets up the tasks, and timer3 for the tick. Every periodic   *
+ *              task is first due on the first tick.                         *
+ *                                                                           *
+ * Parameters: tasks        - the table of tasks, which must stay valid      *
+ *             count        - the number of tasks                            *
+ *             cpuFrequency - F_CPU (up to 16MHz)                            *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void setupScheduler(SchedulerTask * tasks, uint8_t count, uint32_t cpuFrequency)
+{
+	uint8_t i;
+
+	pSchedulerTasks = tasks;
+	pSchedulerTaskCount = count;
+	for(i = 0; i < count; i++)
+	{
+		tasks[i].runs = 0;
+		tasks[i].overruns = 0;
+		tasks[i].maxTimeUs = 0;
+		tasks[i].totalTimeUs = 0;
+		tasks[i].countdown = 1;
+		tasks[i].due = false;
+		tasks[i].missed = 0;
+	}
+
+	pSchedulerCountsPerTick = (uint16_t)((cpuFrequency / SCHEDULER_PRESCALER) / (1000 / SCHEDULER_TICK_MS));
+	pSchedulerUsPerCount = (uint8_t)((SCHEDULER_PRESCALER * 1000000UL) / cpuFrequency);
+
+	// Timer3 in CTC mode 4 (TOP is OCR3A), interrupt on every match
+	TimerWGM timer3Mode;
+	timer3Mode.value = 4;
+	setTimer3WGMMode(timer3Mode);
+	OCR3A = pSchedulerCountsPerTick - 1;
+	TCNT3 = 0;
+	bitOn(TIMSK3, OCIE3A);
+	setTimer3ClockSelect(CS64);
+
+	set_sleep_mode(SLEEP_MODE_IDLE); // timers, SPI and USB keep running
+}
+
+/*****************************************************************************
+ * Function Definition: runScheduler()                                       *
+ *                                                                           *
+ * Description: Runs the tasks as they become due, and sleeps (idle mode)    *
+ *              while none are. Never returns.                               *
+ *                                                                           *
+ *              Note: After each task, it starts again from the top of the   *
+ *                    table, so earlier tasks go first.                      *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void runScheduler()
+{
+	uint8_t i;
+
+	while(1)
+	{
+		for(i = 0; i < pSchedulerTaskCount; i++)
+		{
+			if(pSchedulerTasks[i].due)
+			{
+				pRunTask(&pSchedulerTasks[i]);
+				break;
+			}
+		}
+
+		if(i < pSchedulerTaskCount)
+		{
+			continue;
+		}
+
+		// Nothing is due. Interrupts are only enabled again by the sei just
+		// before sleeping, so one that makes a task due can't be missed.
+		cli();
+		if(!pIsTaskDue())
+		{
+			sleep_enable();
+			sei();
+			sleep_cpu();
+			sleep_disable();
+		}
+		sei();
+	}
+}
+
+/*****************************************************************************
+ * Function Definition: postSchedulerEvent(uint8_t events)                   *
+ *                                                                           *
+ * Description: Makes the tasks waiting for any of the events due. Can be    *
+ *              called from an interrupt; the tasks run from the main loop.  *
+ *                                                                           *
+ * Parameters: events - the events (bits)                                    *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void postSchedulerEvent(uint8_t events)
+{
+	uint8_t i;
+
+	for(i = 0; i < pSchedulerTaskCount; i++)
+	{
+		if(pSchedulerTasks[i].events & events)
+		{
+			pSchedulerTasks[i].due = true;
+		}
+	}
+}
+
+/*****************************************************************************
+ * Function Definition: getSchedulerTimeUs()                                 *
+ *                                                                           *
+ * Description: The time since the scheduler was set up, in microseconds.    *
+ *              Wraps after about 71 minutes.                                *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: The time in microseconds                                         *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t getSchedulerTimeUs()
+{
+	uint8_t sreg = SREG;
+	uint32_t ticks;
+	uint16_t counts;
+
+	cli();
+	ticks = pSchedulerTicks;
+	counts = TCNT3;
+	// The counter wrapped, but the interrupt has not run yet
+	if((TIFR3 & (1 << OCF3A)) && counts < (pSchedulerCountsPerTick / 2))
+	{
+		ticks++;
+	}
+	SREG = sreg;
+
+	return (ticks * SCHEDULER_US_PER_TICK) + ((uint32_t)counts * pSchedulerUsPerCount);
+}
+
+/*****************************************************************************
+ * Function Definition: clearSchedulerStats(SchedulerTask * task)            *
+ *                                                                           *
+ * Description: Clears the runs and times of a task, to start a new window.  *
+ *              Overruns are kept.                                           *
+ *                                                                           *
+ * Parameters: task - the task                                               *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void clearSchedulerStats(SchedulerTask * task)
+{
+	task->runs = 0;
+	task->maxTimeUs = 0;
+	task->totalTimeUs = 0;
+}
+
+/*****************************************************************************
+ * Function Definition: handleSchedulerInterrupt()                           *
+ *                                                                           *
+ * Description: Should be called by the ISR for timer3 compare A match       *
+ *              (TIMER3_COMPA_vect). Makes the periodic tasks due. A task    *
+ *              that is still due from its last period has missed it.        *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void handleSchedulerInterrupt()
+{
+	uint8_t i;
+
+	pSchedulerTicks++;
+
+	for(i = 0; i < pSchedulerTaskCount; i++)
+	{
+		SchedulerTask * task = &pSchedulerTasks[i];
+		if(task->periodMs == 0 || --task->countdown != 0)
+		{
+			continue;
+		}
+
+		task->countdown = task->periodMs / SCHEDULER_TICK_MS;
+		if(task->due && task->missed < UINT8_MAX)
+		{
+			task->missed++;
+		}
+		task->due = true;
+	}
+}
+
+/*****************************************************************************
+ * Function Definition: pIsTaskDue()                                         *
+ *                                                                           *
+ * Description: Indicates if any task is due                                 *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: true if a task is due                                            *
+ *                                                                           *
+ *****************************************************************************/
+static bool pIsTaskDue()
+{
+	uint8_t i;
+
+	for(i = 0; i < pSchedulerTaskCount; i++)
+	{
+		if(pSchedulerTasks[i].due)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/*****************************************************************************
+ * Function Definition: pRunTask(SchedulerTask * task)                       *
+ *                                                                           *
+ * Description: Runs a task, and keeps its statistics. A periodic task that  *
+ *              runs for longer than its period is an overrun too.           *
+ *                                                                           *
+ * Parameters: task - the task                                               *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+static void pRunTask(SchedulerTask * task)
+{
+	uint32_t start;
+	uint32_t elapsed;
+	uint8_t missed;
+
+	// Cleared before it runs, so an event posted while it runs is kept
+	cli();
+	task->due = false;
+	missed = task->missed;
+	task->missed = 0;
+	sei();
+
+	start = getSchedulerTimeUs();
+	task->function();
+	elapsed = getSchedulerTimeUs() - start;
+
+	task->runs++;
+	task->overruns += missed;
+	task->totalTimeUs += elapsed;
+	if(elapsed > task->maxTimeUs)
+	{
+		task->maxTimeUs = (elapsed > UINT16_MAX) ? UINT16_MAX : (uint16_t)elapsed;
+	}
+	if(task->periodMs != 0 && elapsed > ((uint32_t)task->periodMs * 1000))
+	{
+		task->overruns++;
+	}
+}
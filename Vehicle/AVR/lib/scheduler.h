@@ -0,0 +1,155 @@
+/************************************************************************
+* FILENAME: scheduler.h													*
+*																		*
+* DESCRIPTION: Fixed Rate Task Scheduler Functions						*
+*																		*
+* LICENSE: The MIT License (MIT)										*
+*          Copyright (c) 2017 Brian Nordland       						*
+* 																		*
+* AUTHOR:  Brian Nordland												*
+*																		*
+* --------------------------------------------------------------------  *
+* | Change  | Date     |            |								  | *
+* | Flag    | (DDMYY)  | Author     | Description					  |	*
+* |---------|----------|------------|---------------------------------	*
+* | None    | 17Oct26  | BNordland  | Initial creation                | *
+*  -------------------------------------------------------------------	*
+*************************************************************************/
+
+#ifndef _scheduler_H_
+#define _scheduler_H_
+
+// integer types
+#include <stdint.h>
+
+#include "util.h" // bool
+
+/************************************************************************
+ * IMPORTANT USAGE INSTRUCTIONS:										*
+ * 	The scheduler ticks every 1ms from the compare A match of timer3,	*
+ * 	which it uses in CTC mode. The application must forward the			*
+ * 	interrupt:															*
+ * 		ISR(TIMER3_COMPA_vect) { handleSchedulerInterrupt(); }			*
+ * 																		*
+ * 	Tasks are cooperative: each runs to completion in the main loop,	*
+ * 	so a long task delays the others (counted as overruns).				*
+ ************************************************************************/
+
+// The scheduler tick, tasks run at multiples of it
+#define SCHEDULER_TICK_MS	1
+
+/*****************************************************************************
+ * Description: A task. The application owns the table of tasks, and sets    *
+ *              the first three fields; the rest are kept by the scheduler.  *
+ *              Tasks earlier in the table run first when due together.      *
+ *                                                                           *
+ *              function    - called when the task is due                    *
+ *              periodMs    - how often it runs, 0 to only run on events     *
+ *              events      - the events (bits) that also make it run        *
+ *              runs        - times it ran                                   *
+ *              overruns    - times it was due again before it had run       *
+ *              maxTimeUs   - its longest run                                *
+ *              totalTimeUs - the time of all of its runs                    *
+ *                                                                           *
+ *              The statistics are only changed from the main loop, so a     *
+ *              task can read and clear them (see clearSchedulerStats).      *
+ *                                                                           *
+ *****************************************************************************/
+typedef struct
+{
+	void (*function)();
+	uint16_t periodMs;
+	uint8_t events;
+
+	uint16_t runs;
+	uint16_t overruns;
+	uint16_t maxTimeUs;
+	uint32_t totalTimeUs;
+
+	uint16_t countdown;		  // ticks until it is next due
+	volatile bool due;		  // set from the interrupts
+	volatile uint8_t missed;  // overruns not yet counted, from the tick interrupt
+} SchedulerTask;
+
+/*****************************************************************************
+ * Function Definition: setupScheduler(SchedulerTask * tasks, uint8_t count, *
+ *                                     uint32_t cpuFrequency)                *
+ *                                                                           *
+ * Description: Sets up the tasks, and timer3 for the tick. Every periodic   *
+ *              task is first due on the first tick.                         *
+ *                                                                           *
+ * Parameters: tasks        - the table of tasks, which must stay valid      *
+ *             count        - the number of tasks                            *
+ *             cpuFrequency - F_CPU (up to 16MHz)                            *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void setupScheduler(SchedulerTask * tasks, uint8_t count, uint32_t cpuFrequency);
+
+/*****************************************************************************
+ * Function Definition: runScheduler()                                       *
+ *                                                                           *
+ * Description: Runs the tasks as they become due, and sleeps (idle mode)    *
+ *              while none are. Never returns.                               *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void runScheduler();
+
+/*****************************************************************************
+ * Function Definition: postSchedulerEvent(uint8_t events)                   *
+ *                                                                           *
+ * Description: Makes the tasks waiting for any of the events due. Can be    *
+ *              called from an interrupt; the tasks run from the main loop.  *
+ *                                                                           *
+ * Parameters: events - the events (bits)                                    *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void postSchedulerEvent(uint8_t events);
+
+/*****************************************************************************
+ * Function Definition: getSchedulerTimeUs()                                 *
+ *                                                                           *
+ * Description: The time since the scheduler was set up, in microseconds.    *
+ *              Wraps after about 71 minutes.                                *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: The time in microseconds                                         *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t getSchedulerTimeUs();
+
+/*****************************************************************************
+ * Function Definition: clearSchedulerStats(SchedulerTask * task)            *
+ *                                                                           *
+ * Description: Clears the runs and times of a task, to start a new window.  *
+ *              Overruns are kept.                                           *
+ *                                                                           *
+ * Parameters: task - the task                                               *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void clearSchedulerStats(SchedulerTask * task);
+
+/*****************************************************************************
+ * Function Definition: handleSchedulerInterrupt()                           *
+ *                                                                           *
+ * Description: Should be called by the ISR for timer3 compare A match       *
+ *              (TIMER3_COMPA_vect). Makes the periodic tasks due.           *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void handleSchedulerInterrupt();
+
+#endif /* _scheduler_H_ */
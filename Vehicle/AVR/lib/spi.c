@@ -0,0 +1,234 @@
+/************************************************************************
+* FILENAME: spi.c														*
+*																		*
+* DESCRIPTION: SPI Master Functions Implementation						*
+*																		*
+* LICENSE: The MIT License (MIT)										*
+*          Copyright (c) 2017 Brian Nordland       						*
+* 																		*
+* AUTHOR:  Brian Nordland												*
+*																		*
+* --------------------------------------------------------------------  *
+* | Change  | Date     |            |								  | *
+* | Flag    | (DDMYY)  | Author     | Description					  |	*
+* |---------|----------|------------|---------------------------------	*
+* | None    | 17Oct26  | BNordland  | Initial creation                | *
+*  -------------------------------------------------------------------	*
+*************************************************************************/
+
+#include "spi.h"
+#include "util.h"
+
+// AVR Includes
+#include <avr/io.h>
+
+// integer types
+#include <stdint.h>
+
+// Global Variables, shared with the interrupts
+static SpiTransfer * volatile pSpiTransfer = 0; // the transfer in progress
+static volatile bool          pSpiBusy = false; // a transfer is in progress
+static volatile uint8_t       pSpiPosition = 0; // bytes clocked so far
+static uint8_t                pSpiSelectDelayTicks = 2;
+
+// Internal function definitions
+static void pSpiSendByte(const SpiTransfer * transfer, uint8_t position);
+
+/*****************************************************************************
+ * Function Definition: setupSpiMaster(SpiClockRate rate,                    *
+ *                                     uint8_t selectDelayTicks)             *
+ *                                                                           *
+ * Description: Sets the SPI PINs and the SPI as master, with interrupts.    *
+ *                                                                           *
+ * Parameters: rate             - the SCK rate                               *
+ *             selectDelayTicks - timer0 ticks from slave select on to the   *
+ *                                first clock (2 to 255)                     *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void setupSpiMaster(SpiClockRate rate, uint8_t selectDelayTicks)
+{
+	// A compare match one tick after the current count can be missed
+	pSpiSelectDelayTicks = (selectDelayTicks < 2) ? 2 : selectDelayTicks;
+
+	// Set SS, MOSI, SCK as Output, slave select off (by holding high)
+	setDDR(DDRB, DDB0, DDR_OUTPUT);
+	setDDR(DDRB, DDB1, DDR_OUTPUT);
+	setDDR(DDRB, DDB2, DDR_OUTPUT);
+	bitOn(PORTB, PORTB0);
+
+	// spr1, spr0, spi2x
+	uint8_t spcr = (1 << SPE) | (1 << MSTR) | (1 << SPIE);
+	switch(rate)
+	{
+		case SPI_CLOCK_DIV2:
+			SPSR |= (1 << SPI2X);
+			break;
+		case SPI_CLOCK_DIV4:
+			SPSR &= ~(1 << SPI2X);
+			break;
+		case SPI_CLOCK_DIV8:
+			spcr |= (1 << SPR0);
+			SPSR |= (1 << SPI2X);
+			break;
+		case SPI_CLOCK_DIV16:
+			spcr |= (1 << SPR0);
+			SPSR &= ~(1 << SPI2X);
+			break;
+		case SPI_CLOCK_DIV32:
+			spcr |= (1 << SPR1);
+			SPSR |= (1 << SPI2X);
+			break;
+		case SPI_CLOCK_DIV64:
+			spcr |= (1 << SPR1);
+			SPSR &= ~(1 << SPI2X);
+			break;
+		case SPI_CLOCK_DIV128:
+		default:
+			spcr |= (1 << SPR1) | (1 << SPR0);
+			SPSR &= ~(1 << SPI2X);
+			break;
+	}
+	SPCR = spcr;
+}
+
+/*****************************************************************************
+ * Function Definition: startSpiTransfer(SpiTransfer * transfer)             *
+ *                                                                           *
+ * Description: Turns on slave select, and starts clocking once the select   *
+ *              delay has passed. Returns straight away.                     *
+ *                                                                           *
+ * Parameters: transfer - the transfer                                       *
+ *                                                                           *
+ * Returns: true if started, false if a transfer is already in progress      *
+ *                                                                           *
+ *****************************************************************************/
+bool startSpiTransfer(SpiTransfer * transfer)
+{
+	if(pSpiBusy || transfer->length == 0)
+	{
+		return false;
+	}
+
+	pSpiBusy = true;
+	pSpiTransfer = transfer;
+	pSpiPosition = 0;
+	transfer->received = 0;
+	if(transfer->length > transfer->rxSize)
+	{
+		transfer->length = transfer->rxSize;
+	}
+
+	bitOff(PORTB, PORTB0); // Slave select on (by turning the bit off)
+
+	// The first byte is sent from the compare match, instead of waiting here
+	OCR0B = (uint8_t)(TCNT0 + pSpiSelectDelayTicks);
+	TIFR0 = (1 << OCF0B); // clear a match from before (cleared by writing 1)
+	bitOn(TIMSK0, OCIE0B);
+
+	return true;
+}
+
+/*****************************************************************************
+ * Function Definition: isSpiBusy()                                          *
+ *                                                                           *
+ * Description: Indicates if a transfer is in progress                       *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: true if a transfer is in progress                                *
+ *                                                                           *
+ *****************************************************************************/
+bool isSpiBusy()
+{
+	return pSpiBusy;
+}
+
+/*****************************************************************************
+ * Function Definition: handleSpiSelectInterrupt()                           *
+ *                                                                           *
+ * Description: Should be called by the ISR for timer0 compare B match       *
+ *              (TIMER0_COMPB_vect). Sends the first byte.                   *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void handleSpiSelectInterrupt()
+{
+	bitOff(TIMSK0, OCIE0B); // one shot
+
+	if(pSpiBusy)
+	{
+		pSpiSendByte(pSpiTransfer, 0);
+	}
+}
+
+/*****************************************************************************
+ * Function Definition: handleSpiInterrupt()                                 *
+ *                                                                           *
+ * Description: Should be called by the ISR for SPI transfer complete        *
+ *              (SPI_STC_vect). Stores the byte received and sends the next. *
+ *              Once all of the bytes are clocked, slave select is turned    *
+ *              off and the transfer is done.                                *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void handleSpiInterrupt()
+{
+	SpiTransfer * transfer = pSpiTransfer;
+	uint8_t position = pSpiPosition;
+
+	if(!pSpiBusy)
+	{
+		return;
+	}
+
+	transfer->rx[position++] = SPDR;
+
+	// A frame that says its own length
+	if(position == transfer->headerLength && transfer->lengthCallback != 0)
+	{
+		uint8_t length = transfer->lengthCallback(transfer);
+		transfer->length = (length < position) ? position
+						 : (length > transfer->rxSize) ? transfer->rxSize : length;
+	}
+
+	if(position < transfer->length)
+	{
+		pSpiPosition = position;
+		pSpiSendByte(transfer, position);
+		return;
+	}
+
+	bitOn(PORTB, PORTB0); // Slave select off (by turning the bit on)
+	transfer->received = position;
+	pSpiBusy = false;
+
+	if(transfer->doneCallback != 0)
+	{
+		transfer->doneCallback(transfer);
+	}
+}
+
+/*****************************************************************************
+ * Function Definition: pSpiSendByte(const SpiTransfer * transfer,           *
+ *                                   uint8_t position)                       *
+ *                                                                           *
+ * Description: Loads the next byte of a transfer, which starts clocking it. *
+ *                                                                           *
+ * Parameters: transfer - the transfer                                       *
+ *             position - the byte to send                                   *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+static void pSpiSendByte(const SpiTransfer * transfer, uint8_t position)
+{
+	SPDR = (position < transfer->txLength) ? transfer->tx[position] : 0x00;
+}
@@ -0,0 +1,150 @@
+/************************************************************************
+* FILENAME: spi.h														*
+*																		*
+* DESCRIPTION: SPI Master Functions										*
+*																		*
+* LICENSE: The MIT License (MIT)										*
+*          Copyright (c) 2017 Brian Nordland       						*
+* 																		*
+* AUTHOR:  Brian Nordland												*
+*																		*
+* --------------------------------------------------------------------  *
+* | Change  | Date     |            |								  | *
+* | Flag    | (DDMYY)  | Author     | Description					  |	*
+* |---------|----------|------------|---------------------------------	*
+* | None    | 17Oct26  | BNordland  | Initial creation                | *
+*  -------------------------------------------------------------------	*
+*************************************************************************/
+
+#ifndef _spi_H_
+#define _spi_H_
+
+// integer types
+#include <stdint.h>
+
+#include "util.h" // bool
+
+/************************************************************************
+ * IMPORTANT USAGE INSTRUCTIONS:										*
+ * 	Transfers are driven by the SPI transfer complete interrupt, and	*
+ * 	the slave select setup delay by the compare B match of timer0.		*
+ * 	The application must forward both interrupts:						*
+ * 		ISR(SPI_STC_vect)     { handleSpiInterrupt(); }					*
+ * 		ISR(TIMER0_COMPB_vect) { handleSpiSelectInterrupt(); }			*
+ * 																		*
+ * 	Timer0 must be running in normal mode, and nothing may write TCNT0	*
+ * 	or OCR0B: the delay is a compare match against the count. The		*
+ * 	ultrasonic sensor in main.c reads the count, it does not reset it.	*
+ * 	Only one transfer can be in progress, and the slave select is the	*
+ * 	hardware SS pin (PB0).												*
+ ************************************************************************/
+
+/*****************************************************************************
+ * Description: The valid values for the SCK rate, as a division of the      *
+ *              CPU clock (i.e. SPI_CLOCK_DIV8 is 2MHz at 16MHz)             *
+ *                                                                           *
+ *              See: pg. 183 of the datasheet                                *
+ *                                                                           *
+ *****************************************************************************/
+typedef enum {SPI_CLOCK_DIV2, SPI_CLOCK_DIV4, SPI_CLOCK_DIV8, SPI_CLOCK_DIV16,
+			  SPI_CLOCK_DIV32, SPI_CLOCK_DIV64, SPI_CLOCK_DIV128 } SpiClockRate;
+
+/*****************************************************************************
+ * Description: A transfer. It must stay valid until it is done. Bytes past  *
+ *              txLength are sent as 0x00. The callbacks are called from the *
+ *              SPI interrupt, so they must be short.                        *
+ *                                                                           *
+ *              tx             - bytes to send                               *
+ *              txLength       - the number of bytes in tx                   *
+ *              rx             - where to place the bytes received           *
+ *              rxSize         - the size of rx, the most bytes clocked      *
+ *              length         - the number of bytes to clock                *
+ *              headerLength   - after this many bytes, lengthCallback is    *
+ *                               called (0 for none)                         *
+ *              lengthCallback - returns the number of bytes to clock, from  *
+ *                               the header received. For frames that say    *
+ *                               their own length.                           *
+ *              doneCallback   - called once slave select is off again       *
+ *              received       - the number of bytes clocked, set when done  *
+ *                                                                           *
+ *****************************************************************************/
+typedef struct SpiTransfer
+{
+	const uint8_t * tx;
+	uint8_t txLength;
+	uint8_t * rx;
+	uint8_t rxSize;
+	uint8_t length;
+	uint8_t headerLength;
+	uint8_t (*lengthCallback)(const struct SpiTransfer * transfer);
+	void (*doneCallback)(struct SpiTransfer * transfer);
+	volatile uint8_t received;
+} SpiTransfer;
+
+/*****************************************************************************
+ * Function Definition: setupSpiMaster(SpiClockRate rate,                    *
+ *                                     uint8_t selectDelayTicks)             *
+ *                                                                           *
+ * Description: Sets the SPI PINs and the SPI as master, with interrupts.    *
+ *                                                                           *
+ * Parameters: rate             - the SCK rate                               *
+ *             selectDelayTicks - timer0 ticks from slave select on to the   *
+ *                                first clock (2 to 255)                     *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void setupSpiMaster(SpiClockRate rate, uint8_t selectDelayTicks);
+
+/*****************************************************************************
+ * Function Definition: startSpiTransfer(SpiTransfer * transfer)             *
+ *                                                                           *
+ * Description: Turns on slave select, and starts clocking once the select   *
+ *              delay has passed. Returns straight away.                     *
+ *                                                                           *
+ * Parameters: transfer - the transfer                                       *
+ *                                                                           *
+ * Returns: true if started, false if a transfer is already in progress      *
+ *                                                                           *
+ *****************************************************************************/
+bool startSpiTransfer(SpiTransfer * transfer);
+
+/*****************************************************************************
+ * Function Definition: isSpiBusy()                                          *
+ *                                                                           *
+ * Description: Indicates if a transfer is in progress                       *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: true if a transfer is in progress                                *
+ *                                                                           *
+ *****************************************************************************/
+bool isSpiBusy();
+
+/*****************************************************************************
+ * Function Definition: handleSpiInterrupt()                                 *
+ *                                                                           *
+ * Description: Should be called by the ISR for SPI transfer complete        *
+ *              (SPI_STC_vect). Stores the byte received and sends the next. *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void handleSpiInterrupt();
+
+/*****************************************************************************
+ * Function Definition: handleSpiSelectInterrupt()                           *
+ *                                                                           *
+ * Description: Should be called by the ISR for timer0 compare B match       *
+ *              (TIMER0_COMPB_vect). Sends the first byte.                   *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ *****************************************************************************/
+void handleSpiSelectInterrupt();
+
+#endif /* _spi_H_ */
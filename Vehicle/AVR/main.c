@@ -25,6 +25,14 @@
 * |---------|----------|------------|---------------------------------  *
 * | None    | 18Apr17  | BNordland  | Initial creation                | *
 * | @01     | 30Apr17  | BNordland  | Adding ultrasonic sensor        | *
+* | @02     | 17Oct26  | BNordland  | Forward the raw IMU stream      | *
+* | @03     | 17Oct26  | BNordland  | Framed, CRC checked SPI link    | *
+* | @04     | 17Oct26  | BNordland  | Read BLE board on data ready    | *
+* | @05     | 17Oct26  | BNordland  | Interrupt driven SPI transfers  | *
+* | @06     | 17Oct26  | BNordland  | Fixed rate task scheduler       | *
+* | @07     | 17Oct26  | BNordland  | Time out on the publish count   | *
+* | @08     | 17Oct26  | BNordland  | Run control on new glove values | *
+* | @09     | 17Oct26  | BNordland  | Sonar leaves timer0 running     | *
 *  -------------------------------------------------------------------  *
 *************************************************************************/
 
@@ -42,10 +50,15 @@
 #include "lib/timer.h" // Timer utilities
 #include "lib/kill.h" // kill board
 #include "lib/motor.h" // motor utilities
+#include "lib/spi.h" // @05a interrupt driven SPI master
+#include "lib/scheduler.h" // @06a fixed rate task scheduler
 
 // Hardware Definitions
 #include "hardware.h"
 
+// @03a The frames of the SPI link, shared with the BLE board
+#include "Link_Frame.h"
+
 // Standard Includes
 #include <stdint.h> // integer types
 #include <string.h>
@@ -73,14 +86,54 @@
 #define ULTRASONIC_INSTR_PER_US     (ULTRASONIC_INSTR_PER_MS / 1000)
 #define ULTRASONIC_MAX_TICKS        (uint32_t)ULTRASONIC_MAX_RSP_TIME_MS * ULTRASONIC_INSTR_PER_MS
 
+// @03a SPI link. If the publish count of the command frames has not
+// changed for this long, the glove is treated as lost and the throttle is
+// cut. @07c A time rather than a count of transfers, as the BLE board arms
+// a new frame after every transfer. The glove sends at least once every
+// SERVICE_RATE_KEEPALIVE_MS (1s), plus a few connection intervals.
+#define LINK_STALE_MS       1500
+
+// @04a The BLE board raises its data ready line when it has a new frame,
+// and the frame is read straight away. If it has not for this long, it is
+// read anyway, so that a board that has stopped is noticed. @06c
+#define LINK_POLL_MS        100
+
+// @06a The tasks, in the order they go in when due together. @08c The
+// control task also runs as soon as new glove values are in, so it is not
+// a fixed rate and delays are timed rather than counted in its runs.
+#define TASK_LINK           0   // Reads the BLE board, on events and at 10Hz
+#define TASK_CONTROL        1   // Computes and sets the motor duty, on new values and at 100Hz
+#define TASK_SONAR          2   // Reads and triggers the ultrasonic sensor, 20Hz
+#define TASK_TELEMETRY      3   // Sends the task statistics over USB, 1Hz
+#define TASK_COUNT          4
+#define EVENT_LINK          (1 << 0) // Data ready was raised, or a transfer finished
+#define EVENT_COMMAND       (1 << 1) // @08a A new, good command frame was decoded
+
+// @08a How long to stop for before changing the direction of travel
+#define DIRECTION_CHANGE_MS 250
+
+// @05a SPI link timing. The nRF51 SPI slave takes at most 2MHz, and needs
+// 7us from slave select to the first clock; timer0 counts at F_CPU.
+#define LINK_SPI_RATE           SPI_CLOCK_DIV8
+#define LINK_SELECT_DELAY_TICKS (10 * (F_CPU / 1000000)) // 10us
+
 // Internal function definitions
 void pSetup();
 void pStartupFlashLEDs();
-void pRetrieveGloveValues();
+bool pRetrieveGloveValues(uint16_t distance); // @05c starts the transfer
+void pHandleGloveFrame(); // @05a decodes the frame of the last transfer
 void pCalculateDuty();
 bool pIsDirectionChanging();
-uint8_t pSpiTransmit(uint8_t data);
+uint8_t pLinkFrameLength(const SpiTransfer * transfer); // @05a bytes to clock, from the header
+void pLinkTransferDone(SpiTransfer * transfer); // @05a called from the SPI interrupt
 void pTriggerSonar(); // @01a start the ultrasonic detection
+void pForwardStream(); // @02a send the stream frames out over USB
+bool pServiceLink(uint32_t distance, bool poll); // @04a read the BLE board and forward its stream
+void pLinkTask(); // @06a
+void pControlTask(); // @06a
+void pSonarTask(); // @06a
+uint32_t pSonarTicks(); // @09a timer0 ticks since the echo rose
+void pTelemetryTask(); // @06a
 
 // Global Variables
 volatile int16_t    mAnglePitch; // Typically between -90 and 90
@@ -90,13 +143,51 @@ volatile int16_t    mLeftMotorDuty; // computed duty cycle of the drivers side m
 volatile int16_t    mRightMotorDuty; // computed duty cycle of the passenger side motor
 
 volatile bool       mPreviousDirection; // the direction we were going last time
-volatile uint16_t   mDirectionChangeCount; // how long we have been waiting for a direction change
+volatile bool       mDirectionChangeWaiting; // @08c we are waiting for a direction change
+volatile uint32_t   mDirectionChangeStartUs; // @08c when we started waiting
 
 // Global Variables for ultrasonic @01a
 volatile uint8_t    mUltrasonicState;
 volatile uint32_t   mUltrasonicTimerOverflowCount;
+volatile uint8_t    mUltrasonicStartTicks; // @09a timer0 count when the echo rose
 volatile float      mUltrasonicResult;
 
+// Global Variables for the raw IMU stream @02a
+uint8_t             mStreamCount; // Frames read in the last SPI transfer
+uint8_t             mStreamDropped; // Frames the BLE board dropped (wraps)
+uint8_t             mStreamDroppedSent; // The dropped count last sent over USB
+uint8_t             mStreamFrames[LINK_STREAM_MAX_FRAMES][LINK_STREAM_FRAME_LEN]; // @03c
+
+// Global Variables for the SPI link @03a
+uint8_t             mLinkTxBuffer[LINK_FRAME_MAX_LEN]; // Telemetry frame sent
+uint8_t             mLinkRxBuffer[LINK_FRAME_MAX_LEN]; // Command frame received
+uint8_t             mLinkTxSequence; // Sequence number of the next telemetry frame
+uint8_t             mLinkLastSequence; // Sequence number of the last good command frame
+uint8_t             mLinkErrors; // Command frames rejected (wraps)
+uint8_t             mLinkPublished; // @07a Publish count of the last good command frame
+uint32_t            mLinkPublishedUs; // @07a When the publish count last changed
+bool                mLinkFresh; // @07a The publish count changed less than LINK_STALE_MS ago
+int16_t             mLinkAnglePitch; // The glove values of the last good command frame.
+bool                mLinkDirection; // They are copied every control run, as pCalculateDuty
+uint8_t             mLinkThrottle;  // changes the working values in place.
+volatile bool       mLinkDataReady; // @04a The BLE board raised data ready
+SpiTransfer         mLinkTransfer; // @05a The transfer of the frames
+volatile bool       mLinkTransferDone; // @05a A transfer finished, its frame is not decoded yet
+uint32_t            mLinkStartUs; // @06a When the last transfer started
+
+// @01a Distance to the nearest obstacle ahead in cm, start off assuming we
+// are going to hit something. @06c Global, the sonar task sets it.
+uint32_t            mCollisionDistanceFront = 0;
+
+// @06a The tasks, see TASK_...
+SchedulerTask       mTasks[TASK_COUNT] =
+{
+    { pLinkTask,      LINK_POLL_MS, EVENT_LINK },
+    { pControlTask,   10,           EVENT_COMMAND }, // @08c
+    { pSonarTask,     50,           0 },
+    { pTelemetryTask, 1000,         0 }
+};
+
 
 int main(void)
 {
@@ -106,9 +197,6 @@ int main(void)
 
     sei(); //Enables interrupts
 
-    uint8_t    ultrasonicDelayCount = 0; // @01a used to delay ultrasonic readings
-    uint32_t    collisionDistanceFront = 0; // @01a start off assuming we are going to hit something
-
     // Have the motors figure out which direction
     // is considered forward by calibrating them.
     calibrateMotor1();
@@ -121,74 +209,148 @@ int main(void)
 
     mPreviousDirection = mVehicleDirection; // set our direction to be whatever it may be (by default 0 for backward)
 
-    while(1)
+    // @06c The work is done by the tasks, at fixed rates, and the
+    // board sleeps between them.
+    setupScheduler(mTasks, TASK_COUNT, F_CPU);
+    runScheduler();
+
+    return 0;
+}
+
+/*****************************************************************************
+ *                                                                      @06a *
+ *                                                                           *
+ * Description: Link task. Runs when the BLE board raises data ready, when a *
+ *              transfer finishes, and at 10Hz; the BLE board is polled if   *
+ *              it has not been read for LINK_POLL_MS.                       *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void pLinkTask()
+{
+    uint32_t now = getSchedulerTimeUs();
+    bool poll = (now - mLinkStartUs) >= ((uint32_t)LINK_POLL_MS * 1000);
+
+    if(pServiceLink(mCollisionDistanceFront, poll))
+    {
+        mLinkStartUs = now;
+    }
+}
+
+/*****************************************************************************
+ *                                                                      @06a *
+ *                                                                           *
+ * Description: Control task. Computes the motor duty cycles from the last   *
+ *              good glove values, stops for obstacles ahead, and sets the   *
+ *              motors. @08c Runs as soon as a new command frame is decoded, *
+ *              and at least every 10ms.                                     *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void pControlTask()
+{
+    // @04a pCalculateDuty changes these in place, so they are set from
+    // the last good glove values every run.
+    mAnglePitch = mLinkAnglePitch;
+    mVehicleDirection = mLinkDirection;
+    mThrottle = mLinkThrottle;
+    pCalculateDuty();
+
+    // @01a If we are closer than 15cm, let's stop
+    if(mVehicleDirection && mCollisionDistanceFront < 15)
     {
-        pRetrieveGloveValues();
-        pCalculateDuty();
+        mLeftMotorDuty = 0;
+        mRightMotorDuty = 0;
+        yellow(1); // indicate close collision with yellow LED
+    }
+    else
+    {
+        yellow(0); // Not close to hitting anything, or we are going backwards
+    }
 
-        // Start @01a - Check for collisions
-        if(mUltrasonicState == ULTRASONIC_STATE_OFF)
+    // If we are not currently changing the direction
+    // of travel, then update our duty cycle.
+    if(!pIsDirectionChanging())
+    {
+        if(mVehicleDirection)
         {
-            // If the ultrasonic sensor is off,
-            // check to see if it has been long enough since
-            // the last reading, and try again.
-            if(ultrasonicDelayCount >= 5)
-            {
-                ultrasonicDelayCount = 0;
-                pTriggerSonar();
-            }
-            else
-            {
-                ultrasonicDelayCount++;
-            }
+            setMotor1DutyCycle((uint8_t)mLeftMotorDuty);
+            setMotor2DutyCycle((uint8_t)mRightMotorDuty);
         }
-        else if(mUltrasonicState == ULTRASONIC_STATE_AVAILABLE)
+        else
         {
-            mUltrasonicState = ULTRASONIC_STATE_OFF;
-            if(mUltrasonicResult != -1)
-            {
-                collisionDistanceFront = mUltrasonicResult;
-            }
-            else
-            {
-                collisionDistanceFront = 1000; // assume big, we didn't get a response
-            }
+
+            // Ironically we flip the duty cycles here.
+            // This is to make it so that when going backwards the direction
+            // we head is intuitive to the tilt of the hand.
+            setMotor1DutyCycle((uint8_t)mLeftMotorDuty);
+            setMotor2DutyCycle((uint8_t)mRightMotorDuty);
         }
+    }
+}
 
-        // If we are closer than 15cm, let's stop
-        if(mVehicleDirection && collisionDistanceFront < 15)
+/*****************************************************************************
+ *                                                                      @06a *
+ *                                                                           *
+ * Description: Sonar task, 20Hz. Takes the last ultrasonic reading, if one  *
+ *              is available, and triggers the next once the sensor is off.  *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void pSonarTask()
+{
+    if(mUltrasonicState == ULTRASONIC_STATE_AVAILABLE)
+    {
+        mUltrasonicState = ULTRASONIC_STATE_OFF;
+        if(mUltrasonicResult != -1)
         {
-            mLeftMotorDuty = 0;
-            mRightMotorDuty = 0;
-            yellow(1); // indicate close collision with yellow LED
+            mCollisionDistanceFront = mUltrasonicResult;
         }
         else
         {
-            yellow(0); // Not close to hitting anything, or we are going backwards
+            mCollisionDistanceFront = 1000; // assume big, we didn't get a response
         }
-        // end @01a
+    }
 
-        // If we are not currently changing the direction
-        // of travel, then update our duty cycle.
-        if(!pIsDirectionChanging())
-        {
-            if(mVehicleDirection)
-            {
-                setMotor1DutyCycle((uint8_t)mLeftMotorDuty);
-                setMotor2DutyCycle((uint8_t)mRightMotorDuty);
-            }
-            else
-            {
+    if(mUltrasonicState == ULTRASONIC_STATE_OFF)
+    {
+        pTriggerSonar();
+    }
+}
 
-                // Ironically we flip the duty cycles here.
-                // This is to make it so that when going backwards the direction
-                // we head is intuitive to the tilt of the hand.
-                setMotor1DutyCycle((uint8_t)mLeftMotorDuty);
-                setMotor2DutyCycle((uint8_t)mRightMotorDuty);
-            }
-        }
+/*****************************************************************************
+ *                                                                      @06a *
+ *                                                                           *
+ * Description: Telemetry task, 1Hz. Sends the statistics of each task over  *
+ *              USB, one line per task, then starts a new window:            *
+ *                  T<task> <runs> <average us> <max us> <overruns>          *
+ *              The link telemetry goes to the BLE board in its frames.      *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void pTelemetryTask()
+{
+    uint8_t i;
 
-        _delay_ms(10);
+    for(i = 0; i < TASK_COUNT; i++)
+    {
+        SchedulerTask * task = &mTasks[i];
+        printf("T%u %u %lu %u %u\n", i, task->runs,
+               (task->runs != 0) ? (unsigned long)(task->totalTimeUs / task->runs) : 0UL,
+               task->maxTimeUs, task->overruns);
+        clearSchedulerStats(task);
     }
 }
 
@@ -256,11 +418,13 @@ void pCalculateDuty()
 
 bool pIsDirectionChanging()
 {
+    uint32_t now = getSchedulerTimeUs(); // @08a
+
     if(mPreviousDirection != mVehicleDirection)
     {
         // If the direction changed, put in a delay
-        // of 25 times our normal setting of the duty
-        // cycle. This makes us favor the previous direction
+        // of DIRECTION_CHANGE_MS (@08c was 25 runs of the
+        // control task). This makes us favor the previous direction
         // for times when we are flipping right on the edge
         // and helps prevent such rapid changes in direction.
 
@@ -269,7 +433,12 @@ bool pIsDirectionChanging()
         setMotor2DutyCycle(0);
 
         // Determine if we should change the direction
-        if(mDirectionChangeCount > 25)
+        if(!mDirectionChangeWaiting)
+        {
+            mDirectionChangeWaiting = true;
+            mDirectionChangeStartUs = now;
+        }
+        else if((now - mDirectionChangeStartUs) >= ((uint32_t)DIRECTION_CHANGE_MS * 1000))
         {
             if(mVehicleDirection)
             {
@@ -283,49 +452,238 @@ bool pIsDirectionChanging()
                 setMotor1Backward();
                 setMotor2Backward();
             }
-            mDirectionChangeCount = 0;
+            mDirectionChangeWaiting = false;
             mPreviousDirection = mVehicleDirection; // update our previous direction
         }
-        else
-        {
-            mDirectionChangeCount += 1;
-        }
     }
     else
     {
-        // Directions do equal, set out change count back to 0
-        mDirectionChangeCount = 0;
+        // Directions do equal, stop waiting
+        mDirectionChangeWaiting = false;
     }
 
     // If the direction is changing, let's return true
     return (mPreviousDirection != mVehicleDirection);
 }
 
-void pRetrieveGloveValues()
+/*****************************************************************************
+ *                                                                      @05c *
+ *                                                                           *
+ * Description: Starts exchanging frames with the BLE board: a telemetry     *
+ *              frame goes out while the command frame comes in. The header  *
+ *              comes first so that only as many bytes as the longer frame   *
+ *              are clocked (see pLinkFrameLength). The transfer runs from   *
+ *              the SPI interrupt; pHandleGloveFrame decodes its frame.      *
+ *                                                                           *
+ * Returns: true if the transfer started, false if one is in progress        *
+ *                                                                           *
+ * Parameters: distance - Distance to the nearest obstacle ahead in cm       *
+ *                                                                           *
+ *****************************************************************************/
+bool pRetrieveGloveValues(uint16_t distance)
 {
-    bitOff(PORTB, PORTB0); // Slave select on (by turning the bit off)
-    _delay_ms(1); // The BLE Nano requires a 7us delay after turning on slave select.
-    // Note, since the transmit data is ignored in our implementation
-    // we simply transmit 0x00.
-    uint8_t anglePitchByteHigh = pSpiTransmit(0x00);
-    uint8_t anglePitchByteLow = pSpiTransmit(0x00);
-    mAnglePitch = ((int16_t)(anglePitchByteHigh << 8)) | anglePitchByteLow;
-
-    mVehicleDirection = pSpiTransmit(0x00);
-    mThrottle = pSpiTransmit(0x00);
-    bitOn(PORTB, PORTB0); // Slave select off (by turning the bit on)
+    uint8_t telemetry[LINK_TELEMETRY_LEN];
+
+    if(isSpiBusy())
+    {
+        return false;
+    }
+
+    telemetry[LINK_TELEMETRY_ACK] = mLinkLastSequence;
+    telemetry[LINK_TELEMETRY_ERRORS] = mLinkErrors;
+    telemetry[LINK_TELEMETRY_LEFT_DUTY] = (uint8_t)mLeftMotorDuty;
+    telemetry[LINK_TELEMETRY_RIGHT_DUTY] = (uint8_t)mRightMotorDuty;
+    Link_Frame_PutUInt16(&telemetry[LINK_TELEMETRY_DISTANCE], distance);
+
+    mLinkTransfer.tx = mLinkTxBuffer;
+    mLinkTransfer.txLength = Link_Frame_Encode(mLinkTxBuffer, LINK_FRAME_TYPE_TELEMETRY, mLinkTxSequence++,
+                                               telemetry, LINK_TELEMETRY_LEN);
+    mLinkTransfer.rx = mLinkRxBuffer;
+    mLinkTransfer.rxSize = sizeof(mLinkRxBuffer);
+    mLinkTransfer.length = LINK_FRAME_HEADER_LEN;
+    mLinkTransfer.headerLength = LINK_FRAME_HEADER_LEN;
+    mLinkTransfer.lengthCallback = pLinkFrameLength;
+    mLinkTransfer.doneCallback = pLinkTransferDone;
+
+    return startSpiTransfer(&mLinkTransfer);
 }
 
-uint8_t pSpiTransmit(uint8_t data)
+/*****************************************************************************
+ *                                                                      @05a *
+ *                                                                           *
+ * Description: The number of bytes to clock, once the header of the command *
+ *              frame is in: the longer of the two frames. If the header is  *
+ *              not valid, the rest of the telemetry frame still goes out,   *
+ *              and the command frame is rejected when it is decoded.        *
+ *                                                                           *
+ *              Note: Called from the SPI interrupt.                         *
+ *                                                                           *
+ * Returns: The number of bytes to clock                                     *
+ *                                                                           *
+ * Parameters: transfer - the transfer                                       *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t pLinkFrameLength(const SpiTransfer * transfer)
+{
+    uint8_t rxLength = Link_Frame_Length(transfer->rx);
+    return (rxLength > transfer->txLength) ? rxLength : transfer->txLength;
+}
+
+/*****************************************************************************
+ *                                                                      @05a *
+ *                                                                           *
+ * Description: Marks the transfer as done. The frame is decoded from the    *
+ *              main loop, as checking its CRC is too long for an interrupt. *
+ *                                                                           *
+ *              Note: Called from the SPI interrupt.                         *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: transfer - the transfer                                       *
+ *                                                                           *
+ *****************************************************************************/
+void pLinkTransferDone(SpiTransfer * transfer)
+{
+    mLinkTransferDone = true;
+    postSchedulerEvent(EVENT_LINK); // @06a
+}
+
+/*****************************************************************************
+ *                                                                      @05a *
+ *                                                                           *
+ * Description: Decodes the command frame of the last transfer. A frame that *
+ *              fails its checks is counted and the last good values are     *
+ *              kept; if the BLE board has not published anything new for    *
+ *              LINK_STALE_MS, the throttle is cut.                     @07c *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void pHandleGloveFrame()
+{
+    Link_Frame_t frame;
+    uint32_t now = getSchedulerTimeUs(); // @07a
+
+    mStreamCount = 0;
+    if(Link_Frame_Decode(mLinkRxBuffer, mLinkTransfer.received, LINK_FRAME_TYPE_COMMAND, &frame) != Link_Frame_OK
+        || frame.length < LINK_COMMAND_STREAM
+        || frame.payload[LINK_COMMAND_STREAM_COUNT] > LINK_STREAM_MAX_FRAMES
+        || frame.length < LINK_COMMAND_STREAM + (frame.payload[LINK_COMMAND_STREAM_COUNT] * LINK_STREAM_FRAME_LEN))
+    {
+        mLinkErrors++;
+    }
+    else if(frame.sequence != mLinkLastSequence) // @07c not a frame read twice
+    {
+        mLinkLastSequence = frame.sequence;
+
+        // @07a The glove sent something since the last frame
+        if(frame.payload[LINK_COMMAND_PUBLISHED] != mLinkPublished)
+        {
+            mLinkPublished = frame.payload[LINK_COMMAND_PUBLISHED];
+            mLinkPublishedUs = now;
+            mLinkFresh = true;
+        }
+
+        mLinkAnglePitch = (int16_t)Link_Frame_GetUInt16(&frame.payload[LINK_COMMAND_PITCH]);
+        mLinkDirection = frame.payload[LINK_COMMAND_DIRECTION];
+        mLinkThrottle = frame.payload[LINK_COMMAND_THROTTLE];
+        postSchedulerEvent(EVENT_COMMAND); // @08a Act on it straight away
+
+        // @02a The stream frames. The BLE board only takes them off its queue
+        // once the whole command frame has been clocked out.
+        mStreamCount = frame.payload[LINK_COMMAND_STREAM_COUNT];
+        mStreamDropped = frame.payload[LINK_COMMAND_STREAM_DROPPED];
+        memcpy(mStreamFrames, &frame.payload[LINK_COMMAND_STREAM], mStreamCount * LINK_STREAM_FRAME_LEN);
+    }
+
+    // @07c Once stale, only a new publish clears it, so the time wrapping
+    // can't bring the throttle back.
+    if((now - mLinkPublishedUs) >= ((uint32_t)LINK_STALE_MS * 1000))
+    {
+        mLinkFresh = false;
+    }
+    if(!mLinkFresh)
+    {
+        mLinkThrottle = 0;
+    }
+}
+
+/*****************************************************************************
+ *                                                                      @04a *
+ *                                                                           *
+ * Description: Decodes the frame of a finished transfer and forwards its    *
+ *              stream frames over USB. Then, if the BLE board raised data   *
+ *              ready, or a poll is asked for, starts the next transfer.     *
+ *              Data ready is cleared first, so a frame the BLE board arms   *
+ *              during the transfer is not missed.                      @05c *
+ *                                                                           *
+ * Returns: true if a transfer was started                                   *
+ *                                                                           *
+ * Parameters: distance - Distance to the nearest obstacle ahead in cm       *
+ *             poll     - start a transfer without data ready                *
+ *                                                                           *
+ *****************************************************************************/
+bool pServiceLink(uint32_t distance, bool poll)
+{
+    if(mLinkTransferDone)
+    {
+        mLinkTransferDone = false;
+        pHandleGloveFrame();
+        pForwardStream(); // @02a
+    }
+
+    if(!(mLinkDataReady || poll) || isSpiBusy())
+    {
+        return false;
+    }
+
+    mLinkDataReady = false;
+    return pRetrieveGloveValues((distance > UINT16_MAX) ? UINT16_MAX : (uint16_t)distance);
+}
+
+/*****************************************************************************
+ *                                                                      @02a *
+ *                                                                           *
+ * Description: Sends the stream frames of the last SPI transfer out over    *
+ *              USB for capture, one line per frame: 'S' and the 20 bytes in *
+ *              hex. When the BLE board has dropped frames, a line with 'D'  *
+ *              and its dropped count (hex) comes first.                     *
+ *                                                                           *
+ *              Performance Note: hex is written a character at a time, as   *
+ *                                printf is too slow for ~150 frames/s.      *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+void pForwardStream()
 {
-    // Load data into the buffer
-    SPDR = data;
+    static const char hex[] = "0123456789ABCDEF";
+    uint8_t i, j;
 
-    //Wait until transmission complete
-    while(!(SPSR & (1<<SPIF) ));
+    if(mStreamDropped != mStreamDroppedSent)
+    {
+        mStreamDroppedSent = mStreamDropped;
+        putchar('D');
+        putchar(hex[mStreamDropped >> 4]);
+        putchar(hex[mStreamDropped & 0x0F]);
+        putchar('\n');
+    }
 
-    // Return received data
-    return(SPDR);
+    for(i = 0; i < mStreamCount; i++)
+    {
+        putchar('S');
+        for(j = 0; j < LINK_STREAM_FRAME_LEN; j++) // @03c
+        {
+            putchar(hex[mStreamFrames[i][j] >> 4]);
+            putchar(hex[mStreamFrames[i][j] & 0x0F]);
+        }
+        putchar('\n');
+    }
+    mStreamCount = 0;
 }
 
 /*****************************************************************************
@@ -377,6 +735,30 @@ ISR(INT3_vect)
     handleMotor2Interrupt();
 }
 
+// @04a The BLE board has a new frame
+ISR(INT2_vect)
+{
+    mLinkDataReady = true;
+    postSchedulerEvent(EVENT_LINK); // @06a
+}
+
+// @05a The SPI link, see lib/spi.h
+ISR(SPI_STC_vect)
+{
+    handleSpiInterrupt();
+}
+
+ISR(TIMER0_COMPB_vect)
+{
+    handleSpiSelectInterrupt();
+}
+
+// @06a The scheduler tick, see lib/scheduler.h
+ISR(TIMER3_COMPA_vect)
+{
+    handleSchedulerInterrupt();
+}
+
 /*****************************************************************************
  *                                                                      @01a *
  *                                                                           *
@@ -398,8 +780,7 @@ ISR(TIMER0_OVF_vect)
             mUltrasonicTimerOverflowCount++;
 
             // check to see if we have gone over maximum response time
-            uint32_t ticks = (mUltrasonicTimerOverflowCount * 256) + TCNT0;
-            if (ticks > ULTRASONIC_MAX_TICKS)
+            if (pSonarTicks() > ULTRASONIC_MAX_TICKS) // @09c
             {
                 // timeout in distance measurement
                 mUltrasonicState = ULTRASONIC_STATE_AVAILABLE; // set to off, as no distance is available.
@@ -430,19 +811,51 @@ ISR(INT0_vect)
         // voltage rise, we can start the measurement
         mUltrasonicState = ULTRASONIC_STATE_MEASURING;
 
-        // reset counts
+        // reset counts @09c - timer0 is not reset, the SPI slave select
+        // delay is a compare match on it (see lib/spi.h). Measure from here.
         mUltrasonicTimerOverflowCount = 0;
-        TCNT0 = 0;
+        mUltrasonicStartTicks = TCNT0;
+        if((TIFR0 & (1 << TOV0)) && mUltrasonicStartTicks < 128)
+        {
+            // the overflow pending is from before the rise, don't count it
+            TIFR0 = (1 << TOV0); // cleared by writing 1
+        }
     }
     else if(mUltrasonicState == ULTRASONIC_STATE_MEASURING)
     {
         // voltage drop, stop the measurement
         mUltrasonicState = ULTRASONIC_STATE_AVAILABLE;
 
-        mUltrasonicResult = (mUltrasonicTimerOverflowCount * 256 + TCNT0)/58.0/ULTRASONIC_INSTR_PER_US;
+        mUltrasonicResult = pSonarTicks()/58.0/ULTRASONIC_INSTR_PER_US; // @09c
     }
 }
 
+/*****************************************************************************
+ *                                                                      @09a *
+ *                                                                           *
+ * Description: The timer0 ticks since the echo line rose, from the count    *
+ *              and the overflows since then. Called from the ultrasonic     *
+ *              interrupts, so an overflow can be pending and not yet        *
+ *              counted: a low count with TOV0 set means the timer has       *
+ *              wrapped since.                                               *
+ *                                                                           *
+ * Returns: The ticks since the echo line rose                               *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+uint32_t pSonarTicks()
+{
+    uint8_t count = TCNT0;
+    uint32_t overflows = mUltrasonicTimerOverflowCount;
+
+    if((TIFR0 & (1 << TOV0)) && count < 128)
+    {
+        overflows++;
+    }
+    return (overflows * 256) + count - mUltrasonicStartTicks;
+}
+
 void pSetup()
 {
     // This prevents the need to reset after flashing
@@ -456,11 +869,8 @@ void pSetup()
     setDDR(EXT_BLE_DDR,EXT_BLE_DDRBIT,DDR_OUTPUT);
     bitOn(EXT_BLE_PORT,EXT_BLE_PORTBIT);
 
-    // Setup SPI
-    // Set MOSI, SCK as Output
-    DDRB=(1<<DDB1)|(1<<DDB2)|(1<<DDB0); // TODO: make this nicer
-    SPCR=(1<<SPE)|(1<<MSTR)|(1<<SPR0);
-    bitOn(PORTB, PORTB0); // Turn off slave select (which is done by holding high)
+    // Setup SPI @05c - interrupt driven, slave select delay from timer0
+    setupSpiMaster(LINK_SPI_RATE, LINK_SELECT_DELAY_TICKS);
 
     setupMotor1(); // This sets up the motor 1
     setupMotor2(); // This sets up the motor 2
@@ -482,6 +892,12 @@ void pSetup()
     bitOn(EIMSK, INT1);
     bitOn(EIMSK, INT3);
 
+    // @04a Data ready line of the BLE board, interrupt on INT2 rising edge (mode: 1,1)
+    setDDR(EXT_BLE_READY_DDR, EXT_BLE_READY_DDRBIT, DDR_INPUT);
+    bitOn(EICRA, ISC20);
+    bitOn(EICRA, ISC21);
+    bitOn(EIMSK, EXT_BLE_READY_INT);
+
     // start @01a - setup ultrasonic sensor
     // TODO: we should move to hardware.h for sonar
     setDDR(DDRE,DDE6, DDR_OUTPUT); // trigger (transmit)
@@ -499,7 +915,8 @@ void pSetup()
     bitOn(EIMSK, INT0);
 
     // Enable timer0
-    // Timer 0 - used for distance
+    // Timer 0 - used for distance, and the SPI slave select delay @09c
+    //           Free running: nothing may write TCNT0
     TimerWGM timer0Mode;
     timer0Mode.value = 0;
     setTimer0WGMMode(timer0Mode);
@@ -0,0 +1,488 @@
+/*****************************************************************************
+* FILENAME: Test_Spi.c                                                       *
+*                                                                            *
+* DESCRIPTION: Host test of the interrupt driven SPI master, see lib/spi.h,  *
+*              with the link frames of main.c. The SPI and timer0 hardware   *
+*              is modelled in CPU cycles: the compare B match fires when the *
+*              count reaches OCR0B, and a byte written to SPDR is clocked at *
+*              the SCK rate set in SPCR and SPSR, then the transfer complete *
+*              interrupt is called.                                          *
+*                                                                            *
+*              The same frames are also clocked the way main.c did before    *
+*              @05, polled, so the CPU time of both can be put side by side. *
+*              Each interrupt is charged the cycles of its code, counted by  *
+*              hand, see ISR_ENTRY_CYCLES; the next byte starts when the     *
+*              interrupt writes SPDR, so a slow interrupt also slows the bus.*
+*              Built and run with "make test" in this directory.             *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "spi.h"
+#include "Link_Frame.h"
+#include "Test_Check.h"
+
+// As in main.c
+#define F_CPU                   16000000UL
+#define CYCLES_PER_US           (F_CPU / 1000000)
+#define LINK_SPI_RATE           SPI_CLOCK_DIV8
+#define LINK_SELECT_DELAY_TICKS (10 * CYCLES_PER_US)
+
+// The BLE Nano requires 7us from slave select on to the first clock
+#define SELECT_SETUP_CYCLES     (7 * CYCLES_PER_US)
+
+// main.c before @05: _delay_us(10) after slave select, SCK at F_CPU / 16,
+// and each byte polled for SPIF
+#define POLLED_SELECT_DELAY_US  10
+#define POLLED_SPI_DIVISOR      16
+#define POLLED_BYTE_CYCLES      21      // Past the clocking: the call of
+                                        // pSpiTransmit, the exit of the SPIF
+                                        // loop, and storing the byte
+
+// The CPU cycles of the interrupt path. No AVR compiler is at hand to
+// disassemble it, so they are counted by hand, from the AVR Instruction Set
+// Manual timings, for the code avr-gcc -Os makes of lib/spi.c and the ISRs of
+// main.c. An ISR that calls a function saves r0, r1, SREG and the 12
+// call-used registers, whatever the function uses.
+#define ISR_ENTRY_CYCLES        7       // Response 4, jmp of the vector 3
+#define ISR_PROLOGUE_CYCLES     32      // 15 pushes, in SREG, clr r1
+#define ISR_CALL_CYCLES         4       // call of the handler
+#define ISR_RETURN_CYCLES       39      // ret 4, 15 pops and out SREG 31, reti 4
+#define ISR_OVERHEAD_CYCLES     (ISR_ENTRY_CYCLES + ISR_PROLOGUE_CYCLES \
+                                 + ISR_CALL_CYCLES + ISR_RETURN_CYCLES)
+#define SELECT_TO_WRITE_CYCLES  25      // handleSpiSelectInterrupt, to SPDR
+#define BYTE_TO_WRITE_CYCLES    52      // handleSpiInterrupt, to SPDR
+#define BYTE_AFTER_WRITE_CYCLES 10      // and after it
+#define HEADER_CYCLES           65      // The length callback, on the header
+#define LAST_BYTE_CYCLES        93      // The last byte, with the done callback
+#define START_CYCLES            50      // startSpiTransfer, from the main loop
+#define ISR_TO_WRITE_CYCLES     (ISR_ENTRY_CYCLES + ISR_PROLOGUE_CYCLES + ISR_CALL_CYCLES)
+
+// From the compare B match to the first byte starting
+#define SELECT_WRITE_CYCLES     (ISR_TO_WRITE_CYCLES + SELECT_TO_WRITE_CYCLES)
+
+// The fake registers, see fake/avr/io.h
+volatile uint8_t                DDRB;
+volatile uint8_t                PORTB;
+volatile uint8_t                SPCR;
+volatile uint8_t                SPSR;
+volatile uint16_t               SPDR;
+volatile uint8_t                TCNT0;
+volatile uint8_t                OCR0B;
+volatile uint8_t                TIFR0;
+volatile uint8_t                TIMSK0;
+
+// The model of the hardware and of the BLE board
+static uint32_t                 mCycles;            // CPU cycles since the start
+static uint32_t                 mSelectOnCycle;     // When slave select went on
+static uint32_t                 mSelectCycles;      // Slave select on to the first clock
+static uint8_t                  mSlave[LINK_FRAME_MAX_LEN];   // Bytes the BLE board sends
+static uint8_t                  mSlaveLength;
+static uint8_t                  mMaster[LINK_FRAME_MAX_LEN];  // Bytes the BLE board got
+static uint8_t                  mClocked;           // Bytes clocked
+static uint8_t                  mClockedDeselected; // Bytes clocked with slave select off
+static uint16_t                 mInterrupts;        // SPI and compare B interrupts
+static uint32_t                 mInterruptCycles;   // CPU cycles in them
+static uint32_t                 mLongestInterrupt;  // The most cycles of one
+static uint32_t                 mWriteCycle;        // When SPDR was last written
+
+// The link, as in main.c
+static SpiTransfer              mTransfer;
+static uint8_t                  mTxBuffer[LINK_FRAME_MAX_LEN];
+static uint8_t                  mRxBuffer[LINK_FRAME_MAX_LEN];
+static uint8_t                  mDoneCalls;
+static bool                     mDoneDeselected;    // Slave select was off in the callback
+
+/*****************************************************************************
+ ****************Start of Fake Implementations *******************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Lets time pass, with timer0 counting at F_CPU.               *
+ *                                                                           *
+ *****************************************************************************/
+static void pAdvance(uint32_t cycles)
+{
+    mCycles += cycles;
+    TCNT0 = (uint8_t)mCycles;
+}
+
+/*****************************************************************************
+ * Description: The CPU cycles per SCK, from SPCR and SPSR.                  *
+ *                                                                           *
+ *              See: pg. 183 of the datasheet                                *
+ *                                                                           *
+ *****************************************************************************/
+static uint32_t pSpiDivisor()
+{
+    static const uint32_t divisors[] = {4, 16, 64, 128};
+    uint32_t divisor = divisors[SPCR & ((1 << SPR1) | (1 << SPR0))];
+
+    return (SPSR & (1 << SPI2X)) ? (divisor / 2) : divisor;
+}
+
+/*****************************************************************************
+ * Description: Exchanges a byte with the BLE board, once it is clocked.     *
+ *                                                                           *
+ *****************************************************************************/
+static uint8_t pExchangeByte(uint8_t data)
+{
+    uint8_t received = (mClocked < mSlaveLength) ? mSlave[mClocked] : 0xFF;
+
+    if(PORTB & (1 << PORTB0))
+    {
+        mClockedDeselected++;
+    }
+    mMaster[mClocked++] = data;
+    return received;
+}
+
+/*****************************************************************************
+ * Description: Runs an interrupt. The handler runs when it is entered, but  *
+ *              a byte it writes to SPDR only starts once the cycles up to   *
+ *              the write have passed.                                       *
+ *                                                                           *
+ * Parameters: handler      -> the handler of lib/spi.c                      *
+ *             toWrite      -> cycles of the handler up to the write of SPDR *
+ *             afterWrite   -> cycles of the handler after it                *
+ *             withoutWrite -> cycles of the handler if it did not write     *
+ *                                                                           *
+ *****************************************************************************/
+static void pInterrupt(void (*handler)(), uint32_t toWrite, uint32_t afterWrite,
+                       uint32_t withoutWrite)
+{
+    uint32_t start = mCycles;
+    uint32_t cycles;
+
+    pAdvance(ISR_TO_WRITE_CYCLES);
+    handler();
+    if(!(SPDR & FAKE_SPDR_RECEIVED))
+    {
+        mWriteCycle = mCycles + toWrite;
+        pAdvance(toWrite + afterWrite + ISR_RETURN_CYCLES);
+    }
+    else
+    {
+        pAdvance(withoutWrite + ISR_RETURN_CYCLES);
+    }
+
+    cycles = mCycles - start;
+    mInterrupts++;
+    mInterruptCycles += cycles;
+    mLongestInterrupt = (cycles > mLongestInterrupt) ? cycles : mLongestInterrupt;
+}
+
+/*****************************************************************************
+ * Description: Runs the hardware until the transfer in progress is done:    *
+ *              the compare B match, then a byte and its interrupt at a time.*
+ *              A byte is done 8 SCKs after SPDR was written, or when the    *
+ *              last interrupt returns, if that is later.                    *
+ *                                                                           *
+ * Returns: false if the transfer stopped without being done                 *
+ *                                                                           *
+ *****************************************************************************/
+static bool pRunHardware()
+{
+    while(isSpiBusy())
+    {
+        if(TIMSK0 & (1 << OCIE0B))
+        {
+            uint8_t wait = (uint8_t)(OCR0B - TCNT0);
+
+            pAdvance((wait == 0) ? 256 : wait);
+            SPDR = FAKE_SPDR_RECEIVED;
+            pInterrupt(handleSpiSelectInterrupt, SELECT_TO_WRITE_CYCLES, 0, 0);
+            mSelectCycles = mWriteCycle - mSelectOnCycle;
+        }
+        else if(!(SPDR & FAKE_SPDR_RECEIVED))
+        {
+            uint32_t done = mWriteCycle + (8 * pSpiDivisor());
+            bool header = (mClocked + 1 == mTransfer.headerLength);
+
+            pAdvance((done > mCycles) ? (done - mCycles) : 0);
+            SPDR = FAKE_SPDR_RECEIVED | pExchangeByte((uint8_t)SPDR);
+
+            // The header and the last byte call back into main.c
+            pInterrupt(handleSpiInterrupt, BYTE_TO_WRITE_CYCLES + (header ? HEADER_CYCLES : 0),
+                       BYTE_AFTER_WRITE_CYCLES, LAST_BYTE_CYCLES);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*****************************************************************************
+ ****************Start of Test Helpers ***************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: The length callback of main.c: the longer of the two frames. *
+ *                                                                           *
+ *****************************************************************************/
+static uint8_t pLinkFrameLength(const SpiTransfer * transfer)
+{
+    uint8_t rxLength = Link_Frame_Length(transfer->rx);
+    return (rxLength > transfer->txLength) ? rxLength : transfer->txLength;
+}
+
+/*****************************************************************************
+ * Description: The done callback.                                           *
+ *                                                                           *
+ *****************************************************************************/
+static void pLinkTransferDone(SpiTransfer * transfer)
+{
+    (void)transfer;
+    mDoneCalls++;
+    mDoneDeselected = (PORTB & (1 << PORTB0)) != 0;
+}
+
+/*****************************************************************************
+ * Description: Sets up the SPI master and the BLE board. The board sends a  *
+ *              command frame with a number of stream frames.                *
+ *                                                                           *
+ *****************************************************************************/
+static void pSetUp(uint8_t streamFrames)
+{
+    uint8_t payload[LINK_FRAME_MAX_PAYLOAD];
+    uint8_t i;
+
+    DDRB = 0;
+    PORTB = 0;
+    SPCR = 0;
+    SPSR = 0;
+    SPDR = FAKE_SPDR_RECEIVED;
+    TIFR0 = 0;
+    TIMSK0 = 0;
+    mClocked = 0;
+    mClockedDeselected = 0;
+    mInterrupts = 0;
+    mInterruptCycles = 0;
+    mLongestInterrupt = 0;
+    mDoneCalls = 0;
+    mDoneDeselected = false;
+    memset(mMaster, 0x00, sizeof(mMaster));
+    memset(mRxBuffer, 0x00, sizeof(mRxBuffer));
+
+    setupSpiMaster(LINK_SPI_RATE, LINK_SELECT_DELAY_TICKS);
+
+    for(i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = (uint8_t)(0x30 + i);
+    }
+    payload[LINK_COMMAND_STREAM_COUNT] = streamFrames;
+    mSlaveLength = Link_Frame_Encode(mSlave, LINK_FRAME_TYPE_COMMAND, 0x42, payload,
+                                     (uint8_t)(LINK_COMMAND_STREAM + (streamFrames * LINK_STREAM_FRAME_LEN)));
+}
+
+/*****************************************************************************
+ * Description: Starts the transfer of a telemetry frame, as main.c does.    *
+ *                                                                           *
+ * Returns: The result of startSpiTransfer                                   *
+ *                                                                           *
+ *****************************************************************************/
+static bool pStartLinkTransfer()
+{
+    uint8_t telemetry[LINK_TELEMETRY_LEN] = {1, 2, 3, 4, 5, 6};
+
+    mTransfer.tx = mTxBuffer;
+    mTransfer.txLength = Link_Frame_Encode(mTxBuffer, LINK_FRAME_TYPE_TELEMETRY, 0x07,
+                                           telemetry, LINK_TELEMETRY_LEN);
+    mTransfer.rx = mRxBuffer;
+    mTransfer.rxSize = sizeof(mRxBuffer);
+    mTransfer.length = LINK_FRAME_HEADER_LEN;
+    mTransfer.headerLength = LINK_FRAME_HEADER_LEN;
+    mTransfer.lengthCallback = pLinkFrameLength;
+    mTransfer.doneCallback = pLinkTransferDone;
+
+    mSelectOnCycle = mCycles;
+    return startSpiTransfer(&mTransfer);
+}
+
+/*****************************************************************************
+ * Description: Clocks the same frames the way main.c did before @05, with   *
+ *              the main loop waiting on each byte.                          *
+ *                                                                           *
+ * Returns: The CPU cycles it took, all of them in the main loop             *
+ *                                                                           *
+ *****************************************************************************/
+static uint32_t pPolledLinkTransfer(uint8_t * rx)
+{
+    uint32_t start = mCycles;
+    uint8_t rxLength, length, i;
+
+    mClocked = 0;
+    bitOff(PORTB, PORTB0);
+    pAdvance(POLLED_SELECT_DELAY_US * CYCLES_PER_US);
+
+    for(i = 0; i < LINK_FRAME_HEADER_LEN; i++)
+    {
+        pAdvance((8 * POLLED_SPI_DIVISOR) + POLLED_BYTE_CYCLES);
+        rx[i] = pExchangeByte(mTxBuffer[i]);
+    }
+
+    rxLength = Link_Frame_Length(rx);
+    length = (rxLength > mTransfer.txLength) ? rxLength : mTransfer.txLength;
+    for(; i < length; i++)
+    {
+        pAdvance((8 * POLLED_SPI_DIVISOR) + POLLED_BYTE_CYCLES);
+        rx[i] = pExchangeByte((i < mTransfer.txLength) ? mTxBuffer[i] : 0x00);
+    }
+    bitOn(PORTB, PORTB0);
+
+    return mCycles - start;
+}
+
+/*****************************************************************************
+ ****************Start of Tests **********************************************
+ *****************************************************************************/
+
+static void pTestSetup()
+{
+    pSetUp(0);
+    CHECK(SPCR == ((1 << SPE) | (1 << MSTR) | (1 << SPIE) | (1 << SPR0)));
+    CHECK((SPSR & (1 << SPI2X)) != 0);
+    CHECK(pSpiDivisor() == 8);
+    CHECK((DDRB & 0x07) == 0x07);
+    CHECK((PORTB & (1 << PORTB0)) != 0);
+
+    setupSpiMaster(SPI_CLOCK_DIV16, LINK_SELECT_DELAY_TICKS);
+    CHECK(pSpiDivisor() == 16);
+}
+
+// A frame with a number of stream frames, both ways, side by side
+static void pTestLinkTransfer(uint8_t streamFrames)
+{
+    uint8_t polledRx[LINK_FRAME_MAX_LEN];
+    uint32_t start, polled, onBus, interrupts;
+    uint8_t i;
+    bool sent = true;
+
+    pSetUp(streamFrames);
+    start = mCycles;
+    CHECK(pStartLinkTransfer());
+    CHECK(mCycles == start); // Nothing waited for
+    CHECK((PORTB & (1 << PORTB0)) == 0);
+    CHECK(isSpiBusy());
+
+    CHECK(pRunHardware());
+    onBus = mCycles - start;
+    CHECK(mSelectCycles == LINK_SELECT_DELAY_TICKS + SELECT_WRITE_CYCLES);
+    CHECK(mSelectCycles >= SELECT_SETUP_CYCLES);
+    CHECK(mTransfer.received == mSlaveLength);
+    CHECK(memcmp(mRxBuffer, mSlave, mSlaveLength) == 0);
+    for(i = 0; i < mTransfer.received; i++)
+    {
+        sent = sent && (mMaster[i] == ((i < mTransfer.txLength) ? mTxBuffer[i] : 0x00));
+    }
+    CHECK(sent);
+    CHECK(mClockedDeselected == 0);
+    CHECK(mDoneCalls == 1);
+    CHECK(mDoneDeselected);
+    CHECK(mInterrupts == mTransfer.received + 1);
+
+    // The same bytes, polled
+    polled = pPolledLinkTransfer(polledRx);
+    CHECK(memcmp(polledRx, mRxBuffer, mTransfer.received) == 0);
+    CHECK(mClockedDeselected == 0);
+
+    // The CPU time of the interrupt path, with the start from the main loop
+    interrupts = START_CYCLES + mInterruptCycles;
+    CHECK(mLongestInterrupt == ISR_OVERHEAD_CYCLES + BYTE_TO_WRITE_CYCLES + HEADER_CYCLES
+                               + BYTE_AFTER_WRITE_CYCLES); // The header
+    printf("  %u stream frames, %2u bytes: polled %4lu us CPU; interrupts %4lu us CPU in %2u, "
+           "the longest %lu us, %3lu us on the bus\n",
+           streamFrames, mTransfer.received, (unsigned long)(polled / CYCLES_PER_US),
+           (unsigned long)(interrupts / CYCLES_PER_US), mInterrupts,
+           (unsigned long)(mLongestInterrupt / CYCLES_PER_US), (unsigned long)(onBus / CYCLES_PER_US));
+}
+
+static void pTestBusy()
+{
+    pSetUp(1);
+    CHECK(pStartLinkTransfer());
+    CHECK(!startSpiTransfer(&mTransfer));
+    CHECK(pRunHardware());
+    CHECK(mTransfer.received == mSlaveLength);
+    CHECK(mDoneCalls == 1);
+
+    mTransfer.length = 0;
+    CHECK(!startSpiTransfer(&mTransfer));
+    CHECK(!isSpiBusy());
+}
+
+// Without a good header from the BLE board the telemetry frame still goes out
+static void pTestBadHeader()
+{
+    pSetUp(0);
+    mSlave[0] = 0x00;
+    CHECK(pStartLinkTransfer());
+    CHECK(pRunHardware());
+    CHECK(mTransfer.received == mTransfer.txLength);
+    CHECK(memcmp(mMaster, mTxBuffer, mTransfer.txLength) == 0);
+}
+
+// A length past rx is cut to rx, from the callback and from the start
+static void pTestRxSize()
+{
+    pSetUp(LINK_STREAM_MAX_FRAMES);
+    CHECK(pStartLinkTransfer());
+    mTransfer.rxSize = 20;
+    CHECK(pRunHardware());
+    CHECK(mTransfer.received == 20);
+    CHECK(mClocked == 20);
+
+    pSetUp(LINK_STREAM_MAX_FRAMES);
+    mTransfer.rxSize = 3;
+    mTransfer.length = LINK_FRAME_HEADER_LEN;
+    mSelectOnCycle = mCycles;
+    CHECK(startSpiTransfer(&mTransfer));
+    CHECK(pRunHardware());
+    CHECK(mTransfer.received == 3);
+}
+
+// The compare match is found when OCR0B wraps past TCNT0
+static void pTestSelectDelay()
+{
+    pSetUp(0);
+    pAdvance(256 - (uint8_t)mCycles + 200);
+    CHECK(TCNT0 == 200);
+    CHECK(pStartLinkTransfer());
+    CHECK(pRunHardware());
+    CHECK(mSelectCycles == LINK_SELECT_DELAY_TICKS + SELECT_WRITE_CYCLES);
+
+    // Too short a delay is raised, so the match is not missed
+    pSetUp(0);
+    setupSpiMaster(LINK_SPI_RATE, 1);
+    CHECK(pStartLinkTransfer());
+    CHECK(pRunHardware());
+    CHECK(mSelectCycles == 2 + SELECT_WRITE_CYCLES);
+}
+
+int main()
+{
+    pTestSetup();
+    pTestLinkTransfer(0);
+    pTestLinkTransfer(LINK_STREAM_MAX_FRAMES);
+    pTestBusy();
+    pTestBadHeader();
+    pTestRxSize();
+    pTestSelectDelay();
+
+    return Test_Check_Summary("Spi");
+}
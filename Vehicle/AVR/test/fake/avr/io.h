@@ -0,0 +1,59 @@
+/*****************************************************************************
+* FILENAME: io.h                                                             *
+*                                                                            *
+* DESCRIPTION: Stands in for <avr/io.h> in the host tests. The registers     *
+*              are plain variables, defined by the test, with the bit        *
+*              numbers of the ATmega32U4. Only what the tested modules use   *
+*              is declared.                                                  *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef FAKE_AVR_IO_H__
+#define FAKE_AVR_IO_H__
+
+#include <stdint.h>
+
+// Port B
+extern volatile uint8_t     DDRB;
+extern volatile uint8_t     PORTB;
+#define DDB0                0
+#define DDB1                1
+#define DDB2                2
+#define PORTB0              0
+
+// SPI. SPDR is wider than the register, so the test can tell that a byte was
+// written: it leaves a received byte in it with FAKE_SPDR_RECEIVED set, and
+// a write clears it.
+extern volatile uint8_t     SPCR;
+extern volatile uint8_t     SPSR;
+extern volatile uint16_t    SPDR;
+#define FAKE_SPDR_RECEIVED  0x100
+#define SPR0                0
+#define SPR1                1
+#define MSTR                4
+#define SPE                 6
+#define SPIE                7
+#define SPI2X               0
+#define SPIF                7
+
+// Timer0
+extern volatile uint8_t     TCNT0;
+extern volatile uint8_t     OCR0B;
+extern volatile uint8_t     TIFR0;
+extern volatile uint8_t     TIMSK0;
+#define OCF0B               2
+#define OCIE0B              2
+
+#endif /* FAKE_AVR_IO_H__ */
@@ -16,26 +16,62 @@
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 16Apr17  | BNordland  | Initial creation                    |  *
 * | @01     | 19Apr17  | BNordland  | Notification Enable Improvements    |  *
+* | @02     | 17Oct26  | BNordland  | Packed control frame characteristic |  *
+* | @03     | 17Oct26  | BNordland  | Raw IMU stream characteristic       |  *
+* | @04     | 17Oct26  | BNordland  | Cache handles, skip discovery       |  *
+* | @05     | 17Oct26  | BNordland  | Queued CCCD writes                  |  *
+* | @06     | 17Oct26  | BNordland  | Check the glove's database version  |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
 #include "Client_Glove.h"
 
+#include <string.h> // @04a memcmp
+
 #include "Config_Hardware.h"
+#include "Storage_Flash.h" // @04a
+
+// @05a CCCD writes that can be waiting for their response at one time
+#define CCCD_QUEUE_LEN  4
+
+// @06a The reads that check the cached handles on a reconnect, in order
+typedef enum
+{
+    PROBE_NONE = 0,     // Not checking
+    PROBE_DB_VERSION,   // The database version, and its handle
+    PROBE_CONTROL,      // The control value handle
+    PROBE_STREAM,       // The stream value handle
+    PROBE_DONE          // All checked
+} Client_Glove_Probe_t;
 
 // Private Structures
 
 // Glove Client Characteristics Data Structure
 typedef struct
 {
-    uint16_t    anglePitch_handle;      // handle of the angle pitch characteristic as provided by a discovery.
-    uint16_t    anglePitch_cccd_handle; // handle of the CCCD of the angle pitch characteristic as provided by a discovery
-    uint16_t    throttle_handle;        // handle of the throttle characteristic as provided by a discovery.
-    uint16_t    throttle_cccd_handle;   // handle of the CCCD of the throttle characteristic as provided by a discovery
-    uint16_t    direction_handle;       // handle of the direction characteristic as provided by a discovery.
-    uint16_t    direction_cccd_handle;  // handle of the CCCD of the direction characteristic as provided by a discovery
+    uint16_t    control_handle;         // @02c handle of the control characteristic as provided by a discovery.
+    uint16_t    control_cccd_handle;    // @02c handle of the CCCD of the control characteristic as provided by a discovery
+    uint16_t    stream_handle;          // @03a handle of the stream characteristic as provided by a discovery.
+    uint16_t    stream_cccd_handle;     // @03a handle of the CCCD of the stream characteristic as provided by a discovery
+    uint16_t    db_version_handle;      // @06a handle of the database version characteristic as provided by a discovery
 } Client_Glove_Handles_t;
 
+// @04a The handles of the last glove, as kept in flash
+typedef struct
+{
+    ble_gap_addr_t              peer_addr;  // The glove the handles were discovered on
+    uint8_t                     db_version; // CLIENT_GLOVE_DB_VERSION when they were discovered
+    Client_Glove_Handles_t      handles;    // The handles
+} Client_Glove_Cache_t;
+
+// @05a A CCCD write. The value is kept here, rather than on the stack, as
+// the SoftDevice reads it until the write is responded to.
+typedef struct
+{
+    uint16_t    cccd_handle;                // The CCCD to write
+    uint8_t     value[BLE_CCCD_VALUE_LEN];  // The value to write
+} Client_Glove_CccdWrite_t;
+
 // The client data
 typedef struct Client_Glove_Data
 {
@@ -43,9 +79,16 @@ typedef struct Client_Glove_Data
     uint16_t                     conn_handle;        // Handle of the current connection.
     Client_Glove_Handles_t       handles;            // Handles on the connected peer device needed to interact with it.
     Client_Glove_Event_Handler_t evt_handler;        // Application event handler to be called when there is an event
-    bool                         pitch_notify_enable; // Indicates if the throttle notifications have been enabled
-    bool                         throttle_notify_enable; // Indicates if the direction notifications have been enabled
-    bool                         notifyEnableComplete;   // @01a Indicates if all notifications are enabled.
+    Client_Glove_CccdWrite_t     cccd_queue[CCCD_QUEUE_LEN]; // @05a CCCD writes, oldest first
+    uint8_t                      cccd_head;          // @05a The write that was sent, or is sent next
+    uint8_t                      cccd_count;         // @05a Writes in the queue
+    bool                         cccd_in_flight;     // @05a The head write was sent, its response is awaited
+    bool                         cccd_failed;        // @05a A write of this connection was refused
+    ble_db_discovery_t           * db_discovery;     // @04a Discovery instance, for when the cache can't be used
+    ble_gap_addr_t               peer_addr;          // @04a The glove connected to
+    Client_Glove_Cache_t         cache;              // @04a The handles read from flash
+    bool                         cache_valid;        // @04a cache holds handles of this build's glove
+    Client_Glove_Probe_t         cache_probe;        // @04a @06c The cached handle being checked
 } Client_Glove_Data_t;
 
 // Private variables
@@ -57,6 +100,16 @@ static Client_Glove_Data_t   mClientData; // Note: since we only accept from one
 static void pNotifyApplication(const ble_evt_t * event); // used to dispatch the application event handler
 static uint32_t pEnableNotifications(); // Used to enable all notifications
 static uint32_t pConfigureNotification(uint16_t cccdHandle, bool enable); // Enable or Disable Notifications
+static void pProcessCccdQueue(); // @05a Sends the next CCCD write
+static void pOnWriteResponse(const ble_evt_t * event); // @05a Completes the CCCD write that was sent
+static void pClearCccdQueue(); // @05a Drops the CCCD writes of the last connection
+static bool pDecodeControl(const uint8_t * data, uint16_t length, Client_Glove_Control_t * control); // @02a Control frame decoding
+static void pOnConnected(const ble_evt_t * event); // @04a Uses the cached handles, or starts discovery
+static void pOnProbeResponse(const ble_evt_t * event); // @04a Checks the cached control handle
+static bool pProbe(uint16_t connHandle, Client_Glove_Probe_t probe); // @06a Checks the next cached handle
+static void pStartDiscovery(uint16_t connHandle); // @04a Discovers the glove service
+static void pInvalidateHandles(); // @04a Forgets the handles of the last connection
+static void pSaveCache(); // @04a Writes the discovered handles to flash
 
 
 /*****************************************************************************
@@ -70,7 +123,9 @@ static uint32_t pConfigureNotification(uint16_t cccdHandle, bool enable); // Ena
  *              for the correct UUID type of the glove.                      *
  *              and will also register the application event handler passed  *
  *              to it. In addition, all variables for the Glove client are   *
- *              initialized to their default values.                         *
+ *              initialized to their default values, and the cached handles  *
+ *              are read from flash (Storage_Flash_Init must be called       *
+ *              first).                                                 @04c *
  *                                                                           *
  * Returns: NRF_SUCCESS if everything was initialized successfully.          *
  *          Otherwise and error code is returned. For example if the         *
@@ -86,7 +141,7 @@ uint32_t Client_Glove_Init(Client_Glove_Init_t * initData)
     ble_uuid_t    glove_uuid;
     ble_uuid128_t base_uuid = BLE_UUID_GLOVE_BASE_UUID;
 
-    if(initData == NULL)
+    if(initData == NULL || initData->db_discovery == NULL) // @04c
     {
         return NRF_ERROR_NULL;
     }
@@ -105,18 +160,19 @@ uint32_t Client_Glove_Init(Client_Glove_Init_t * initData)
 
     // Set the event handler
     mClientData.evt_handler = initData->evt_handler;
+    mClientData.db_discovery = initData->db_discovery; // @04a
 
     // Invalidate all handles
     mClientData.conn_handle                     = BLE_CONN_HANDLE_INVALID;
-    mClientData.handles.anglePitch_handle       = BLE_GATT_HANDLE_INVALID;
-    mClientData.handles.anglePitch_cccd_handle  = BLE_GATT_HANDLE_INVALID;
-    mClientData.handles.throttle_handle         = BLE_GATT_HANDLE_INVALID;
-    mClientData.handles.throttle_cccd_handle    = BLE_GATT_HANDLE_INVALID;
-    mClientData.handles.direction_handle        = BLE_GATT_HANDLE_INVALID;
-    mClientData.handles.direction_cccd_handle   = BLE_GATT_HANDLE_INVALID;
-    mClientData.pitch_notify_enable             = false; // @01a
-    mClientData.throttle_notify_enable          = false; // @01a
-    mClientData.notifyEnableComplete            = false; // @01a
+    pInvalidateHandles(); // @04c
+    pClearCccdQueue(); // @05a
+
+    // @04a Handles discovered by another build of the glove client may not
+    // match this glove service, so only those of this version are used.
+    mClientData.cache_probe = PROBE_NONE; // @06c
+    mClientData.cache_valid = Storage_Flash_Read(STORAGE_FLASH_KEY_GLOVE_HANDLES,
+                                                 &mClientData.cache, sizeof(mClientData.cache))
+                              && (mClientData.cache.db_version == CLIENT_GLOVE_DB_VERSION);
 
     return ble_db_discovery_evt_register(&glove_uuid);
 }
@@ -153,22 +209,21 @@ void Client_Glove_DiscoveryEventHandler(ble_db_discovery_evt_t * event)
         {
             switch (characteristics[i].characteristic.uuid.uuid)
             {
-                case BLE_UUID_GLOVE_ANGLEPITCH_CHARACTERISTC_UUID:
+                case BLE_UUID_GLOVE_CONTROL_CHARACTERISTC_UUID: // @02c
                 {
-                    mClientData.handles.anglePitch_handle = characteristics[i].characteristic.handle_value;
-                    mClientData.handles.anglePitch_cccd_handle = characteristics[i].cccd_handle;
+                    mClientData.handles.control_handle = characteristics[i].characteristic.handle_value;
+                    mClientData.handles.control_cccd_handle = characteristics[i].cccd_handle;
                     break;
                 }
-                case BLE_UUID_GLOVE_THROTTLE_CHARACTERISTC_UUID:
+                case BLE_UUID_GLOVE_STREAM_CHARACTERISTC_UUID: // @03a
                 {
-                    mClientData.handles.throttle_handle = characteristics[i].characteristic.handle_value;
-                    mClientData.handles.throttle_cccd_handle = characteristics[i].cccd_handle;
+                    mClientData.handles.stream_handle = characteristics[i].characteristic.handle_value;
+                    mClientData.handles.stream_cccd_handle = characteristics[i].cccd_handle;
                     break;
                 }
-                case BLE_UUID_GLOVE_DIRECTION_CHARACTERISTC_UUID:
+                case BLE_UUID_GLOVE_DB_VERSION_CHARACTERISTC_UUID: // @06a
                 {
-                    mClientData.handles.direction_handle = characteristics[i].characteristic.handle_value;
-                    mClientData.handles.direction_cccd_handle = characteristics[i].cccd_handle;
+                    mClientData.handles.db_version_handle = characteristics[i].characteristic.handle_value;
                     break;
                 }
                 default:
@@ -181,6 +236,9 @@ void Client_Glove_DiscoveryEventHandler(ble_db_discovery_evt_t * event)
         // Set the connection handle
         mClientData.conn_handle = event->conn_handle;
 
+        // @04a So that the next connection to this glove can skip discovery
+        pSaveCache();
+
         // enable notifications
         pEnableNotifications();
     }
@@ -192,8 +250,12 @@ void Client_Glove_DiscoveryEventHandler(ble_db_discovery_evt_t * event)
  *              by validating connection handles.                            *
  *                                                                           *
  *              Types of events include:                                     *
+ *                  Connect -> checks the cached handles are still right, or *
+ *                      starts discovery if they can't be used.         @04a *
  *                  Receiving a notification -> will call proper application *
  *                      event handler.                                       *
+ *                  Write response -> sends the next queued CCCD write, and  *
+ *                      tells the application once all are done.        @05a *
  *                  Disconnect -> will invalidate handles, and call the      *
  *                      application disconnect event handler.                *
  *                                                                           *
@@ -224,12 +286,25 @@ void Client_Glove_BLEEventHandler(const ble_evt_t * event)
 
     switch (event->header.evt_id)
     {
+        case BLE_GAP_EVT_CONNECTED: // @04a
+            pOnConnected(event);
+            break;
+
+        case BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP: // @04a
+            pOnProbeResponse(event);
+            break;
+
         case BLE_GATTC_EVT_HVX:
             // notification received, process it and call the event handler
             pNotifyApplication(event);
             break;
 
+        case BLE_GATTC_EVT_WRITE_RSP: // @05a
+            pOnWriteResponse(event);
+            break;
+
         case BLE_GAP_EVT_DISCONNECTED:
+            pClearCccdQueue(); // @05a
             if (event->evt.gap_evt.conn_handle == mClientData.conn_handle
                     && mClientData.evt_handler != NULL)
             {
@@ -238,13 +313,13 @@ void Client_Glove_BLEEventHandler(const ble_evt_t * event)
                 gloveEvent.evt_type = Client_Glove_Event_DISCONNECTED;
 
                 mClientData.conn_handle = BLE_CONN_HANDLE_INVALID;
-                mClientData.throttle_notify_enable          = false; // @01a reset notification enables on disconnect
-                mClientData.pitch_notify_enable             = false; // @01a reset notification enables on disconnect
-                mClientData.notifyEnableComplete            = false; // @01a reset notification enables on disconnect
                 mClientData.evt_handler(&gloveEvent);
             }
             break;
     }
+
+    // @05a A write the SoftDevice was too busy for is retried on every event
+    pProcessCccdQueue();
 }
 
 /*****************************************************************************
@@ -263,115 +338,89 @@ void Client_Glove_BLEEventHandler(const ble_evt_t * event)
  *****************************************************************************/
 static void pNotifyApplication(const ble_evt_t * event)
 {
-    // figure out what type of notification event was sent.
-    if ( (mClientData.handles.anglePitch_handle != BLE_GATT_HANDLE_INVALID)
-            && (event->evt.gattc_evt.params.hvx.handle == mClientData.handles.anglePitch_handle)
+    // @02c The control frame, @03c and the stream frames
+    if ( (mClientData.handles.control_handle != BLE_GATT_HANDLE_INVALID)
+            && (event->evt.gattc_evt.params.hvx.handle == mClientData.handles.control_handle)
             && (mClientData.evt_handler != NULL)
         )
     {
+        Client_Glove_Control_t control;
 
-        // If it is an angle pitch update notification, call the appropriate
-        // event handler in the application.
-        Client_Glove_Event_t notifyEventData;
-
-        notifyEventData.evt_type = Client_Glove_Event_ANGLEPITCH_UPDATED;
-        notifyEventData.p_data   = (uint8_t *)event->evt.gattc_evt.params.hvx.data;
-        notifyEventData.data_len = event->evt.gattc_evt.params.hvx.len;
-
-        // @01a - Only send notifications if all notifications are enabled
-        if(mClientData.notifyEnableComplete)
-        {
-            mClientData.evt_handler(&notifyEventData);
-        }
-        else if(!mClientData.pitch_notify_enable)
+        // Frames that can't be decoded are dropped, the next one follows
+        // within a timer tick of the glove.
+        if(pDecodeControl(event->evt.gattc_evt.params.hvx.data,
+                          event->evt.gattc_evt.params.hvx.len, &control))
         {
-            pConfigureNotification(mClientData.handles.throttle_cccd_handle, true);
-            mClientData.pitch_notify_enable = true;
-        }
-    }
-    else if ( (mClientData.handles.throttle_handle != BLE_GATT_HANDLE_INVALID)
-            && (event->evt.gattc_evt.params.hvx.handle == mClientData.handles.throttle_handle)
-            && (mClientData.evt_handler != NULL)
-        )
-    {
-        // If it is a throttle update notification, call the appropriate
-        // event handler in the application.
-        Client_Glove_Event_t notifyEventData;
+            Client_Glove_Event_t notifyEventData;
 
-        notifyEventData.evt_type = Client_Glove_Event_THROTTLE_UPDATED;
-        notifyEventData.p_data   = (uint8_t *)event->evt.gattc_evt.params.hvx.data;
-        notifyEventData.data_len = event->evt.gattc_evt.params.hvx.len;
+            notifyEventData.evt_type    = Client_Glove_Event_CONTROL_UPDATED;
+            notifyEventData.conn_handle = mClientData.conn_handle;
+            notifyEventData.p_data      = (uint8_t *)event->evt.gattc_evt.params.hvx.data;
+            notifyEventData.data_len    = event->evt.gattc_evt.params.hvx.len;
+            notifyEventData.control     = &control;
 
-        // @01a - Only send notifications if all notifications are enabled
-        if(mClientData.notifyEnableComplete)
-        {
             mClientData.evt_handler(&notifyEventData);
         }
-        else if(!mClientData.throttle_notify_enable)
-        {
-            pConfigureNotification(mClientData.handles.direction_cccd_handle, true);
-            mClientData.throttle_notify_enable = true;
-        }
     }
-    else if ( (mClientData.handles.direction_handle != BLE_GATT_HANDLE_INVALID)
-            && (event->evt.gattc_evt.params.hvx.handle == mClientData.handles.direction_handle)
+    else if ( (mClientData.handles.stream_handle != BLE_GATT_HANDLE_INVALID) // @03a
+            && (event->evt.gattc_evt.params.hvx.handle == mClientData.handles.stream_handle)
             && (mClientData.evt_handler != NULL)
         )
     {
-
-        // If it is a throttle update notification, call the appropriate
-        // event handler in the application.
         Client_Glove_Event_t notifyEventData;
 
-        notifyEventData.evt_type = Client_Glove_Event_DIRECTION_UPDATED;
-        notifyEventData.p_data   = (uint8_t *)event->evt.gattc_evt.params.hvx.data;
-        notifyEventData.data_len = event->evt.gattc_evt.params.hvx.len;
+        notifyEventData.evt_type    = Client_Glove_Event_STREAM_RECEIVED;
+        notifyEventData.conn_handle = mClientData.conn_handle;
+        notifyEventData.p_data      = (uint8_t *)event->evt.gattc_evt.params.hvx.data;
+        notifyEventData.data_len    = event->evt.gattc_evt.params.hvx.len;
+        notifyEventData.control     = NULL;
 
-        // @01a - Only send notifications if all notifications are enabled
-        if(mClientData.notifyEnableComplete)
-        {
-            mClientData.evt_handler(&notifyEventData);
-        }
-        else
-        {
-            mClientData.notifyEnableComplete = true;
-        }
+        mClientData.evt_handler(&notifyEventData);
     }
 }
 
 /*****************************************************************************
- * Description: Enables all notifications for our three characteristics      *
+ * Description: Enables notifications for the control characteristic,  @02c  *
+ *              and for the stream if it is enabled. The writes are queued   *
+ *              together, and the application is told once the glove has     *
+ *              accepted all of them.                                   @05c *
  *                                                                           *
- * Returns: NRF_SUCCESS if notifications were successfully enabled or        *
- *          disabled or a bluetooth stack error otherwise.                   *
+ * Returns: NRF_SUCCESS if the writes were queued, or an error otherwise.    *
  *                                                                           *
  * Parameters: None                                                          *
  *                                                                           *
  *****************************************************************************/
 static uint32_t pEnableNotifications()
 {
+    uint32_t err_code;
+
     // Error validation
     if(mClientData.conn_handle == BLE_CONN_HANDLE_INVALID)
     {
         return NRF_ERROR_INVALID_STATE;
     }
 
-    // Note this will trigger a cascading effect.
-    // Once notifications are enabled for the pitch angle, then,
-    // notifications will be enabled for the throttle and direction.
-    // The client will not be notified until notifications have been enabled
-    // for all three.
-    pConfigureNotification(mClientData.handles.anglePitch_cccd_handle, true);
+    err_code = pConfigureNotification(mClientData.handles.control_cccd_handle, true);
+
+    // @05c The stream CCCD goes out as soon as the control CCCD is
+    // responded to, rather than waiting for the first control frame.
+    if(err_code == NRF_SUCCESS
+        && CLIENT_GLOVE_STREAM_ENABLED
+        && mClientData.handles.stream_cccd_handle != BLE_GATT_HANDLE_INVALID)
+    {
+        err_code = pConfigureNotification(mClientData.handles.stream_cccd_handle, true);
+    }
 
-    return 0;//returnCode;
+    return err_code;
 }
 
 /*****************************************************************************
  * Description: Configures a particular notification, by writing to the      *
- *              cccd the enable or disable byte for notifications.           *
+ *              cccd the enable or disable byte for notifications. The write *
+ *              is queued, and sent once the writes before it are done. @05c *
  *                                                                           *
- * Returns: NRF_SUCCESS if notifications were successfully enabled or        *
- *          disabled or a bluetooth stack error otherwise.                   *
+ * Returns: NRF_SUCCESS if the write was queued, NRF_ERROR_NO_MEM if the     *
+ *          queue is full.                                                   *
  *                                                                           *
  * Parameters: cccdHandle -> the bluetooth cccd handle for the characteristic*
  *                           that notifications are being enabled or         *
@@ -381,20 +430,383 @@ static uint32_t pEnableNotifications()
  *****************************************************************************/
 static uint32_t pConfigureNotification(uint16_t cccdHandle, bool enable)
 {
+    // @05c Queue the write
+    if(mClientData.cccd_count >= CCCD_QUEUE_LEN)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    Client_Glove_CccdWrite_t * write =
+        &mClientData.cccd_queue[(mClientData.cccd_head + mClientData.cccd_count) % CCCD_QUEUE_LEN];
+    mClientData.cccd_count++;
+
     // Configure or deconfigure notifications
-    uint8_t gattValue[BLE_CCCD_VALUE_LEN];
-    gattValue[0] = enable ? BLE_GATT_HVX_NOTIFICATION : 0;
-    gattValue[1] = 0;
-
-    // Set the cccd parameters
-    const ble_gattc_write_params_t write_params = {
-        .write_op = BLE_GATT_OP_WRITE_REQ,
-        .flags    = BLE_GATT_EXEC_WRITE_FLAG_PREPARED_WRITE,
-        .handle   = cccdHandle,
-        .offset   = 0,
-        .len      = sizeof(gattValue),
-        .p_value  = gattValue
+    write->cccd_handle = cccdHandle;
+    write->value[0] = enable ? BLE_GATT_HVX_NOTIFICATION : 0;
+    write->value[1] = 0;
+
+    pProcessCccdQueue();
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+ * Description: Sends the CCCD write at the head of the queue, unless one is *
+ *              already waiting for its response; the glove only takes one   *
+ *              write request at a time. If the SoftDevice is busy, the      *
+ *              write stays queued and is tried again on the next       @05a *
+ *              event.                                                       *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pProcessCccdQueue()
+{
+    while(mClientData.cccd_count > 0 && !mClientData.cccd_in_flight)
+    {
+        Client_Glove_CccdWrite_t * write = &mClientData.cccd_queue[mClientData.cccd_head];
+
+        // Set the cccd parameters
+        const ble_gattc_write_params_t write_params = {
+            .write_op = BLE_GATT_OP_WRITE_REQ,
+            .flags    = BLE_GATT_EXEC_WRITE_FLAG_PREPARED_WRITE,
+            .handle   = write->cccd_handle,
+            .offset   = 0,
+            .len      = sizeof(write->value),
+            .p_value  = write->value
+        };
+
+        uint32_t err_code = sd_ble_gattc_write(mClientData.conn_handle, &write_params);
+        if(err_code == NRF_SUCCESS)
+        {
+            mClientData.cccd_in_flight = true;
+        }
+        else if(err_code == NRF_ERROR_BUSY)
+        {
+            return;
+        }
+        else
+        {
+            // The write can't be sent on this connection, drop it
+            mClientData.cccd_failed = true;
+            mClientData.cccd_head = (mClientData.cccd_head + 1) % CCCD_QUEUE_LEN;
+            mClientData.cccd_count--;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Description: Handles the response to the CCCD write that was sent, and    *
+ *              sends the next one. Once the queue is empty, the application *
+ *              is told that the notifications are enabled, unless the glove *
+ *              refused one of the writes.                              @05a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: event -> the write response                                   *
+ *                                                                           *
+ *****************************************************************************/
+static void pOnWriteResponse(const ble_evt_t * event)
+{
+    const ble_gattc_evt_t * gattcEvent = &event->evt.gattc_evt;
+
+    if(!mClientData.cccd_in_flight
+        || gattcEvent->params.write_rsp.handle != mClientData.cccd_queue[mClientData.cccd_head].cccd_handle)
+    {
+        return;
+    }
+
+    if(gattcEvent->gatt_status != BLE_GATT_STATUS_SUCCESS)
+    {
+        mClientData.cccd_failed = true;
+    }
+
+    mClientData.cccd_in_flight = false;
+    mClientData.cccd_head = (mClientData.cccd_head + 1) % CCCD_QUEUE_LEN;
+    mClientData.cccd_count--;
+
+    pProcessCccdQueue();
+
+    if(mClientData.cccd_count == 0 && !mClientData.cccd_failed
+        && mClientData.evt_handler != NULL)
+    {
+        Client_Glove_Event_t gloveEvent;
+
+        gloveEvent.evt_type    = Client_Glove_Event_SUBSCRIBED;
+        gloveEvent.conn_handle = mClientData.conn_handle;
+        gloveEvent.p_data      = NULL;
+        gloveEvent.data_len    = 0;
+        gloveEvent.control     = NULL;
+
+        mClientData.evt_handler(&gloveEvent);
+    }
+}
+
+/*****************************************************************************
+ * Description: Drops all queued CCCD writes, as they can't complete once    *
+ *              the connection is lost.                                 @05a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pClearCccdQueue()
+{
+    mClientData.cccd_head = 0;
+    mClientData.cccd_count = 0;
+    mClientData.cccd_in_flight = false;
+    mClientData.cccd_failed = false;
+}
+
+/*****************************************************************************
+ * Description: Decodes a control frame sent by the glove. The fields are    *
+ *              little endian, see CLIENT_GLOVE_CONTROL_LEN.            @02a *
+ *                                                                           *
+ * Returns: true if the frame was decoded, false if it is too short or of    *
+ *          an unknown version.                                              *
+ *                                                                           *
+ * Parameters: data    -> the notification data                              *
+ *             length  -> the length of the notification data                *
+ *             control -> where to store the decoded frame                   *
+ *                                                                           *
+ *****************************************************************************/
+static bool pDecodeControl(const uint8_t * data, uint16_t length, Client_Glove_Control_t * control)
+{
+    if(length < CLIENT_GLOVE_CONTROL_LEN || data[0] != CLIENT_GLOVE_CONTROL_VERSION)
+    {
+        return false;
+    }
+
+    control->sequence  = data[1];
+    control->timestamp = (uint32_t)data[2]
+                       | ((uint32_t)data[3] << 8)
+                       | ((uint32_t)data[4] << 16)
+                       | ((uint32_t)data[5] << 24);
+    control->pitch     = (int16_t)((uint16_t)data[6] | ((uint16_t)data[7] << 8));
+    control->roll      = (int16_t)((uint16_t)data[8] | ((uint16_t)data[9] << 8));
+    control->throttle  = data[10];
+    control->direction = data[11];
+
+    return true;
+}
+
+/*****************************************************************************
+ * Description: Called when connected to a glove. If the handles of this     *
+ *              glove are cached, they are checked by reading the database   *
+ *              version, control and stream handles by their UUIDs (see      *
+ *              pProbe); that is three requests, where discovery is one for  *
+ *              every service, characteristic and descriptor. Otherwise      *
+ *              discovery is started.                              @04a @06c *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: event -> the connected event                                  *
+ *                                                                           *
+ *****************************************************************************/
+static void pOnConnected(const ble_evt_t * event)
+{
+    uint16_t connHandle = event->evt.gap_evt.conn_handle;
+
+    mClientData.peer_addr = event->evt.gap_evt.params.connected.peer_addr;
+    mClientData.cache_probe = PROBE_NONE; // @06c
+    pInvalidateHandles();
+    pClearCccdQueue(); // @05a
+
+    if(!mClientData.cache_valid
+        || memcmp(&mClientData.cache.peer_addr, &mClientData.peer_addr, sizeof(ble_gap_addr_t)) != 0)
+    {
+        pStartDiscovery(connHandle);
+        return;
+    }
+
+    if(pProbe(connHandle, PROBE_DB_VERSION)) // @06c
+    {
+        mClientData.conn_handle = connHandle;
+    }
+    else
+    {
+        pStartDiscovery(connHandle);
+    }
+}
+
+/*****************************************************************************
+ * Description: Handles the response to a read of a cached handle. If the    *
+ *              characteristic was found there (and, for the database        *
+ *              version, has the version this client is built for), the next *
+ *              handle is checked. Once all are, the cached handles are used *
+ *              and notifications are enabled. Otherwise the cache is out of *
+ *              date and discovery is started.                     @04a @06c *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: event -> the read by UUID response                            *
+ *                                                                           *
+ *****************************************************************************/
+static void pOnProbeResponse(const ble_evt_t * event)
+{
+    const ble_gattc_evt_t * gattcEvent = &event->evt.gattc_evt;
+    const ble_gattc_evt_char_val_by_uuid_read_rsp_t * response = &gattcEvent->params.char_val_by_uuid_read_rsp;
+    const Client_Glove_Handles_t * cached = &mClientData.cache.handles;
+    Client_Glove_Probe_t probe = mClientData.cache_probe;
+    uint16_t expected;
+
+    if(probe == PROBE_NONE)
+    {
+        return;
+    }
+    mClientData.cache_probe = PROBE_NONE;
+
+    switch(probe)
+    {
+        case PROBE_DB_VERSION:  expected = cached->db_version_handle;   break;
+        case PROBE_CONTROL:     expected = cached->control_handle;      break;
+        default:                expected = cached->stream_handle;       break;
+    }
+
+    bool found = (gattcEvent->gatt_status == BLE_GATT_STATUS_SUCCESS)
+                 && (response->count > 0)
+                 && (response->handle_value[0].handle == expected);
+    if(found && probe == PROBE_DB_VERSION)
+    {
+        found = (response->value_len >= 1)
+                && (response->handle_value[0].p_value[0] == CLIENT_GLOVE_DB_VERSION);
+    }
+
+    if(!found)
+    {
+        mClientData.cache_valid = false;
+        pStartDiscovery(gattcEvent->conn_handle);
+    }
+    else if(!pProbe(gattcEvent->conn_handle, (Client_Glove_Probe_t)(probe + 1)))
+    {
+        pStartDiscovery(gattcEvent->conn_handle);
+    }
+}
+
+/*****************************************************************************
+ * Description: Checks a cached handle, by reading the value of its          *
+ *              characteristic by UUID. Only the cached handle is searched,  *
+ *              so the read finds nothing if the characteristic has moved.   *
+ *              The stream handle is skipped if the glove had no stream.     *
+ *              After the last handle, the cached handles are used and       *
+ *              notifications are enabled.                              @06a *
+ *                                                                           *
+ * Returns: true if the read was started, or all handles are checked         *
+ *                                                                           *
+ * Parameters: connHandle -> the connection to the glove                     *
+ *             probe      -> the handle to check                             *
+ *                                                                           *
+ *****************************************************************************/
+static bool pProbe(uint16_t connHandle, Client_Glove_Probe_t probe)
+{
+    const Client_Glove_Handles_t * cached = &mClientData.cache.handles;
+    ble_uuid_t uuid = { .type = mClientData.uuid_type };
+    uint16_t handle;
+
+    if(probe == PROBE_STREAM && cached->stream_handle == BLE_GATT_HANDLE_INVALID)
+    {
+        probe = PROBE_DONE;
+    }
+
+    switch(probe)
+    {
+        case PROBE_DB_VERSION:
+            uuid.uuid = BLE_UUID_GLOVE_DB_VERSION_CHARACTERISTC_UUID;
+            handle = cached->db_version_handle;
+            break;
+        case PROBE_CONTROL:
+            uuid.uuid = BLE_UUID_GLOVE_CONTROL_CHARACTERISTC_UUID;
+            handle = cached->control_handle;
+            break;
+        case PROBE_STREAM:
+            uuid.uuid = BLE_UUID_GLOVE_STREAM_CHARACTERISTC_UUID;
+            handle = cached->stream_handle;
+            break;
+        default:
+            mClientData.handles = *cached;
+            pEnableNotifications();
+            return true;
+    }
+
+    const ble_gattc_handle_range_t range =
+    {
+        .start_handle = handle,
+        .end_handle   = handle
     };
+    if(handle == BLE_GATT_HANDLE_INVALID
+        || sd_ble_gattc_char_value_by_uuid_read(connHandle, &uuid, &range) != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    mClientData.cache_probe = probe;
+    return true;
+}
+
+/*****************************************************************************
+ * Description: Starts the discovery of the glove service. The handles are   *
+ *              set by Client_Glove_DiscoveryEventHandler once done.    @04a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: connHandle -> the connection to the glove                     *
+ *                                                                           *
+ *****************************************************************************/
+static void pStartDiscovery(uint16_t connHandle)
+{
+    uint32_t err_code = ble_db_discovery_start(mClientData.db_discovery, connHandle);
+    APP_ERROR_CHECK(err_code);
+}
 
-    return sd_ble_gattc_write(mClientData.conn_handle, &write_params);
+/*****************************************************************************
+ * Description: Invalidates the handles of the characteristics, so that      *
+ *              nothing is received until they are set again.           @04a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pInvalidateHandles()
+{
+    mClientData.handles.control_handle          = BLE_GATT_HANDLE_INVALID;
+    mClientData.handles.control_cccd_handle     = BLE_GATT_HANDLE_INVALID;
+    mClientData.handles.stream_handle           = BLE_GATT_HANDLE_INVALID;
+    mClientData.handles.stream_cccd_handle      = BLE_GATT_HANDLE_INVALID;
+    mClientData.handles.db_version_handle       = BLE_GATT_HANDLE_INVALID; // @06a
+}
+
+/*****************************************************************************
+ * Description: Writes the discovered handles to flash, with the address of  *
+ *              the glove, unless they are already there. The flash is only  *
+ *              written when the glove or its attribute table changes.  @04a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pSaveCache()
+{
+    Client_Glove_Cache_t cache;
+
+    memset(&cache, 0x00, sizeof(cache));
+    cache.peer_addr  = mClientData.peer_addr;
+    cache.db_version = CLIENT_GLOVE_DB_VERSION;
+    cache.handles    = mClientData.handles;
+
+    if(mClientData.cache_valid && memcmp(&cache, &mClientData.cache, sizeof(cache)) == 0)
+    {
+        return;
+    }
+
+    // If the write can't start, the handles are discovered again on the next
+    // connection, and the write tried again then.
+    if(Storage_Flash_Write(STORAGE_FLASH_KEY_GLOVE_HANDLES, &cache, sizeof(cache)) == NRF_SUCCESS)
+    {
+        mClientData.cache = cache;
+        mClientData.cache_valid = true;
+    }
 }
@@ -15,12 +15,18 @@
 * | Flag    | (DDMYY)  | Author     | Description                         |  *
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 16Apr17  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Packed control frame characteristic |  *
+* | @02     | 17Oct26  | BNordland  | Raw IMU stream characteristic       |  *
+* | @03     | 17Oct26  | BNordland  | Cache handles, skip discovery       |  *
+* | @04     | 17Oct26  | BNordland  | Queued CCCD writes                  |  *
+* | @05     | 17Oct26  | BNordland  | Check the glove's database version  |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
 #ifndef _CLIENT_GLOVE_H_
 #define _CLIENT_GLOVE_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "NordicSDK.h"
 
@@ -32,10 +38,53 @@
 #define BLE_UUID_GLOVE_SERVICE                              0x1000 // 16-bit Glove service UUID
 
 // 16-bit characteristic UUIDs
-#define BLE_UUID_GLOVE_ANGLEPITCH_CHARACTERISTC_UUID        0x1001 // Glove Service AnglePitch Characterstic
-#define BLE_UUID_GLOVE_THROTTLE_CHARACTERISTC_UUID          0x10A0 // Glove Service Throttle Characterstic
-#define BLE_UUID_GLOVE_DIRECTION_CHARACTERISTC_UUID         0x10A1 // Glove Service Direction Characterstic
-
+// @01c AnglePitch (0x1001), Throttle (0x10A0) and Direction (0x10A1) are
+//      replaced by the Control characteristic.
+#define BLE_UUID_GLOVE_CONTROL_CHARACTERISTC_UUID           0x10B0 // Glove Service Control Characterstic @01a
+#define BLE_UUID_GLOVE_STREAM_CHARACTERISTC_UUID            0x10B2 // Glove Service Stream Characterstic @02a
+#define BLE_UUID_GLOVE_DB_VERSION_CHARACTERISTC_UUID        0x10B3 // Glove Service Database Version Characterstic @05a
+
+// @01a The control frame, as sent by the glove (see Service_Glove.h).
+// All values are little endian:
+//      byte 0      version (CLIENT_GLOVE_CONTROL_VERSION)
+//      byte 1      sequence number, incremented for every frame
+//      bytes 2-5   timestamp: IMU sample index of the angles (1/416s)
+//      bytes 6-7   pitch in centidegrees (int16)
+//      bytes 8-9   roll in centidegrees (int16)
+//      byte 10     throttle, 0 to 100
+//      byte 11     direction: forward(1) or backward(0)
+// A longer frame of the same version is accepted; the extra bytes are
+// fields added by a newer glove.
+#define CLIENT_GLOVE_CONTROL_VERSION                        1
+#define CLIENT_GLOVE_CONTROL_LEN                            12
+
+// @02a The raw IMU stream of the glove is only enabled for capturing the
+// sensor data, as it keeps the radio busy. Its frames (see Service_Stream.h
+// of the glove) are not decoded here, they are forwarded as they are.
+#ifndef CLIENT_GLOVE_STREAM_ENABLED
+    #define CLIENT_GLOVE_STREAM_ENABLED                     0
+#endif
+#define CLIENT_GLOVE_STREAM_FRAME_LEN                       20 // The longest stream frame
+
+// @03a The handles found by discovery are kept in flash, with the address
+// of the glove, so that a reconnect can skip discovery. @05c This is the
+// version of the glove's attribute table the client is built for, and must
+// match SERVICE_GLOVE_DB_VERSION of the glove. On a reconnect the glove's
+// Database Version characteristic is read and checked against it, so a
+// glove that was updated since the handles were cached is discovered
+// again; so are handles cached by a client built for another version.
+#define CLIENT_GLOVE_DB_VERSION                             2
+
+// @01a The decoded control frame
+typedef struct
+{
+    uint8_t     sequence;   // Incremented by the glove for every frame
+    uint32_t    timestamp;  // IMU sample index the angles were computed from
+    int16_t     pitch;      // Pitch in centidegrees
+    int16_t     roll;       // Roll in centidegrees
+    uint8_t     throttle;   // 0 to 100
+    uint8_t     direction;  // forward(1) or backward(0)
+} Client_Glove_Control_t;
 
 // The types of the events from the glove client
 // For the most part these are when either characteristics
@@ -43,10 +92,10 @@
 // or when there is a disconnect event.
 typedef enum
 {
-    Client_Glove_Event_ANGLEPITCH_UPDATED = 1, // Event indicating that the central device has received an updated pitch angle value
-    Client_Glove_Event_THROTTLE_UPDATED,       // Event indicating that the central device has received an updated throttle value
-    Client_Glove_Event_DIRECTION_UPDATED,      // Event indicating that the central device has received an updated direction value
-    Client_Glove_Event_DISCONNECTED            // Event indicating that the Glove server (peripheral) has disconnected.
+    Client_Glove_Event_CONTROL_UPDATED = 1,    // @01c Event indicating that the central device has received a new control frame
+    Client_Glove_Event_STREAM_RECEIVED,        // @02a Event indicating that a stream frame was received (in p_data)
+    Client_Glove_Event_DISCONNECTED,           // Event indicating that the Glove server (peripheral) has disconnected.
+    Client_Glove_Event_SUBSCRIBED              // @04a Event indicating that the glove accepted all notification enables
 } Client_Glove_Event_Type_t;
 
 
@@ -59,6 +108,7 @@ typedef struct
     uint16_t                    conn_handle; // The connection handle for the glove client.
     uint8_t                     * p_data; // The data corresponding to the event type
     uint8_t                     data_len; // The length of the data received
+    const Client_Glove_Control_t * control; // @01a The decoded frame for Client_Glove_Event_CONTROL_UPDATED
 } Client_Glove_Event_t;
 
 /*****************************************************************************
@@ -76,12 +126,12 @@ typedef void (* Client_Glove_Event_Handler_t)(const Client_Glove_Event_t * event
 
 // Client initialization structure.
 // This is used to pass all data required to initialize the glove
-// client. In our case the only interesting data is the event handler.
-// This could be simplified to not require a structure, but is left
-// in its complex form in case additional variables are added down the road.
+// client: the event handler, @03a and the discovery instance the client
+// starts when the cached handles can't be used.
 typedef struct
 {
     Client_Glove_Event_Handler_t evt_handler;
+    ble_db_discovery_t           * db_discovery; // @03a
 } Client_Glove_Init_t;
 
 
@@ -91,7 +141,9 @@ typedef struct
  *              for the correct UUID type of the glove.                      *
  *              and will also register the application event handler passed  *
  *              to it. In addition, all variables for the Glove client are   *
- *              initialized to their default values.                         *
+ *              initialized to their default values, and the cached handles  *
+ *              are read from flash (Storage_Flash_Init must be called       *
+ *              first).                                                 @03c *
  *                                                                           *
  * Returns: NRF_SUCCESS if everything was initialized successfully.          *
  *          Otherwise and error code is returned. For example if the         *
@@ -127,8 +179,12 @@ void Client_Glove_DiscoveryEventHandler(ble_db_discovery_evt_t * event);
  *              by validating connection handles.                            *
  *                                                                           *
  *              Types of events include:                                     *
+ *                  Connect -> checks the cached handles are still right, or *
+ *                      starts discovery if they can't be used.         @03a *
  *                  Receiving a notification -> will call proper application *
  *                      event handler.                                       *
+ *                  Write response -> sends the next queued CCCD write, and  *
+ *                      tells the application once all are done.        @04a *
  *                  Disconnect -> will invalidate handles, and call the      *
  *                      application disconnect event handler.                *
  *                                                                           *
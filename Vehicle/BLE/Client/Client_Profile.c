@@ -0,0 +1,270 @@
+/*****************************************************************************
+* FILENAME: Client_Profile.c                                                 *
+*                                                                            *
+* DESCRIPTION: Connection parameter profiles of the vehicle, see             *
+*              Client_Profile.h.                                             *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Client_Profile.h"
+
+#define MS_PER_SECOND           1000
+
+// The drive profile, which the vehicle switches to itself
+static const ble_gap_conn_params_t mDriveParams =
+{
+    .min_conn_interval = (uint16_t)CLIENT_PROFILE_DRIVE_MIN_INTERVAL,
+    .max_conn_interval = (uint16_t)CLIENT_PROFILE_DRIVE_MAX_INTERVAL,
+    .slave_latency     = CLIENT_PROFILE_DRIVE_SLAVE_LATENCY,
+    .conn_sup_timeout  = (uint16_t)CLIENT_PROFILE_DRIVE_SUP_TIMEOUT
+};
+
+// Private variables
+static uint16_t     mConnHandle = BLE_CONN_HANDLE_INVALID; // The connection to the glove
+static uint16_t     mInterval = 0;          // The connection interval (1.25ms)
+static bool         mUpdatePending = false; // A parameter update was started and has not completed
+static bool         mReplyPending = false;  // The answer to a request was refused as busy
+static ble_gap_conn_params_t mReply;        // The answer to send again
+static bool         mHasControl = false;    // A control frame was received on this connection
+static uint32_t     mLastTimestamp = 0;     // Timestamp of the last control frame
+static uint32_t     mActiveTimestamp = 0;   // Timestamp of the last frame the glove was in use
+static int16_t      mLastPitch = 0;         // Pitch of the last control frame
+
+// Private functions
+static bool pIsActive(); // Has the glove been used recently?
+static void pNegotiate(const ble_gap_conn_params_t * requested, ble_gap_conn_params_t * chosen);
+static void pSendReply(); // Answers the last update request
+static uint16_t pClamp(uint16_t value, uint16_t min, uint16_t max);
+
+/*****************************************************************************
+ ****************Start of Public Function Implementations ********************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Handles the bluetooth events of the connection parameters:   *
+ *              tracks the connection and its interval, and answers the      *
+ *              parameter update requests of the glove.                      *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: event -> event from the bluetooth stack                       *
+ *                                                                           *
+ *****************************************************************************/
+void Client_Profile_BLEEventHandler(const ble_evt_t * event)
+{
+    const ble_gap_evt_t * gapEvent = &event->evt.gap_evt;
+
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            mConnHandle = gapEvent->conn_handle;
+            mInterval = gapEvent->params.connected.conn_params.max_conn_interval;
+            mUpdatePending = false;
+            mReplyPending = false;
+            mHasControl = false;
+            break;
+        }
+        case BLE_GAP_EVT_DISCONNECTED:
+        {
+            mConnHandle = BLE_CONN_HANDLE_INVALID;
+            mInterval = 0;
+            mReplyPending = false;
+            break;
+        }
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+        {
+            mInterval = gapEvent->params.conn_param_update.conn_params.max_conn_interval;
+            mUpdatePending = false;
+
+            // The stack was busy with this update when the glove asked
+            if(mReplyPending)
+            {
+                pSendReply();
+            }
+            break;
+        }
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST:
+        {
+            // The drive update the vehicle started itself already answers
+            // the glove; asking again would only be refused as busy.
+            if(mUpdatePending)
+            {
+                break;
+            }
+
+            // Rather than accepting whatever the glove asks for, answer
+            // with what the vehicle accepts.
+            pNegotiate(&gapEvent->params.conn_param_update_request.conn_params, &mReply);
+            pSendReply();
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Description: Called with each control frame from the glove. Decides if    *
+ *              the glove is in use, and switches to the drive profile if    *
+ *              it is.                                                       *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: control -> the control frame                                  *
+ *                                                                           *
+ *****************************************************************************/
+void Client_Profile_Update(const Client_Glove_Control_t * control)
+{
+    bool active = (control->throttle > CLIENT_PROFILE_ACTIVE_THROTTLE);
+
+    // The pitch rate, from the glove's own timestamps so it does not
+    // depend on when the frames arrive
+    uint32_t samples = control->timestamp - mLastTimestamp;
+    if(mHasControl && samples > 0)
+    {
+        int32_t pitchChange = (int32_t)control->pitch - mLastPitch;
+        pitchChange = (pitchChange < 0) ? -pitchChange : pitchChange;
+        if((uint32_t)pitchChange * CLIENT_PROFILE_TIMESTAMP_HZ >= (uint32_t)CLIENT_PROFILE_ACTIVE_PITCH_RATE * samples)
+        {
+            active = true;
+        }
+    }
+
+    mLastTimestamp = control->timestamp;
+    mLastPitch = control->pitch;
+    if(active || !mHasControl)
+    {
+        mActiveTimestamp = control->timestamp;
+    }
+    mHasControl = true;
+
+    // Don't wait for the glove to ask; the vehicle sees the throttle first
+    if(active && mInterval > CLIENT_PROFILE_DRIVE_MAX_INTERVAL
+        && !mUpdatePending && mConnHandle != BLE_CONN_HANDLE_INVALID)
+    {
+        if(sd_ble_gap_conn_param_update(mConnHandle, &mDriveParams) == NRF_SUCCESS)
+        {
+            mUpdatePending = true;
+        }
+    }
+}
+
+/*****************************************************************************
+ ****************Start of Private Function Implementations *******************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Checks if the glove has been in use within the idle delay.   *
+ *                                                                           *
+ * Returns: true if it has (or there were no control frames yet)             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static bool pIsActive()
+{
+    if(!mHasControl)
+    {
+        return true;
+    }
+
+    uint32_t idleSamples = mLastTimestamp - mActiveTimestamp;
+    return (idleSamples * MS_PER_SECOND) < ((uint32_t)CLIENT_PROFILE_IDLE_DELAY_MS * CLIENT_PROFILE_TIMESTAMP_HZ);
+}
+
+/*****************************************************************************
+ * Description: Chooses the parameters to answer an update request with.     *
+ *              The idle profile is refused while the glove is in use, and   *
+ *              anything asked for is kept between the limits of the drive   *
+ *              and idle profiles.                                           *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: requested -> the parameters the glove asked for               *
+ *             chosen    -> the parameters to use                            *
+ *                                                                           *
+ *****************************************************************************/
+static void pNegotiate(const ble_gap_conn_params_t * requested, ble_gap_conn_params_t * chosen)
+{
+    bool slower = (requested->min_conn_interval > CLIENT_PROFILE_DRIVE_MAX_INTERVAL);
+    if(slower && pIsActive())
+    {
+        *chosen = mDriveParams;
+        return;
+    }
+
+    // The limits keep the supervision timeout longer than the (1 + latency)
+    // x 2 intervals the specification asks for.
+    chosen->min_conn_interval = pClamp(requested->min_conn_interval,
+                                       (uint16_t)CLIENT_PROFILE_DRIVE_MIN_INTERVAL,
+                                       (uint16_t)CLIENT_PROFILE_IDLE_MAX_INTERVAL);
+    chosen->max_conn_interval = pClamp(requested->max_conn_interval,
+                                       chosen->min_conn_interval,
+                                       (uint16_t)CLIENT_PROFILE_IDLE_MAX_INTERVAL);
+    chosen->slave_latency     = pClamp(requested->slave_latency,
+                                       0,
+                                       CLIENT_PROFILE_IDLE_SLAVE_LATENCY);
+    chosen->conn_sup_timeout  = pClamp(requested->conn_sup_timeout,
+                                       (uint16_t)CLIENT_PROFILE_DRIVE_SUP_TIMEOUT,
+                                       (uint16_t)CLIENT_PROFILE_IDLE_SUP_TIMEOUT);
+}
+
+/*****************************************************************************
+ * Description: Answers the last update request of the glove with mReply. If *
+ *              the stack is still busy with another update, the answer is   *
+ *              sent again once that update completes.                       *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pSendReply()
+{
+    uint32_t err_code = sd_ble_gap_conn_param_update(mConnHandle, &mReply);
+    if(err_code == NRF_ERROR_BUSY)
+    {
+        mReplyPending = true;
+        return;
+    }
+    APP_ERROR_CHECK(err_code);
+
+    mReplyPending = false;
+    mUpdatePending = true;
+}
+
+/*****************************************************************************
+ * Description: Limits a value to a range                                    *
+ *                                                                           *
+ * Returns: The value, or the nearest limit                                  *
+ *                                                                           *
+ * Parameters: value, min, max -> the value and the range                    *
+ *                                                                           *
+ *****************************************************************************/
+static uint16_t pClamp(uint16_t value, uint16_t min, uint16_t max)
+{
+    if(value < min)
+    {
+        return min;
+    }
+    if(value > max)
+    {
+        return max;
+    }
+    return value;
+}
@@ -0,0 +1,89 @@
+/*****************************************************************************
+* FILENAME: Client_Profile.h                                                 *
+*                                                                            *
+* DESCRIPTION: Connection parameter profiles of the vehicle. The glove asks  *
+*              for a drive or an idle profile; the vehicle answers with what *
+*              it accepts rather than whatever was asked, and switches to    *
+*              the drive profile itself as soon as the glove is used.        *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef _CLIENT_PROFILE_H_
+#define _CLIENT_PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "NordicSDK.h"
+#include "Client_Glove.h"
+
+// The connection parameter profiles, the same as the glove's
+// (see Service_Profile.h).
+typedef enum
+{
+    CLIENT_PROFILE_DRIVE = 0,   // Shortest interval, no latency
+    CLIENT_PROFILE_IDLE,        // Long interval, with slave latency
+    CLIENT_PROFILE_COUNT
+} Client_Profile_t;
+
+// Drive: 7.5ms (the shortest allowed) to 15ms
+#define CLIENT_PROFILE_DRIVE_MIN_INTERVAL       MSEC_TO_UNITS(7.5, UNIT_1_25_MS)
+#define CLIENT_PROFILE_DRIVE_MAX_INTERVAL       MSEC_TO_UNITS(15, UNIT_1_25_MS)
+#define CLIENT_PROFILE_DRIVE_SLAVE_LATENCY      0
+#define CLIENT_PROFILE_DRIVE_SUP_TIMEOUT        MSEC_TO_UNITS(4000, UNIT_10_MS)
+
+// Idle: 100ms to 200ms, with up to 4 skipped events
+#define CLIENT_PROFILE_IDLE_MIN_INTERVAL        MSEC_TO_UNITS(100, UNIT_1_25_MS)
+#define CLIENT_PROFILE_IDLE_MAX_INTERVAL        MSEC_TO_UNITS(200, UNIT_1_25_MS)
+#define CLIENT_PROFILE_IDLE_SLAVE_LATENCY       4
+#define CLIENT_PROFILE_IDLE_SUP_TIMEOUT         MSEC_TO_UNITS(6000, UNIT_10_MS)
+
+// The control frame timestamps count IMU samples of the glove
+#define CLIENT_PROFILE_TIMESTAMP_HZ             416
+
+// The glove is in use while the throttle is above this, or while the
+// pitch changes at least this fast (centidegrees per second).
+#define CLIENT_PROFILE_ACTIVE_THROTTLE          0
+#define CLIENT_PROFILE_ACTIVE_PITCH_RATE        2000
+
+// The idle profile is only granted once the glove has not been used for
+// this long. Shorter than the glove's own delay, as the vehicle only sees
+// a keep-alive frame a second while the glove is still.
+#define CLIENT_PROFILE_IDLE_DELAY_MS            3000
+
+/*****************************************************************************
+ * Description: Handles the bluetooth events of the connection parameters:   *
+ *              tracks the connection and its interval, and answers the      *
+ *              parameter update requests of the glove.                      *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: event -> event from the bluetooth stack                       *
+ *                                                                           *
+ *****************************************************************************/
+void Client_Profile_BLEEventHandler(const ble_evt_t * event);
+
+/*****************************************************************************
+ * Description: Called with each control frame from the glove. Decides if    *
+ *              the glove is in use, and switches to the drive profile if    *
+ *              it is.                                                       *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: control -> the control frame                                  *
+ *                                                                           *
+ *****************************************************************************/
+void Client_Profile_Update(const Client_Glove_Control_t * control);
+
+#endif
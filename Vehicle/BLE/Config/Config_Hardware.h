@@ -14,6 +14,7 @@
 * | Flag    | (DDMYY)  | Author     | Description                         |  *
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 18Apr17  | BNordland  | Initial creation                    |  *
+* | @01     | 17Oct26  | BNordland  | Data ready line to the controller   |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
@@ -42,3 +43,10 @@
 #ifndef HDW_CONFIG_SPI_SCK_PIN
     #define HDW_CONFIG_SPI_SCK_PIN 8
 #endif
+
+// @01a The data ready line to the controller, high while the SPI slave
+// holds a frame the controller has not read. Wired to PD2 (INT2) of the
+// A* controller.
+#ifndef HDW_CONFIG_DATA_READY_PIN
+    #define HDW_CONFIG_DATA_READY_PIN 4
+#endif
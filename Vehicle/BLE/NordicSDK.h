@@ -15,6 +15,9 @@
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 16Apr17  | BNordland  | Initial creation                    |  *
 * | @01     | 18Apr17  | BNordland  | Add SPI Slave Driver                |  *
+* | @02     | 17Oct26  | BNordland  | Add critical regions                |  *
+* | @03     | 17Oct26  | BNordland  | Add flash data storage              |  *
+* | @04     | 17Oct26  | BNordland  | Add GPIOTE for the data ready line  |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
@@ -35,3 +38,7 @@
 #include "nrf_gpio.h"
 #include "nrf_delay.h"
 #include "nrf_drv_spis.h" // @01a - SPI Slave Driver
+#include "app_util_platform.h" // @02a - Critical regions
+#include "fstorage.h" // @03a - Flash storage
+#include "fds.h" // @03a - Flash data storage
+#include "nrf_drv_gpiote.h" // @04a - Data ready line
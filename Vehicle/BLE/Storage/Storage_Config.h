@@ -0,0 +1,41 @@
+/*****************************************************************************
+* FILENAME: Storage_Config.h                                                 *
+*                                                                            *
+* DESCRIPTION: The vehicle's flash records, for the shared Storage_Flash in  *
+*              Common/Storage.                                               *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation, from              |  *
+* |         |          |            | Storage_Flash.h                     |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef STORAGE_CONFIG_H__
+#define STORAGE_CONFIG_H__
+
+// The fds file that holds all of the vehicle records
+#define STORAGE_FLASH_FILE_ID               0x1000
+
+// The keys of the vehicle records (0x0000 is not a valid key)
+#define STORAGE_FLASH_KEY_GLOVE_HANDLES     0x0001  // Client_Glove handle cache
+
+// The largest record that can be written, in bytes
+#ifndef STORAGE_FLASH_MAX_RECORD_BYTES
+    #define STORAGE_FLASH_MAX_RECORD_BYTES  32
+#endif
+
+// The number of writes that can be in progress at the same time
+#ifndef STORAGE_FLASH_WRITE_SLOTS
+    #define STORAGE_FLASH_WRITE_SLOTS       1
+#endif
+
+#endif /* STORAGE_CONFIG_H__ */
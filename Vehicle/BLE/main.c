@@ -20,6 +20,15 @@
 * |---------|----------|------------|-------------------------------------   *
 * | None    | 16Apr17  | BNordland  | Initial creation                    |  *
 * | @01     | 19Apr17  | BNordland  | Clear out data on disconnect.       |  *
+* | @02     | 17Oct26  | BNordland  | Single packed control notification  |  *
+* | @03     | 17Oct26  | BNordland  | Negotiated connection profiles      |  *
+* | @04     | 17Oct26  | BNordland  | Forward the raw IMU stream          |  *
+* | @05     | 17Oct26  | BNordland  | Reconnect to the last glove         |  *
+* | @06     | 17Oct26  | BNordland  | Cached glove handles in flash       |  *
+* | @07     | 17Oct26  | BNordland  | LED on once notifications enabled   |  *
+* | @08     | 17Oct26  | BNordland  | Double buffered SPI handoff         |  *
+* | @09     | 17Oct26  | BNordland  | Framed, CRC checked SPI link        |  *
+* | @10     | 17Oct26  | BNordland  | Data ready line to the controller   |  *
 *  ------------------------------------------------------------------------  *
 ******************************************************************************/
 
@@ -34,6 +43,15 @@
 // The glove client
 #include "Client_Glove.h"
 
+// @03a The connection parameter profiles
+#include "Client_Profile.h"
+
+// @06a Persistent storage, for the glove handle cache
+#include "Storage_Flash.h"
+
+// @09a The frames of the SPI link, shared with the controller
+#include "Link_Frame.h"
+
 #define APP_TIMER_PRESCALER     0                               // RTC1 PRESCALER register.
 #define APP_TIMER_OP_QUEUE_SIZE 2                               // Size of timer operation queues.
 
@@ -64,26 +82,99 @@
         #endif
     };
 
+    // @05a The last glove connected to; only it is connected to while reconnecting
+    static ble_gap_addr_t mGloveAddress;
+    static ble_gap_addr_t * mGloveWhitelistAddrs[] = { &mGloveAddress };
+    static ble_gap_whitelist_t mGloveWhitelist =
+    {
+        .pp_addrs   = mGloveWhitelistAddrs,
+        .addr_count = 1,
+        .pp_irks    = NULL,
+        .irk_count  = 0,
+    };
+
+    // @05a Parameters used when reconnecting. With the whitelist the
+    // SoftDevice connects on the first packet from the glove, directed or
+    // not, without an advertising report in between.
+    static const ble_gap_scan_params_t mReconnectScanParams =
+    {
+        .active   = 0,
+        .interval = RECONNECT_SCAN_INTERVAL,
+        .window   = RECONNECT_SCAN_WINDOW,
+        .timeout  = RECONNECT_TIMEOUT,
+        #if (NRF_SD_BLE_API_VERSION == 2)
+            .selective   = 1,
+            .p_whitelist = &mGloveWhitelist,
+        #endif
+        #if (NRF_SD_BLE_API_VERSION == 3)
+            .use_whitelist = 1,
+        #endif
+    };
+
 // Structure definitions
-// Application data is stored in a structure for ease of sending
-// via SPI when requested by the SPI master (A* Controller)
+// Application data is stored in a structure, and sent in the command
+// frames to the SPI master (A* Controller) @09c
 typedef struct AppData
 {
-    uint16_t    anglePitch; // The pitch angle of the glove
+    int16_t     anglePitch; // The pitch angle of the glove, whole degrees @09c
     uint8_t     direction; // The direction - forward(1) or backward(0)
     uint8_t     throttle;  // The throttle - 0-100;
 
 } AppData_t;
 
+// @09a What the controller reports in its telemetry frames
+typedef struct ControllerData
+{
+    uint8_t     ack;        // Sequence number of the last command frame it accepted
+    uint8_t     errors;     // Command frames it rejected (wraps)
+    uint8_t     leftDuty;   // Left motor duty cycle
+    uint8_t     rightDuty;  // Right motor duty cycle
+    uint16_t    distance;   // Distance to the nearest obstacle ahead in cm
+
+} ControllerData_t;
+
+// @04a Raw IMU stream frames of the glove, forwarded to the controller
+// in the command frames. @09c The frames of a command are taken off the
+// queue once the controller has clocked out the whole command; otherwise
+// they are sent again in the next one.
+#define STREAM_QUEUE_LEN    16  // Stream frames waiting for the controller
+STATIC_ASSERT(CLIENT_GLOVE_STREAM_FRAME_LEN == LINK_STREAM_FRAME_LEN); // @09a
+
 // Global Variables
 static ble_db_discovery_t       mDbDiscovery;    // Database discovery module instance
 static AppData_t                mAppData; // The application data structure.
 
 #define SPIS_INSTANCE 1 /**< SPIS instance index. */
+#define DATA_READY_PPI_CHANNEL 0 // @10a Clears the data ready line at the end of a transfer
 static const nrf_drv_spis_t mSPIsDriver = NRF_DRV_SPIS_INSTANCE(SPIS_INSTANCE); // SPI Slave Driver
-static uint8_t       mRxBuffer[sizeof(AppData_t) + 1]; // RxBuffer that is the size AppData + 1 buffer byte
-static AppData_t                mTxBuffer; // The transmit buffer
-static volatile bool mSPITxComplete; //Indicates if the SPI transfer is done
+static uint8_t       mRxBuffer[LINK_FRAME_MAX_LEN]; // The telemetry frame of the controller @09c
+
+// @08c Two transmit buffers, so that a new frame can be filled while the
+// SPI slave owns the other. A buffer is only written when the SPI slave
+// neither has it nor has been asked to take it, so the controller always
+// reads a complete frame.
+static uint8_t       mTxBuffers[2][LINK_FRAME_MAX_LEN]; // @09c Command frames
+static uint8_t       mTxLength[2];                      // @09a Length of each command frame
+static uint8_t       mTxStreamCount[2];                 // @09a Stream frames in each command frame
+static uint8_t       mTxSequence = 0;                   // @09a Sequence number of the next command frame
+static uint8_t       mTxPublished = 0;                  // @09a Publish count, see LINK_COMMAND_PUBLISHED
+static uint8_t       mTxArmed = 0;              // @08a The buffer last given to the SPI slave
+static bool          mTxSetPending = false;     // @08a The SPI slave has not taken mTxBuffers[mTxArmed] yet
+static bool          mTxPublishPending = false; // @08a A frame was published while the SPI slave could not take it
+static bool          mTxFresh = false;          // @10a Something new to send since the last buffer was filled
+static bool          mTxReady[2];               // @10a The buffer holds something the controller has not read
+
+// @04a Stream frames waiting for the controller
+static uint8_t       mStreamQueue[STREAM_QUEUE_LEN][CLIENT_GLOVE_STREAM_FRAME_LEN];
+static uint8_t       mStreamHead;    // Oldest frame in the queue
+static uint8_t       mStreamCount;   // Frames in the queue
+static uint8_t       mStreamDropped; // Frames dropped because the queue was full
+
+// @09a The last telemetry of the controller
+static ControllerData_t mControllerData;
+static uint8_t       mTelemetryErrors; // Telemetry frames rejected (wraps)
+
+static bool          mGloveKnown = false; // @05a mGloveAddress is valid
 
 // Function Definitions
     // Functions Required for Setup
@@ -91,16 +182,25 @@ static volatile bool mSPITxComplete; //Indicates if the SPI transfer is done
     static void pSetupDbDiscovery(); // Called to setup bluetooth discovery
     static void pSetupBLEStack(); // sets up the Nordic bluetooth stack
     static void pSetupGloveClient(); // sets up the glove client
+    static void pSetupDataReady(); // @10a sets up the data ready line to the controller
 
     // Required for Starting
     static void pStartScanning();
+    static void pStartReconnect(); // @05a Connects to the last glove
     static void pBLEEventHandler(ble_evt_t * event); // Dispatches bluetooth events to all modules
     static void pBLEEventHandlerImpl(ble_evt_t * event); // Handles bluetooth events for our main application
 
     // Functions required for event handling
     static void pDbDiscoveryEventHandler(ble_db_discovery_evt_t * event); // Handles events
+    static void pSystemEventHandler(uint32_t event); // @06a Forwards system events to fstorage
     static void pGloveClientEventHandler(const Client_Glove_Event_t * event); // Handles events from the glove client
     static void pSPIEventHandler(nrf_drv_spis_event_t event);
+    static void pQueueStreamFrame(const uint8_t * frame, uint8_t length); // @04a Queues a frame for the controller
+    static void pDequeueSentFrames(uint32_t txAmount); // @08c Drops the stream frames the controller read
+    static void pFillTxBuffer(uint8_t index); // @08c Fills the next SPI transfer
+    static void pHandleTelemetry(uint32_t rxAmount); // @09a Decodes the frame the controller sent
+    static void pArmTxBuffer(bool slaveIdle); // @08a Gives the newest frame to the SPI slave
+    static void pPublishAppData(const AppData_t * appData); // @08a Sends new application data to the controller
 
     // Helper functions
     static bool isUuidInReport(const ble_uuid_t *targetUuid, const ble_gap_evt_adv_report_t *report);
@@ -118,12 +218,14 @@ int main(void)
 {
     // @01c - to start with, until we are connected, we don't want to move
     memset(&mAppData, 0x00, sizeof(mAppData));
-    memset(&mTxBuffer, 0x00, sizeof(mTxBuffer));
+    memset(mTxBuffers, 0x00, sizeof(mTxBuffers)); // @08c
+    memset(&mControllerData, 0x00, sizeof(mControllerData)); // @09a
 
     // Initialize and setup hardware
     pSetupTimers();
     pSetupDbDiscovery();
     pSetupBLEStack();
+    Storage_Flash_Init(); // @06a Before the glove client, which reads its cache
 
     // Prepare the glove client
     pSetupGloveClient();
@@ -142,18 +244,14 @@ int main(void)
     spis_config.sck_pin               = HDW_CONFIG_SPI_SCK_PIN;
     APP_ERROR_CHECK(nrf_drv_spis_init(&mSPIsDriver, &spis_config, pSPIEventHandler));
     // TODO: we should create a Comm_SPISlave
+    pSetupDataReady(); // @10a After the SPI slave, whose END event it uses
 
+    // @08c The SPI slave is re-armed from its event handler after every
+    // transfer, and whenever the glove sends new data.
+    pArmTxBuffer(true);
 
     while(1)
     {
-        mSPITxComplete = false;
-
-        APP_ERROR_CHECK(nrf_drv_spis_buffers_set(&mSPIsDriver, (uint8_t*)&mTxBuffer, sizeof(AppData_t), mRxBuffer, sizeof(AppData_t)));
-
-        while (!mSPITxComplete)
-        {
-            __WFE();
-        }
         // Perform device power management
         uint32_t err_code = sd_app_evt_wait();
         APP_ERROR_CHECK(err_code);
@@ -170,10 +268,221 @@ void pSPIEventHandler(nrf_drv_spis_event_t event)
     {
         if (event.evt_type == NRF_DRV_SPIS_XFER_DONE)
         {
-            memcpy(&mTxBuffer, &mAppData, sizeof(AppData_t)); // copy the new tx buffer
-            mSPITxComplete = true;
+            // @08c The slave holds no buffer until it is re-armed
+            pHandleTelemetry(event.rx_amount); // @09a
+            pDequeueSentFrames(event.tx_amount);
+            pArmTxBuffer(true);
         }
+        else if (event.evt_type == NRF_DRV_SPIS_BUFFERS_SET_DONE)
+        {
+            // @08a The slave took the buffer; publish what arrived meanwhile
+            mTxSetPending = false;
+            if (mTxPublishPending)
+            {
+                pArmTxBuffer(false);
+            }
+            else if (mTxReady[mTxArmed])
+            {
+                // @10a Tell the controller there is a new frame to read. The
+                // end of its transfer clears the line through PPI.
+                nrf_drv_gpiote_out_task_force(HDW_CONFIG_DATA_READY_PIN, 1);
+            }
+        }
+    }
+
+/*****************************************************************************
+ * Description: Takes the stream frames the controller clocked out in the    *
+ *              last transfer off the queue. They are only taken off if the  *
+ *              whole command frame was clocked out, so that the controller  *
+ *              could check its CRC.                                    @09c *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: txAmount -> bytes the controller clocked out last transfer    *
+ *                                                                           *
+ *****************************************************************************/
+static void pDequeueSentFrames(uint32_t txAmount)
+{
+    uint8_t sent = 0;
+    if(txAmount >= mTxLength[mTxArmed])
+    {
+        sent = mTxStreamCount[mTxArmed];
+    }
+
+    // The bluetooth events add frames at the same time
+    CRITICAL_REGION_ENTER();
+    mStreamHead = (mStreamHead + sent) % STREAM_QUEUE_LEN;
+    mStreamCount -= sent;
+    CRITICAL_REGION_EXIT();
+}
+
+/*****************************************************************************
+ * Description: Fills a transmit buffer for the next SPI transfer with a     *
+ *              command frame: the newest application data, and the oldest   *
+ *              stream frames.                                          @09c *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: index -> the buffer to fill                                   *
+ *                                                                           *
+ *****************************************************************************/
+static void pFillTxBuffer(uint8_t index)
+{
+    // The payload is built in place, after the header
+    uint8_t * payload = &mTxBuffers[index][LINK_FRAME_HEADER_LEN];
+    uint8_t   count;
+
+    // The bluetooth events add frames, and publish data, at the same time
+    CRITICAL_REGION_ENTER();
+    Link_Frame_PutUInt16(&payload[LINK_COMMAND_PITCH], (uint16_t)mAppData.anglePitch);
+    payload[LINK_COMMAND_DIRECTION] = mAppData.direction;
+    payload[LINK_COMMAND_THROTTLE]  = mAppData.throttle;
+    payload[LINK_COMMAND_PUBLISHED] = mTxPublished;
+
+    count = (mStreamCount < LINK_STREAM_MAX_FRAMES) ? mStreamCount : LINK_STREAM_MAX_FRAMES;
+    payload[LINK_COMMAND_STREAM_COUNT]   = count;
+    payload[LINK_COMMAND_STREAM_DROPPED] = mStreamDropped;
+    for(uint8_t i = 0; i < count; i++)
+    {
+        memcpy(&payload[LINK_COMMAND_STREAM + (i * LINK_STREAM_FRAME_LEN)],
+               mStreamQueue[(mStreamHead + i) % STREAM_QUEUE_LEN], LINK_STREAM_FRAME_LEN);
+    }
+    mTxReady[index] = mTxFresh || (count > 0); // @10a
+    mTxFresh = false;
+    CRITICAL_REGION_EXIT();
+
+    mTxStreamCount[index] = count;
+    mTxLength[index] = Link_Frame_Encode(mTxBuffers[index], LINK_FRAME_TYPE_COMMAND, mTxSequence++,
+                                         payload, LINK_COMMAND_STREAM + (count * LINK_STREAM_FRAME_LEN));
+}
+
+/*****************************************************************************
+ * Description: Decodes the telemetry frame the controller clocked in with   *
+ *              the last transfer. A frame that is cut short or corrupted is *
+ *              counted and dropped; the last good telemetry is kept.   @09a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: rxAmount -> bytes the controller clocked in last transfer     *
+ *                                                                           *
+ *****************************************************************************/
+static void pHandleTelemetry(uint32_t rxAmount)
+{
+    Link_Frame_t frame;
+
+    if(Link_Frame_Decode(mRxBuffer, (uint16_t)rxAmount, LINK_FRAME_TYPE_TELEMETRY, &frame) != Link_Frame_OK
+        || frame.length < LINK_TELEMETRY_LEN)
+    {
+        mTelemetryErrors++;
+        return;
+    }
+
+    mControllerData.ack       = frame.payload[LINK_TELEMETRY_ACK];
+    mControllerData.errors    = frame.payload[LINK_TELEMETRY_ERRORS];
+    mControllerData.leftDuty  = frame.payload[LINK_TELEMETRY_LEFT_DUTY];
+    mControllerData.rightDuty = frame.payload[LINK_TELEMETRY_RIGHT_DUTY];
+    mControllerData.distance  = Link_Frame_GetUInt16(&frame.payload[LINK_TELEMETRY_DISTANCE]);
+}
+
+/*****************************************************************************
+ * Description: Fills the buffer the SPI slave does not own with the newest  *
+ *              frame and asks the slave to take it. If the slave is in a    *
+ *              transfer, or has not taken the last buffer yet, this waits   *
+ *              for its next event: the transfer ends with XFER_DONE, which  *
+ *              re-arms anyway, and a pending buffer with BUFFERS_SET_DONE.  *
+ *              Asking for the semaphore in the middle of a transfer would   *
+ *              lose the XFER_DONE of that transfer in the driver.      @08a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: slaveIdle -> true if the slave is known not to be in a        *
+ *                          transfer (it has no buffer, or just finished)    *
+ *                                                                           *
+ *****************************************************************************/
+static void pArmTxBuffer(bool slaveIdle)
+{
+    bool inTransfer = !slaveIdle && (nrf_gpio_pin_read(HDW_CONFIG_SPI_SS_PIN) == 0);
+    if(mTxSetPending || inTransfer)
+    {
+        mTxPublishPending = true;
+        return;
+    }
+
+    // @10a The controller must not start on the buffer being replaced; if
+    // it already has, the CRC of its frame fails and it asks again.
+    nrf_drv_gpiote_out_task_force(HDW_CONFIG_DATA_READY_PIN, 0);
+
+    uint8_t spare = (uint8_t)(1 - mTxArmed);
+    pFillTxBuffer(spare);
+
+    uint32_t err_code = nrf_drv_spis_buffers_set(&mSPIsDriver,
+                                                 mTxBuffers[spare], mTxLength[spare], // @09c
+                                                 mRxBuffer, sizeof(mRxBuffer));
+    APP_ERROR_CHECK(err_code);
+
+    mTxArmed = spare;
+    mTxSetPending = true;
+    mTxPublishPending = false;
+}
+
+/*****************************************************************************
+ * Description: Publishes new application data, and hands it to the SPI      *
+ *              slave straight away so the controller reads it on its next   *
+ *              transfer. The data is replaced as a whole, so a transfer     *
+ *              never mixes old and new fields.                         @08a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: appData -> the new application data                           *
+ *                                                                           *
+ *****************************************************************************/
+static void pPublishAppData(const AppData_t * appData)
+{
+    CRITICAL_REGION_ENTER();
+    mAppData = *appData;
+    mTxPublished++;  // @09a
+    mTxFresh = true; // @10a
+    CRITICAL_REGION_EXIT();
+
+    pArmTxBuffer(false);
+}
+
+/*****************************************************************************
+ * Description: Queues a stream frame of the glove for the controller. If    *
+ *              the controller can't keep up the frame is dropped; the gap   *
+ *              in the frame sequence numbers shows where.              @04a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: frame  -> the stream frame                                    *
+ *             length -> the length of the frame                             *
+ *                                                                           *
+ *****************************************************************************/
+static void pQueueStreamFrame(const uint8_t * frame, uint8_t length)
+{
+    if(length > CLIENT_GLOVE_STREAM_FRAME_LEN)
+    {
+        length = CLIENT_GLOVE_STREAM_FRAME_LEN;
+    }
+
+    CRITICAL_REGION_ENTER();
+    if(mStreamCount < STREAM_QUEUE_LEN)
+    {
+        uint8_t * slot = mStreamQueue[(mStreamHead + mStreamCount) % STREAM_QUEUE_LEN];
+        memset(slot, 0x00, CLIENT_GLOVE_STREAM_FRAME_LEN);
+        memcpy(slot, frame, length);
+        mStreamCount++;
+    }
+    else
+    {
+        mStreamDropped++;
     }
+    mTxPublished++;  // @09a The glove is there, even if the frame was dropped
+    mTxFresh = true; // @10a
+    CRITICAL_REGION_EXIT();
+
+    pArmTxBuffer(false); // @10a Signal the controller straight away
+}
 
 /*****************************************************************************
  * Description: Forwards database discovery events to those interested       *
@@ -213,31 +522,49 @@ void pGloveClientEventHandler(const Client_Glove_Event_t * event)
 {
     switch (event->evt_type)
     {
-        case Client_Glove_Event_ANGLEPITCH_UPDATED:
+        case Client_Glove_Event_CONTROL_UPDATED: // @02c All inputs in one frame
         {
-            mAppData.anglePitch = ((uint16_t)event->p_data[0] << 8) | (uint16_t)event->p_data[1];
+            // The controller works in whole degrees, rounded half away from zero
+            int16_t pitch = event->control->pitch;
+            pitch = (pitch + ((pitch < 0) ? -50 : 50)) / 100;
+
+            // @08c Built whole, then published in one go
+            // @09c The command frame encodes the pitch little endian, so it
+            // is no longer stored byte swapped.
+            AppData_t appData;
+            appData.anglePitch = pitch;
+            appData.throttle = event->control->throttle;
+            appData.direction = event->control->direction;
+            pPublishAppData(&appData);
+
+            // @03a Switch to the drive profile as soon as the glove is used
+            Client_Profile_Update(event->control);
             break;
         }
-        case Client_Glove_Event_THROTTLE_UPDATED:
+        case Client_Glove_Event_SUBSCRIBED:
         {
-            mAppData.throttle = event->p_data[0];
+            // @07c turn on the LED as soon as the glove accepted the
+            // notification enables, rather than on every control frame
+            nrf_gpio_cfg_output(HDW_CONFIG_ONBOARD_LED_PIN);
+            nrf_gpio_pin_clear(HDW_CONFIG_ONBOARD_LED_PIN);
             break;
         }
-        case Client_Glove_Event_DIRECTION_UPDATED:
+        case Client_Glove_Event_STREAM_RECEIVED:
         {
-            mAppData.direction = event->p_data[0];
-            // turn on the LED
-            nrf_gpio_cfg_output(HDW_CONFIG_ONBOARD_LED_PIN);
-            nrf_gpio_pin_clear(HDW_CONFIG_ONBOARD_LED_PIN);
+            // @04a Forwarded to the controller, which sends it out over USB
+            pQueueStreamFrame(event->p_data, event->data_len);
             break;
         }
         case Client_Glove_Event_DISCONNECTED:
         {
             // @01a - disconnected, we want to set all to zero in order to stop activity
-            memset(&mAppData, 0x00, sizeof(mAppData));
+            // @08c and the controller should stop on its very next read
+            AppData_t appData;
+            memset(&appData, 0x00, sizeof(appData));
+            pPublishAppData(&appData);
             nrf_gpio_pin_set(HDW_CONFIG_ONBOARD_LED_PIN);
-            // disconnected, start scanning again.
-            pStartScanning();
+            // @05c Scanning is restarted on the BLE_GAP_EVT_DISCONNECTED, as
+            // this is only raised once the glove service was discovered.
             break;
         }
     }
@@ -262,6 +589,23 @@ static void pBLEEventHandler(ble_evt_t * event)
 
     // Handles events relevant to the glove client, for example when discovery is complete
     Client_Glove_BLEEventHandler(event);
+
+    // @03a Tracks and negotiates the connection parameters
+    Client_Profile_BLEEventHandler(event);
+}
+
+/*****************************************************************************
+ * Description: Forwards system events to required modules             @06a  *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: event -> event details                                        *
+ *                                                                           *
+ *****************************************************************************/
+static void pSystemEventHandler(uint32_t event)
+{
+    // Flash operations complete on SoftDevice system events
+    fs_sys_event_handler(event);
 }
 
 /*****************************************************************************
@@ -301,10 +645,12 @@ static void pBLEEventHandlerImpl(ble_evt_t * event)
         }
         case BLE_GAP_EVT_CONNECTED:
         {
-            // after we are connected, start discovery of services
-            // This will trigger a discovery event that the glove client reacts to.
-            err_code = ble_db_discovery_start(&mDbDiscovery, event->evt.gap_evt.conn_handle);
-            APP_ERROR_CHECK(err_code);
+            // @05a Reconnect to this glove if the link is lost
+            mGloveAddress = gapEvent->params.connected.peer_addr;
+            mGloveKnown = true;
+
+            // @06c The glove client starts discovery of services on the
+            // connected event, unless it has the handles of this glove cached.
             break;
         }
         case BLE_GAP_EVT_TIMEOUT:
@@ -316,21 +662,28 @@ static void pBLEEventHandlerImpl(ble_evt_t * event)
             else if (gapEvent->params.timeout.src == BLE_GAP_TIMEOUT_SRC_CONN)
             {
                 // Connection Request timed out
+                // @05a The last glove did not come back, look for any glove
+                pStartScanning();
             }
             break; // BLE_GAP_EVT_TIMEOUT
         }
-        case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
+        case BLE_GAP_EVT_DISCONNECTED:
         {
-            // Pairing not supported
-            err_code = sd_ble_gap_sec_params_reply(event->evt.gap_evt.conn_handle, BLE_GAP_SEC_STATUS_PAIRING_NOT_SUPP, NULL, NULL);
-            APP_ERROR_CHECK(err_code);
+            // @05a Go straight back to the glove that was lost
+            if (mGloveKnown)
+            {
+                pStartReconnect();
+            }
+            else
+            {
+                pStartScanning();
+            }
             break;
         }
-        case BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST:
+        case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
         {
-            // Accepting parameters requested by peer.
-            err_code = sd_ble_gap_conn_param_update(gapEvent->conn_handle,
-                                                    &gapEvent->params.conn_param_update_request.conn_params);
+            // Pairing not supported
+            err_code = sd_ble_gap_sec_params_reply(event->evt.gap_evt.conn_handle, BLE_GAP_SEC_STATUS_PAIRING_NOT_SUPP, NULL, NULL);
             APP_ERROR_CHECK(err_code);
             break;
         }
@@ -434,6 +787,10 @@ static void pSetupBLEStack()
     // Register with the SoftDevice handler module for BLE events.
     err_code = softdevice_ble_evt_handler_set(pBLEEventHandler);
     APP_ERROR_CHECK(err_code);
+
+    // @06a Register with the SoftDevice handler module for system events.
+    err_code = softdevice_sys_evt_handler_set(pSystemEventHandler);
+    APP_ERROR_CHECK(err_code);
 }
 
 /*****************************************************************************
@@ -449,16 +806,52 @@ static void pSetupBLEStack()
 static void pSetupGloveClient()
 {
     // Set up the init data structure.
-    // The only initialization data required currently
-    // for our glove client is the event handler
+    // The glove client needs our event handler, @06c and the discovery
+    // instance to start when its cached handles can't be used.
     Client_Glove_Init_t glove_init;
     glove_init.evt_handler = pGloveClientEventHandler;
+    glove_init.db_discovery = &mDbDiscovery; // @06a
 
     // Actually perform the init.
     uint32_t err_code = Client_Glove_Init(&glove_init);
     APP_ERROR_CHECK(err_code);
 }
 
+/*****************************************************************************
+ * Description: Sets up the data ready line to the controller. The line is   *
+ *              raised when the SPI slave holds a frame with new data, and   *
+ *              cleared by PPI at the END event of the SPI slave, so it is   *
+ *              low again before the next frame is armed.               @10a *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pSetupDataReady()
+{
+    uint32_t err_code;
+
+    if(!nrf_drv_gpiote_is_init())
+    {
+        APP_ERROR_CHECK(nrf_drv_gpiote_init());
+    }
+
+    // The task clears the line, it is only set by the CPU
+    nrf_drv_gpiote_out_config_t config = GPIOTE_CONFIG_OUT_TASK_LOW;
+    err_code = nrf_drv_gpiote_out_init(HDW_CONFIG_DATA_READY_PIN, &config);
+    APP_ERROR_CHECK(err_code);
+    nrf_drv_gpiote_out_task_enable(HDW_CONFIG_DATA_READY_PIN);
+
+    // PPI is owned by the SoftDevice once it is enabled
+    err_code = sd_ppi_channel_assign(DATA_READY_PPI_CHANNEL,
+                                     (const volatile void *)nrf_spis_event_address_get(mSPIsDriver.p_reg, NRF_SPIS_EVENT_END),
+                                     (const volatile void *)nrf_drv_gpiote_out_task_addr_get(HDW_CONFIG_DATA_READY_PIN));
+    APP_ERROR_CHECK(err_code);
+    err_code = sd_ppi_channel_enable_set(1UL << DATA_READY_PPI_CHANNEL);
+    APP_ERROR_CHECK(err_code);
+}
+
 /*****************************************************************************
  * Description: Starts scanning for bluetooth devices that we can try to     *
  *              connect to.                                                  *
@@ -473,6 +866,23 @@ static void pStartScanning()
     APP_ERROR_CHECK(ret);
 }
 
+/*****************************************************************************
+ * Description: Connects to the last glove, without waiting for it to be     *
+ *              reported by a scan. If it is not found within                *
+ *              RECONNECT_TIMEOUT, a BLE_GAP_EVT_TIMEOUT starts scanning for *
+ *              any glove.                                              @05a *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: None                                                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pStartReconnect()
+{
+    // The address is ignored, the whitelist holds it
+    ret_code_t ret = sd_ble_gap_connect(NULL, &mReconnectScanParams, &mConnectionParam);
+    APP_ERROR_CHECK(ret);
+}
+
 /*****************************************************************************
  *************************Start of Helper Functions***************************
  *****************************************************************************/
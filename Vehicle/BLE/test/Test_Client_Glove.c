@@ -0,0 +1,563 @@
+/*****************************************************************************
+* FILENAME: Test_Client_Glove.c                                              *
+*                                                                            *
+* DESCRIPTION: Host test of the glove client, see Client_Glove.h. The        *
+*              SoftDevice is a fake GATT client: it keeps the writes sent,   *
+*              answers as the test tells it to, and refuses a second write   *
+*              request while one is waiting for its response, as the real    *
+*              one does. Built and run with "make test" in this directory.   *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "Client_Glove.h"
+#include "Storage_Flash.h"
+#include "Test_Check.h"
+
+// The glove, as the fake sees it
+#define CONN_HANDLE             0x0021
+#define CONTROL_HANDLE          0x000E
+#define CONTROL_CCCD_HANDLE     0x000F
+#define STREAM_HANDLE           0x0011
+#define STREAM_CCCD_HANDLE      0x0012
+#define DB_VERSION_HANDLE       0x0015
+#define MAX_WRITES              16
+
+// A CCCD write the client sent
+typedef struct
+{
+    uint16_t    handle;
+    uint8_t     value[BLE_CCCD_VALUE_LEN];
+} Fake_Write_t;
+
+// The fake SoftDevice
+static Fake_Write_t         mWrites[MAX_WRITES];    // Writes sent, in order
+static uint8_t              mWriteCount;            // Writes sent
+static bool                 mWriteOutstanding;      // A write request waits for its response
+static uint8_t              mBusyCount;             // Write calls to refuse as busy
+static uint32_t             mWriteError;            // Error for the next write call, if not NRF_SUCCESS
+static uint8_t              mDiscoveries;           // Discoveries started
+static uint8_t              mProbes;                // Reads by UUID started
+static ble_gattc_handle_range_t mProbeRange;        // Range of the last read by UUID
+static uint16_t             mProbeUuid;             // UUID of the last read by UUID
+static uint8_t              mAppErrors;             // Failed APP_ERROR_CHECKs
+
+// The fake flash
+static uint8_t              mFlash[STORAGE_FLASH_MAX_RECORD_BYTES];
+static uint16_t             mFlashLength;           // 0 if nothing was written
+
+// The events the application was given
+static uint8_t              mSubscribed;
+static uint8_t              mDisconnected;
+static uint8_t              mControlUpdates;
+
+/*****************************************************************************
+ ****************Start of Fake Implementations *******************************
+ *****************************************************************************/
+
+void Fake_AppError(uint32_t errorCode, const char * file, int line)
+{
+    mAppErrors++;
+    printf("APP_ERROR_CHECK 0x%04X at %s:%d\n", (unsigned)errorCode, file, line);
+}
+
+uint32_t sd_ble_uuid_vs_add(const ble_uuid128_t * p_vs_uuid, uint8_t * p_uuid_type)
+{
+    (void)p_vs_uuid;
+    *p_uuid_type = 2; // The first vendor specific type
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gattc_write(uint16_t conn_handle, const ble_gattc_write_params_t * p_write_params)
+{
+    if(mWriteError != NRF_SUCCESS)
+    {
+        uint32_t err_code = mWriteError;
+        mWriteError = NRF_SUCCESS;
+        return err_code;
+    }
+    if(mBusyCount > 0)
+    {
+        mBusyCount--;
+        return NRF_ERROR_BUSY;
+    }
+    if(mWriteOutstanding)
+    {
+        // The client must not get here: it waits for the response
+        mFailures++;
+        printf("FAIL: second write request while one is outstanding\n");
+        return NRF_ERROR_BUSY;
+    }
+    if(conn_handle != CONN_HANDLE || p_write_params->write_op != BLE_GATT_OP_WRITE_REQ
+        || p_write_params->len != BLE_CCCD_VALUE_LEN || mWriteCount >= MAX_WRITES)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    mWrites[mWriteCount].handle = p_write_params->handle;
+    memcpy(mWrites[mWriteCount].value, p_write_params->p_value, BLE_CCCD_VALUE_LEN);
+    mWriteCount++;
+    mWriteOutstanding = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gattc_char_value_by_uuid_read(uint16_t conn_handle, const ble_uuid_t * p_uuid,
+                                              const ble_gattc_handle_range_t * p_handle_range)
+{
+    (void)conn_handle;
+    mProbes++;
+    mProbeUuid = p_uuid->uuid;
+    mProbeRange = *p_handle_range;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, const ble_gap_conn_params_t * p_conn_params)
+{
+    (void)conn_handle;
+    (void)p_conn_params;
+    return NRF_SUCCESS;
+}
+
+uint32_t ble_db_discovery_evt_register(const ble_uuid_t * p_uuid)
+{
+    (void)p_uuid;
+    return NRF_SUCCESS;
+}
+
+uint32_t ble_db_discovery_start(ble_db_discovery_t * p_db_discovery, uint16_t conn_handle)
+{
+    (void)p_db_discovery;
+    (void)conn_handle;
+    mDiscoveries++;
+    return NRF_SUCCESS;
+}
+
+void Storage_Flash_Init()
+{
+}
+
+bool Storage_Flash_Read(uint16_t key, void * data, uint16_t length)
+{
+    if(key != STORAGE_FLASH_KEY_GLOVE_HANDLES || mFlashLength != length)
+    {
+        return false;
+    }
+    memcpy(data, mFlash, length);
+    return true;
+}
+
+uint32_t Storage_Flash_Write(uint16_t key, const void * data, uint16_t length)
+{
+    if(key != STORAGE_FLASH_KEY_GLOVE_HANDLES || length > sizeof(mFlash))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    memcpy(mFlash, data, length);
+    mFlashLength = length;
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+ ****************Start of Test Helpers ***************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: The application event handler; counts the events.            *
+ *                                                                           *
+ *****************************************************************************/
+static void pOnGloveEvent(const Client_Glove_Event_t * event)
+{
+    switch(event->evt_type)
+    {
+        case Client_Glove_Event_SUBSCRIBED:         mSubscribed++;      break;
+        case Client_Glove_Event_DISCONNECTED:       mDisconnected++;    break;
+        case Client_Glove_Event_CONTROL_UPDATED:    mControlUpdates++;  break;
+        default:                                                        break;
+    }
+}
+
+/*****************************************************************************
+ * Description: Starts a test: empties the flash and the fake, and           *
+ *              initializes the client.                                      *
+ *                                                                           *
+ *****************************************************************************/
+static void pSetUp()
+{
+    static ble_db_discovery_t discovery;
+    Client_Glove_Init_t init = { pOnGloveEvent, &discovery };
+
+    memset(mWrites, 0x00, sizeof(mWrites));
+    mWriteCount = 0;
+    mWriteOutstanding = false;
+    mBusyCount = 0;
+    mWriteError = NRF_SUCCESS;
+    mDiscoveries = 0;
+    mProbes = 0;
+    mAppErrors = 0;
+    mFlashLength = 0;
+    mSubscribed = 0;
+    mDisconnected = 0;
+    mControlUpdates = 0;
+
+    CHECK(Client_Glove_Init(&init) == NRF_SUCCESS);
+}
+
+/*****************************************************************************
+ * Description: Sends the client an event that only has a type and the       *
+ *              connection handle.                                           *
+ *                                                                           *
+ *****************************************************************************/
+static void pSendEvent(uint16_t evtId)
+{
+    ble_evt_t event;
+
+    memset(&event, 0x00, sizeof(event));
+    event.header.evt_id = evtId;
+    event.evt.gap_evt.conn_handle = CONN_HANDLE;
+    Client_Glove_BLEEventHandler(&event);
+}
+
+/*****************************************************************************
+ * Description: Connects to the glove.                                       *
+ *                                                                           *
+ *****************************************************************************/
+static void pConnect()
+{
+    ble_evt_t event;
+
+    memset(&event, 0x00, sizeof(event));
+    event.header.evt_id = BLE_GAP_EVT_CONNECTED;
+    event.evt.gap_evt.conn_handle = CONN_HANDLE;
+    event.evt.gap_evt.params.connected.peer_addr.addr[0] = 0xC3;
+    event.evt.gap_evt.params.connected.peer_addr.addr[5] = 0xE1;
+    Client_Glove_BLEEventHandler(&event);
+}
+
+/*****************************************************************************
+ * Description: Completes the discovery of the glove service, with the       *
+ *              control and stream characteristics.                          *
+ *                                                                           *
+ *****************************************************************************/
+static void pDiscover()
+{
+    ble_db_discovery_evt_t event;
+    ble_gatt_db_char_t * characteristics = event.params.discovered_db.charateristics;
+
+    memset(&event, 0x00, sizeof(event));
+    event.evt_type = BLE_DB_DISCOVERY_COMPLETE;
+    event.conn_handle = CONN_HANDLE;
+    event.params.discovered_db.srv_uuid.uuid = BLE_UUID_GLOVE_SERVICE;
+    event.params.discovered_db.srv_uuid.type = 2;
+    event.params.discovered_db.char_count = 3;
+    characteristics[0].characteristic.uuid.uuid = BLE_UUID_GLOVE_CONTROL_CHARACTERISTC_UUID;
+    characteristics[0].characteristic.handle_value = CONTROL_HANDLE;
+    characteristics[0].cccd_handle = CONTROL_CCCD_HANDLE;
+    characteristics[1].characteristic.uuid.uuid = BLE_UUID_GLOVE_STREAM_CHARACTERISTC_UUID;
+    characteristics[1].characteristic.handle_value = STREAM_HANDLE;
+    characteristics[1].cccd_handle = STREAM_CCCD_HANDLE;
+    characteristics[2].characteristic.uuid.uuid = BLE_UUID_GLOVE_DB_VERSION_CHARACTERISTC_UUID;
+    characteristics[2].characteristic.handle_value = DB_VERSION_HANDLE;
+    characteristics[2].cccd_handle = BLE_GATT_HANDLE_INVALID;
+    Client_Glove_DiscoveryEventHandler(&event);
+}
+
+/*****************************************************************************
+ * Description: The glove responds to the outstanding write request.         *
+ *                                                                           *
+ *****************************************************************************/
+static void pWriteResponse(uint16_t handle, uint16_t gattStatus)
+{
+    ble_evt_t event;
+
+    memset(&event, 0x00, sizeof(event));
+    event.header.evt_id = BLE_GATTC_EVT_WRITE_RSP;
+    event.evt.gattc_evt.conn_handle = CONN_HANDLE;
+    event.evt.gattc_evt.gatt_status = gattStatus;
+    event.evt.gattc_evt.params.write_rsp.handle = handle;
+    mWriteOutstanding = false;
+    Client_Glove_BLEEventHandler(&event);
+}
+
+/*****************************************************************************
+ * Description: The glove responds to the outstanding read by UUID. A        *
+ *              handle of BLE_GATT_HANDLE_INVALID means nothing was found.   *
+ *                                                                           *
+ *****************************************************************************/
+static void pReadResponse(uint16_t handle, uint8_t value)
+{
+    ble_evt_t event;
+
+    memset(&event, 0x00, sizeof(event));
+    event.header.evt_id = BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP;
+    event.evt.gattc_evt.conn_handle = CONN_HANDLE;
+    if(handle == BLE_GATT_HANDLE_INVALID)
+    {
+        event.evt.gattc_evt.gatt_status = BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND;
+    }
+    else
+    {
+        event.evt.gattc_evt.params.char_val_by_uuid_read_rsp.count = 1;
+        event.evt.gattc_evt.params.char_val_by_uuid_read_rsp.value_len = 1;
+        event.evt.gattc_evt.params.char_val_by_uuid_read_rsp.handle_value[0].handle = handle;
+        event.evt.gattc_evt.params.char_val_by_uuid_read_rsp.handle_value[0].p_value = &value;
+    }
+    Client_Glove_BLEEventHandler(&event);
+}
+
+/*****************************************************************************
+ * Description: Connects, discovers and subscribes, so the handles are       *
+ *              cached; then disconnects.                                    *
+ *                                                                           *
+ *****************************************************************************/
+static void pCacheHandles()
+{
+    pSetUp();
+    pConnect();
+    pDiscover();
+    pWriteResponse(CONTROL_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    pWriteResponse(STREAM_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    pSendEvent(BLE_GAP_EVT_DISCONNECTED);
+    mWriteCount = 0;
+    mSubscribed = 0;
+}
+
+/*****************************************************************************
+ * Description: Checks that a read by UUID of one cached handle is the one   *
+ *              in progress.                                                 *
+ *                                                                           *
+ *****************************************************************************/
+static void pCheckProbe(uint8_t count, uint16_t uuid, uint16_t handle, int line)
+{
+    Test_Check(mProbes == count && mProbeUuid == uuid
+               && mProbeRange.start_handle == handle && mProbeRange.end_handle == handle,
+               "probe of the cached handle", line);
+}
+
+/*****************************************************************************
+ ****************Start of Tests **********************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Both CCCD writes are queued together, but only one is sent   *
+ *              at a time, and the next only goes out on the response to the *
+ *              last. The application is told once both are accepted.        *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestBackToBack()
+{
+    pSetUp();
+    pConnect();
+    CHECK(mDiscoveries == 1);
+    pDiscover();
+
+    CHECK(mWriteCount == 1);
+    CHECK(mWrites[0].handle == CONTROL_CCCD_HANDLE);
+    CHECK(mWrites[0].value[0] == BLE_GATT_HVX_NOTIFICATION && mWrites[0].value[1] == 0);
+
+    // Other events don't advance the queue, nor does a response to another
+    // handle
+    pSendEvent(BLE_GATTC_EVT_HVX);
+    pSendEvent(BLE_GAP_EVT_CONN_PARAM_UPDATE);
+    CHECK(mWriteCount == 1);
+    pWriteResponse(STREAM_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    CHECK(mWriteCount == 1);
+    CHECK(mSubscribed == 0);
+
+    pWriteResponse(CONTROL_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    CHECK(mWriteCount == 2);
+    CHECK(mWrites[1].handle == STREAM_CCCD_HANDLE);
+    CHECK(mSubscribed == 0);
+
+    pWriteResponse(STREAM_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    CHECK(mWriteCount == 2);
+    CHECK(mSubscribed == 1);
+
+    // A late, repeated response changes nothing
+    pWriteResponse(STREAM_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    CHECK(mWriteCount == 2);
+    CHECK(mSubscribed == 1);
+    CHECK(mAppErrors == 0);
+}
+
+/*****************************************************************************
+ * Description: A write the SoftDevice is too busy for stays at the head of  *
+ *              the queue, and is sent on a later event.                     *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestRetryBusy()
+{
+    pSetUp();
+    pConnect();
+    // Each write queued tries to send, so two of these are used up there
+    mBusyCount = 3;
+    pDiscover();
+    CHECK(mWriteCount == 0);
+
+    pSendEvent(BLE_GATTC_EVT_HVX); // Still busy
+    CHECK(mWriteCount == 0);
+    pSendEvent(BLE_GATTC_EVT_HVX);
+    CHECK(mWriteCount == 1);
+    CHECK(mWrites[0].handle == CONTROL_CCCD_HANDLE);
+
+    // Busy again for the second write; the response and the end of the
+    // event each try once
+    mBusyCount = 2;
+    pWriteResponse(CONTROL_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    CHECK(mWriteCount == 1);
+    CHECK(mSubscribed == 0);
+    pSendEvent(BLE_GAP_EVT_CONN_PARAM_UPDATE);
+    CHECK(mWriteCount == 2);
+    CHECK(mWrites[1].handle == STREAM_CCCD_HANDLE);
+
+    pWriteResponse(STREAM_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    CHECK(mSubscribed == 1);
+    CHECK(mAppErrors == 0);
+}
+
+/*****************************************************************************
+ * Description: If the glove refuses a write, or the SoftDevice won't send   *
+ *              it, the rest of the queue still goes out but the application *
+ *              is not told the notifications are enabled.                   *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestRefused()
+{
+    pSetUp();
+    pConnect();
+    pDiscover();
+    pWriteResponse(CONTROL_CCCD_HANDLE, BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED);
+    CHECK(mWriteCount == 2);
+    pWriteResponse(STREAM_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    CHECK(mSubscribed == 0);
+
+    pSetUp();
+    pConnect();
+    mWriteError = NRF_ERROR_INVALID_STATE;
+    pDiscover();
+    CHECK(mWriteCount == 1); // The control write was dropped, the stream one sent
+    CHECK(mWrites[0].handle == STREAM_CCCD_HANDLE);
+    pWriteResponse(STREAM_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    CHECK(mSubscribed == 0);
+    CHECK(mAppErrors == 0);
+}
+
+/*****************************************************************************
+ * Description: A disconnect drops the queue: nothing of the old connection  *
+ *              is sent on the next one, a late response is ignored, and a   *
+ *              refused write of the old connection doesn't count.           *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestDisconnect()
+{
+    pSetUp();
+    pConnect();
+    pDiscover();
+    pWriteResponse(CONTROL_CCCD_HANDLE, BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED);
+    CHECK(mWriteCount == 2);
+
+    pSendEvent(BLE_GAP_EVT_DISCONNECTED);
+    CHECK(mDisconnected == 1);
+    pWriteResponse(STREAM_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    pSendEvent(BLE_GATTC_EVT_HVX);
+    CHECK(mWriteCount == 2);
+    CHECK(mSubscribed == 0);
+
+    // The next connection starts with an empty queue
+    mWriteCount = 0;
+    pConnect();
+    CHECK(mWriteCount == 0);
+    CHECK(mProbes == 1); // The handles were cached by the last discovery
+    CHECK(mProbeUuid == BLE_UUID_GLOVE_DB_VERSION_CHARACTERISTC_UUID);
+    CHECK(mDiscoveries == 1);
+    CHECK(mAppErrors == 0);
+}
+
+/*****************************************************************************
+ * Description: On a reconnect, the database version, control and stream     *
+ *              handles are read in turn, and the cached handles are only    *
+ *              used once all three are where they were.                     *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestProbe()
+{
+    pCacheHandles();
+    CHECK(mDiscoveries == 1);
+
+    pConnect();
+    pCheckProbe(1, BLE_UUID_GLOVE_DB_VERSION_CHARACTERISTC_UUID, DB_VERSION_HANDLE, __LINE__);
+    pReadResponse(DB_VERSION_HANDLE, CLIENT_GLOVE_DB_VERSION);
+    pCheckProbe(2, BLE_UUID_GLOVE_CONTROL_CHARACTERISTC_UUID, CONTROL_HANDLE, __LINE__);
+    pReadResponse(CONTROL_HANDLE, 1);
+    pCheckProbe(3, BLE_UUID_GLOVE_STREAM_CHARACTERISTC_UUID, STREAM_HANDLE, __LINE__);
+    CHECK(mWriteCount == 0);
+    pReadResponse(STREAM_HANDLE, 0);
+
+    CHECK(mProbes == 3);
+    CHECK(mDiscoveries == 1);
+    CHECK(mWriteCount == 1);
+    CHECK(mWrites[0].handle == CONTROL_CCCD_HANDLE);
+    pWriteResponse(CONTROL_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    pWriteResponse(STREAM_CCCD_HANDLE, BLE_GATT_STATUS_SUCCESS);
+    CHECK(mSubscribed == 1);
+
+    // A late response is not taken for another probe
+    pReadResponse(STREAM_HANDLE, 0);
+    CHECK(mDiscoveries == 1);
+    CHECK(mAppErrors == 0);
+}
+
+/*****************************************************************************
+ * Description: A glove with another database version, or whose stream       *
+ *              characteristic has moved, is discovered again.               *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestProbeMismatch()
+{
+    pCacheHandles();
+    pConnect();
+    pReadResponse(DB_VERSION_HANDLE, CLIENT_GLOVE_DB_VERSION + 1);
+    CHECK(mProbes == 1);
+    CHECK(mDiscoveries == 2);
+    CHECK(mWriteCount == 0);
+
+    pCacheHandles();
+    pConnect();
+    pReadResponse(DB_VERSION_HANDLE, CLIENT_GLOVE_DB_VERSION);
+    pReadResponse(CONTROL_HANDLE, 1);
+    pReadResponse(BLE_GATT_HANDLE_INVALID, 0); // Nothing at the stream handle
+    CHECK(mProbes == 3);
+    CHECK(mDiscoveries == 2);
+    CHECK(mWriteCount == 0);
+
+    // The discovery that follows enables the notifications
+    pDiscover();
+    CHECK(mWriteCount == 1);
+    CHECK(mAppErrors == 0);
+}
+
+int main()
+{
+    CHECK(CLIENT_GLOVE_STREAM_ENABLED == 1); // Set by the Makefile, for two CCCDs
+
+    pTestBackToBack();
+    pTestRetryBusy();
+    pTestRefused();
+    pTestDisconnect();
+    pTestProbe();
+    pTestProbeMismatch();
+
+    return Test_Check_Summary("Client_Glove");
+}
@@ -0,0 +1,235 @@
+/*****************************************************************************
+* FILENAME: Test_Client_Profile.c                                            *
+*                                                                            *
+* DESCRIPTION: Host test of the connection parameter profiles, see           *
+*              Client_Profile.h: how the vehicle answers the update requests *
+*              of the glove while the SoftDevice is busy with another        *
+*              update. Built and run with "make test" in this directory.     *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "Client_Profile.h"
+#include "Test_Check.h"
+
+#define CONN_HANDLE             0x0021
+
+// The fake SoftDevice
+static uint8_t                  mUpdateCalls;   // Calls of sd_ble_gap_conn_param_update
+static uint8_t                  mUpdatesSent;   // Calls that were accepted
+static ble_gap_conn_params_t    mLastSent;      // Parameters of the last accepted call
+static ble_gap_conn_params_t    mLastAsked;     // Parameters of the last call
+static bool                     mBusy;          // An update is in progress
+static uint32_t                 mUpdateError;   // Error for the next call, if not NRF_SUCCESS
+static uint8_t                  mAppErrors;     // Failed APP_ERROR_CHECKs
+
+/*****************************************************************************
+ ****************Start of Fake Implementations *******************************
+ *****************************************************************************/
+
+void Fake_AppError(uint32_t errorCode, const char * file, int line)
+{
+    mAppErrors++;
+    printf("APP_ERROR_CHECK 0x%04X at %s:%d\n", (unsigned)errorCode, file, line);
+}
+
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, const ble_gap_conn_params_t * p_conn_params)
+{
+    mUpdateCalls++;
+    mLastAsked = *p_conn_params;
+    if(mUpdateError != NRF_SUCCESS)
+    {
+        uint32_t err_code = mUpdateError;
+        mUpdateError = NRF_SUCCESS;
+        return err_code;
+    }
+    if(mBusy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if(conn_handle != CONN_HANDLE)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+
+    mUpdatesSent++;
+    mLastSent = *p_conn_params;
+    mBusy = true;
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+ ****************Start of Test Helpers ***************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Sends a GAP event with connection parameters.                *
+ *                                                                           *
+ *****************************************************************************/
+static void pSendEvent(uint16_t evtId, uint16_t minInterval, uint16_t maxInterval, uint16_t latency)
+{
+    ble_evt_t event;
+    ble_gap_conn_params_t params;
+
+    params.min_conn_interval = minInterval;
+    params.max_conn_interval = maxInterval;
+    params.slave_latency = latency;
+    params.conn_sup_timeout = (uint16_t)CLIENT_PROFILE_IDLE_SUP_TIMEOUT;
+
+    memset(&event, 0x00, sizeof(event));
+    event.header.evt_id = evtId;
+    event.evt.gap_evt.conn_handle = CONN_HANDLE;
+    switch(evtId)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            event.evt.gap_evt.params.connected.conn_params = params;
+            break;
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            event.evt.gap_evt.params.conn_param_update.conn_params = params;
+            mBusy = false; // The update in progress is done
+            break;
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST:
+            event.evt.gap_evt.params.conn_param_update_request.conn_params = params;
+            break;
+        default:
+            break;
+    }
+    Client_Profile_BLEEventHandler(&event);
+}
+
+/*****************************************************************************
+ * Description: Starts a test: connects at the idle interval.                *
+ *                                                                           *
+ *****************************************************************************/
+static void pSetUp()
+{
+    mUpdateCalls = 0;
+    mUpdatesSent = 0;
+    mBusy = false;
+    mUpdateError = NRF_SUCCESS;
+    mAppErrors = 0;
+
+    pSendEvent(BLE_GAP_EVT_CONNECTED, (uint16_t)CLIENT_PROFILE_IDLE_MIN_INTERVAL,
+               (uint16_t)CLIENT_PROFILE_IDLE_MAX_INTERVAL, CLIENT_PROFILE_IDLE_SLAVE_LATENCY);
+}
+
+/*****************************************************************************
+ * Description: The glove sends a control frame with the throttle open.      *
+ *                                                                           *
+ *****************************************************************************/
+static void pDrive(uint32_t timestamp)
+{
+    Client_Glove_Control_t control;
+
+    memset(&control, 0x00, sizeof(control));
+    control.timestamp = timestamp;
+    control.throttle = 50;
+    control.direction = 1;
+    Client_Profile_Update(&control);
+}
+
+/*****************************************************************************
+ ****************Start of Tests **********************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: A request that arrives while the vehicle's own drive update  *
+ *              is in progress is left to that update.                       *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestRequestDuringDriveUpdate()
+{
+    pSetUp();
+    pDrive(1000);
+    CHECK(mUpdatesSent == 1);
+    CHECK(mLastSent.max_conn_interval == (uint16_t)CLIENT_PROFILE_DRIVE_MAX_INTERVAL);
+
+    pSendEvent(BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST, (uint16_t)CLIENT_PROFILE_IDLE_MIN_INTERVAL,
+               (uint16_t)CLIENT_PROFILE_IDLE_MAX_INTERVAL, CLIENT_PROFILE_IDLE_SLAVE_LATENCY);
+    CHECK(mUpdateCalls == 1);
+    CHECK(mAppErrors == 0);
+
+    // The drive update completes, and nothing else is sent
+    pSendEvent(BLE_GAP_EVT_CONN_PARAM_UPDATE, (uint16_t)CLIENT_PROFILE_DRIVE_MIN_INTERVAL,
+               (uint16_t)CLIENT_PROFILE_DRIVE_MAX_INTERVAL, CLIENT_PROFILE_DRIVE_SLAVE_LATENCY);
+    CHECK(mUpdateCalls == 1);
+    CHECK(mAppErrors == 0);
+}
+
+/*****************************************************************************
+ * Description: A reply the SoftDevice is too busy for is not fatal, and is  *
+ *              sent once the update in progress completes.                  *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestBusyReply()
+{
+    ble_gap_conn_params_t reply;
+
+    pSetUp();
+    mBusy = true; // Busy with an update the client did not start
+
+    pSendEvent(BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST, (uint16_t)CLIENT_PROFILE_IDLE_MIN_INTERVAL,
+               (uint16_t)CLIENT_PROFILE_IDLE_MAX_INTERVAL, CLIENT_PROFILE_IDLE_SLAVE_LATENCY);
+    CHECK(mUpdateCalls == 1);
+    CHECK(mUpdatesSent == 0);
+    CHECK(mAppErrors == 0);
+    reply = mLastAsked;
+
+    pSendEvent(BLE_GAP_EVT_CONN_PARAM_UPDATE, (uint16_t)CLIENT_PROFILE_IDLE_MIN_INTERVAL,
+               (uint16_t)CLIENT_PROFILE_IDLE_MAX_INTERVAL, CLIENT_PROFILE_IDLE_SLAVE_LATENCY);
+    CHECK(mUpdateCalls == 2);
+    CHECK(mUpdatesSent == 1);
+    CHECK(memcmp(&mLastSent, &reply, sizeof(reply)) == 0); // The same answer
+    CHECK(mAppErrors == 0);
+
+    // Sent once only
+    pSendEvent(BLE_GAP_EVT_CONN_PARAM_UPDATE, (uint16_t)CLIENT_PROFILE_IDLE_MIN_INTERVAL,
+               (uint16_t)CLIENT_PROFILE_IDLE_MAX_INTERVAL, CLIENT_PROFILE_IDLE_SLAVE_LATENCY);
+    CHECK(mUpdateCalls == 2);
+}
+
+/*****************************************************************************
+ * Description: A busy reply is not sent on the next connection, and other   *
+ *              errors are still checked.                                    *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestDisconnectAndErrors()
+{
+    pSetUp();
+    mBusy = true;
+    pSendEvent(BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST, (uint16_t)CLIENT_PROFILE_IDLE_MIN_INTERVAL,
+               (uint16_t)CLIENT_PROFILE_IDLE_MAX_INTERVAL, CLIENT_PROFILE_IDLE_SLAVE_LATENCY);
+    pSendEvent(BLE_GAP_EVT_DISCONNECTED, 0, 0, 0);
+
+    pSetUp();
+    pSendEvent(BLE_GAP_EVT_CONN_PARAM_UPDATE, (uint16_t)CLIENT_PROFILE_IDLE_MIN_INTERVAL,
+               (uint16_t)CLIENT_PROFILE_IDLE_MAX_INTERVAL, CLIENT_PROFILE_IDLE_SLAVE_LATENCY);
+    CHECK(mUpdateCalls == 0);
+
+    mUpdateError = NRF_ERROR_INVALID_PARAM;
+    pSendEvent(BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST, (uint16_t)CLIENT_PROFILE_IDLE_MIN_INTERVAL,
+               (uint16_t)CLIENT_PROFILE_IDLE_MAX_INTERVAL, CLIENT_PROFILE_IDLE_SLAVE_LATENCY);
+    CHECK(mAppErrors == 1);
+}
+
+int main()
+{
+    pTestRequestDuringDriveUpdate();
+    pTestBusyReply();
+    pTestDisconnectAndErrors();
+
+    return Test_Check_Summary("Client_Profile");
+}
@@ -0,0 +1,182 @@
+/*****************************************************************************
+* FILENAME: NordicSDK.h                                                      *
+*                                                                            *
+* DESCRIPTION: Stands in for the Nordic SDK and SoftDevice headers in the    *
+*              host tests. Only what the tested modules use is declared,     *
+*              with the names and values of SDK12 / S130 (API version 2).    *
+*              The SoftDevice calls are implemented by the test that needs   *
+*              them.                                                         *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef FAKE_NORDIC_SDK_H__
+#define FAKE_NORDIC_SDK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Error codes (nrf_error.h, ble_err.h)
+#define NRF_SUCCESS                         0
+#define NRF_ERROR_NO_MEM                    4
+#define NRF_ERROR_NOT_FOUND                 5
+#define NRF_ERROR_INVALID_STATE             8
+#define NRF_ERROR_INVALID_PARAM             7
+#define NRF_ERROR_NULL                      14
+#define NRF_ERROR_BUSY                      17
+#define BLE_ERROR_INVALID_CONN_HANDLE       0x3002
+
+// A failed APP_ERROR_CHECK is recorded by the test, rather than resetting
+void Fake_AppError(uint32_t errorCode, const char * file, int line);
+#define APP_ERROR_CHECK(err_code) \
+    do { uint32_t _err = (err_code); if(_err != NRF_SUCCESS) { Fake_AppError(_err, __FILE__, __LINE__); } } while(0)
+
+// app_util.h
+#define UNIT_1_25_MS                        1250
+#define UNIT_10_MS                          10000
+#define MSEC_TO_UNITS(TIME, RESOLUTION)     (((TIME) * 1000) / (RESOLUTION))
+
+// ble.h, ble_gap.h, ble_gatt.h, ble_gattc.h
+#define BLE_CONN_HANDLE_INVALID             0xFFFF
+#define BLE_GATT_HANDLE_INVALID             0x0000
+#define BLE_GATT_STATUS_SUCCESS             0x0000
+#define BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED 0x0103
+#define BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND 0x010A
+#define BLE_GATT_HVX_NOTIFICATION           0x01
+#define BLE_GATT_OP_WRITE_REQ               0x01
+#define BLE_GATT_EXEC_WRITE_FLAG_PREPARED_WRITE 0x01
+#define BLE_CCCD_VALUE_LEN                  2
+#define BLE_GAP_ADDR_LEN                    6
+
+enum
+{
+    BLE_GAP_EVT_CONNECTED                   = 0x10,
+    BLE_GAP_EVT_DISCONNECTED                = 0x11,
+    BLE_GAP_EVT_CONN_PARAM_UPDATE           = 0x12,
+    BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST   = 0x1F,
+    BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP = 0x35,
+    BLE_GATTC_EVT_HVX                       = 0x39,
+    BLE_GATTC_EVT_WRITE_RSP                 = 0x38
+};
+
+typedef struct { uint8_t uuid128[16]; } ble_uuid128_t;
+typedef struct { uint16_t uuid; uint8_t type; } ble_uuid_t;
+typedef struct { uint8_t addr_type; uint8_t addr[BLE_GAP_ADDR_LEN]; } ble_gap_addr_t;
+typedef struct
+{
+    uint16_t min_conn_interval;
+    uint16_t max_conn_interval;
+    uint16_t slave_latency;
+    uint16_t conn_sup_timeout;
+} ble_gap_conn_params_t;
+typedef struct { uint16_t start_handle; uint16_t end_handle; } ble_gattc_handle_range_t;
+typedef struct
+{
+    uint8_t         write_op;
+    uint8_t         flags;
+    uint16_t        handle;
+    uint16_t        offset;
+    uint16_t        len;
+    const uint8_t   * p_value;
+} ble_gattc_write_params_t;
+
+typedef struct { ble_gap_addr_t peer_addr; uint8_t role; ble_gap_conn_params_t conn_params; } ble_gap_evt_connected_t;
+typedef struct { uint8_t reason; } ble_gap_evt_disconnected_t;
+typedef struct { ble_gap_conn_params_t conn_params; } ble_gap_evt_conn_param_update_t;
+typedef struct { ble_gap_conn_params_t conn_params; } ble_gap_evt_conn_param_update_request_t;
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        ble_gap_evt_connected_t                 connected;
+        ble_gap_evt_disconnected_t              disconnected;
+        ble_gap_evt_conn_param_update_t         conn_param_update;
+        ble_gap_evt_conn_param_update_request_t conn_param_update_request;
+    } params;
+} ble_gap_evt_t;
+
+typedef struct { uint16_t handle; uint8_t type; uint16_t len; uint8_t data[20]; } ble_gattc_evt_hvx_t;
+typedef struct { uint16_t handle; uint8_t write_op; uint16_t offset; uint16_t len; uint8_t data[1]; } ble_gattc_evt_write_rsp_t;
+typedef struct { uint16_t handle; uint8_t * p_value; } ble_gattc_handle_value_t;
+typedef struct
+{
+    uint16_t                    count;
+    uint16_t                    value_len;
+    ble_gattc_handle_value_t    handle_value[1];
+} ble_gattc_evt_char_val_by_uuid_read_rsp_t;
+typedef struct
+{
+    uint16_t conn_handle;
+    uint16_t gatt_status;
+    uint16_t error_handle;
+    union
+    {
+        ble_gattc_evt_char_val_by_uuid_read_rsp_t char_val_by_uuid_read_rsp;
+        ble_gattc_evt_hvx_t                       hvx;
+        ble_gattc_evt_write_rsp_t                 write_rsp;
+    } params;
+} ble_gattc_evt_t;
+
+typedef struct { uint16_t evt_id; uint16_t evt_len; } ble_evt_hdr_t;
+typedef struct
+{
+    ble_evt_hdr_t header;
+    union
+    {
+        ble_gap_evt_t   gap_evt;
+        ble_gattc_evt_t gattc_evt;
+    } evt;
+} ble_evt_t;
+
+uint32_t sd_ble_uuid_vs_add(const ble_uuid128_t * p_vs_uuid, uint8_t * p_uuid_type);
+uint32_t sd_ble_gattc_write(uint16_t conn_handle, const ble_gattc_write_params_t * p_write_params);
+uint32_t sd_ble_gattc_char_value_by_uuid_read(uint16_t conn_handle, const ble_uuid_t * p_uuid,
+                                              const ble_gattc_handle_range_t * p_handle_range);
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, const ble_gap_conn_params_t * p_conn_params);
+
+// ble_db_discovery.h
+#define BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV   6
+typedef enum
+{
+    BLE_DB_DISCOVERY_COMPLETE,
+    BLE_DB_DISCOVERY_ERROR,
+    BLE_DB_DISCOVERY_SRV_NOT_FOUND,
+    BLE_DB_DISCOVERY_AVAILABLE
+} ble_db_discovery_evt_type_t;
+typedef struct { ble_uuid_t uuid; uint16_t handle_value; } ble_gattc_char_t;
+typedef struct { ble_gattc_char_t characteristic; uint16_t cccd_handle; } ble_gatt_db_char_t;
+typedef struct
+{
+    ble_uuid_t          srv_uuid;
+    uint8_t             char_count;
+    ble_gatt_db_char_t  charateristics[BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV];
+} ble_gatt_db_srv_t;
+typedef struct
+{
+    ble_db_discovery_evt_type_t evt_type;
+    uint16_t                    conn_handle;
+    union
+    {
+        ble_gatt_db_srv_t discovered_db;
+        uint32_t          err_code;
+    } params;
+} ble_db_discovery_evt_t;
+typedef struct { uint8_t discoveries; } ble_db_discovery_t;
+
+uint32_t ble_db_discovery_evt_register(const ble_uuid_t * p_uuid);
+uint32_t ble_db_discovery_start(ble_db_discovery_t * p_db_discovery, uint16_t conn_handle);
+
+#endif /* FAKE_NORDIC_SDK_H__ */
@@ -0,0 +1,212 @@
+/*****************************************************************************
+* FILENAME: Link_Frame.c                                                     *
+*                                                                            *
+* DESCRIPTION: The frames of the SPI link, see Link_Frame.h.                 *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include "Link_Frame.h"
+
+#include <string.h>
+
+// Constants
+#define CRC_INITIAL         0xFFFF
+#define CRC_POLYNOMIAL      0x1021
+
+// Header bytes
+#define HEADER_SYNC         0
+#define HEADER_VERSION      1
+#define HEADER_TYPE         2
+#define HEADER_SEQUENCE     3
+#define HEADER_LENGTH       4
+
+// Private functions
+static uint16_t pCrc16(const uint8_t * data, uint16_t length); // CRC of the bytes
+
+/*****************************************************************************
+ ****************Start of Public Function Implementations ********************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: Builds a frame around a payload.                             *
+ *                                                                           *
+ * Returns: The length of the frame, or 0 if the payload is too long         *
+ *                                                                           *
+ * Parameters: buffer   -> where to build the frame, LINK_FRAME_MAX_LEN long *
+ *             type     -> LINK_FRAME_TYPE_...                               *
+ *             sequence -> sequence number of the frame                      *
+ *             payload  -> the payload, can be NULL if length is 0           *
+ *             length   -> the payload length                                *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t Link_Frame_Encode(uint8_t * buffer, uint8_t type, uint8_t sequence,
+                          const uint8_t * payload, uint8_t length)
+{
+    if(length > LINK_FRAME_MAX_PAYLOAD)
+    {
+        return 0;
+    }
+
+    buffer[HEADER_SYNC]     = LINK_FRAME_SYNC;
+    buffer[HEADER_VERSION]  = LINK_FRAME_VERSION;
+    buffer[HEADER_TYPE]     = type;
+    buffer[HEADER_SEQUENCE] = sequence;
+    buffer[HEADER_LENGTH]   = length;
+
+    // The payload may already be in place
+    if(length > 0 && payload != &buffer[LINK_FRAME_HEADER_LEN])
+    {
+        memmove(&buffer[LINK_FRAME_HEADER_LEN], payload, length);
+    }
+
+    uint8_t crcOffset = LINK_FRAME_HEADER_LEN + length;
+    Link_Frame_PutUInt16(&buffer[crcOffset], pCrc16(buffer, crcOffset));
+
+    return crcOffset + LINK_FRAME_CRC_LEN;
+}
+
+/*****************************************************************************
+ * Description: Works out the length of a frame from its header, so that     *
+ *              the controller knows how many bytes to clock in.             *
+ *                                                                           *
+ * Returns: The length of the whole frame, or 0 if the header is not valid   *
+ *                                                                           *
+ * Parameters: header -> the first LINK_FRAME_HEADER_LEN bytes received      *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t Link_Frame_Length(const uint8_t * header)
+{
+    if(header[HEADER_SYNC] != LINK_FRAME_SYNC
+        || header[HEADER_VERSION] != LINK_FRAME_VERSION
+        || header[HEADER_LENGTH] > LINK_FRAME_MAX_PAYLOAD)
+    {
+        return 0;
+    }
+
+    return LINK_FRAME_HEADER_LEN + header[HEADER_LENGTH] + LINK_FRAME_CRC_LEN;
+}
+
+/*****************************************************************************
+ * Description: Checks and decodes a received frame.                         *
+ *                                                                           *
+ * Returns: Link_Frame_OK, or why the frame was rejected                     *
+ *                                                                           *
+ * Parameters: buffer   -> the bytes received                                *
+ *             received -> the number of bytes received; bytes after the     *
+ *                         frame are ignored                                 *
+ *             type     -> the type of frame expected                        *
+ *             frame    -> the decoded frame, only set if Link_Frame_OK      *
+ *                                                                           *
+ *****************************************************************************/
+Link_Frame_Result_t Link_Frame_Decode(const uint8_t * buffer, uint16_t received,
+                                      uint8_t type, Link_Frame_t * frame)
+{
+    if(received < LINK_FRAME_HEADER_LEN + LINK_FRAME_CRC_LEN
+        || buffer[HEADER_SYNC] != LINK_FRAME_SYNC)
+    {
+        return Link_Frame_ERROR_SYNC;
+    }
+    if(buffer[HEADER_VERSION] != LINK_FRAME_VERSION)
+    {
+        return Link_Frame_ERROR_VERSION;
+    }
+
+    // The CRC is checked before the type, so a corrupted type byte is
+    // counted as corruption.
+    uint8_t length = buffer[HEADER_LENGTH];
+    if(length > LINK_FRAME_MAX_PAYLOAD
+        || received < (uint16_t)(LINK_FRAME_HEADER_LEN + length + LINK_FRAME_CRC_LEN))
+    {
+        return Link_Frame_ERROR_LENGTH;
+    }
+
+    uint8_t crcOffset = LINK_FRAME_HEADER_LEN + length;
+    if(Link_Frame_GetUInt16(&buffer[crcOffset]) != pCrc16(buffer, crcOffset))
+    {
+        return Link_Frame_ERROR_CRC;
+    }
+    if(buffer[HEADER_TYPE] != type)
+    {
+        return Link_Frame_ERROR_TYPE;
+    }
+
+    frame->type     = buffer[HEADER_TYPE];
+    frame->sequence = buffer[HEADER_SEQUENCE];
+    frame->length   = length;
+    frame->payload  = &buffer[LINK_FRAME_HEADER_LEN];
+
+    return Link_Frame_OK;
+}
+
+/*****************************************************************************
+ * Description: Writes a value to a buffer, low byte first.                  *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: buffer -> where to write the value                            *
+ *             value  -> the value to write                                  *
+ *                                                                           *
+ *****************************************************************************/
+void Link_Frame_PutUInt16(uint8_t * buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)(value & 0xFF);
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+/*****************************************************************************
+ * Description: Reads a value from a buffer, low byte first.                 *
+ *                                                                           *
+ * Returns: The value                                                        *
+ *                                                                           *
+ * Parameters: buffer -> where to read the value from                        *
+ *                                                                           *
+ *****************************************************************************/
+uint16_t Link_Frame_GetUInt16(const uint8_t * buffer)
+{
+    return (uint16_t)buffer[0] | ((uint16_t)buffer[1] << 8);
+}
+
+/*****************************************************************************
+ ****************Start of Private Function Implementations *******************
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Description: CRC-16/CCITT of some bytes, a bit at a time. The frames are  *
+ *              short enough that a table is not worth its flash.            *
+ *                                                                           *
+ * Returns: The CRC                                                          *
+ *                                                                           *
+ * Parameters: data   -> the bytes                                           *
+ *             length -> the number of bytes                                 *
+ *                                                                           *
+ *****************************************************************************/
+static uint16_t pCrc16(const uint8_t * data, uint16_t length)
+{
+    uint16_t crc = CRC_INITIAL;
+    uint16_t i;
+    uint8_t  bit;
+
+    // Declared above, as the controller build is not C99
+    for(i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for(bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ CRC_POLYNOMIAL) : (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
@@ -0,0 +1,167 @@
+/*****************************************************************************
+* FILENAME: Link_Frame.h                                                     *
+*                                                                            *
+* DESCRIPTION: The frames of the SPI link between the vehicle BLE board      *
+*              (SPI slave) and the A* controller (SPI master). Shared by     *
+*              both builds, so it only uses the standard integer types.      *
+*                                                                            *
+*              Every transfer is full duplex: while the controller clocks in *
+*              a command frame from the BLE board, it clocks out a telemetry *
+*              frame of its own. The controller reads the header first, and  *
+*              then clocks as many bytes as the longer of the two frames.    *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef LINK_FRAME_H__
+#define LINK_FRAME_H__
+
+#include <stdint.h>
+
+// The frame. All values are little endian:
+//      byte 0      LINK_FRAME_SYNC
+//      byte 1      LINK_FRAME_VERSION
+//      byte 2      type (LINK_FRAME_TYPE_...)
+//      byte 3      sequence number, incremented for every frame built
+//      byte 4      payload length
+//      bytes 5...  payload
+//      last 2      CRC-16/CCITT (0x1021, from 0xFFFF) of all the bytes before
+// A receiver that sees a bad frame keeps its last good values; the CRC
+// also catches a board that is not driving the line (all 0x00 or 0xFF).
+#define LINK_FRAME_SYNC                 0xA5
+#define LINK_FRAME_VERSION              2
+#define LINK_FRAME_TYPE_COMMAND         0x01 // BLE board to controller
+#define LINK_FRAME_TYPE_TELEMETRY       0x02 // Controller to BLE board
+#define LINK_FRAME_HEADER_LEN           5
+#define LINK_FRAME_CRC_LEN              2
+#define LINK_FRAME_MAX_PAYLOAD          (LINK_COMMAND_STREAM + (LINK_STREAM_MAX_FRAMES * LINK_STREAM_FRAME_LEN))
+#define LINK_FRAME_MAX_LEN              (LINK_FRAME_HEADER_LEN + LINK_FRAME_MAX_PAYLOAD + LINK_FRAME_CRC_LEN)
+
+// The command payload
+//      bytes 0-1   pitch of the glove in whole degrees (int16)
+//      byte 2      direction: forward(1) or backward(0)
+//      byte 3      throttle, 0 to 100
+//      byte 4      publish count: incremented whenever the glove sends the
+//                  BLE board something new (wraps). Unlike the sequence
+//                  number it stays the same while the glove is silent, so
+//                  the controller can tell a lost glove from a busy link.
+//      byte 5      raw IMU stream frames in this command
+//      byte 6      stream frames the BLE board dropped (wraps)
+//      bytes 7...  the stream frames, LINK_STREAM_FRAME_LEN bytes each
+#define LINK_COMMAND_PITCH              0
+#define LINK_COMMAND_DIRECTION          2
+#define LINK_COMMAND_THROTTLE           3
+#define LINK_COMMAND_PUBLISHED          4
+#define LINK_COMMAND_STREAM_COUNT       5
+#define LINK_COMMAND_STREAM_DROPPED     6
+#define LINK_COMMAND_STREAM             7
+#define LINK_STREAM_FRAME_LEN           20
+#define LINK_STREAM_MAX_FRAMES          3
+
+// The telemetry payload
+//      byte 0      sequence number of the last good command frame
+//      byte 1      command frames the controller rejected (wraps)
+//      byte 2      left motor duty cycle
+//      byte 3      right motor duty cycle
+//      bytes 4-5   distance to the nearest obstacle ahead in cm (uint16)
+#define LINK_TELEMETRY_ACK              0
+#define LINK_TELEMETRY_ERRORS           1
+#define LINK_TELEMETRY_LEFT_DUTY        2
+#define LINK_TELEMETRY_RIGHT_DUTY       3
+#define LINK_TELEMETRY_DISTANCE         4
+#define LINK_TELEMETRY_LEN              6
+
+// The results of decoding a frame
+typedef enum
+{
+    Link_Frame_OK = 0,
+    Link_Frame_ERROR_SYNC,      // No frame, or not the start of one
+    Link_Frame_ERROR_VERSION,   // Built by another version of the link
+    Link_Frame_ERROR_TYPE,      // Not the type expected
+    Link_Frame_ERROR_LENGTH,    // Longer than a frame can be, or cut short
+    Link_Frame_ERROR_CRC        // Corrupted
+} Link_Frame_Result_t;
+
+// A decoded frame. The payload points into the buffer it was decoded from.
+typedef struct
+{
+    uint8_t         type;       // LINK_FRAME_TYPE_...
+    uint8_t         sequence;   // Sequence number of the frame
+    uint8_t         length;     // Payload length
+    const uint8_t   * payload;  // The payload
+} Link_Frame_t;
+
+/*****************************************************************************
+ * Description: Builds a frame around a payload.                             *
+ *                                                                           *
+ * Returns: The length of the frame, or 0 if the payload is too long         *
+ *                                                                           *
+ * Parameters: buffer   -> where to build the frame, LINK_FRAME_MAX_LEN long *
+ *             type     -> LINK_FRAME_TYPE_...                               *
+ *             sequence -> sequence number of the frame                      *
+ *             payload  -> the payload, can be NULL if length is 0           *
+ *             length   -> the payload length                                *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t Link_Frame_Encode(uint8_t * buffer, uint8_t type, uint8_t sequence,
+                          const uint8_t * payload, uint8_t length);
+
+/*****************************************************************************
+ * Description: Works out the length of a frame from its header, so that     *
+ *              the controller knows how many bytes to clock in.             *
+ *                                                                           *
+ * Returns: The length of the whole frame, or 0 if the header is not valid   *
+ *                                                                           *
+ * Parameters: header -> the first LINK_FRAME_HEADER_LEN bytes received      *
+ *                                                                           *
+ *****************************************************************************/
+uint8_t Link_Frame_Length(const uint8_t * header);
+
+/*****************************************************************************
+ * Description: Checks and decodes a received frame.                         *
+ *                                                                           *
+ * Returns: Link_Frame_OK, or why the frame was rejected                     *
+ *                                                                           *
+ * Parameters: buffer   -> the bytes received                                *
+ *             received -> the number of bytes received; bytes after the     *
+ *                         frame are ignored                                 *
+ *             type     -> the type of frame expected                        *
+ *             frame    -> the decoded frame, only set if Link_Frame_OK      *
+ *                                                                           *
+ *****************************************************************************/
+Link_Frame_Result_t Link_Frame_Decode(const uint8_t * buffer, uint16_t received,
+                                      uint8_t type, Link_Frame_t * frame);
+
+/*****************************************************************************
+ * Description: Writes a value to a buffer, low byte first.                  *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: buffer -> where to write the value                            *
+ *             value  -> the value to write                                  *
+ *                                                                           *
+ *****************************************************************************/
+void Link_Frame_PutUInt16(uint8_t * buffer, uint16_t value);
+
+/*****************************************************************************
+ * Description: Reads a value from a buffer, low byte first.                 *
+ *                                                                           *
+ * Returns: The value                                                        *
+ *                                                                           *
+ * Parameters: buffer -> where to read the value from                        *
+ *                                                                           *
+ *****************************************************************************/
+uint16_t Link_Frame_GetUInt16(const uint8_t * buffer);
+
+#endif /* LINK_FRAME_H__ */
@@ -0,0 +1,69 @@
+/*****************************************************************************
+* FILENAME: Test_Check.h                                                     *
+*                                                                            *
+* DESCRIPTION: The checks of the host tests, shared by the tests of the      *
+*              vehicle and of the glove. Included once, by the file with the *
+*              test's main(), which ends with Test_Check_Summary.            *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#ifndef TEST_CHECK_H__
+#define TEST_CHECK_H__
+
+#include <stdio.h>
+
+// Counts a failed check, and says where it was
+#define CHECK(condition) Test_Check((condition), #condition, __LINE__)
+
+// The checks so far, and how many failed. A fake can count a failure of its
+// own in mFailures.
+static int mChecks = 0;
+static int mFailures = 0;
+
+/*****************************************************************************
+ * Description: Records the result of a check.                               *
+ *                                                                           *
+ * Returns: None                                                             *
+ *                                                                           *
+ * Parameters: passed    -> the result of the check                          *
+ *             condition -> the check, as written                            *
+ *             line      -> the line of the check                            *
+ *                                                                           *
+ *****************************************************************************/
+static void Test_Check(int passed, const char * condition, int line)
+{
+    mChecks++;
+    if(!passed)
+    {
+        mFailures++;
+        printf("FAIL line %d: %s\n", line, condition);
+    }
+}
+
+/*****************************************************************************
+ * Description: Prints the checks and failures of a test.                    *
+ *                                                                           *
+ * Returns: The exit code of the test: 0 if no check failed                  *
+ *                                                                           *
+ * Parameters: name -> the module tested                                     *
+ *                                                                           *
+ *****************************************************************************/
+static int Test_Check_Summary(const char * name)
+{
+    printf("%s: %d checks, %d failed\n", name, mChecks, mFailures);
+    return (mFailures == 0) ? 0 : 1;
+}
+
+#endif /* TEST_CHECK_H__ */
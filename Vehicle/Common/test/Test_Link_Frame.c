@@ -0,0 +1,214 @@
+/*****************************************************************************
+* FILENAME: Test_Link_Frame.c                                                *
+*                                                                            *
+* DESCRIPTION: Host test of the SPI link frames, see Link_Frame.h. Built     *
+*              and run with "make test" in this directory.                   *
+*                                                                            *
+* AUTHOR:  Brian Nordland                                                    *
+*                                                                            *
+* LICENSE: The MIT License (MIT)                                             *
+*          Copyright (c) 2017 Brian Nordland                                 *
+*                                                                            *
+*                                                                            *
+* ------------------------------------------------------------------------   *
+* | Change  | Date     |            |                                     |  *
+* | Flag    | (DDMYY)  | Author     | Description                         |  *
+* |---------|----------|------------|-------------------------------------   *
+* | None    | 17Oct26  | BNordland  | Initial creation                    |  *
+*  ------------------------------------------------------------------------  *
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "Link_Frame.h"
+#include "Test_Check.h"
+
+/*****************************************************************************
+ * Description: Builds a full command frame, with every stream frame.        *
+ *                                                                           *
+ * Returns: The length of the frame                                          *
+ *                                                                           *
+ * Parameters: buffer   -> where to build the frame                          *
+ *             sequence -> sequence number of the frame                      *
+ *                                                                           *
+ *****************************************************************************/
+static uint8_t pBuildCommand(uint8_t * buffer, uint8_t sequence)
+{
+    uint8_t payload[LINK_FRAME_MAX_PAYLOAD];
+    uint8_t i;
+
+    for(i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = (uint8_t)(i * 7 + 3);
+    }
+    Link_Frame_PutUInt16(&payload[LINK_COMMAND_PITCH], (uint16_t)-45);
+    payload[LINK_COMMAND_STREAM_COUNT] = LINK_STREAM_MAX_FRAMES;
+
+    return Link_Frame_Encode(buffer, LINK_FRAME_TYPE_COMMAND, sequence, payload, sizeof(payload));
+}
+
+/*****************************************************************************
+ * Description: A frame decodes to what was encoded, with the CRC of the     *
+ *              standard CRC-16/CCITT-FALSE.                                 *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestRoundTrip()
+{
+    // Worked out by hand: CRC-16/CCITT-FALSE of A5 02 01 07 03 31 32 33
+    const uint8_t expected[] = { 0xA5, LINK_FRAME_VERSION, LINK_FRAME_TYPE_COMMAND, 0x07, 0x03,
+                                 0x31, 0x32, 0x33, 0x70, 0xB1 };
+    uint8_t buffer[LINK_FRAME_MAX_LEN + 4];
+    Link_Frame_t frame;
+
+    CHECK(LINK_FRAME_VERSION == 2);
+    CHECK(Link_Frame_Encode(buffer, LINK_FRAME_TYPE_COMMAND, 7, (const uint8_t *)"123", 3) == sizeof(expected));
+    CHECK(memcmp(buffer, expected, sizeof(expected)) == 0);
+    CHECK(Link_Frame_Length(buffer) == sizeof(expected));
+
+    // The longest frame, with bytes after it that must be ignored
+    memset(buffer, 0xEE, sizeof(buffer));
+    CHECK(pBuildCommand(buffer, 200) == LINK_FRAME_MAX_LEN);
+    CHECK(Link_Frame_Length(buffer) == LINK_FRAME_MAX_LEN);
+    CHECK(Link_Frame_Decode(buffer, sizeof(buffer), LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_OK);
+    CHECK(frame.type == LINK_FRAME_TYPE_COMMAND);
+    CHECK(frame.sequence == 200);
+    CHECK(frame.length == LINK_FRAME_MAX_PAYLOAD);
+    CHECK(frame.payload == &buffer[LINK_FRAME_HEADER_LEN]);
+    CHECK((int16_t)Link_Frame_GetUInt16(&frame.payload[LINK_COMMAND_PITCH]) == -45);
+    CHECK(frame.payload[LINK_COMMAND_STREAM_COUNT] == LINK_STREAM_MAX_FRAMES);
+    CHECK(frame.payload[LINK_FRAME_MAX_PAYLOAD - 1] == (uint8_t)((LINK_FRAME_MAX_PAYLOAD - 1) * 7 + 3));
+
+    // A payload built in place, as the BLE board does
+    buffer[LINK_FRAME_HEADER_LEN] = 0x5A;
+    CHECK(Link_Frame_Encode(buffer, LINK_FRAME_TYPE_TELEMETRY, 1, &buffer[LINK_FRAME_HEADER_LEN], 1)
+          == LINK_FRAME_HEADER_LEN + 1 + LINK_FRAME_CRC_LEN);
+    CHECK(Link_Frame_Decode(buffer, LINK_FRAME_HEADER_LEN + 1 + LINK_FRAME_CRC_LEN,
+                            LINK_FRAME_TYPE_TELEMETRY, &frame) == Link_Frame_OK);
+    CHECK(frame.payload[0] == 0x5A);
+
+    // An empty payload, and one that is too long to build
+    CHECK(Link_Frame_Encode(buffer, LINK_FRAME_TYPE_TELEMETRY, 0, NULL, 0) == LINK_FRAME_HEADER_LEN + LINK_FRAME_CRC_LEN);
+    CHECK(Link_Frame_Decode(buffer, LINK_FRAME_HEADER_LEN + LINK_FRAME_CRC_LEN,
+                            LINK_FRAME_TYPE_TELEMETRY, &frame) == Link_Frame_OK);
+    CHECK(frame.length == 0);
+    CHECK(Link_Frame_Encode(buffer, LINK_FRAME_TYPE_TELEMETRY, 0, buffer, LINK_FRAME_MAX_PAYLOAD + 1) == 0);
+
+    CHECK(Link_Frame_GetUInt16((const uint8_t *)"\x34\x12") == 0x1234);
+}
+
+/*****************************************************************************
+ * Description: Every single bit flipped anywhere in a frame is caught,      *
+ *              whichever byte it is in.                                     *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestCorruption()
+{
+    uint8_t buffer[LINK_FRAME_MAX_LEN];
+    uint8_t length = pBuildCommand(buffer, 9);
+    Link_Frame_t frame;
+    int caught = 0;
+    int flips = 0;
+    uint8_t i;
+    uint8_t bit;
+
+    for(i = 0; i < length; i++)
+    {
+        for(bit = 0; bit < 8; bit++)
+        {
+            buffer[i] ^= (uint8_t)(1 << bit);
+            caught += (Link_Frame_Decode(buffer, length, LINK_FRAME_TYPE_COMMAND, &frame) != Link_Frame_OK);
+            flips++;
+            buffer[i] ^= (uint8_t)(1 << bit);
+        }
+    }
+    CHECK(caught == flips);
+
+    // Flips in the payload and the CRC are reported as corruption
+    buffer[LINK_FRAME_HEADER_LEN + 10] ^= 0x10;
+    CHECK(Link_Frame_Decode(buffer, length, LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_ERROR_CRC);
+    buffer[LINK_FRAME_HEADER_LEN + 10] ^= 0x10;
+    buffer[length - 1] ^= 0x80;
+    CHECK(Link_Frame_Decode(buffer, length, LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_ERROR_CRC);
+    buffer[length - 1] ^= 0x80;
+
+    // A line nobody drives reads as all 0x00 or all 0xFF
+    memset(buffer, 0x00, sizeof(buffer));
+    CHECK(Link_Frame_Decode(buffer, sizeof(buffer), LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_ERROR_SYNC);
+    CHECK(Link_Frame_Length(buffer) == 0);
+    memset(buffer, 0xFF, sizeof(buffer));
+    CHECK(Link_Frame_Decode(buffer, sizeof(buffer), LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_ERROR_SYNC);
+    CHECK(Link_Frame_Length(buffer) == 0);
+
+    // Another version of the link
+    length = pBuildCommand(buffer, 9);
+    buffer[1] = LINK_FRAME_VERSION - 1;
+    CHECK(Link_Frame_Decode(buffer, length, LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_ERROR_VERSION);
+    CHECK(Link_Frame_Length(buffer) == 0);
+}
+
+/*****************************************************************************
+ * Description: A transfer cut short at any byte is rejected.                *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestTruncated()
+{
+    uint8_t buffer[LINK_FRAME_MAX_LEN];
+    uint8_t length = pBuildCommand(buffer, 11);
+    Link_Frame_t frame;
+    uint16_t received;
+
+    CHECK(Link_Frame_Decode(buffer, 0, LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_ERROR_SYNC);
+    CHECK(Link_Frame_Decode(buffer, LINK_FRAME_HEADER_LEN + 1, LINK_FRAME_TYPE_COMMAND, &frame)
+          == Link_Frame_ERROR_SYNC);
+    for(received = LINK_FRAME_HEADER_LEN + LINK_FRAME_CRC_LEN; received < length; received++)
+    {
+        CHECK(Link_Frame_Decode(buffer, received, LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_ERROR_LENGTH);
+    }
+    CHECK(Link_Frame_Decode(buffer, length, LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_OK);
+}
+
+/*****************************************************************************
+ * Description: A length byte longer than any payload is rejected, even if   *
+ *              the CRC over it is right, so nothing reads past the buffer.  *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestLongLength()
+{
+    uint8_t buffer[LINK_FRAME_MAX_LEN];
+    uint8_t length = pBuildCommand(buffer, 13);
+    Link_Frame_t frame;
+
+    buffer[4] = LINK_FRAME_MAX_PAYLOAD + 1;
+    CHECK(Link_Frame_Length(buffer) == 0);
+    CHECK(Link_Frame_Decode(buffer, length, LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_ERROR_LENGTH);
+    buffer[4] = 0xFF;
+    CHECK(Link_Frame_Length(buffer) == 0);
+    CHECK(Link_Frame_Decode(buffer, 0xFFFF, LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_ERROR_LENGTH);
+}
+
+/*****************************************************************************
+ * Description: A good frame of the other type is rejected for its type.     *
+ *                                                                           *
+ *****************************************************************************/
+static void pTestWrongType()
+{
+    uint8_t buffer[LINK_FRAME_MAX_LEN];
+    uint8_t length = pBuildCommand(buffer, 15);
+    Link_Frame_t frame;
+
+    memset(&frame, 0x00, sizeof(frame));
+    CHECK(Link_Frame_Decode(buffer, length, LINK_FRAME_TYPE_TELEMETRY, &frame) == Link_Frame_ERROR_TYPE);
+    CHECK(frame.payload == NULL); // Only set for a good frame
+    CHECK(Link_Frame_Decode(buffer, length, LINK_FRAME_TYPE_COMMAND, &frame) == Link_Frame_OK);
+}
+
+int main()
+{
+    pTestRoundTrip();
+    pTestCorruption();
+    pTestTruncated();
+    pTestLongLength();
+    pTestWrongType();
+
+    return Test_Check_Summary("Link_Frame");
+}